@@ -55,6 +55,10 @@ private:
     bool isMiddleDragging;
     bool isAltPressed;
     
+    // Marquee selection (left drag with the select tool)
+    bool isMarqueeSelecting;
+    double marqueeStartX, marqueeStartY;
+    
     // Mouse state
     double lastX, lastY;
     bool firstMouse;
@@ -92,6 +96,7 @@ private:
     Vec3 GetCameraRight() const;
     Vec3 GetCameraUp() const;
     void GetEditorViewMatrix(float* mat);
+    void GetEditorProjectionMatrix(float* mat, float aspect);
     
     // GLFW callbacks
     static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -0,0 +1,118 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/gl.h>
+#include <cstddef>
+
+// Shadow copy of the GL bindings the Renderer changes. Each setter only
+// reaches the driver when the value differs from the last one it set, and
+// counts the calls it issued and filtered per frame.
+//
+// The shadow cannot see changes made behind its back, so it is forgotten
+// at the start of every frame (ImGui and texture uploads bind things
+// between frames) and whenever an object that might be bound is deleted.
+class GLState {
+public:
+    struct Counts {
+        size_t issued = 0;
+        size_t filtered = 0;
+    };
+
+    static const GLuint TEXTURE_UNITS = 16;
+    static const GLuint UNIFORM_BINDINGS = 8;
+
+    GLState() { Invalidate(); }
+
+    void Invalidate() {
+        program = vertexArray = arrayBuffer = uniformBuffer = activeUnit = UNKNOWN;
+        for (GLuint& texture : textures) texture = UNKNOWN;
+        for (GLuint& buffer : uniformBindings) buffer = UNKNOWN;
+        polygonMode = UNKNOWN;
+        lineWidth = -1.0f;
+    }
+
+    // Closes the current frame's counts and forgets the shadow
+    void NextFrame() {
+        lastFrame = frame;
+        frame = Counts();
+        Invalidate();
+    }
+
+    const Counts& LastFrame() const { return lastFrame; }
+
+    void UseProgram(GLuint id) {
+        if (Changed(program, id)) glUseProgram(id);
+    }
+
+    // The element buffer binding belongs to the VAO, so it is not shadowed
+    // here; bind it once while setting the VAO up
+    void BindVertexArray(GLuint id) {
+        if (Changed(vertexArray, id)) glBindVertexArray(id);
+    }
+
+    void BindBuffer(GLenum target, GLuint id) {
+        GLuint* shadow = target == GL_ARRAY_BUFFER ? &arrayBuffer
+                       : target == GL_UNIFORM_BUFFER ? &uniformBuffer : nullptr;
+        if (!shadow) {
+            frame.issued++;
+            glBindBuffer(target, id);
+        } else if (Changed(*shadow, id)) {
+            glBindBuffer(target, id);
+        }
+    }
+
+    // Indexed uniform buffer binding; like GL, also sets the generic one
+    void BindUniformBlock(GLuint index, GLuint id) {
+        if (index >= UNIFORM_BINDINGS || Changed(uniformBindings[index], id)) {
+            glBindBufferBase(GL_UNIFORM_BUFFER, index, id);
+            uniformBuffer = id;
+        }
+    }
+
+    // GL_TEXTURE_2D on the given unit; switches the active unit only if
+    // the binding has to change. Counted once per bind: the unit switch
+    // is part of it, not a call of its own
+    void BindTexture(GLuint unit, GLuint id) {
+        if (unit >= TEXTURE_UNITS) {
+            frame.issued++;
+        } else if (!Changed(textures[unit], id)) {
+            return;
+        }
+        if (activeUnit != unit) {
+            activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        glBindTexture(GL_TEXTURE_2D, id);
+    }
+
+    void PolygonMode(GLenum mode) {
+        if (Changed(polygonMode, mode)) glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+
+    void LineWidth(float width) {
+        if (Changed(lineWidth, width)) glLineWidth(width);
+    }
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+
+    template <typename T>
+    bool Changed(T& shadow, T value) {
+        if (shadow == value) {
+            frame.filtered++;
+            return false;
+        }
+        shadow = value;
+        frame.issued++;
+        return true;
+    }
+
+    GLuint program, vertexArray, arrayBuffer, uniformBuffer, activeUnit;
+    GLuint textures[TEXTURE_UNITS];
+    GLuint uniformBindings[UNIFORM_BINDINGS];
+    GLenum polygonMode;
+    float lineWidth;
+    Counts frame, lastFrame;
+};
+
+#endif // GL_STATE_H
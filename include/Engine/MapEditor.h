@@ -54,9 +54,7 @@ private:
     float lastMouseX, lastMouseY;
     float accumulatedDeltaX, accumulatedDeltaY, accumulatedDeltaZ;
     
-    // Multi-selection
-    std::vector<int> selectedBrushIndices;
-    std::vector<int> selectedEntityIndices;
+    // Multi-selection (the sets themselves live in state)
     bool multiSelectMode;
     
     // Clipboard
@@ -77,10 +75,12 @@ private:
     MeasurementPoint measureStart, measureEnd;
     bool isMeasuring;
     
-    // Auto-save
+    // Auto-save: checkpoints append only what changed to a journal next to
+    // the map (see PCDJournal.h)
     std::chrono::steady_clock::time_point lastAutoSave;
     float autoSaveInterval;
     bool autoSaveEnabled;
+    PCD::MapJournal journal;
     
     // Snap settings
     float rotationSnapAngle;
@@ -92,21 +92,9 @@ private:
     std::deque<std::string> recentFiles;
     static const int MAX_RECENT_FILES = 10;
     
-    // Statistics
-    struct MapStats {
-        int totalVertices;
-        int totalTriangles;
-        int totalBrushes;
-        int totalEntities;
-        int totalTextures;
-        PCD::Vec3 mapBoundsMin;
-        PCD::Vec3 mapBoundsMax;
-    } stats;
-
-    struct BrushBounds {
-        PCD::Vec3 min, max, center;
-    };
-
+    // Frustum query results for VisibleBrushes, kept to reuse their storage
+    std::vector<int> visibleBrushes, visibleEntities;
+    
     struct Ray {
         PCD::Vec3 origin;
         PCD::Vec3 direction;
@@ -125,7 +113,7 @@ public:
         , selectionMode(SelectionMode::OBJECT)
         , clipMode(ClipMode::NONE)
         , isMeasuring(false)
-        , autoSaveInterval(300.0f) // 5 minutes
+        , autoSaveInterval(60.0f) // Checkpoints only write the edit, so they can be frequent
         , autoSaveEnabled(true)
         , rotationSnapAngle(15.0f)
         , scaleSnapIncrement(0.25f)
@@ -138,10 +126,18 @@ public:
         lastAutoSave = std::chrono::steady_clock::now();
         measureStart.active = false;
         measureEnd.active = false;
-        UpdateStats();
     }
 
-    ~MapEditor() { delete ui; }
+    ~MapEditor() {
+        // Keep unsaved work recoverable; a saved map needs no journal
+        if (journal.IsOpen() && state.hasUnsavedChanges) {
+            journal.Checkpoint(state.map, state.journalChanges, 0);
+            journal.Close();
+        } else {
+            journal.Discard();
+        }
+        delete ui;
+    }
 void SetUnsavedChanges(bool changed) { 
     state.hasUnsavedChanges = changed; 
 }
@@ -157,12 +153,22 @@ return state.currentTool;
     const PCD::EditorSettings& GetSettings() const { return state.settings; }
     int GetSelectedBrushIndex() const { return state.selectedBrushIndex; }
     int GetSelectedEntityIndex() const { return state.selectedEntityIndex; }
+    const PCD::SelectionSet& GetSelectedBrushes() const { return state.selectedBrushes; }
+    const PCD::SelectionSet& GetSelectedEntities() const { return state.selectedEntities; }
     bool IsCreating() const { return state.isCreating; }
     PCD::Vec3 GetCreateStart() const { return state.createStart; }
     PCD::Vec3 GetCreateEnd() const { return state.createEnd; }
     GizmoMode GetGizmoMode() const { return gizmoMode; }
     SelectionMode GetSelectionMode() const { return selectionMode; }
-    const MapStats& GetStats() const { return stats; }
+    // Brings the totals up to date with the edits since the last call
+    const PCD::MapStats::Totals& GetStats() { return state.stats.Get(state.map, state.pickTree); }
+    // Indices of the brushes inside or crossing the view, ascending, from
+    // the pick tree; valid until the next call
+    const std::vector<int>& VisibleBrushes(const float* view, const float* proj) {
+        state.pickTree.QueryFrustum(state.map, PCD::Frustum::FromViewAndProjection(view, proj), visibleBrushes,
+                                    visibleEntities);
+        return visibleBrushes;
+    }
     
     // Gizmo mode
     void SetGizmoMode(GizmoMode mode) { gizmoMode = mode; }
@@ -177,18 +183,23 @@ return state.currentTool;
             selectedVertexIndices.clear();
         }
     }
+    
+    // For edits made directly through GetMap(), e.g. keyboard nudges
+    void BrushChanged(int index) { state.BrushChanged(index); }
+    void EntityChanged(int index) { state.EntityChanged(index); }
 
     // Actions
-    void NewMap() { 
-        state.NewMap(); 
-        UpdateStats();
-    }
+    void NewMap() { state.NewMap(); }
     
     void SaveMap() {
         if (state.currentFilePath.empty()) {
             state.currentFilePath = "map.pcd";
         }
-        PCD::PCDWriter::Save(state.map, state.currentFilePath);
+        PCD::SaveOptions options;
+        options.threads = 0; // Encode on every core
+        options.packGeometry = state.settings.packGeometry;
+        options.positionPrecision = state.settings.packPrecision;
+        if (!PCD::PCDWriter::Save(state.map, state.currentFilePath, options)) return;
         state.hasUnsavedChanges = false;
         AddRecentFile(state.currentFilePath);
     }
@@ -199,32 +210,45 @@ return state.currentTool;
     }
     
     bool LoadMap(const std::string& path) {
-        if (PCD::PCDReader::Load(state.map, path)) {
+        if (PCD::PCDReader::Load(state.map, path, TextureOnDemand())) {
+            // Undo steps describe edits to the previous map
+            state.history.Clear();
+            state.MapReplaced();
+            state.DeselectAll();
             state.currentFilePath = path;
             state.hasUnsavedChanges = false;
+            // Bring back edits that were autosaved but never saved
+            if (journal.Recover(JournalPath(), state.map, TextureOnDemand(), 0)) {
+                state.journalChanges.Clear();
+                state.hasUnsavedChanges = true;
+            } else {
+                StartJournal(path);
+            }
             AddRecentFile(path);
-            UpdateStats();
             return true;
         }
         return false;
     }
 
-    void Undo() { state.Undo(); UpdateStats(); }
-    void Redo() { state.Redo(); UpdateStats(); }
-    void DeleteSelected() { 
-        state.DeleteSelected(); 
-        UpdateStats();
-    }
-    void DuplicateSelected() { 
-        state.DuplicateSelected(); 
-        UpdateStats();
+    // Replays the journal of a map that was never saved, e.g. after a crash
+    bool RecoverAutoSave() {
+        if (!journal.Recover(JournalPath(), state.map, TextureOnDemand(), 0)) return false;
+        state.history.Clear();
+        state.MapReplaced();
+        state.journalChanges.Clear(); // The journal already holds this map
+        state.DeselectAll();
+        state.hasUnsavedChanges = true;
+        return true;
     }
+
+    void Undo() { state.Undo(); }
+    void Redo() { state.Redo(); }
+    void DeleteSelected() { state.DeleteSelected(); }
+    void DuplicateSelected() { state.DuplicateSelected(); }
     void SelectAll() { state.SelectAll(); }
     
     void DeselectAll() {
         state.DeselectAll();
-        selectedBrushIndices.clear();
-        selectedEntityIndices.clear();
         selectedVertexIndices.clear();
         isManipulating = false;
         isDragging = false;
@@ -272,7 +296,7 @@ return state.currentTool;
         }
         
         // Multi-selection
-        for (int idx : selectedBrushIndices) {
+        for (int idx : state.selectedBrushes) {
             if (idx >= 0 && idx < (int)state.map.brushes.size()) {
                 ClipboardItem item;
                 item.isBrush = true;
@@ -281,7 +305,7 @@ return state.currentTool;
             }
         }
         
-        for (int idx : selectedEntityIndices) {
+        for (int idx : state.selectedEntities) {
             if (idx >= 0 && idx < (int)state.map.entities.size()) {
                 ClipboardItem item;
                 item.isBrush = false;
@@ -313,6 +337,7 @@ return state.currentTool;
                 for (auto& v : newBrush.vertices) {
                     v.position = v.position + offset;
                 }
+                newBrush.TranslateBounds(offset);
                 
                 state.map.brushes.push_back(newBrush);
                 state.selectedBrushIndex = state.map.brushes.size() - 1;
@@ -322,13 +347,12 @@ return state.currentTool;
                 newEnt.name = newEnt.name + "_paste";
                 newEnt.position = newEnt.position + offset;
                 
-                state.map.entities.push_back(newEnt);
+                state.map.AddEntity(std::move(newEnt));
                 state.selectedEntityIndex = state.map.entities.size() - 1;
             }
         }
         
         state.hasUnsavedChanges = true;
-        UpdateStats();
     }
     
     bool HasClipboard() const { return !clipboard.empty(); }
@@ -337,14 +361,17 @@ return state.currentTool;
     void AlignToGrid() {
         if (state.selectedBrushIndex >= 0) {
             state.PushUndo();
+            state.TouchBrush(state.selectedBrushIndex);
             auto& brush = state.map.brushes[state.selectedBrushIndex];
             for (auto& v : brush.vertices) {
                 v.position = state.SnapToGrid(v.position);
             }
+            brush.InvalidateBounds();
             state.hasUnsavedChanges = true;
         }
         if (state.selectedEntityIndex >= 0) {
             state.PushUndo();
+            state.TouchEntity(state.selectedEntityIndex);
             auto& ent = state.map.entities[state.selectedEntityIndex];
             ent.position = state.SnapToGrid(ent.position);
             state.hasUnsavedChanges = true;
@@ -356,18 +383,18 @@ return state.currentTool;
     void AlignSelectedToZ() { AlignSelectedToAxis(2); }
     
     void AlignSelectedToAxis(int axis) {
-        if (selectedBrushIndices.size() < 2 && selectedEntityIndices.size() < 2) return;
+        if (state.selectedBrushes.Size() < 2 && state.selectedEntities.Size() < 2) return;
         
         // Find average position
         float sum = 0;
         int count = 0;
         
-        for (int idx : selectedBrushIndices) {
-            PCD::Vec3 center = GetBrushBounds(state.map.brushes[idx]).center;
+        for (int idx : state.selectedBrushes) {
+            PCD::Vec3 center = state.map.brushes[idx].GetBounds().center;
             sum += (axis == 0 ? center.x : (axis == 1 ? center.y : center.z));
             count++;
         }
-        for (int idx : selectedEntityIndices) {
+        for (int idx : state.selectedEntities) {
             PCD::Vec3 pos = state.map.entities[idx].position;
             sum += (axis == 0 ? pos.x : (axis == 1 ? pos.y : pos.z));
             count++;
@@ -377,10 +404,12 @@ return state.currentTool;
         float avg = sum / count;
         
         state.PushUndo();
+        for (int idx : state.selectedBrushes) state.TouchBrush(idx);
+        for (int idx : state.selectedEntities) state.TouchEntity(idx);
         
-        for (int idx : selectedBrushIndices) {
+        for (int idx : state.selectedBrushes) {
             auto& brush = state.map.brushes[idx];
-            BrushBounds bounds = GetBrushBounds(brush);
+            PCD::BrushBounds bounds = brush.GetBounds();
             float current = (axis == 0 ? bounds.center.x : (axis == 1 ? bounds.center.y : bounds.center.z));
             float delta = avg - current;
             
@@ -389,9 +418,10 @@ return state.currentTool;
                 else if (axis == 1) v.position.y += delta;
                 else v.position.z += delta;
             }
+            brush.TranslateBounds(PCD::Vec3(axis == 0 ? delta : 0, axis == 1 ? delta : 0, axis == 2 ? delta : 0));
         }
         
-        for (int idx : selectedEntityIndices) {
+        for (int idx : state.selectedEntities) {
             auto& ent = state.map.entities[idx];
             if (axis == 0) ent.position.x = avg;
             else if (axis == 1) ent.position.y = avg;
@@ -405,22 +435,24 @@ return state.currentTool;
     void HollowBrush(float thickness = 0.25f) {
         if (state.selectedBrushIndex < 0) return;
         
-        state.PushUndo();
-        
         PCD::Brush& original = state.map.brushes[state.selectedBrushIndex];
-        BrushBounds bounds = GetBrushBounds(original);
+        PCD::BrushBounds bounds = original.GetBounds();
         
         // Create inner bounds
         PCD::Vec3 innerMin(bounds.min.x + thickness, bounds.min.y + thickness, bounds.min.z + thickness);
         PCD::Vec3 innerMax(bounds.max.x - thickness, bounds.max.y - thickness, bounds.max.z - thickness);
         
-        // Check if hollow is possible
+        // Check if hollow is possible, before opening an undo step for it
         if (innerMax.x <= innerMin.x || innerMax.y <= innerMin.y || innerMax.z <= innerMin.z) {
             return; // Too thin to hollow
         }
         
+        state.PushUndo();
+        state.TouchBrush(state.selectedBrushIndex);
+        
         // Delete original and create 6 walls
         state.map.brushes.erase(state.map.brushes.begin() + state.selectedBrushIndex);
+        state.selectedBrushes.Erase(state.selectedBrushIndex);
         
         auto createWall = [this](PCD::Vec3 min, PCD::Vec3 max, const std::string& name) {
             PCD::Brush wall = PCD::BrushFactory::CreateBox(state.map, min, max);
@@ -448,7 +480,6 @@ return state.currentTool;
         
         state.selectedBrushIndex = -1;
         state.hasUnsavedChanges = true;
-        UpdateStats();
     }
     
     void FlipBrushX() { FlipBrush(0); }
@@ -459,8 +490,9 @@ return state.currentTool;
         if (state.selectedBrushIndex < 0) return;
         
         state.PushUndo();
+        state.TouchBrush(state.selectedBrushIndex);
         auto& brush = state.map.brushes[state.selectedBrushIndex];
-        BrushBounds bounds = GetBrushBounds(brush);
+        PCD::BrushBounds bounds = brush.GetBounds();
         
         for (auto& v : brush.vertices) {
             if (axis == 0) {
@@ -475,6 +507,8 @@ return state.currentTool;
             }
         }
         
+        brush.InvalidateBounds();
+        
         // Reverse winding order
         for (size_t i = 0; i < brush.indices.size(); i += 3) {
             std::swap(brush.indices[i + 1], brush.indices[i + 2]);
@@ -487,8 +521,9 @@ return state.currentTool;
         if (state.selectedBrushIndex < 0) return;
         
         state.PushUndo();
+        state.TouchBrush(state.selectedBrushIndex);
         auto& brush = state.map.brushes[state.selectedBrushIndex];
-        BrushBounds bounds = GetBrushBounds(brush);
+        PCD::BrushBounds bounds = brush.GetBounds();
         
         for (auto& v : brush.vertices) {
             PCD::Vec3 rel = v.position - bounds.center;
@@ -517,6 +552,7 @@ return state.currentTool;
             v.position = bounds.center + rel;
             v.normal = relN;
         }
+        brush.InvalidateBounds();
         
         state.hasUnsavedChanges = true;
     }
@@ -589,51 +625,68 @@ return state.currentTool;
 
     // Auto-save
     void CheckAutoSave() {
-        if (!autoSaveEnabled || !state.hasUnsavedChanges) return;
+        if (!autoSaveEnabled) return;
+        journal.PollCompaction();
+        
+        if (!journal.IsOpen()) {
+            // Edits made before the journal existed can't be expressed against
+            // the file on disk, so then the first checkpoint records everything
+            if (!StartJournal(state.hasUnsavedChanges ? std::string() : state.currentFilePath)) {
+                autoSaveEnabled = false;
+                return;
+            }
+        }
+        
+        // Saved, loaded or cleared since the last checkpoint: the file on disk
+        // is the new base and the old journal has nothing left to recover
+        if (!state.hasUnsavedChanges) {
+            if (journal.HasCheckpoints() || journal.Path() != JournalPath()) {
+                journal.Discard();
+                StartJournal(state.currentFilePath);
+            }
+            return;
+        }
         
         auto now = std::chrono::steady_clock::now();
         float elapsed = std::chrono::duration<float>(now - lastAutoSave).count();
         
         if (elapsed >= autoSaveInterval) {
-            std::string autoSavePath = state.currentFilePath.empty() ? 
-                "autosave.pcd" : state.currentFilePath + ".autosave";
-            PCD::PCDWriter::Save(state.map, autoSavePath);
+            PCD::MapJournal::CheckpointStats saved = journal.Checkpoint(state.map, state.journalChanges, 0);
+            state.journalChanges.Clear();
+            if (saved.bytes > 0) {
+                std::cout << "[Editor] Autosaved " << saved.brushesWritten + saved.brushesRemoved << " brush, "
+                          << saved.entitiesWritten + saved.entitiesRemoved << " entity and "
+                          << saved.texturesWritten + saved.texturesRemoved << " texture changes ("
+                          << saved.bytes << " bytes)\n";
+            }
+            if (saved.texturesUnreadable > 0) {
+                std::cerr << "[Editor] Autosave left out " << saved.texturesUnreadable
+                          << " texture(s) whose pixels could not be read; retrying next autosave\n";
+            }
+            journal.StartCompaction();
             lastAutoSave = now;
         }
     }
     
-    void SetAutoSaveEnabled(bool enabled) { autoSaveEnabled = enabled; }
-    void SetAutoSaveInterval(float seconds) { autoSaveInterval = seconds; }
+    // Texture pixels stay in the file until the texture panel, the viewport
+    // stream or an edit asks for them (TextureLoader::EnsurePixels)
+    static PCD::LoadOptions TextureOnDemand() {
+        PCD::LoadOptions options;
+        options.deferTextures = true;
+        return options;
+    }
 
-    // Statistics
-    void UpdateStats() {
-        stats.totalBrushes = state.map.brushes.size();
-        stats.totalEntities = state.map.entities.size();
-        stats.totalTextures = state.map.textures.size();
-        stats.totalVertices = 0;
-        stats.totalTriangles = 0;
-        
-        bool first = true;
-        for (const auto& brush : state.map.brushes) {
-            stats.totalVertices += brush.vertices.size();
-            stats.totalTriangles += brush.indices.size() / 3;
-            
-            for (const auto& v : brush.vertices) {
-                if (first) {
-                    stats.mapBoundsMin = v.position;
-                    stats.mapBoundsMax = v.position;
-                    first = false;
-                } else {
-                    stats.mapBoundsMin.x = std::min(stats.mapBoundsMin.x, v.position.x);
-                    stats.mapBoundsMin.y = std::min(stats.mapBoundsMin.y, v.position.y);
-                    stats.mapBoundsMin.z = std::min(stats.mapBoundsMin.z, v.position.z);
-                    stats.mapBoundsMax.x = std::max(stats.mapBoundsMax.x, v.position.x);
-                    stats.mapBoundsMax.y = std::max(stats.mapBoundsMax.y, v.position.y);
-                    stats.mapBoundsMax.z = std::max(stats.mapBoundsMax.z, v.position.z);
-                }
-            }
-        }
+    std::string JournalPath() const {
+        return (state.currentFilePath.empty() ? std::string("autosave") : state.currentFilePath) + ".journal";
+    }
+    
+    bool StartJournal(const std::string& basePath) {
+        state.journalChanges.Clear();
+        return journal.Start(JournalPath(), basePath, state.map, 0);
     }
+    
+    void SetAutoSaveEnabled(bool enabled) { autoSaveEnabled = enabled; }
+    void SetAutoSaveInterval(float seconds) { autoSaveInterval = seconds; }
 
     // Snap settings
     void SetRotationSnap(float angle) { rotationSnapAngle = angle; }
@@ -684,16 +737,25 @@ return state.currentTool;
                 } else if (state.selectedBrushIndex >= 0 &&
                            state.selectedBrushIndex < (int)state.map.brushes.size()) {
                     auto& brush = state.map.brushes[state.selectedBrushIndex];
-                    BrushBounds bounds = GetBrushBounds(brush);
+                    PCD::BrushBounds bounds = brush.GetBounds();
                     objectStartPos = bounds.center;
                 }
 
                 state.PushUndo();
+                TouchSelection();
                 return;
             }
         }
 
         Ray ray = ScreenPointToRay(screenX, screenY, screenWidth, screenHeight, view, proj);
+        if (state.currentTool == PCD::EditorTool::SELECT ||
+            state.currentTool == PCD::EditorTool::MOVE ||
+            state.currentTool == PCD::EditorTool::ROTATE ||
+            state.currentTool == PCD::EditorTool::SCALE) {
+            SelectByRay(ray, shift);
+            return;
+        }
+
         float t = (state.settings.gridHeight - ray.origin.y) / ray.direction.y;
         PCD::Vec3 worldPos = ray.origin + ray.direction * t;
 
@@ -721,70 +783,18 @@ return state.currentTool;
             {
                 PCD::Entity ent = PCD::BrushFactory::CreateEntity(
                     state.map, state.entityToPlace, clickPos);
-                state.map.entities.push_back(ent);
+                state.map.AddEntity(std::move(ent));
                 state.selectedEntityIndex = state.map.entities.size() - 1;
                 state.hasUnsavedChanges = true;
             }
-            UpdateStats();
             break;
 
         case PCD::EditorTool::SELECT:
         case PCD::EditorTool::MOVE:
         case PCD::EditorTool::ROTATE:
         case PCD::EditorTool::SCALE:
-            if (!shift) {
-                state.DeselectAll();
-                selectedBrushIndices.clear();
-                selectedEntityIndices.clear();
-            }
-
-            // Check entities first
-            for (size_t i = 0; i < state.map.entities.size(); i++) {
-                auto& ent = state.map.entities[i];
-                float dx = ent.position.x - clickPos.x;
-                float dy = ent.position.y - clickPos.y;
-                float dz = ent.position.z - clickPos.z;
-                float dist = sqrt(dx*dx + dy*dy + dz*dz);
-
-                if (dist < 2.0f) {
-                    if (shift) {
-                        auto it = std::find(selectedEntityIndices.begin(), 
-                                           selectedEntityIndices.end(), (int)i);
-                        if (it != selectedEntityIndices.end()) {
-                            selectedEntityIndices.erase(it);
-                        } else {
-                            selectedEntityIndices.push_back(i);
-                        }
-                    }
-                    state.selectedEntityIndex = i;
-                    state.selectedBrushIndex = -1;
-                    return;
-                }
-            }
-
-            // Check brushes
-            for (size_t i = 0; i < state.map.brushes.size(); i++) {
-                auto& brush = state.map.brushes[i];
-                if (!brush.vertices.empty()) {
-                    BrushBounds bounds = GetBrushBounds(brush);
-
-                    if (clickPos.x >= bounds.min.x && clickPos.x <= bounds.max.x &&
-                        clickPos.z >= bounds.min.z && clickPos.z <= bounds.max.z) {
-                        if (shift) {
-                            auto it = std::find(selectedBrushIndices.begin(), 
-                                               selectedBrushIndices.end(), (int)i);
-                            if (it != selectedBrushIndices.end()) {
-                                selectedBrushIndices.erase(it);
-                            } else {
-                                selectedBrushIndices.push_back(i);
-                            }
-                        }
-                        state.selectedBrushIndex = i;
-                        state.selectedEntityIndex = -1;
-                        return;
-                    }
-                }
-            }
+            // No view ray here, so look straight down through the point
+            SelectByRay(Ray{PCD::Vec3(clickPos.x, clickPos.y + 1e4f, clickPos.z), PCD::Vec3(0, -1, 0)}, shift);
             break;
 
         default:
@@ -792,6 +802,35 @@ return state.currentTool;
         }
     }
 
+    // Marquee selection: every brush and entity inside or touching the
+    // screen rectangle (x0, y0)-(x1, y1). With shift they are added to the
+    // current selection instead of replacing it.
+    void SelectInRect(float x0, float y0, float x1, float y1, int screenWidth, int screenHeight,
+                      const float* view, const float* proj, bool shift) {
+        float left = 2.0f * std::min(x0, x1) / screenWidth - 1.0f;
+        float right = 2.0f * std::max(x0, x1) / screenWidth - 1.0f;
+        float bottom = 1.0f - 2.0f * std::max(y0, y1) / screenHeight;
+        float top = 1.0f - 2.0f * std::min(y0, y1) / screenHeight;
+        if (right <= left || top <= bottom) return;
+
+        PCD::Frustum frustum = PCD::Frustum::FromViewAndProjection(view, proj, left, right, bottom, top);
+
+        std::vector<int> brushes, entities;
+        state.pickTree.QueryFrustum(state.map, frustum, brushes, entities);
+
+        if (!shift) DeselectAll();
+        for (int index : brushes) state.selectedBrushes.Add(index, state.BrushID(index));
+        for (int index : entities) state.selectedEntities.Add(index, state.EntityID(index));
+
+        if (!state.selectedBrushes.Empty()) {
+            state.selectedBrushIndex = state.selectedBrushes.Front();
+            state.selectedEntityIndex = -1;
+        } else if (!state.selectedEntities.Empty()) {
+            state.selectedEntityIndex = state.selectedEntities.Front();
+            state.selectedBrushIndex = -1;
+        }
+    }
+
     // FIXED: OnMouseDrag now correctly handles delta values
     void OnMouseDrag(float deltaX, float deltaY, float deltaZ, 
                      float screenDX, float screenDY, bool constrainAxis) {
@@ -883,13 +922,13 @@ return state.currentTool;
 
     void OnMouseRelease() {
         if (isManipulating) {
+            state.CommitUndo();
             isManipulating = false;
             isDragging = false;
             activeAxis = GizmoAxis::NONE;
             accumulatedDeltaX = 0;
             accumulatedDeltaY = 0;
             accumulatedDeltaZ = 0;
-            UpdateStats();
             return;
         }
 
@@ -940,7 +979,6 @@ return state.currentTool;
         state.map.brushes.push_back(newBrush);
         state.selectedBrushIndex = state.map.brushes.size() - 1;
         state.hasUnsavedChanges = true;
-        UpdateStats();
     }
 
     PCD::Brush CreateBox(const PCD::Vec3& min, const PCD::Vec3& max) {
@@ -969,16 +1007,7 @@ return state.currentTool;
             state.selectedBrushIndex < (int)state.map.brushes.size()) {
             auto& brush = state.map.brushes[state.selectedBrushIndex];
             if (!brush.vertices.empty()) {
-                PCD::Vec3 center(0, 0, 0);
-                for (auto& v : brush.vertices) {
-                    center.x += v.position.x;
-                    center.y += v.position.y;
-                    center.z += v.position.z;
-                }
-                center.x /= brush.vertices.size();
-                center.y /= brush.vertices.size();
-                center.z /= brush.vertices.size();
-                return center;
+                return brush.GetBounds().center;
             }
         }
         if (state.selectedEntityIndex >= 0 &&
@@ -989,27 +1018,21 @@ return state.currentTool;
     }
 
 private:
-    BrushBounds GetBrushBounds(const PCD::Brush& brush) const {
-        BrushBounds bounds;
-        if (brush.vertices.empty()) return bounds;
-
-        bounds.min = brush.vertices[0].position;
-        bounds.max = brush.vertices[0].position;
-
-        for (const auto& v : brush.vertices) {
-            bounds.min.x = std::min(bounds.min.x, v.position.x);
-            bounds.min.y = std::min(bounds.min.y, v.position.y);
-            bounds.min.z = std::min(bounds.min.z, v.position.z);
-            bounds.max.x = std::max(bounds.max.x, v.position.x);
-            bounds.max.y = std::max(bounds.max.y, v.position.y);
-            bounds.max.z = std::max(bounds.max.z, v.position.z);
+    // Selects the front-most brush or entity the ray hits. With shift the
+    // hit is toggled in the multi-selection instead.
+    void SelectByRay(const Ray& ray, bool shift) {
+        if (!shift) state.DeselectAll();
+
+        PCD::PickTree::Hit hit = state.pickTree.Raycast(state.map, ray.origin, ray.direction);
+        if (hit.kind == PCD::PickTree::Kind::ENTITY) {
+            if (shift) state.selectedEntities.Toggle(hit.index, state.EntityID(hit.index));
+            state.selectedEntityIndex = hit.index;
+            state.selectedBrushIndex = -1;
+        } else if (hit.kind == PCD::PickTree::Kind::BRUSH) {
+            if (shift) state.selectedBrushes.Toggle(hit.index, state.BrushID(hit.index));
+            state.selectedBrushIndex = hit.index;
+            state.selectedEntityIndex = -1;
         }
-
-        bounds.center.x = (bounds.min.x + bounds.max.x) * 0.5f;
-        bounds.center.y = (bounds.min.y + bounds.max.y) * 0.5f;
-        bounds.center.z = (bounds.min.z + bounds.max.z) * 0.5f;
-
-        return bounds;
     }
 
     Ray ScreenPointToRay(float screenX, float screenY, int screenWidth,
@@ -1186,37 +1209,50 @@ private:
         return closestAxis;
     }
 
+    // Gizmo edits change the primary selection and the multi-selection
+    void TouchSelection() {
+        if (state.selectedBrushIndex >= 0) state.TouchBrush(state.selectedBrushIndex);
+        if (state.selectedEntityIndex >= 0) state.TouchEntity(state.selectedEntityIndex);
+        for (int idx : state.selectedBrushes) state.TouchBrush(idx);
+        for (int idx : state.selectedEntities) state.TouchEntity(idx);
+    }
+
+    // Each drag step marks what it moved: the statistics panel can query
+    // the pick tree mid-drag, which uses up the marks TouchSelection made
     void ApplyMove(const PCD::Vec3& delta) {
         if (state.selectedEntityIndex >= 0 &&
             state.selectedEntityIndex < (int)state.map.entities.size()) {
             auto& ent = state.map.entities[state.selectedEntityIndex];
             ent.position = ent.position + delta;
+            state.EntityChanged(state.selectedEntityIndex);
         }
 
-        if (state.selectedBrushIndex >= 0 &&
-            state.selectedBrushIndex < (int)state.map.brushes.size()) {
-            auto& brush = state.map.brushes[state.selectedBrushIndex];
-            for (auto& v : brush.vertices) {
-                v.position = v.position + delta;
-            }
-        }
-        
         // Multi-selection
-        for (int idx : selectedEntityIndices) {
+        for (int idx : state.selectedEntities) {
             if (idx != state.selectedEntityIndex && idx >= 0 && 
                 idx < (int)state.map.entities.size()) {
                 state.map.entities[idx].position = state.map.entities[idx].position + delta;
+                state.EntityChanged(idx);
             }
         }
         
-        for (int idx : selectedBrushIndices) {
-            if (idx != state.selectedBrushIndex && idx >= 0 && 
-                idx < (int)state.map.brushes.size()) {
-                for (auto& v : state.map.brushes[idx].vertices) {
-                    v.position = v.position + delta;
-                }
-            }
+        std::vector<int> brushes = SelectedBrushList();
+        PCD::TransformBrushes(state.map.brushes, brushes, PCD::Affine::Translation(delta));
+        for (int idx : brushes) state.BrushChanged(idx);
+    }
+    
+    // The primary brush and the multi-selection, each once, for bulk
+    // transforms
+    std::vector<int> SelectedBrushList() const {
+        std::vector<int> list;
+        int count = (int)state.map.brushes.size();
+        if (state.selectedBrushIndex >= 0 && state.selectedBrushIndex < count) {
+            list.push_back(state.selectedBrushIndex);
         }
+        for (int idx : state.selectedBrushes) {
+            if (idx != state.selectedBrushIndex && idx >= 0 && idx < count) list.push_back(idx);
+        }
+        return list;
     }
 
     void ApplyRotation(float screenDX, float screenDY) {
@@ -1242,31 +1278,16 @@ private:
                 ent.rotation.x += rotX;
                 break;
             }
+            state.EntityChanged(state.selectedEntityIndex);
         }
         
-        // Rotate brush around center
-        if (state.selectedBrushIndex >= 0 &&
-            state.selectedBrushIndex < (int)state.map.brushes.size()) {
-            auto& brush = state.map.brushes[state.selectedBrushIndex];
-            BrushBounds bounds = GetBrushBounds(brush);
-            
-            float angle = rotY * 0.01f;
-            float cosA = std::cos(angle);
-            float sinA = std::sin(angle);
-            
-            for (auto& v : brush.vertices) {
-                float relX = v.position.x - bounds.center.x;
-                float relZ = v.position.z - bounds.center.z;
-                
-                v.position.x = bounds.center.x + relX * cosA - relZ * sinA;
-                v.position.z = bounds.center.z + relX * sinA + relZ * cosA;
-                
-                // Rotate normal
-                float nrelX = v.normal.x;
-                float nrelZ = v.normal.z;
-                v.normal.x = nrelX * cosA - nrelZ * sinA;
-                v.normal.z = nrelX * sinA + nrelZ * cosA;
-            }
+        // Rotate the selected brushes around the gizmo (the primary
+        // object's center)
+        std::vector<int> brushes = SelectedBrushList();
+        if (!brushes.empty()) {
+            PCD::Affine rotation = PCD::Affine::RotationY(rotY * 0.01f, GetSelectedObjectPosition());
+            PCD::TransformBrushes(state.map.brushes, brushes, rotation);
+            for (int idx : brushes) state.BrushChanged(idx);
         }
     }
 
@@ -1299,25 +1320,23 @@ private:
                 ent.scale.z = std::max(0.1f, ent.scale.z * scaleFactor);
                 break;
             }
+            state.EntityChanged(state.selectedEntityIndex);
         }
 
-        if (state.selectedBrushIndex >= 0 &&
-            state.selectedBrushIndex < (int)state.map.brushes.size()) {
-            auto& brush = state.map.brushes[state.selectedBrushIndex];
-            BrushBounds bounds = GetBrushBounds(brush);
-
-            for (auto& v : brush.vertices) {
-                PCD::Vec3 offset = v.position - bounds.center;
-
-                switch (activeAxis) {
-                case GizmoAxis::X: offset.x *= scaleFactor; break;
-                case GizmoAxis::Y: offset.y *= scaleFactor; break;
-                case GizmoAxis::Z: offset.z *= scaleFactor; break;
-                default: offset = offset * scaleFactor; break;
-                }
-
-                v.position = bounds.center + offset;
+        // Scale the selected brushes about the gizmo; normals follow the
+        // inverse-transpose so faces stay lit correctly under uneven scale
+        std::vector<int> brushes = SelectedBrushList();
+        if (!brushes.empty()) {
+            PCD::Vec3 factors(1, 1, 1);
+            switch (activeAxis) {
+            case GizmoAxis::X: factors.x = scaleFactor; break;
+            case GizmoAxis::Y: factors.y = scaleFactor; break;
+            case GizmoAxis::Z: factors.z = scaleFactor; break;
+            default: factors = PCD::Vec3(scaleFactor, scaleFactor, scaleFactor); break;
             }
+            PCD::Affine scale = PCD::Affine::Scale(factors, GetSelectedObjectPosition());
+            PCD::TransformBrushes(state.map.brushes, brushes, scale);
+            for (int idx : brushes) state.BrushChanged(idx);
         }
     }
 };
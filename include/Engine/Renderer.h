@@ -1,43 +1,129 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include "Engine/GLState.h"
+#include "Engine/ShaderProgram.h"
 #include <glad/gl.h>
+#include <memory>
 #include <vector>
 
 // Forward declarations
 struct Vec3;
 namespace PCD {
     struct EditorSettings;
+    struct Map;
     struct Brush;
     struct Entity;
     struct Vec3;
+    class SelectionSet;
+    class CullTree;
     enum class EditorTool;
 }
 
 class Renderer {
 private:
-    GLuint shaderProgram;
+    GLState state;
+    ShaderProgram program;
+    GLint modelLoc, hasTextureLoc;
+    
+    // Projection and view live in the shader's std140 Camera block. It and
+    // the plain uniforms are written only when the value changes.
+    static const GLuint CAMERA_BINDING = 0;
+    GLuint cameraUbo;
+    float camera[32];       // Projection, then view, as last uploaded
+    float model[16];
+    bool cameraValid, modelValid;
+    int hasTextureValue;    // -1 until first set
+    
     GLuint vao, vbo, ebo;
     
+    // One brush's range of a vertex/index buffer pair. Brushes are drawn
+    // in batches of equal texture and fill mode, one multi-draw per batch;
+    // flag colors and the selection highlight are baked into the vertices.
+    struct BrushDraw {
+        GLuint texture;     // GL name, 0 for untextured
+        bool wireframe;     // Selected brushes in the editor
+        GLsizei count;      // Indices
+        GLintptr offset;    // Bytes into the index buffer
+        GLint baseVertex;   // Brush indices are local to the brush
+        size_t brush;       // Index in the brushes it was packed from
+    };
+    
+    // Static map geometry, draws sorted into batches when built. The cull
+    // tree holds each draw's brush bounds, by position in staticDraws.
+    GLuint staticVao, staticVbo, staticEbo;
+    std::vector<BrushDraw> staticDraws;
+    std::unique_ptr<PCD::CullTree> staticCull;
+    std::vector<int> visibleDraws;
+    
+    // RenderBrushes packs everything into vao/vbo/ebo once per frame
+    std::vector<float> frameVerts;
+    std::vector<unsigned int> frameIndices;
+    std::vector<BrushDraw> frameDraws;
+    
+    // Arguments of the multi-draw being assembled
+    std::vector<GLsizei> batchCounts;
+    std::vector<const void*> batchOffsets;
+    std::vector<GLint> batchBaseVertices;
+    
 public:
+    // Brushes drawn and skipped as outside the view
+    struct CullCounts {
+        size_t visible = 0;
+        size_t culled = 0;
+    };
+    
     Renderer();
     ~Renderer();
     
     bool Initialize();
     void Shutdown();
     
+    // Call once per frame before any rendering. GL bindings made outside
+    // the renderer since the last frame are picked up again after this.
+    void BeginFrame();
+    // Bind/state calls the last full frame sent to GL and skipped as redundant
+    const GLState::Counts& GetStateCounts() const { return state.LastFrame(); }
+    // Over the last full frame's culled draws: RenderStaticMap, and
+    // RenderBrushes given visible. Unculled extras such as player boxes
+    // are left out.
+    const CullCounts& GetCullCounts() const { return lastCullCounts; }
+    
     // Rendering functions
     void RenderGrid(const PCD::EditorSettings& settings, const PCD::Vec3& target, float* view, float* proj);
-    void RenderBrushes(const std::vector<PCD::Brush>& brushes, int selectedIdx, float* view, float* proj);
-    void RenderEntities(const std::vector<PCD::Entity>& entities, int selectedIdx, bool showIcons, float* view, float* proj);
+    // selectedIdx and everything in selection (if given) are highlighted.
+    // With visible (ascending indices, e.g. from a frustum query) only those
+    // brushes are drawn and the rest count as culled; without it nothing
+    // is added to the cull counts.
+    void RenderBrushes(const std::vector<PCD::Brush>& brushes, int selectedIdx, float* view, float* proj,
+                       const PCD::SelectionSet* selection = nullptr, const std::vector<int>* visible = nullptr);
+    void RenderEntities(const std::vector<PCD::Entity>& entities, int selectedIdx, bool showIcons, float* view, float* proj,
+                        const PCD::SelectionSet* selection = nullptr);
     void RenderCreationPreview(const PCD::Vec3& start, const PCD::Vec3& end, float gridSize, float* view, float* proj);
     void RenderGizmo(const PCD::Vec3& position, PCD::EditorTool tool, int activeAxis, float* view, float* proj);
     
+    // Map geometry that does not change while it is drawn (the game). Build
+    // packs every brush into GPU buffers once, through PCD::MapGeometry,
+    // after the brushes' textureIDs hold GL names
+    // (TextureLoader::LoadMapTextures); each frame then only binds textures
+    // and draws the ranges of brushes inside the view, uploading nothing.
+    void BuildStaticMap(const PCD::Map& map);
+    void RenderStaticMap(float* view, float* proj);
+    void FreeStaticMap();
+    
 private:
-    GLuint CompileShader(GLenum type, const char* src);
+    void BeginDraw(const float* view, const float* proj); // Binds the program and camera block
+    void SetModel(const float* mat);
+    void SetHasTexture(bool textured);
     void SetIdentityMatrix(float* mat);
     void RenderArrow(const PCD::Vec3& pos, const PCD::Vec3& dir, float r, float g, float b, bool highlight, float* view, float* proj);
     void RenderCube(const PCD::Vec3& pos, float size, float r, float g, float b, float* view, float* proj);
+    static void PackBrush(const PCD::Brush& brush, size_t index, bool selected, std::vector<float>& verts,
+                          std::vector<unsigned int>& indices, std::vector<BrushDraw>& draws);
+    static void SortIntoBatches(std::vector<BrushDraw>& draws);
+    void DrawBatches(const std::vector<BrushDraw>& draws); // With the buffers' VAO and the program bound
+    
+    CullCounts cullCounts, lastCullCounts; // This frame's, and the last full frame's
 };
 
 #endif // RENDERER_H
@@ -0,0 +1,77 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <glad/gl.h>
+#include <iostream>
+
+// A linked GL program. Uniform locations and block indices are looked up
+// by name once, right after linking, so drawing never passes strings to GL.
+class ShaderProgram {
+public:
+    ShaderProgram() : id(0) {}
+
+    bool Build(const char* vertexSrc, const char* fragmentSrc) {
+        GLuint vs = Compile(GL_VERTEX_SHADER, vertexSrc);
+        GLuint fs = Compile(GL_FRAGMENT_SHADER, fragmentSrc);
+
+        id = glCreateProgram();
+        glAttachShader(id, vs);
+        glAttachShader(id, fs);
+        glLinkProgram(id);
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+
+        GLint success;
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
+        if (!success) {
+            char log[512];
+            glGetProgramInfoLog(id, 512, nullptr, log);
+            std::cerr << "Shader linking error:\n" << log << std::endl;
+            Destroy();
+            return false;
+        }
+        return true;
+    }
+
+    void Destroy() {
+        if (id) glDeleteProgram(id);
+        id = 0;
+    }
+
+    GLuint Id() const { return id; }
+
+    // For use after Build; -1 (which GL ignores) if the uniform is unused
+    GLint Location(const char* name) const { return glGetUniformLocation(id, name); }
+
+    // Points a std140 block at a uniform buffer binding; false if the
+    // program has no block of that name
+    bool BindBlock(const char* name, GLuint binding) const {
+        GLuint index = glGetUniformBlockIndex(id, name);
+        if (index == GL_INVALID_INDEX) {
+            std::cerr << "Shader has no uniform block " << name << std::endl;
+            return false;
+        }
+        glUniformBlockBinding(id, index, binding);
+        return true;
+    }
+
+private:
+    static GLuint Compile(GLenum type, const char* src) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &src, nullptr);
+        glCompileShader(shader);
+
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char log[512];
+            glGetShaderInfoLog(shader, 512, nullptr, log);
+            std::cerr << "Shader compilation error:\n" << log << std::endl;
+        }
+        return shader;
+    }
+
+    GLuint id;
+};
+
+#endif // SHADER_PROGRAM_H
@@ -56,51 +56,66 @@ inline bool LoadImage(const std::string& filename, PCD::Texture& tex) {
     return true;
 }
 
-inline GLuint CreateGLTexture(const PCD::Texture& tex) {
-    if (tex.data.empty()) return 0;
-    
-    GLuint textureID;
-    glGenTextures(1, &textureID);
+// Hands a BC1/BC3 mip chain to the driver as-is. Returns false if the
+// driver has no S3TC support so the caller can fall back to RGBA.
+inline bool UploadCompressedLevels(const PCD::Texture& tex) {
+    if (!GLAD_GL_EXT_texture_compression_s3tc) return false;
+    
+    GLenum format = (tex.format == PCD::TEXFMT_BC3) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                                    : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    for (uint32_t mip = 0; mip < tex.mipCount; mip++) {
+        uint32_t w, h;
+        size_t offset, size;
+        PCD::TextureCompressor::MipLevel(tex, mip, w, h, offset, size);
+        if (offset + size > tex.data.size()) return false;
+        glCompressedTexImage2D(GL_TEXTURE_2D, mip, format, w, h, 0,
+                               (GLsizei)size, tex.data.data() + offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex.mipCount - 1);
+    return true;
+}
+
+// Fills an existing GL texture name with tex's pixels and mipmaps
+inline void UploadGLTexture(GLuint textureID, const PCD::Texture& tex) {
     glBindTexture(GL_TEXTURE_2D, textureID);
     
-    GLenum format = (tex.channels == 4) ? GL_RGBA : GL_RGB;
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, format, tex.width, tex.height, 0, 
-                 format, GL_UNSIGNED_BYTE, tex.data.data());
+    bool haveMips = false;
+    if (tex.IsCompressed()) {
+        haveMips = UploadCompressedLevels(tex);
+        if (!haveMips) {
+            std::vector<uint8_t> rgba;
+            PCD::TextureCompressor::Decompress(tex, 0, rgba);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        }
+    } else {
+        GLenum format = (tex.channels == 4) ? GL_RGBA : GL_RGB;
+        
+        glTexImage2D(GL_TEXTURE_2D, 0, format, tex.width, tex.height, 0, 
+                     format, GL_UNSIGNED_BYTE, tex.data.data());
+    }
     
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (!haveMips) glGenerateMipmap(GL_TEXTURE_2D);
     glBindTexture(GL_TEXTURE_2D, 0);
-    
-    std::cout << "[Texture] Created GL texture: " << textureID << "\n";
-    return textureID;
 }
 
-inline void LoadMapTextures(PCD::Map& map) {
-    for (auto& [id, tex] : map.textures) {
-        if (tex.glTextureID == 0 && !tex.data.empty()) {
-            tex.glTextureID = CreateGLTexture(tex);
-        }
-    }
+inline GLuint CreateGLTexture(const PCD::Texture& tex) {
+    if (tex.data.empty()) return 0;
     
-    // Update brush texture IDs to OpenGL IDs
-    for (auto& brush : map.brushes) {
-        if (brush.textureID > 0) {
-            auto* tex = map.GetTexture(brush.textureID);
-            if (tex && tex->glTextureID > 0) {
-                brush.textureID = tex->glTextureID;
-            }
-        }
-    }
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    UploadGLTexture(textureID, tex);
     
-    std::cout << "[Texture] Loaded " << map.textures.size() << " textures\n";
+    std::cout << "[Texture] Created GL texture: " << textureID << "\n";
+    return textureID;
 }
 
-inline PCD::Texture CreateCheckerboardTexture(uint32_t size = 64) {
+inline PCD::Texture CreateCheckerboardPixels(uint32_t size = 64) {
     PCD::Texture tex;
     tex.name = "checkerboard";
     tex.width = size;
@@ -121,6 +136,77 @@ inline PCD::Texture CreateCheckerboardTexture(uint32_t size = 64) {
         }
     }
     
+    return tex;
+}
+
+// Pulls in the pixels of a texture loaded with LoadOptions::deferTextures
+inline bool EnsurePixels(PCD::Texture& tex) {
+    return PCD::PCDReader::LoadTexturePixels(tex);
+}
+
+// deferPixels: textures still on disk get their GL name right away with a
+// checkerboard stand-in, so brush IDs can be remapped now; StreamMapTextures
+// swaps the real pixels in later
+inline void LoadMapTextures(PCD::Map& map, bool deferPixels = false) {
+    PCD::Texture placeholder;
+    size_t pending = 0;
+    
+    for (auto& [id, tex] : map.textures) {
+        if (tex.glTextureID != 0) continue;
+        
+        if (tex.IsDeferred() && deferPixels) {
+            if (placeholder.data.empty()) placeholder = CreateCheckerboardPixels();
+            glGenTextures(1, &tex.glTextureID);
+            UploadGLTexture(tex.glTextureID, placeholder);
+            pending++;
+            continue;
+        }
+        
+        EnsurePixels(tex);
+        if (!tex.data.empty()) {
+            tex.glTextureID = CreateGLTexture(tex);
+        }
+    }
+    
+    // Update brush texture IDs to OpenGL IDs
+    for (auto& brush : map.brushes) {
+        if (brush.textureID > 0) {
+            auto* tex = map.GetTexture(brush.textureID);
+            if (tex && tex->glTextureID > 0) {
+                brush.textureID = tex->glTextureID;
+            }
+        }
+    }
+    
+    std::cout << "[Texture] Loaded " << map.textures.size() << " textures";
+    if (pending > 0) std::cout << " (" << pending << " streaming)";
+    std::cout << "\n";
+}
+
+// Uploads the real pixels for up to budget placeholder textures left by
+// LoadMapTextures(map, true). Returns how many are still waiting.
+inline size_t StreamMapTextures(PCD::Map& map, size_t budget) {
+    size_t pending = 0;
+    for (auto& [id, tex] : map.textures) {
+        if (tex.glTextureID == 0 || !tex.IsDeferred()) continue;
+        
+        if (budget == 0) {
+            pending++;
+            continue;
+        }
+        budget--;
+        if (EnsurePixels(tex)) {
+            UploadGLTexture(tex.glTextureID, tex);
+        } else {
+            // Unreadable source: keep the checkerboard and stop retrying
+            tex.source = PCD::Texture::Source();
+        }
+    }
+    return pending;
+}
+
+inline PCD::Texture CreateCheckerboardTexture(uint32_t size = 64) {
+    PCD::Texture tex = CreateCheckerboardPixels(size);
     tex.glTextureID = CreateGLTexture(tex);
     return tex;
 }
@@ -4,6 +4,7 @@
 
 #include <enet/enet.h>
 #include "PCD/PCD.h"
+#include "Network/NetworkMessages.h"
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -12,20 +13,10 @@
 #include <functional>
 #include <cstring>
 #include <fstream>
+#include <deque>
 
 namespace Network {
 
-enum class MessageType : uint8_t {
-    PLAYER_JOIN = 0,
-    PLAYER_LEAVE = 1,
-    PLAYER_STATE = 2,
-    CHAT_MESSAGE = 3,
-    MAP_REQUEST = 4,
-    MAP_CHUNK = 5,
-    MAP_COMPLETE = 6,
-    GAME_START = 7
-};
-
 struct ClientInfo {
     uint32_t playerId;
     std::string name;
@@ -41,6 +32,8 @@ using MapLoadedCallback = std::function<void(const PCD::Map&)>;
 
 class NetworkManager {
 private:
+    static constexpr const char* RECEIVED_MAP_PATH = "/tmp/received_map.pcd";
+    
     ENetHost* host;
     ENetPeer* serverPeer;
     bool isHost;
@@ -62,6 +55,15 @@ private:
     size_t expectedMapSize;
     size_t chunksReceived;
     
+    // Map revisions. The host keeps the per-ID hashes of recent revisions so
+    // a client still holding one of them only needs a delta; a client reports
+    // the revision of the map it cached from its last download.
+    static const size_t MAX_MAP_REVISIONS = 8;
+    PCD::MapDiffer currentMapState;
+    uint64_t currentRevision; // Revision of currentMap
+    std::deque<std::pair<uint64_t, PCD::MapDiffer>> mapRevisions;
+    bool cachedRevisionKnown;
+    
     // Stats
     uint32_t packetsSent;
     uint32_t packetsReceived;
@@ -71,6 +73,7 @@ public:
         : host(nullptr), serverPeer(nullptr), isHost(false)
         , isConnected(false), localPlayerId(0), nextPlayerId(1)
         , expectedMapSize(0), chunksReceived(0)
+        , currentRevision(0), cachedRevisionKnown(false)
         , packetsSent(0), packetsReceived(0)
     {
         if (enet_initialize() != 0) {
@@ -138,9 +141,9 @@ public:
             std::cout << "[NET] Connected!\n";
             
             // Send join request
-            std::vector<uint8_t> data;
-            data.push_back((uint8_t)MessageType::PLAYER_JOIN);
-            data.insert(data.end(), playerName.begin(), playerName.end());
+            PlayerJoinMessage join;
+            join.name = playerName;
+            std::vector<uint8_t> data = EncodeMessage(MessageType::PLAYER_JOIN, join);
             
             ENetPacket* packet = enet_packet_create(data.data(), data.size(), 
                                                     ENET_PACKET_FLAG_RELIABLE);
@@ -207,12 +210,25 @@ public:
         
         std::cout << "[NET] Loading map: " << mapPath << "\n";
         
-        if (!PCD::PCDReader::Load(currentMap, mapPath)) {
+        PCD::LoadOptions options;
+        options.threads = 0; // Decode on every core
+        options.deferTextures = true; // Pixels are read when the scene uploads them
+        if (!PCD::PCDReader::Load(currentMap, mapPath, options)) {
             std::cerr << "[NET] Failed to load map\n";
             return false;
         }
         
+        // Reloading an edited map: remember the outgoing revision so clients
+        // that already have it get a delta
+        if (!currentMapPath.empty()) {
+            mapRevisions.push_back({currentRevision, std::move(currentMapState)});
+            if (mapRevisions.size() > MAX_MAP_REVISIONS) mapRevisions.pop_front();
+        }
+        
         currentMapPath = mapPath;
+        currentMapState = PCD::MapDiffer();
+        currentMapState.Track(currentMap, 0);
+        currentRevision = currentMapState.Revision();
         std::cout << "[NET] Map loaded successfully\n";
         std::cout << "[NET]   Brushes: " << currentMap.brushes.size() << "\n";
         std::cout << "[NET]   Entities: " << currentMap.entities.size() << "\n";
@@ -227,8 +243,17 @@ public:
         
         std::cout << "[NET] Requesting map...\n";
         
-        std::vector<uint8_t> data;
-        data.push_back((uint8_t)MessageType::MAP_REQUEST);
+        // Offer the revision we already have so the host can send a delta
+        if (!cachedRevisionKnown) {
+            PCD::LoadOptions options;
+            options.deferTextures = true;
+            std::ifstream cached(RECEIVED_MAP_PATH);
+            cachedRevisionKnown = cached.is_open() && PCD::PCDReader::Load(currentMap, RECEIVED_MAP_PATH, options);
+            if (cachedRevisionKnown) currentRevision = PCD::MapRevision(currentMap, 0);
+        }
+        MapRequestMessage request;
+        if (cachedRevisionKnown) request.revision = currentRevision;
+        std::vector<uint8_t> data = EncodeMessage(MessageType::MAP_REQUEST, request);
         
         ENetPacket* packet = enet_packet_create(data.data(), data.size(), 
                                                 ENET_PACKET_FLAG_RELIABLE);
@@ -240,24 +265,18 @@ public:
     void SendPlayerState(float x, float y, float z, float yaw, float pitch, int health, int weapon) {
         if (!isConnected) return;
         
-        struct __attribute__((packed)) StatePacket {
-            uint8_t type;
-            uint32_t playerId;
-            float x, y, z, yaw, pitch;
-            int32_t health, weapon;
-        } packet;
-        
-        packet.type = (uint8_t)MessageType::PLAYER_STATE;
-        packet.playerId = localPlayerId;
-        packet.x = x;
-        packet.y = y;
-        packet.z = z;
-        packet.yaw = yaw;
-        packet.pitch = pitch;
-        packet.health = health;
-        packet.weapon = weapon;
-        
-        ENetPacket* enetPacket = enet_packet_create(&packet, sizeof(packet), 
+        PlayerStateMessage state;
+        state.playerId = localPlayerId;
+        state.x = x;
+        state.y = y;
+        state.z = z;
+        state.yaw = yaw;
+        state.pitch = pitch;
+        state.health = health;
+        state.weapon = weapon;
+        std::vector<uint8_t> data = EncodeMessage(MessageType::PLAYER_STATE, state);
+        
+        ENetPacket* enetPacket = enet_packet_create(data.data(), data.size(), 
                                                      ENET_PACKET_FLAG_UNSEQUENCED);
         
         if (isHost) {
@@ -271,16 +290,10 @@ public:
     void SendChatMessage(const std::string& message) {
         if (!isConnected) return;
         
-        std::vector<uint8_t> data;
-        data.push_back((uint8_t)MessageType::CHAT_MESSAGE);
-        
-        uint32_t id = localPlayerId;
-        data.push_back((id >> 24) & 0xFF);
-        data.push_back((id >> 16) & 0xFF);
-        data.push_back((id >> 8) & 0xFF);
-        data.push_back(id & 0xFF);
-        
-        data.insert(data.end(), message.begin(), message.end());
+        ChatMessage chat;
+        chat.playerId = localPlayerId;
+        chat.text = message;
+        std::vector<uint8_t> data = EncodeMessage(MessageType::CHAT_MESSAGE, chat);
         
         ENetPacket* packet = enet_packet_create(data.data(), data.size(), 
                                                 ENET_PACKET_FLAG_RELIABLE);
@@ -296,9 +309,9 @@ public:
     void SendGameStart(const std::string& mapName) {
         if (!isHost) return;
         
-        std::vector<uint8_t> data;
-        data.push_back((uint8_t)MessageType::GAME_START);
-        data.insert(data.end(), mapName.begin(), mapName.end());
+        GameStartMessage start;
+        start.mapName = mapName;
+        std::vector<uint8_t> data = EncodeMessage(MessageType::GAME_START, start);
         
         ENetPacket* packet = enet_packet_create(data.data(), data.size(), 
                                                 ENET_PACKET_FLAG_RELIABLE);
@@ -369,10 +382,11 @@ private:
                 break;
                 
             case MessageType::MAP_REQUEST:
-                HandleMapRequest(peer);
+                HandleMapRequest(data, length, peer);
                 break;
                 
             case MessageType::MAP_CHUNK:
+            case MessageType::MAP_DELTA_CHUNK:
                 HandleMapChunk(data, length);
                 break;
                 
@@ -390,9 +404,12 @@ private:
     }
     
     void HandlePlayerJoin(const uint8_t* data, size_t length, ENetPeer* peer) {
+        PlayerJoinMessage join;
+        if (!DecodeMessage(data, length, join)) return;
+        
         if (isHost) {
             // Host receives join request
-            std::string name((char*)data + 1, length - 1);
+            const std::string& name = join.name;
             uint32_t newId = nextPlayerId++;
             
             ClientInfo info;
@@ -408,13 +425,8 @@ private:
             std::cout << "[NET] Player joined: " << name << " (ID: " << newId << ")\n";
             
             // Send player ID to the new player
-            std::vector<uint8_t> response;
-            response.push_back((uint8_t)MessageType::PLAYER_JOIN);
-            response.push_back((newId >> 24) & 0xFF);
-            response.push_back((newId >> 16) & 0xFF);
-            response.push_back((newId >> 8) & 0xFF);
-            response.push_back(newId & 0xFF);
-            response.insert(response.end(), name.begin(), name.end());
+            join.playerId = newId;
+            std::vector<uint8_t> response = EncodeMessage(MessageType::PLAYER_JOIN, join);
             
             ENetPacket* packet = enet_packet_create(response.data(), response.size(),
                                                    ENET_PACKET_FLAG_RELIABLE);
@@ -422,13 +434,8 @@ private:
             
             // IMPORTANT: Send info about the HOST to the new player
             ClientInfo& hostInfo = clients[localPlayerId];
-            std::vector<uint8_t> hostData;
-            hostData.push_back((uint8_t)MessageType::PLAYER_JOIN);
-            hostData.push_back((localPlayerId >> 24) & 0xFF);
-            hostData.push_back((localPlayerId >> 16) & 0xFF);
-            hostData.push_back((localPlayerId >> 8) & 0xFF);
-            hostData.push_back(localPlayerId & 0xFF);
-            hostData.insert(hostData.end(), hostInfo.name.begin(), hostInfo.name.end());
+            std::vector<uint8_t> hostData = EncodeMessage(MessageType::PLAYER_JOIN,
+                                                          PlayerJoinMessage{localPlayerId, hostInfo.name});
             
             ENetPacket* hostPacket = enet_packet_create(hostData.data(), hostData.size(),
                                                         ENET_PACKET_FLAG_RELIABLE);
@@ -437,13 +444,8 @@ private:
             // Send info about all other players to new player
             for (const auto& [id, client] : clients) {
                 if (id != newId && id != localPlayerId) {
-                    std::vector<uint8_t> info;
-                    info.push_back((uint8_t)MessageType::PLAYER_JOIN);
-                    info.push_back((id >> 24) & 0xFF);
-                    info.push_back((id >> 16) & 0xFF);
-                    info.push_back((id >> 8) & 0xFF);
-                    info.push_back(id & 0xFF);
-                    info.insert(info.end(), client.name.begin(), client.name.end());
+                    std::vector<uint8_t> info = EncodeMessage(MessageType::PLAYER_JOIN,
+                                                              PlayerJoinMessage{id, client.name});
                     
                     ENetPacket* p = enet_packet_create(info.data(), info.size(),
                                                        ENET_PACKET_FLAG_RELIABLE);
@@ -467,10 +469,9 @@ private:
             }
         } else {
             // Client receives player info
-            if (length >= 5) {
-                uint32_t playerId = (data[1] << 24) | (data[2] << 16) | 
-                                   (data[3] << 8) | data[4];
-                std::string name((char*)data + 5, length - 5);
+            {
+                uint32_t playerId = join.playerId;
+                const std::string& name = join.name;
                 
                 if (localPlayerId == 0) {
                     localPlayerId = playerId;
@@ -503,37 +504,29 @@ private:
     }
     
     void HandlePlayerState(const uint8_t* data, size_t length) {
-        if (length < sizeof(uint8_t) + sizeof(uint32_t) + 5 * sizeof(float) + 2 * sizeof(int32_t)) return;
-        
-        const uint8_t* ptr = data + 1;
-        uint32_t playerId = *(uint32_t*)ptr; ptr += sizeof(uint32_t);
-        float x = *(float*)ptr; ptr += sizeof(float);
-        float y = *(float*)ptr; ptr += sizeof(float);
-        float z = *(float*)ptr; ptr += sizeof(float);
-        float yaw = *(float*)ptr; ptr += sizeof(float);
-        float pitch = *(float*)ptr; ptr += sizeof(float);
-        int32_t health = *(int32_t*)ptr; ptr += sizeof(int32_t);
-        int32_t weapon = *(int32_t*)ptr;
+        PlayerStateMessage state;
+        if (!DecodeMessage(data, length, state)) return;
         
         if (messageCallback) {
             std::vector<std::string> args;
-            args.push_back(std::to_string(playerId));
-            args.push_back(std::to_string(x));
-            args.push_back(std::to_string(y));
-            args.push_back(std::to_string(z));
-            args.push_back(std::to_string(yaw));
-            args.push_back(std::to_string(pitch));
-            args.push_back(std::to_string(health));
-            args.push_back(std::to_string(weapon));
+            args.push_back(std::to_string(state.playerId));
+            args.push_back(std::to_string(state.x));
+            args.push_back(std::to_string(state.y));
+            args.push_back(std::to_string(state.z));
+            args.push_back(std::to_string(state.yaw));
+            args.push_back(std::to_string(state.pitch));
+            args.push_back(std::to_string(state.health));
+            args.push_back(std::to_string(state.weapon));
             messageCallback("PLAYER_STATE", args);
         }
     }
     
     void HandleChatMessage(const uint8_t* data, size_t length) {
-        if (length < 6) return;
+        ChatMessage chat;
+        if (!DecodeMessage(data, length, chat) || chat.text.empty()) return;
         
-        uint32_t senderId = (data[1] << 24) | (data[2] << 16) | (data[3] << 8) | data[4];
-        std::string message((char*)data + 5, length - 5);
+        uint32_t senderId = chat.playerId;
+        const std::string& message = chat.text;
         
         std::string senderName = "Unknown";
         auto it = clients.find(senderId);
@@ -551,24 +544,50 @@ private:
         }
     }
     
-    void HandleMapRequest(ENetPeer* peer) {
+    void HandleMapRequest(const uint8_t* data, size_t length, ENetPeer* peer) {
         if (!isHost || currentMapPath.empty()) return;
         
-        std::cout << "[NET] Sending map to client...\n";
-        
         std::ifstream f(currentMapPath, std::ios::binary | std::ios::ate);
         if (!f.is_open()) {
             std::cerr << "[NET] Cannot open map file\n";
             return;
         }
-        
         size_t fileSize = f.tellg();
-        f.seekg(0);
         
+        // A client that reports a revision we still know gets only the delta
+        MapRequestMessage request;
+        if (DecodeMessage(data, length, request) && request.revision != 0) {
+            uint64_t clientRevision = request.revision;
+            
+            const PCD::MapDiffer* base = nullptr;
+            if (clientRevision == currentRevision) base = &currentMapState;
+            for (const auto& [revision, state] : mapRevisions) {
+                if (revision == clientRevision) base = &state;
+            }
+            
+            std::vector<uint8_t> delta;
+            if (base) PCD::Diff(*base, currentMapState, currentMap, delta);
+            if (!delta.empty() && delta.size() < fileSize) {
+                std::cout << "[NET] Sending map delta to client (" << delta.size() << " of "
+                          << fileSize << " bytes)...\n";
+                SendMapData(peer, MessageType::MAP_DELTA_CHUNK, delta);
+                return;
+            }
+        }
+        
+        std::cout << "[NET] Sending map to client...\n";
+        
+        f.seekg(0);
         std::vector<uint8_t> fileData(fileSize);
         f.read((char*)fileData.data(), fileSize);
         f.close();
         
+        SendMapData(peer, MessageType::MAP_CHUNK, fileData);
+    }
+    
+    void SendMapData(ENetPeer* peer, MessageType type, const std::vector<uint8_t>& fileData) {
+        size_t fileSize = fileData.size();
+        
         // Send in 8KB chunks
         const size_t chunkSize = 8192;
         size_t totalChunks = (fileSize + chunkSize - 1) / chunkSize;
@@ -577,17 +596,12 @@ private:
             size_t offset = i * chunkSize;
             size_t size = std::min(chunkSize, fileSize - offset);
             
-            std::vector<uint8_t> chunkData;
-            chunkData.push_back((uint8_t)MessageType::MAP_CHUNK);
-            chunkData.push_back((i >> 8) & 0xFF);
-            chunkData.push_back(i & 0xFF);
-            chunkData.push_back((totalChunks >> 8) & 0xFF);
-            chunkData.push_back(totalChunks & 0xFF);
-            chunkData.push_back((fileSize >> 24) & 0xFF);
-            chunkData.push_back((fileSize >> 16) & 0xFF);
-            chunkData.push_back((fileSize >> 8) & 0xFF);
-            chunkData.push_back(fileSize & 0xFF);
-            chunkData.insert(chunkData.end(), &fileData[offset], &fileData[offset + size]);
+            MapChunkMessage chunk;
+            chunk.index = (uint32_t)i;
+            chunk.count = (uint32_t)totalChunks;
+            chunk.totalSize = (uint32_t)fileSize;
+            chunk.data.assign(&fileData[offset], &fileData[offset + size]);
+            std::vector<uint8_t> chunkData = EncodeMessage(type, chunk);
             
             ENetPacket* packet = enet_packet_create(chunkData.data(), chunkData.size(),
                                                     ENET_PACKET_FLAG_RELIABLE);
@@ -599,21 +613,24 @@ private:
     }
     
     void HandleMapChunk(const uint8_t* data, size_t length) {
-        if (length < 9) return;
+        MapChunkMessage chunk;
+        if (!DecodeMessage(data, length, chunk) || chunk.count == 0) return;
         
-        size_t chunkIdx = (data[1] << 8) | data[2];
-        size_t totalChunks = (data[3] << 8) | data[4];
-        size_t fileSize = (data[5] << 24) | (data[6] << 16) | (data[7] << 8) | data[8];
+        bool isDelta = (MessageType)data[0] == MessageType::MAP_DELTA_CHUNK;
+        size_t chunkIdx = chunk.index;
+        size_t totalChunks = chunk.count;
+        size_t fileSize = chunk.totalSize;
         
         if (chunkIdx == 0) {
             receivedMapData.clear();
             receivedMapData.reserve(fileSize);
             expectedMapSize = fileSize;
             chunksReceived = 0;
-            std::cout << "[NET] Receiving map: " << fileSize << " bytes in " << totalChunks << " chunks\n";
+            std::cout << "[NET] Receiving map" << (isDelta ? " delta" : "") << ": " << fileSize
+                      << " bytes in " << totalChunks << " chunks\n";
         }
         
-        receivedMapData.insert(receivedMapData.end(), data + 9, data + length);
+        receivedMapData.insert(receivedMapData.end(), chunk.data.begin(), chunk.data.end());
         chunksReceived++;
         
         float progress = (float)chunksReceived / totalChunks * 100.0f;
@@ -622,14 +639,37 @@ private:
         if (chunksReceived >= totalChunks) {
             std::cout << "\n[NET] Map transfer complete!\n";
             
-            std::string tempPath = "/tmp/received_map.pcd";
-            std::ofstream f(tempPath, std::ios::binary);
-            f.write((char*)receivedMapData.data(), receivedMapData.size());
-            f.close();
+            if (isDelta) {
+                // currentMap holds the cached revision we reported in RequestMap
+                PCD::DeltaHeader header;
+                bool patched = PCD::ReadDeltaHeader(receivedMapData.data(), receivedMapData.size(), header) &&
+                               PCD::Patch(currentMap, receivedMapData.data(), receivedMapData.size(), 0) &&
+                               PCD::PCDWriter::Save(currentMap, RECEIVED_MAP_PATH);
+                receivedMapData.clear();
+                if (!patched) {
+                    std::cerr << "[NET] Failed to apply map delta, requesting full map\n";
+                    std::remove(RECEIVED_MAP_PATH);
+                    cachedRevisionKnown = false;
+                    currentMap = PCD::Map();
+                    RequestMap();
+                    return;
+                }
+                currentRevision = header.targetRevision;
+            } else {
+                std::ofstream f(RECEIVED_MAP_PATH, std::ios::binary);
+                f.write((char*)receivedMapData.data(), receivedMapData.size());
+                f.close();
+                receivedMapData.clear();
+                cachedRevisionKnown = false; // Hashed on the next request
+            }
             
-            if (PCD::PCDReader::Load(currentMap, tempPath)) {
+            // Reload from the cache so deferred textures point into it
+            PCD::LoadOptions options;
+            options.deferTextures = true;
+            if (PCD::PCDReader::Load(currentMap, RECEIVED_MAP_PATH, options)) {
                 std::cout << "[NET] Map loaded successfully\n";
                 clients[localPlayerId].hasMap = true;
+                cachedRevisionKnown = isDelta;
                 
                 // Send acknowledgment
                 std::vector<uint8_t> ack;
@@ -645,9 +685,8 @@ private:
                 }
             } else {
                 std::cerr << "[NET] Failed to load received map\n";
+                cachedRevisionKnown = false;
             }
-            
-            receivedMapData.clear();
         }
     }
     
@@ -663,7 +702,9 @@ private:
     }
     
     void HandleGameStart(const uint8_t* data, size_t length) {
-        std::string mapName((char*)data + 1, length - 1);
+        GameStartMessage start;
+        if (!DecodeMessage(data, length, start)) return;
+        const std::string& mapName = start.mapName;
         std::cout << "[NET] GAME STARTING - Map: " << mapName << "\n";
         
         if (messageCallback) {
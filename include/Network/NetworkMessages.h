@@ -0,0 +1,119 @@
+// NetworkMessages.h - Packet payloads, encoded through their PCD::Schema
+
+#pragma once
+
+#include "PCD/PCDSchema.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Network {
+
+// Every packet is [MessageType][payload], the payload encoded by
+// PCD::SchemaCodec (little-endian, length-prefixed strings and arrays)
+enum class MessageType : uint8_t {
+    PLAYER_JOIN = 0,
+    PLAYER_LEAVE = 1,
+    PLAYER_STATE = 2,
+    CHAT_MESSAGE = 3,
+    MAP_REQUEST = 4,
+    MAP_CHUNK = 5,
+    MAP_COMPLETE = 6,
+    GAME_START = 7,
+    MAP_DELTA_CHUNK = 8 // Same payload as MAP_CHUNK, data is a PCD::Diff delta
+};
+
+struct PlayerJoinMessage {
+    uint32_t playerId = 0; // 0 in a client's join request
+    std::string name;
+};
+
+struct PlayerStateMessage {
+    uint32_t playerId = 0;
+    float x = 0, y = 0, z = 0;
+    float yaw = 0, pitch = 0;
+    int32_t health = 0;
+    int32_t weapon = 0;
+};
+
+struct ChatMessage {
+    uint32_t playerId = 0;
+    std::string text;
+};
+
+struct MapRequestMessage {
+    uint64_t revision = 0; // PCD::MapRevision of the client's cached map, 0 = none
+};
+
+struct MapChunkMessage {
+    uint32_t index = 0;
+    uint32_t count = 0;
+    uint32_t totalSize = 0;
+    std::vector<uint8_t> data;
+};
+
+struct GameStartMessage {
+    std::string mapName;
+};
+
+template <typename T>
+std::vector<uint8_t> EncodeMessage(MessageType type, const T& msg) {
+    std::vector<uint8_t> data;
+    data.reserve(1 + PCD::SchemaCodec::WireSize(msg));
+    data.push_back((uint8_t)type);
+    PCD::SchemaCodec::Encode(msg, data);
+    return data;
+}
+
+template <typename T>
+bool DecodeMessage(const uint8_t* data, size_t length, T& msg) {
+    if (length < 1) return false;
+    PCD::ByteReader in(data + 1, length - 1);
+    return PCD::SchemaCodec::Decode(in, msg);
+}
+
+} // namespace Network
+
+namespace PCD {
+
+template <>
+struct Schema<Network::PlayerJoinMessage> {
+    using M = Network::PlayerJoinMessage;
+    using Fields = FieldList<Field<&M::playerId>, Field<&M::name>>;
+};
+
+template <>
+struct Schema<Network::PlayerStateMessage> {
+    using M = Network::PlayerStateMessage;
+    using Fields = FieldList<
+        Field<&M::playerId>,
+        Field<&M::x>, Field<&M::y>, Field<&M::z>,
+        Field<&M::yaw>, Field<&M::pitch>,
+        Field<&M::health>, Field<&M::weapon>>;
+};
+
+template <>
+struct Schema<Network::ChatMessage> {
+    using M = Network::ChatMessage;
+    using Fields = FieldList<Field<&M::playerId>, Field<&M::text>>;
+};
+
+template <>
+struct Schema<Network::MapRequestMessage> {
+    using M = Network::MapRequestMessage;
+    using Fields = FieldList<Field<&M::revision>>;
+};
+
+template <>
+struct Schema<Network::MapChunkMessage> {
+    using M = Network::MapChunkMessage;
+    using Fields = FieldList<Field<&M::index>, Field<&M::count>, Field<&M::totalSize>, Field<&M::data>>;
+};
+
+template <>
+struct Schema<Network::GameStartMessage> {
+    using M = Network::GameStartMessage;
+    using Fields = FieldList<Field<&M::mapName>>;
+};
+
+} // namespace PCD
@@ -7,6 +7,13 @@
 #include "PCD/PCDTypes.h"
 #include "PCD/PCDFile.h"
 #include "PCD/PCDBrushFactory.h"
+#include "PCD/PCDMapGeometry.h"
+#include "PCD/PCDTransform.h"
+#include "PCD/PCDCullTree.h"
+#include "PCD/PCDTextureCompression.h"
+#include "PCD/PCDGeometryReport.h"
+#include "PCD/PCDDiff.h"
+#include "PCD/PCDJournal.h"
 #include "PCD/PCDEditorState.h"
 #include "PCD/PCDEditorUI.h"
 
@@ -0,0 +1,137 @@
+#ifndef PCD_COMPRESSION_H
+#define PCD_COMPRESSION_H
+
+// Small LZ77 byte compressor in the LZ4 block style: greedy single-probe hash
+// matching, token byte with 4-bit literal/match lengths, 16-bit offsets.
+// Chosen for decode speed over ratio; every block stands alone so blocks
+// can be (de)compressed on separate threads.
+//
+// Sequence: [token][literal length ext...][literals][offset u16][match length ext...]
+// The last sequence carries literals only and ends the block.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace PCD {
+
+class BlockCompressor {
+public:
+    static const size_t MIN_MATCH = 4;
+    static const size_t MAX_OFFSET = 65535;
+
+    // Appends the compressed form of src to out
+    static void Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+        const size_t HASH_BITS = 14;
+        std::vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+
+        size_t anchor = 0;
+        size_t i = 0;
+        // Leave a tail of literals so the match loop never reads past the end
+        size_t matchLimit = size > 12 ? size - 12 : 0;
+
+        while (i < matchLimit) {
+            uint32_t seq = Read32(src + i);
+            size_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+            int64_t candidate = table[h];
+            table[h] = int64_t(i);
+
+            if (candidate < 0 || i - size_t(candidate) > MAX_OFFSET ||
+                Read32(src + candidate) != seq) {
+                i++;
+                continue;
+            }
+
+            size_t matchLen = MIN_MATCH;
+            size_t maxLen = size - 5 - i;
+            while (matchLen < maxLen && src[candidate + matchLen] == src[i + matchLen]) matchLen++;
+
+            WriteSequence(out, src + anchor, i - anchor, i - size_t(candidate), matchLen);
+            i += matchLen;
+            anchor = i;
+        }
+
+        WriteLiterals(out, src + anchor, size - anchor);
+    }
+
+    // dstSize must be the exact decompressed size; rejects corrupt input
+    static bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+        const uint8_t* ip = src;
+        const uint8_t* iend = src + srcSize;
+        size_t op = 0;
+
+        while (ip < iend) {
+            uint8_t token = *ip++;
+
+            size_t literals = token >> 4;
+            if (literals == 15 && !ReadLength(ip, iend, literals)) return false;
+            if (literals > size_t(iend - ip) || literals > dstSize - op) return false;
+            memcpy(dst + op, ip, literals);
+            ip += literals;
+            op += literals;
+
+            if (ip == iend) break; // Final literal-only sequence
+
+            if (iend - ip < 2) return false;
+            size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) return false;
+
+            size_t matchLen = token & 15;
+            if (matchLen == 15 && !ReadLength(ip, iend, matchLen)) return false;
+            matchLen += MIN_MATCH;
+            if (matchLen > dstSize - op) return false;
+
+            // Byte copy: matches may overlap their own output
+            const uint8_t* from = dst + op - offset;
+            for (size_t k = 0; k < matchLen; k++) dst[op + k] = from[k];
+            op += matchLen;
+        }
+        return op == dstSize;
+    }
+
+private:
+    static uint32_t Read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+    static void WriteLength(std::vector<uint8_t>& out, size_t extra) {
+        while (extra >= 255) {
+            out.push_back(255);
+            extra -= 255;
+        }
+        out.push_back(uint8_t(extra));
+    }
+
+    static bool ReadLength(const uint8_t*& ip, const uint8_t* iend, size_t& length) {
+        uint8_t b;
+        do {
+            if (ip >= iend) return false;
+            b = *ip++;
+            length += b;
+        } while (b == 255);
+        return true;
+    }
+
+    static void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount,
+                              size_t offset, size_t matchLen) {
+        size_t matchCode = matchLen - MIN_MATCH;
+        uint8_t token = uint8_t((literalCount < 15 ? literalCount : 15) << 4) |
+                        uint8_t(matchCode < 15 ? matchCode : 15);
+        out.push_back(token);
+        if (literalCount >= 15) WriteLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+        out.push_back(uint8_t(offset));
+        out.push_back(uint8_t(offset >> 8));
+        if (matchCode >= 15) WriteLength(out, matchCode - 15);
+    }
+
+    static void WriteLiterals(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount) {
+        out.push_back(uint8_t((literalCount < 15 ? literalCount : 15) << 4));
+        if (literalCount >= 15) WriteLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+    }
+};
+
+} // namespace PCD
+
+#endif // PCD_COMPRESSION_H
@@ -0,0 +1,239 @@
+#ifndef PCD_CULL_TREE_H
+#define PCD_CULL_TREE_H
+
+// View-frustum culling for geometry that stays put, such as the map in game
+// mode.
+//
+// This is a four-wide bounding volume hierarchy. Each node holds the boxes
+// of up to four children, each either another node or a single item. The
+// boxes are stored as separate x/y/z arrays, so all four are tested against
+// a plane together: with SSE2 where available, otherwise by
+// Frustum::Classify one box at a time. A child entirely outside the frustum
+// is skipped along with its subtree. A child entirely inside is taken with
+// its subtree and no further tests.
+//
+// Items are boxes identified by their position in the list given to Build;
+// the caller decides what they stand for. Unlike PickTree nothing is updated
+// incrementally, so Build again after the items change.
+
+#include "PCDTypes.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define PCD_CULL_SSE2 1
+#endif
+
+namespace PCD {
+
+class CullTree {
+public:
+    // Items whose box is inverted (min above max) are left out and never
+    // reported visible. A brush without vertices is not one of them:
+    // BrushBounds::Of gives it a zero box at the origin
+    void Build(const std::vector<BrushBounds>& boxes) {
+        nodes.clear();
+        itemCount = 0;
+        visibleBits.assign((boxes.size() + 63) / 64, 0);
+
+        std::vector<uint32_t> items;
+        items.reserve(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++) {
+            const BrushBounds& b = boxes[i];
+            if (b.min.x <= b.max.x && b.min.y <= b.max.y && b.min.z <= b.max.z) {
+                items.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        itemCount = items.size();
+        if (items.empty()) return;
+
+        nodes.reserve(items.size() / 2 + 1);
+        BuildNode(boxes, items.data(), items.size());
+    }
+
+    void Clear() {
+        nodes.clear();
+        visibleBits.clear();
+        itemCount = 0;
+    }
+
+    // Positions of the items inside or crossing the frustum, in ascending
+    // order. Conservative in the same way as Frustum::Classify.
+    void Query(const Frustum& frustum, std::vector<int>& visible) {
+        visible.clear();
+        if (nodes.empty()) return;
+
+        stack.clear();
+        stack.push_back(0);
+        while (!stack.empty()) {
+            uint32_t entry = stack.back();
+            stack.pop_back();
+            bool inside = entry & INSIDE_BIT;
+            const Node& node = nodes[entry & ~INSIDE_BIT];
+
+            int outside = 0, crossing = 0;
+            if (!inside) Classify4(frustum, node, outside, crossing);
+
+            for (int c = 0; c < 4; c++) {
+                uint32_t child = node.child[c];
+                if (child == EMPTY || (outside >> c & 1)) continue;
+                if (child & ITEM_BIT) {
+                    uint32_t item = child & ~ITEM_BIT;
+                    visibleBits[item / 64] |= uint64_t(1) << (item % 64);
+                } else {
+                    bool childInside = inside || !(crossing >> c & 1);
+                    stack.push_back(child | (childInside ? INSIDE_BIT : 0));
+                }
+            }
+        }
+
+        // The walk finds items in tree order; reading them back from a
+        // bitset puts them in ascending order without a sort
+        for (size_t word = 0; word < visibleBits.size(); word++) {
+            uint64_t bits = visibleBits[word];
+            visibleBits[word] = 0;
+            while (bits) {
+                visible.push_back(static_cast<int>(word * 64 + LowestBit(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    size_t ItemCount() const { return itemCount; }
+    size_t NodeCount() const { return nodes.size(); }
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr uint32_t ITEM_BIT = 1u << 31;   // On children: an item position, not a node
+    static constexpr uint32_t INSIDE_BIT = 1u << 31; // On stack entries: subtree known to be inside
+
+    // Slots past the last child keep an inverted box, so they also come out
+    // as outside if tested
+    struct Node {
+        float minX[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+        float minY[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+        float minZ[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+        float maxX[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+        float maxY[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+        float maxZ[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+        uint32_t child[4] = {EMPTY, EMPTY, EMPTY, EMPTY};
+    };
+
+    // Bits of outside and crossing are set per child slot
+    static void Classify4(const Frustum& frustum, const Node& node, int& outside, int& crossing) {
+#ifdef PCD_CULL_SSE2
+        const __m128 minX = _mm_loadu_ps(node.minX), minY = _mm_loadu_ps(node.minY), minZ = _mm_loadu_ps(node.minZ);
+        const __m128 maxX = _mm_loadu_ps(node.maxX), maxY = _mm_loadu_ps(node.maxY), maxZ = _mm_loadu_ps(node.maxZ);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 out = zero, cross = zero;
+        for (const auto& p : frustum.planes) {
+            // The corner choice depends only on the plane, so it is made once
+            // for all four boxes; the sums run in the order Classify uses
+            __m128 a = _mm_set1_ps(p[0]), b = _mm_set1_ps(p[1]), c = _mm_set1_ps(p[2]), d = _mm_set1_ps(p[3]);
+            __m128 farthest = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(a, p[0] >= 0 ? maxX : minX), _mm_mul_ps(b, p[1] >= 0 ? maxY : minY)),
+                _mm_mul_ps(c, p[2] >= 0 ? maxZ : minZ)), d);
+            __m128 nearest = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(a, p[0] >= 0 ? minX : maxX), _mm_mul_ps(b, p[1] >= 0 ? minY : maxY)),
+                _mm_mul_ps(c, p[2] >= 0 ? minZ : maxZ)), d);
+            out = _mm_or_ps(out, _mm_cmplt_ps(farthest, zero));
+            cross = _mm_or_ps(cross, _mm_cmplt_ps(nearest, zero));
+        }
+        outside = _mm_movemask_ps(out);
+        crossing = _mm_movemask_ps(cross);
+#else
+        outside = crossing = 0;
+        for (int i = 0; i < 4; i++) {
+            Frustum::Result result = frustum.Classify(Vec3(node.minX[i], node.minY[i], node.minZ[i]),
+                                                      Vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+            if (result == Frustum::OUTSIDE) outside |= 1 << i;
+            if (result == Frustum::INTERSECTS) crossing |= 1 << i;
+        }
+#endif
+    }
+
+    // Splits items into up to four groups, two median splits on the longest
+    // axis of their centers, and makes each group of more than one a child node
+    uint32_t BuildNode(const std::vector<BrushBounds>& boxes, uint32_t* items, size_t count) {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+
+        size_t bounds[5] = {0, 1, 2, 3, 4};
+        int groups = 4;
+        if (count <= 4) {
+            groups = static_cast<int>(count);
+        } else {
+            size_t half = Split(boxes, items, count);
+            bounds[1] = Split(boxes, items, half);
+            bounds[2] = half;
+            bounds[3] = half + Split(boxes, items + half, count - half);
+            bounds[4] = count;
+        }
+
+        for (int g = 0; g < groups; g++) {
+            uint32_t* group = items + bounds[g];
+            size_t size = bounds[g + 1] - bounds[g];
+
+            Vec3 min = boxes[group[0]].min, max = boxes[group[0]].max;
+            for (size_t i = 1; i < size; i++) {
+                const BrushBounds& b = boxes[group[i]];
+                min = Vec3(std::min(min.x, b.min.x), std::min(min.y, b.min.y), std::min(min.z, b.min.z));
+                max = Vec3(std::max(max.x, b.max.x), std::max(max.y, b.max.y), std::max(max.z, b.max.z));
+            }
+            uint32_t child = size == 1 ? (group[0] | ITEM_BIT) : BuildNode(boxes, group, size);
+
+            // Recursion may have grown nodes, so index it afresh
+            Node& node = nodes[index];
+            node.minX[g] = min.x; node.minY[g] = min.y; node.minZ[g] = min.z;
+            node.maxX[g] = max.x; node.maxY[g] = max.y; node.maxZ[g] = max.z;
+            node.child[g] = child;
+        }
+        return index;
+    }
+
+    // Median split on the longest axis of the centers; returns the size of
+    // the lower half
+    static size_t Split(const std::vector<BrushBounds>& boxes, uint32_t* items, size_t count) {
+        Vec3 lo = Center(boxes[items[0]]), hi = lo;
+        for (size_t i = 1; i < count; i++) {
+            Vec3 c = Center(boxes[items[i]]);
+            lo = Vec3(std::min(lo.x, c.x), std::min(lo.y, c.y), std::min(lo.z, c.z));
+            hi = Vec3(std::max(hi.x, c.x), std::max(hi.y, c.y), std::max(hi.z, c.z));
+        }
+        Vec3 extent = hi - lo;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        size_t half = count / 2;
+        std::nth_element(items, items + half, items + count, [&](uint32_t a, uint32_t b) {
+            return Axis(Center(boxes[a]), axis) < Axis(Center(boxes[b]), axis);
+        });
+        return half;
+    }
+
+    static int LowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int bit = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    static Vec3 Center(const BrushBounds& b) { return (b.min + b.max) * 0.5f; }
+    static float Axis(const Vec3& v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+    std::vector<Node> nodes; // Root first
+    std::vector<uint32_t> stack;
+    std::vector<uint64_t> visibleBits; // By item; cleared again as Query reads it
+    size_t itemCount = 0;
+};
+
+} // namespace PCD
+
+#endif // PCD_CULL_TREE_H
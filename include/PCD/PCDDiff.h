@@ -0,0 +1,735 @@
+#ifndef PCD_DIFF_H
+#define PCD_DIFF_H
+
+// Map deltas keyed on stable brush/entity/texture IDs.
+//
+// A delta is a list of records that turn one Map revision into another:
+// whole objects that were added or changed, removals by ID, and the brush or
+// entity order when it moved. The autosave journal (PCDJournal.h) appends
+// the same records once per checkpoint; PCD::Diff/PCD::Patch wrap them for
+// shipping a map revision to a client that already has an older one.
+//
+//   record: [RecordHeader][payload]
+//   delta:  [DeltaHeader][records, BlockCompressor-compressed when smaller]
+
+#include "PCDFile.h"
+#include "PCDSchema.h"
+#include "PCDHash.h"
+#include "PCDCompression.h"
+#include "PCDWorkerPool.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace PCD {
+
+// Record encoding shared by deltas and the journal
+class MapRecords {
+public:
+    enum RecordType : uint32_t {
+        REC_INFO           = 1, // Map name/author and next IDs
+        REC_BRUSH          = 2, // Full brush, replaces any brush with the same ID
+        REC_BRUSH_REMOVE   = 3, // Brush ID
+        REC_BRUSH_ORDER    = 4, // Every brush ID in map order
+        REC_ENTITY         = 5,
+        REC_ENTITY_REMOVE  = 6,
+        REC_ENTITY_ORDER   = 7,
+        REC_TEXTURE        = 8,
+        REC_TEXTURE_REMOVE = 9,
+        REC_COMMIT         = 10, // Journal only: checkpoint number, ends a batch
+    };
+
+    struct RecordHeader {
+        uint32_t type;
+        uint32_t size;
+        uint64_t hash; // Hash64 of the payload, seeded with type
+    };
+
+    using Reader = ByteReader;
+
+    struct Record {
+        uint32_t type;
+        Reader payload;
+    };
+
+    static void Append(std::vector<uint8_t>& out, uint32_t type, const void* payload, size_t size) {
+        RecordHeader rec;
+        rec.type = type;
+        rec.size = static_cast<uint32_t>(size);
+        rec.hash = Hash64(payload, size, type);
+        Put(out, rec);
+        const uint8_t* p = static_cast<const uint8_t*>(payload);
+        out.insert(out.end(), p, p + size);
+    }
+
+    // Reads the record at pos and advances past it. False at the end of the
+    // data or at a torn/corrupt record.
+    static bool Next(const uint8_t* data, size_t size, size_t& pos, Record& record) {
+        RecordHeader rec;
+        if (size - pos < sizeof(rec)) return false;
+        memcpy(&rec, data + pos, sizeof(rec));
+        const uint8_t* payload = data + pos + sizeof(rec);
+        if (rec.size > size - pos - sizeof(rec) || Hash64(payload, rec.size, rec.type) != rec.hash) {
+            return false;
+        }
+        pos += sizeof(rec) + rec.size;
+        record = Record{rec.type, Reader(payload, rec.size)};
+        return true;
+    }
+
+    template <typename T>
+    static void Put(std::vector<uint8_t>& out, const T& value) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), p, p + sizeof(T));
+    }
+
+    // Brushes, entities and map info are encoded by their Schema (PCDSchema.h)
+    template <typename T>
+    static void Encode(const T& obj, std::vector<uint8_t>& out) { SchemaCodec::Encode(obj, out); }
+
+    template <typename T>
+    static bool Decode(Reader& in, T& obj) { return SchemaCodec::Decode(in, obj); }
+
+    // Textures carry their pixels after the schema fields; deferred pixels
+    // are read from the texture's source file
+    static bool EncodeTexture(const Texture& tex, std::vector<uint8_t>& out) {
+        SchemaCodec::Encode(tex, out);
+        Put(out, static_cast<uint32_t>(tex.DataSize()));
+        size_t offset = out.size();
+        out.resize(offset + static_cast<size_t>(tex.DataSize()));
+        if (!tex.IsDeferred()) {
+            if (!tex.data.empty()) memcpy(out.data() + offset, tex.data.data(), tex.data.size());
+            return true;
+        }
+        return ReadTextureSource(tex, out.data() + offset);
+    }
+
+    static bool DecodeTexture(Reader& in, Texture& tex) {
+        if (!SchemaCodec::Decode(in, tex)) return false;
+        uint32_t size = in.Get<uint32_t>();
+        const uint8_t* data = in.Bytes(size);
+        if (!in.ok) return false;
+        tex.data.assign(data, data + size);
+        return true;
+    }
+
+    static void DecodeIDs(Reader& in, std::vector<uint32_t>& ids) {
+        ids.resize(size_t(in.end - in.ptr) / sizeof(uint32_t));
+        for (auto& id : ids) id = in.Get<uint32_t>();
+    }
+};
+
+struct DiffStats {
+    uint32_t brushesWritten = 0;
+    uint32_t brushesRemoved = 0;
+    uint32_t entitiesWritten = 0;
+    uint32_t entitiesRemoved = 0;
+    uint32_t texturesWritten = 0;
+    uint32_t texturesRemoved = 0;
+    uint32_t texturesUnreadable = 0; // Deferred pixels missing from their source file
+    uint64_t bytes = 0; // Encoded size
+};
+
+// IDs of the objects edited in place since a MapDiffer last saw the map.
+// Added, removed and reordered objects are found without being listed.
+struct MapChanges {
+    std::unordered_set<uint32_t> brushes;
+    std::unordered_set<uint32_t> entities;
+    std::unordered_set<uint32_t> textures;
+    bool all = false; // Anything may have changed, e.g. the map was replaced
+
+    void Clear() {
+        brushes.clear();
+        entities.clear();
+        textures.clear();
+        all = false;
+    }
+};
+
+// Per-ID content hashes of one map revision: enough to diff against it
+// without keeping the revision itself around
+class MapDiffer {
+public:
+    // Records the state of map. Geometry hashing is spread over threads
+    // (0 = all cores); deferred texture pixels are read from disk.
+    void Track(const Map& map, unsigned threads = 1) {
+        brushOrder.resize(map.brushes.size());
+        entityOrder.resize(map.entities.size());
+        std::vector<uint64_t> brushHashes(map.brushes.size());
+        std::vector<uint64_t> entityHashes(map.entities.size());
+        WorkerPool& pool = WorkerPool::Shared();
+        pool.ParallelFor(map.brushes.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) brushHashes[i] = HashObject(map.brushes[i]);
+        });
+        pool.ParallelFor(map.entities.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) entityHashes[i] = HashObject(map.entities[i]);
+        });
+
+        brushes.clear();
+        entities.clear();
+        textures.clear();
+        unreadTextures.clear();
+        brushes.reserve(map.brushes.size());
+        entities.reserve(map.entities.size());
+        // Duplicate IDs: the first object wins, same as in MapPatcher
+        for (size_t i = 0; i < map.brushes.size(); i++) {
+            brushOrder[i] = map.brushes[i].id;
+            brushes.emplace(map.brushes[i].id, brushHashes[i]);
+        }
+        for (size_t i = 0; i < map.entities.size(); i++) {
+            entityOrder[i] = map.entities[i].id;
+            entities.emplace(map.entities[i].id, entityHashes[i]);
+        }
+        for (const auto& [id, tex] : map.textures) textures.emplace(id, HashTexture(tex));
+        infoHash = HashObject(map);
+    }
+
+    // Appends the records that turn the tracked revision into map, then
+    // tracks map instead. Only the objects listed in changes and the ones
+    // not tracked yet are hashed again; the rest are taken as unchanged.
+    // A texture whose deferred pixels cannot be read is left out and
+    // counted, and tried again on every later call until it is written.
+    DiffStats Advance(const Map& map, const MapChanges& changes, std::vector<uint8_t>& out, unsigned threads = 1) {
+        if (changes.all) {
+            MapDiffer next;
+            next.Track(map, threads);
+            DiffStats stats = WriteRecords(*this, next, map, out);
+            *this = std::move(next);
+            return stats;
+        }
+
+        DiffStats stats;
+        size_t start = out.size();
+        std::vector<uint8_t> payload;
+
+        uint64_t info = HashObject(map);
+        if (info != infoHash) {
+            MapRecords::Encode<Map>(map, payload);
+            MapRecords::Append(out, MapRecords::REC_INFO, payload.data(), payload.size());
+            infoHash = info;
+        }
+
+        // Textures first so brushes never reference one the reader hasn't seen
+        for (const auto& [id, tex] : map.textures) {
+            auto it = textures.find(id);
+            if (it != textures.end() && !changes.textures.count(id) && !unreadTextures.count(id)) continue;
+            // Encoded first, so deferred pixels are read once for both
+            payload.clear();
+            if (!MapRecords::EncodeTexture(tex, payload)) {
+                unreadTextures.insert(id);
+                stats.texturesUnreadable++;
+                continue;
+            }
+            unreadTextures.erase(id);
+            uint64_t hash = HashEncodedTexture(tex, payload);
+            if (it != textures.end() && it->second == hash) continue;
+            textures[id] = hash;
+            MapRecords::Append(out, MapRecords::REC_TEXTURE, payload.data(), payload.size());
+            stats.texturesWritten++;
+        }
+        if (textures.size() != map.textures.size()) {
+            for (auto it = textures.begin(); it != textures.end();) {
+                if (map.textures.count(it->first)) {
+                    ++it;
+                    continue;
+                }
+                MapRecords::Append(out, MapRecords::REC_TEXTURE_REMOVE, &it->first, sizeof(it->first));
+                stats.texturesRemoved++;
+                unreadTextures.erase(it->first);
+                it = textures.erase(it);
+            }
+        }
+
+        AdvanceObjects(map.brushes, changes.brushes, brushes, brushOrder, MapRecords::REC_BRUSH,
+                       MapRecords::REC_BRUSH_REMOVE, MapRecords::REC_BRUSH_ORDER, MapRecords::Encode<Brush>,
+                       threads, out, stats.brushesWritten, stats.brushesRemoved);
+        AdvanceObjects(map.entities, changes.entities, entities, entityOrder, MapRecords::REC_ENTITY,
+                       MapRecords::REC_ENTITY_REMOVE, MapRecords::REC_ENTITY_ORDER, MapRecords::Encode<Entity>,
+                       threads, out, stats.entitiesWritten, stats.entitiesRemoved);
+
+        stats.bytes = out.size() - start;
+        return stats;
+    }
+
+    // Identity of the tracked revision
+    uint64_t Revision() const {
+        Hasher hasher;
+        hasher.UpdateValue(infoHash);
+        for (uint32_t id : brushOrder) hasher.UpdateValue(brushes.at(id));
+        for (uint32_t id : entityOrder) hasher.UpdateValue(entities.at(id));
+        std::vector<std::pair<uint32_t, uint64_t>> sorted(textures.begin(), textures.end());
+        std::sort(sorted.begin(), sorted.end());
+        for (const auto& [id, hash] : sorted) {
+            hasher.UpdateValue(id); // Not the pair itself: its padding is uninitialized
+            hasher.UpdateValue(hash);
+        }
+        return hasher.Digest();
+    }
+
+    // Appends the records that turn base into target; targetMap supplies
+    // the objects and must be the map target tracked
+    static DiffStats WriteRecords(const MapDiffer& base, const MapDiffer& target, const Map& targetMap,
+                                  std::vector<uint8_t>& out) {
+        DiffStats stats;
+        size_t start = out.size();
+        std::vector<uint8_t> payload;
+
+        if (base.infoHash != target.infoHash) {
+            MapRecords::Encode<Map>(targetMap, payload);
+            MapRecords::Append(out, MapRecords::REC_INFO, payload.data(), payload.size());
+        }
+
+        // Textures first so brushes never reference one the reader hasn't seen
+        for (const auto& [id, tex] : targetMap.textures) {
+            auto it = base.textures.find(id);
+            if (it != base.textures.end() && it->second == target.textures.at(id)) continue;
+            payload.clear();
+            if (!MapRecords::EncodeTexture(tex, payload)) {
+                stats.texturesUnreadable++;
+                continue;
+            }
+            MapRecords::Append(out, MapRecords::REC_TEXTURE, payload.data(), payload.size());
+            stats.texturesWritten++;
+        }
+        stats.texturesRemoved = WriteRemovals(base.textures, target.textures, MapRecords::REC_TEXTURE_REMOVE, out);
+
+        stats.brushesWritten = WriteChanged(targetMap.brushes, base.brushes, target.brushes,
+                                            MapRecords::REC_BRUSH, MapRecords::Encode<Brush>, out);
+        stats.brushesRemoved = WriteRemovals(base.brushes, target.brushes, MapRecords::REC_BRUSH_REMOVE, out);
+        stats.entitiesWritten = WriteChanged(targetMap.entities, base.entities, target.entities,
+                                             MapRecords::REC_ENTITY, MapRecords::Encode<Entity>, out);
+        stats.entitiesRemoved = WriteRemovals(base.entities, target.entities, MapRecords::REC_ENTITY_REMOVE, out);
+
+        WriteOrderIfMoved(base.brushOrder, base.brushes, target.brushOrder, target.brushes,
+                          MapRecords::REC_BRUSH_ORDER, out);
+        WriteOrderIfMoved(base.entityOrder, base.entities, target.entityOrder, target.entities,
+                          MapRecords::REC_ENTITY_ORDER, out);
+
+        stats.bytes = out.size() - start;
+        return stats;
+    }
+
+private:
+    std::unordered_map<uint32_t, uint64_t> brushes;  // ID -> content hash
+    std::unordered_map<uint32_t, uint64_t> entities;
+    std::unordered_map<uint32_t, uint64_t> textures;
+    std::unordered_set<uint32_t> unreadTextures; // Left out of Advance's output so far
+    std::vector<uint32_t> brushOrder;
+    std::vector<uint32_t> entityOrder;
+    uint64_t infoHash = HashObject(Map());
+
+    template <typename T, typename Encode>
+    static uint32_t WriteChanged(const std::vector<T>& objects, const std::unordered_map<uint32_t, uint64_t>& base,
+                                 const std::unordered_map<uint32_t, uint64_t>& target, uint32_t type,
+                                 Encode encode, std::vector<uint8_t>& out) {
+        uint32_t written = 0;
+        std::unordered_set<uint32_t> seen;
+        std::vector<uint8_t> payload;
+        for (const auto& obj : objects) {
+            if (!seen.insert(obj.id).second) continue;
+            auto it = base.find(obj.id);
+            if (it != base.end() && it->second == target.at(obj.id)) continue;
+            payload.clear();
+            encode(obj, payload);
+            MapRecords::Append(out, type, payload.data(), payload.size());
+            written++;
+        }
+        return written;
+    }
+
+    // Advance for brushes or entities. While the IDs still run in tracked
+    // order nothing was added, removed or moved, so only the listed objects
+    // are looked up.
+    template <typename T, typename Encode>
+    static void AdvanceObjects(const std::vector<T>& objects, const std::unordered_set<uint32_t>& changed,
+                               std::unordered_map<uint32_t, uint64_t>& hashes, std::vector<uint32_t>& order,
+                               uint32_t type, uint32_t removeType, uint32_t orderType, Encode encode,
+                               unsigned threads, std::vector<uint8_t>& out, uint32_t& written, uint32_t& removed) {
+        std::vector<size_t> dirty;
+        std::unordered_set<uint32_t> added;
+        bool sameOrder = objects.size() == order.size();
+        for (size_t i = 0; i < objects.size(); i++) {
+            uint32_t id = objects[i].id;
+            sameOrder = sameOrder && order[i] == id;
+            bool known = sameOrder || hashes.count(id);
+            if (!known && !added.insert(id).second) continue; // Duplicate ID, the first one is written
+            if (!known || changed.count(id)) dirty.push_back(i);
+        }
+
+        std::vector<uint64_t> dirtyHashes(dirty.size());
+        WorkerPool::Shared().ParallelFor(dirty.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) dirtyHashes[k] = HashObject(objects[dirty[k]]);
+        });
+
+        // Duplicate IDs: the first object wins, same as in MapPatcher
+        std::unordered_set<uint32_t> seen;
+        std::vector<uint8_t> payload;
+        for (size_t k = 0; k < dirty.size(); k++) {
+            const T& obj = objects[dirty[k]];
+            if (!seen.insert(obj.id).second) continue;
+            auto it = hashes.find(obj.id);
+            if (it != hashes.end() && it->second == dirtyHashes[k]) continue;
+            hashes[obj.id] = dirtyHashes[k];
+            payload.clear();
+            encode(obj, payload);
+            MapRecords::Append(out, type, payload.data(), payload.size());
+            written++;
+        }
+        if (sameOrder) return;
+
+        std::vector<uint32_t> current(objects.size());
+        std::unordered_set<uint32_t> present;
+        present.reserve(objects.size());
+        for (size_t i = 0; i < objects.size(); i++) {
+            current[i] = objects[i].id;
+            present.insert(current[i]);
+        }
+        for (auto it = hashes.begin(); it != hashes.end();) {
+            if (present.count(it->first)) {
+                ++it;
+                continue;
+            }
+            MapRecords::Append(out, removeType, &it->first, sizeof(it->first));
+            removed++;
+            it = hashes.erase(it);
+        }
+
+        // Same expectation as WriteOrderIfMoved: survivors keep their order,
+        // new objects follow
+        std::vector<uint32_t> expected;
+        expected.reserve(current.size());
+        for (uint32_t id : order) {
+            if (present.count(id)) expected.push_back(id);
+        }
+        for (uint32_t id : current) {
+            if (added.count(id)) expected.push_back(id);
+        }
+        if (expected != current) {
+            MapRecords::Append(out, orderType, current.data(), current.size() * sizeof(uint32_t));
+        }
+        order = std::move(current);
+    }
+
+    static uint32_t WriteRemovals(const std::unordered_map<uint32_t, uint64_t>& base,
+                                  const std::unordered_map<uint32_t, uint64_t>& target, uint32_t type,
+                                  std::vector<uint8_t>& out) {
+        uint32_t removed = 0;
+        for (const auto& entry : base) {
+            if (target.count(entry.first)) continue;
+            MapRecords::Append(out, type, &entry.first, sizeof(entry.first));
+            removed++;
+        }
+        return removed;
+    }
+
+    // MapPatcher erases removed objects in place and appends new ones, so
+    // only a real reorder needs the full ID list
+    static void WriteOrderIfMoved(const std::vector<uint32_t>& baseOrder,
+                                  const std::unordered_map<uint32_t, uint64_t>& base,
+                                  const std::vector<uint32_t>& targetOrder,
+                                  const std::unordered_map<uint32_t, uint64_t>& target,
+                                  uint32_t type, std::vector<uint8_t>& out) {
+        std::vector<uint32_t> expected;
+        expected.reserve(targetOrder.size());
+        for (uint32_t id : baseOrder) {
+            if (target.count(id)) expected.push_back(id);
+        }
+        for (uint32_t id : targetOrder) {
+            if (!base.count(id)) expected.push_back(id);
+        }
+        if (expected != targetOrder) {
+            MapRecords::Append(out, type, targetOrder.data(), targetOrder.size() * sizeof(uint32_t));
+        }
+    }
+
+    template <typename T>
+    static uint64_t HashObject(const T& obj) {
+        Hasher hasher;
+        SchemaCodec::Hash(obj, hasher);
+        return hasher.Digest();
+    }
+
+    static void HashTextureHeader(Hasher& hasher, const Texture& tex) {
+        SchemaCodec::Hash(tex, hasher);
+        hasher.UpdateValue(tex.DataSize());
+    }
+
+    static uint64_t HashTexture(const Texture& tex) {
+        Hasher hasher;
+        HashTextureHeader(hasher, tex);
+        if (!tex.IsDeferred()) {
+            hasher.Update(tex.data.data(), tex.data.size());
+        } else {
+            std::vector<uint8_t> pixels(static_cast<size_t>(tex.source.size));
+            if (ReadTextureSource(tex, pixels.data())) hasher.Update(pixels.data(), pixels.size());
+        }
+        return hasher.Digest();
+    }
+
+    // Same value as HashTexture, from a MapRecords::EncodeTexture payload,
+    // whose pixels are its last DataSize() bytes
+    static uint64_t HashEncodedTexture(const Texture& tex, const std::vector<uint8_t>& payload) {
+        Hasher hasher;
+        HashTextureHeader(hasher, tex);
+        size_t size = static_cast<size_t>(tex.DataSize());
+        hasher.Update(payload.data() + payload.size() - size, size);
+        return hasher.Digest();
+    }
+};
+
+// Applies record batches to a map in place, keeping ID -> index lookups
+// across batches
+class MapPatcher {
+public:
+    explicit MapPatcher(Map& map) : map(map) {}
+
+    // Decodes the whole batch before touching the map, so a corrupt record
+    // leaves the map as it was
+    bool Apply(std::vector<MapRecords::Record>& batch) {
+        bool hasInfo = false;
+        Map info;
+        std::vector<Brush> putBrushes;
+        std::vector<Entity> putEntities;
+        std::vector<Texture> putTextures;
+        std::unordered_set<uint32_t> removedBrushes, removedEntities, removedTextures;
+        std::vector<uint32_t> brushOrder, entityOrder;
+        bool hasBrushOrder = false, hasEntityOrder = false;
+
+        for (auto& record : batch) {
+            MapRecords::Reader& in = record.payload;
+            switch (record.type) {
+            case MapRecords::REC_INFO:
+                hasInfo = MapRecords::Decode(in, info);
+                break;
+            case MapRecords::REC_BRUSH:
+                putBrushes.emplace_back();
+                MapRecords::Decode(in, putBrushes.back());
+                break;
+            case MapRecords::REC_ENTITY:
+                putEntities.emplace_back();
+                MapRecords::Decode(in, putEntities.back());
+                break;
+            case MapRecords::REC_TEXTURE:
+                putTextures.emplace_back();
+                MapRecords::DecodeTexture(in, putTextures.back());
+                break;
+            case MapRecords::REC_BRUSH_REMOVE: removedBrushes.insert(in.Get<uint32_t>()); break;
+            case MapRecords::REC_ENTITY_REMOVE: removedEntities.insert(in.Get<uint32_t>()); break;
+            case MapRecords::REC_TEXTURE_REMOVE: removedTextures.insert(in.Get<uint32_t>()); break;
+            case MapRecords::REC_BRUSH_ORDER:
+                MapRecords::DecodeIDs(in, brushOrder);
+                hasBrushOrder = true;
+                break;
+            case MapRecords::REC_ENTITY_ORDER:
+                MapRecords::DecodeIDs(in, entityOrder);
+                hasEntityOrder = true;
+                break;
+            default:
+                break; // Unknown records from a newer writer are skipped
+            }
+            if (!in.ok) return false;
+        }
+
+        if (hasInfo) {
+            map.name = std::move(info.name);
+            map.author = std::move(info.author);
+            map.nextBrushID = info.nextBrushID;
+            map.nextEntityID = info.nextEntityID;
+            map.nextTextureID = info.nextTextureID;
+        }
+        for (auto& tex : putTextures) {
+            uint32_t id = tex.id;
+            map.textures[id] = std::move(tex);
+        }
+        for (uint32_t id : removedTextures) map.textures.erase(id);
+        if (!putTextures.empty() || !removedTextures.empty()) map.InvalidateTextureIndex();
+
+        if (!indexValid) BuildIndex();
+        for (auto& brush : putBrushes) Put(map.brushes, brushIndex, std::move(brush));
+        for (auto& ent : putEntities) Put(map.entities, entityIndex, std::move(ent));
+
+        if (!removedBrushes.empty() || hasBrushOrder) {
+            Rebuild(map.brushes, removedBrushes, hasBrushOrder ? &brushOrder : nullptr);
+            indexValid = false;
+        }
+        if (!removedEntities.empty() || hasEntityOrder) {
+            Rebuild(map.entities, removedEntities, hasEntityOrder ? &entityOrder : nullptr);
+            indexValid = false;
+        }
+        if (!putEntities.empty() || !removedEntities.empty() || hasEntityOrder) map.InvalidateEntityIndex();
+        return true;
+    }
+
+private:
+    Map& map;
+    std::unordered_map<uint32_t, size_t> brushIndex;
+    std::unordered_map<uint32_t, size_t> entityIndex;
+    bool indexValid = false;
+
+    void BuildIndex() {
+        brushIndex.clear();
+        entityIndex.clear();
+        for (size_t i = 0; i < map.brushes.size(); i++) brushIndex.emplace(map.brushes[i].id, i);
+        for (size_t i = 0; i < map.entities.size(); i++) entityIndex.emplace(map.entities[i].id, i);
+        indexValid = true;
+    }
+
+    template <typename T>
+    static void Put(std::vector<T>& objects, std::unordered_map<uint32_t, size_t>& index, T&& obj) {
+        auto it = index.find(obj.id);
+        if (it != index.end()) {
+            objects[it->second] = std::move(obj);
+            return;
+        }
+        index.emplace(obj.id, objects.size());
+        objects.push_back(std::move(obj));
+    }
+
+    // Erases removed IDs, then applies order (IDs it misses keep their
+    // relative order at the end)
+    template <typename T>
+    static void Rebuild(std::vector<T>& objects, const std::unordered_set<uint32_t>& removed,
+                        const std::vector<uint32_t>* order) {
+        objects.erase(std::remove_if(objects.begin(), objects.end(),
+                                     [&](const T& obj) { return removed.count(obj.id) > 0; }),
+                      objects.end());
+        if (!order) return;
+
+        std::unordered_map<uint32_t, size_t> index;
+        for (size_t i = 0; i < objects.size(); i++) index.emplace(objects[i].id, i);
+        std::vector<bool> placed(objects.size(), false);
+        std::vector<T> sorted;
+        sorted.reserve(objects.size());
+        for (uint32_t id : *order) {
+            auto it = index.find(id);
+            if (it == index.end() || placed[it->second]) continue;
+            placed[it->second] = true;
+            sorted.push_back(std::move(objects[it->second]));
+        }
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (!placed[i]) sorted.push_back(std::move(objects[i]));
+        }
+        objects = std::move(sorted);
+    }
+};
+
+// ---- Deltas ----
+
+const char DELTA_MAGIC[4] = {'P', 'C', 'D', 'D'};
+const uint32_t DELTA_VERSION = 2;
+const uint32_t DELTA_FLAG_COMPRESSED = 1 << 0;
+
+struct DeltaHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t baseRevision;   // MapRevision the delta applies to
+    uint64_t targetRevision; // MapRevision after applying it
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t rawSize;        // Record bytes before compression
+    uint64_t payloadSize;    // Bytes following this header
+};
+
+// Content identity of a map revision: equal maps hash equal no matter how
+// they were stored or loaded
+inline uint64_t MapRevision(const Map& map, unsigned threads = 1) {
+    MapDiffer differ;
+    differ.Track(map, threads);
+    return differ.Revision();
+}
+
+// Delta from a tracked base revision to target (tracked by targetState).
+// Servers keep one MapDiffer per revision they may have handed out instead
+// of the old maps themselves.
+inline DiffStats Diff(const MapDiffer& base, const MapDiffer& targetState, const Map& target,
+                      std::vector<uint8_t>& delta) {
+    std::vector<uint8_t> records;
+    DiffStats stats = MapDiffer::WriteRecords(base, targetState, target, records);
+
+    DeltaHeader header = {};
+    memcpy(header.magic, DELTA_MAGIC, 4);
+    header.version = DELTA_VERSION;
+    header.baseRevision = base.Revision();
+    header.targetRevision = targetState.Revision();
+    header.rawSize = records.size();
+
+    std::vector<uint8_t> compressed;
+    BlockCompressor::Compress(records.data(), records.size(), compressed);
+    bool useCompressed = compressed.size() < records.size();
+    const std::vector<uint8_t>& payload = useCompressed ? compressed : records;
+    header.flags = useCompressed ? DELTA_FLAG_COMPRESSED : 0;
+    header.payloadSize = payload.size();
+
+    delta.resize(sizeof(header));
+    memcpy(delta.data(), &header, sizeof(header));
+    delta.insert(delta.end(), payload.begin(), payload.end());
+    stats.bytes = delta.size();
+    return stats;
+}
+
+inline DiffStats Diff(const Map& base, const Map& target, std::vector<uint8_t>& delta, unsigned threads = 1) {
+    MapDiffer baseState, targetState;
+    baseState.Track(base, threads);
+    targetState.Track(target, threads);
+    return Diff(baseState, targetState, target, delta);
+}
+
+inline bool ReadDeltaHeader(const uint8_t* delta, size_t size, DeltaHeader& header) {
+    if (size < sizeof(header)) return false;
+    memcpy(&header, delta, sizeof(header));
+    return memcmp(header.magic, DELTA_MAGIC, 4) == 0 && header.version == DELTA_VERSION &&
+           header.payloadSize == size - sizeof(header);
+}
+
+// Applies a delta in place. Refuses (leaving map untouched) unless map is the
+// delta's base revision; returns false if the result doesn't hash to the
+// target revision, in which case the caller should fetch the full map.
+inline bool Patch(Map& map, const uint8_t* delta, size_t size, unsigned threads = 1) {
+    DeltaHeader header;
+    if (!ReadDeltaHeader(delta, size, header)) {
+        std::cerr << "[PCD] Invalid map delta\n";
+        return false;
+    }
+    if (MapRevision(map, threads) != header.baseRevision) {
+        std::cerr << "[PCD] Map delta does not apply to this revision\n";
+        return false;
+    }
+
+    const uint8_t* payload = delta + sizeof(header);
+    std::vector<uint8_t> records;
+    if (header.flags & DELTA_FLAG_COMPRESSED) {
+        // Match lengths are bounded, so a tiny payload can't claim a huge size
+        if (header.rawSize > header.payloadSize * 255 + 64) return false;
+        records.resize(static_cast<size_t>(header.rawSize));
+        if (!BlockCompressor::Decompress(payload, header.payloadSize, records.data(), records.size())) {
+            std::cerr << "[PCD] Corrupt map delta\n";
+            return false;
+        }
+        payload = records.data();
+    } else if (header.rawSize != header.payloadSize) {
+        return false;
+    }
+
+    std::vector<MapRecords::Record> batch;
+    size_t pos = 0;
+    MapRecords::Record record{0, MapRecords::Reader(nullptr, 0)};
+    while (MapRecords::Next(payload, static_cast<size_t>(header.rawSize), pos, record)) batch.push_back(record);
+    if (pos != header.rawSize) {
+        std::cerr << "[PCD] Corrupt map delta\n";
+        return false;
+    }
+
+    MapPatcher patcher(map);
+    if (!patcher.Apply(batch)) {
+        std::cerr << "[PCD] Corrupt map delta\n";
+        return false;
+    }
+    if (MapRevision(map, threads) != header.targetRevision) {
+        std::cerr << "[PCD] Patched map does not match the delta's target revision\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace PCD
+
+#endif // PCD_DIFF_H
@@ -2,6 +2,12 @@
 #define PCD_EDITOR_STATE_H
 
 #include "PCDTypes.h"
+#include "PCDFile.h"
+#include "PCDDiff.h"
+#include "PCDUndo.h"
+#include "PCDPickTree.h"
+#include "PCDMapStats.h"
+#include "PCDSelection.h"
 #include <vector>
 #include <string>
 
@@ -25,6 +31,9 @@ struct EditorSettings {
     float gridExtent = 50.0f;
     GridPlane currentPlane = GridPlane::XZ;
     float gridHeight = 0.0f;
+    bool packGeometry = false;                 // SaveOptions::packGeometry for File > Save
+    float packPrecision = 1.0f / 1024.0f;
+    size_t undoMemoryBudget = UndoHistory::DEFAULT_BUDGET; // Bytes of undo/redo history kept
 };
 
 struct EditorState {
@@ -33,11 +42,12 @@ struct EditorState {
     EditorTool currentTool = EditorTool::SELECT;
     EntityType entityToPlace = ENT_INFO_PLAYER_START;
     
-    // Selection
+    // Selection: the primary object the panels and gizmo act on, and the
+    // multi-selection that transforms and copies apply to as well
     int selectedBrushIndex = -1;
     int selectedEntityIndex = -1;
-    std::vector<int> selectedBrushes;
-    std::vector<int> selectedEntities;
+    SelectionSet selectedBrushes;
+    SelectionSet selectedEntities;
     
     // Creation
     bool isCreating = false;
@@ -49,71 +59,194 @@ struct EditorState {
     bool isTransforming = false;
     
     // Undo/Redo
-    std::vector<Map> undoStack;
-    std::vector<Map> redoStack;
-    static const int MAX_UNDO = 50;
+    UndoHistory history;
+    
+    // Ray picking; edits mark what they moved (see BrushChanged)
+    PickTree pickTree;
+    
+    // Statistics panel totals, kept up to date by the same marks
+    MapStats stats;
+    
+    // What the marks touched since the last autosave checkpoint
+    MapChanges journalChanges;
     
     // File
     std::string currentFilePath;
     bool hasUnsavedChanges = false;
     
     // Methods
+    // Starts an undo step. The edit that follows touches what it is about
+    // to modify or delete; new objects are picked up automatically.
     void PushUndo() {
-        undoStack.push_back(map);
-        if (undoStack.size() > MAX_UNDO) {
-            undoStack.erase(undoStack.begin());
+        history.SetBudget(settings.undoMemoryBudget);
+        history.Begin(map);
+    }
+    
+    void TouchBrush(int index) {
+        history.TouchBrush(map, index);
+        BrushChanged(index);
+    }
+    
+    void TouchEntity(int index) {
+        history.TouchEntity(map, index);
+        if (index >= 0 && index < static_cast<int>(map.entities.size())) {
+            pickTree.MarkEntity(map.entities[index].id);
+            journalChanges.entities.insert(map.entities[index].id);
+        }
+    }
+    
+    // Pulls in deferred pixels first: a copy kept for undo must not point
+    // into the map file, which the next save rewrites
+    void TouchTexture(uint32_t id) {
+        if (Texture* tex = map.GetTexture(id)) PCDReader::LoadTexturePixels(*tex);
+        history.TouchTexture(map, id);
+        TextureChanged(id);
+    }
+    
+    void TouchAll() {
+        for (auto& [id, tex] : map.textures) PCDReader::LoadTexturePixels(tex);
+        history.TouchAll(map);
+        MapReplaced();
+    }
+    
+    // Call after editing an object outside an undo step (keyboard nudges,
+    // property fields, gizmo drags); Touch* already marks it for picking,
+    // statistics and autosave
+    void BrushChanged(int index) {
+        if (index >= 0 && index < static_cast<int>(map.brushes.size())) {
+            pickTree.MarkBrush(map.brushes[index].id);
+            stats.MarkBrush(map.brushes[index].id);
+            journalChanges.brushes.insert(map.brushes[index].id);
+        }
+    }
+    
+    // Also updates the map's entity index, for name edits
+    void EntityChanged(int index) {
+        if (index >= 0 && index < static_cast<int>(map.entities.size())) {
+            map.EntityChanged(index);
+            pickTree.MarkEntity(map.entities[index].id);
+            journalChanges.entities.insert(map.entities[index].id);
         }
-        redoStack.clear();
     }
     
+    // Texture data changed outside an undo step, e.g. compression
+    void TextureChanged(uint32_t id) {
+        stats.MarkTextures();
+        journalChanges.textures.insert(id);
+    }
+    
+    // The whole map was loaded or rebuilt: picking, statistics and the
+    // next autosave start over
+    void MapReplaced() {
+        pickTree.Invalidate();
+        stats.Invalidate();
+        journalChanges.all = true;
+    }
+    
+    // Closes the current step, e.g. when a drag ends
+    void CommitUndo() { history.Commit(map); }
+    
+    bool CanUndo() const { return history.CanUndo(); }
+    bool CanRedo() const { return history.CanRedo(); }
+    
     void Undo() {
-        if (!undoStack.empty()) {
-            redoStack.push_back(map);
-            map = undoStack.back();
-            undoStack.pop_back();
+        uint32_t brushID = SelectedBrushID(), entityID = SelectedEntityID();
+        if (history.Undo(map)) {
+            MarkUndone();
             hasUnsavedChanges = true;
-            DeselectAll();
+            RebindSelection(brushID, entityID);
         }
     }
     
     void Redo() {
-        if (!redoStack.empty()) {
-            undoStack.push_back(map);
-            map = redoStack.back();
-            redoStack.pop_back();
+        uint32_t brushID = SelectedBrushID(), entityID = SelectedEntityID();
+        if (history.Redo(map)) {
+            MarkUndone();
             hasUnsavedChanges = true;
-            DeselectAll();
+            RebindSelection(brushID, entityID);
         }
     }
     
+    // Marks what the last undo or redo swapped, so picking, statistics and
+    // autosave update those objects instead of rescanning the map
+    void MarkUndone() {
+        const UndoHistory::Changed& changed = history.LastChanged();
+        for (uint32_t id : changed.brushes) {
+            pickTree.MarkBrush(id);
+            stats.MarkBrush(id);
+            journalChanges.brushes.insert(id);
+        }
+        for (uint32_t id : changed.entities) {
+            pickTree.MarkEntity(id);
+            journalChanges.entities.insert(id);
+        }
+        for (uint32_t id : changed.textures) TextureChanged(id);
+    }
+    
     void DeselectAll() {
         selectedBrushIndex = -1;
         selectedEntityIndex = -1;
-        selectedBrushes.clear();
-        selectedEntities.clear();
+        selectedBrushes.Clear();
+        selectedEntities.Clear();
     }
     
     void SelectAll() {
-        selectedBrushes.clear();
-        selectedEntities.clear();
+        selectedBrushes.Clear();
+        selectedEntities.Clear();
         for (size_t i = 0; i < map.brushes.size(); i++) {
-            selectedBrushes.push_back(static_cast<int>(i));
+            selectedBrushes.Add(static_cast<int>(i), map.brushes[i].id);
         }
         for (size_t i = 0; i < map.entities.size(); i++) {
-            selectedEntities.push_back(static_cast<int>(i));
+            selectedEntities.Add(static_cast<int>(i), map.entities[i].id);
         }
     }
     
+    // Object IDs for SelectionSet::Add; 0 (never assigned) when out of range
+    uint32_t BrushID(int index) const {
+        return index >= 0 && index < static_cast<int>(map.brushes.size()) ? map.brushes[index].id : 0;
+    }
+    
+    uint32_t EntityID(int index) const {
+        return index >= 0 && index < static_cast<int>(map.entities.size()) ? map.entities[index].id : 0;
+    }
+    
+    uint32_t SelectedBrushID() const { return BrushID(selectedBrushIndex); }
+    uint32_t SelectedEntityID() const { return EntityID(selectedEntityIndex); }
+    
+    // After undo/redo rearranged the map: find the selected objects again
+    // by ID, dropping the ones that no longer exist
+    void RebindSelection(uint32_t brushID, uint32_t entityID) {
+        IDTable<int> brushSlots;
+        brushSlots.Reserve(map.brushes.size());
+        for (size_t i = 0; i < map.brushes.size(); i++) brushSlots[map.brushes[i].id] = static_cast<int>(i);
+        auto brushSlot = [&](uint32_t id) {
+            const int* slot = brushSlots.Find(id);
+            return slot ? *slot : -1;
+        };
+        auto entitySlot = [&](uint32_t id) {
+            uint32_t position = map.GetEntityIndex().Position(id);
+            return position == EntityIndex::NO_POSITION ? -1 : static_cast<int>(position);
+        };
+        selectedBrushes.Rebind(brushSlot);
+        selectedEntities.Rebind(entitySlot);
+        selectedBrushIndex = brushID ? brushSlot(brushID) : -1;
+        selectedEntityIndex = entityID ? entitySlot(entityID) : -1;
+    }
+    
     void DeleteSelected() {
         if (selectedBrushIndex >= 0 && selectedBrushIndex < static_cast<int>(map.brushes.size())) {
             PushUndo();
+            TouchBrush(selectedBrushIndex);
             map.brushes.erase(map.brushes.begin() + selectedBrushIndex);
+            selectedBrushes.Erase(selectedBrushIndex);
             selectedBrushIndex = -1;
             hasUnsavedChanges = true;
         }
         if (selectedEntityIndex >= 0 && selectedEntityIndex < static_cast<int>(map.entities.size())) {
             PushUndo();
-            map.entities.erase(map.entities.begin() + selectedEntityIndex);
+            TouchEntity(selectedEntityIndex);
+            map.RemoveEntity(selectedEntityIndex);
+            selectedEntities.Erase(selectedEntityIndex);
             selectedEntityIndex = -1;
             hasUnsavedChanges = true;
         }
@@ -129,6 +262,7 @@ struct EditorState {
                 v.position.x += 1.0f;
                 v.position.z += 1.0f;
             }
+            copy.TranslateBounds(Vec3(1.0f, 0.0f, 1.0f));
             map.brushes.push_back(copy);
             selectedBrushIndex = static_cast<int>(map.brushes.size()) - 1;
             hasUnsavedChanges = true;
@@ -140,7 +274,7 @@ struct EditorState {
             copy.name = copy.name + "_copy";
             copy.position.x += 1.0f;
             copy.position.z += 1.0f;
-            map.entities.push_back(copy);
+            map.AddEntity(std::move(copy));
             selectedEntityIndex = static_cast<int>(map.entities.size()) - 1;
             hasUnsavedChanges = true;
         }
@@ -148,6 +282,7 @@ struct EditorState {
     
     void NewMap() {
         PushUndo();
+        TouchAll();
         map.Clear();
         map.name = "Untitled";
         map.author = "Unknown";
@@ -5,6 +5,8 @@
 #include "PCDBrushFactory.h"
 #include "PCDEditorState.h"
 #include "PCDFile.h"
+#include "PCDGeometryReport.h"
+#include "PCDTextureCompression.h"
 #include <algorithm>
 #include <cstring>
 #include <imgui.h>
@@ -40,6 +42,15 @@ private:
     float ambientR = 0.3f, ambientG = 0.3f, ambientB = 0.3f;
     float fogDensity = 0.0f;
     bool fogEnabled = false;
+    
+    // Last "Measure Encodings" result
+    GeometryReport::Result geometryReport;
+    bool hasGeometryReport = false;
+
+    // GL names of textures merged away by dedupe. History still holds copies
+    // that undo would bring back, so each is deleted only once neither the
+    // map nor the history refers to it.
+    std::vector<GLuint> retiredTextures;
 
 public:
     explicit EditorUI(EditorState& s) : state(s) {
@@ -48,6 +59,7 @@ public:
     }
 
     void Render() {
+        ReleaseRetiredTextures();
         RenderMainMenuBar();
         if (showToolbar) RenderToolbar();
         if (showBrushList) RenderBrushList();
@@ -110,8 +122,8 @@ private:
             }
 
             if (ImGui::BeginMenu("Edit")) {
-                if (ImGui::MenuItem("Undo", "Ctrl+Z", false, !state.undoStack.empty())) state.Undo();
-                if (ImGui::MenuItem("Redo", "Ctrl+Y", false, !state.redoStack.empty())) state.Redo();
+                if (ImGui::MenuItem("Undo", "Ctrl+Z", false, state.CanUndo())) state.Undo();
+                if (ImGui::MenuItem("Redo", "Ctrl+Y", false, state.CanRedo())) state.Redo();
                 ImGui::Separator();
                 if (ImGui::MenuItem("Cut", "Ctrl+X")) {
                     // Cut handled externally
@@ -478,10 +490,25 @@ private:
 
         if (ImGui::Button("Create Checkerboard", ImVec2(230, 22))) {
             Texture checker = TextureLoader::CreateCheckerboardTexture(64);
-            state.map.AddTexture(checker);
+            uint32_t id = state.map.AddTexture(checker);
+            if (state.map.GetTexture(id)->glTextureID != checker.glTextureID) {
+                // Already had one; drop the GL copy we just made
+                glDeleteTextures(1, &checker.glTextureID);
+            }
             state.hasUnsavedChanges = true;
         }
 
+        if (ImGui::Button("Compress All (BC1/BC3)", ImVec2(230, 22))) {
+            for (auto& [id, tex] : state.map.textures) CompressTexture(tex);
+        }
+
+        if (ImGui::Button("Remove Duplicates", ImVec2(230, 22))) {
+            DedupeTextures();
+        }
+        if (state.map.textureBytesDeduped > 0) {
+            ImGui::TextDisabled("Dedupe saved %.1f KB", state.map.textureBytesDeduped / 1024.0);
+        }
+
         ImGui::Separator();
 
         ImGui::BeginChild("TextureList", ImVec2(0, 0), true);
@@ -489,6 +516,11 @@ private:
         for (auto& [id, tex] : state.map.textures) {
             ImGui::PushID(id);
 
+            // Pixels still in the map file load the first time their preview
+            // scrolls into view
+            if (ImGui::IsRectVisible(ImVec2(64, 64)) && tex.IsDeferred() && TextureLoader::EnsurePixels(tex)) {
+                if (tex.glTextureID != 0) TextureLoader::UploadGLTexture(tex.glTextureID, tex);
+            }
             if (tex.glTextureID == 0 && !tex.data.empty()) {
                 tex.glTextureID = TextureLoader::CreateGLTexture(tex);
             }
@@ -504,11 +536,18 @@ private:
             ImGui::TextColored(ImVec4(0.8f, 0.8f, 1.0f, 1.0f), "%s", tex.name.c_str());
             ImGui::Text("ID: %u", tex.id);
             ImGui::Text("Size: %ux%u", tex.width, tex.height);
+            if (tex.IsCompressed()) {
+                ImGui::Text("%s, %u mips, %llu KB", tex.format == TEXFMT_BC3 ? "BC3" : "BC1",
+                            tex.mipCount, static_cast<unsigned long long>(tex.DataSize() / 1024));
+            } else if (ImGui::SmallButton("Compress")) {
+                CompressTexture(tex);
+            }
 
             if (state.selectedBrushIndex >= 0 && 
                 state.selectedBrushIndex < (int)state.map.brushes.size()) {
                 if (ImGui::SmallButton("Apply")) {
                     state.map.brushes[state.selectedBrushIndex].textureID = tex.id;
+                    state.BrushChanged(state.selectedBrushIndex);
                     state.hasUnsavedChanges = true;
                 }
             }
@@ -660,6 +699,37 @@ private:
                 }
             }
             
+            if (ImGui::CollapsingHeader("File")) {
+                ImGui::Checkbox("Pack Geometry", &state.settings.packGeometry);
+                if (state.settings.packGeometry) {
+                    const char* precisions[] = {"1/64", "1/256", "1/1024", "1/4096"};
+                    const float values[] = {1.0f / 64, 1.0f / 256, 1.0f / 1024, 1.0f / 4096};
+                    int current = 2;
+                    for (int i = 0; i < 4; i++) {
+                        if (state.settings.packPrecision == values[i]) current = i;
+                    }
+                    if (ImGui::Combo("Position Grid", &current, precisions, 4)) {
+                        state.settings.packPrecision = values[current];
+                    }
+                }
+                
+                if (ImGui::Button("Measure Encodings")) {
+                    geometryReport = GeometryReport::Measure(state.map, state.settings.packPrecision, 0);
+                    hasGeometryReport = true;
+                }
+                if (hasGeometryReport) {
+                    const GeometryReport::Result& r = geometryReport;
+                    ImGui::Text("Raw:    %.1f KB, load %.2f ms", r.rawFileBytes / 1024.0, r.rawLoadMs);
+                    ImGui::Text("Packed: %.1f KB, load %.2f ms", r.packedFileBytes / 1024.0, r.packedLoadMs);
+                    ImGui::Text("Max position error: %.5f", r.error.position);
+                    if (r.withinTolerance) {
+                        ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Round trip OK");
+                    } else {
+                        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Round trip out of tolerance");
+                    }
+                }
+            }
+            
             if (ImGui::CollapsingHeader("Gameplay")) {
                 static int gameMode = 0;
                 const char* gameModes[] = {"Deathmatch", "Team DM", "CTF", "Custom"};
@@ -754,6 +824,7 @@ private:
             strncpy(brushNameBuffer, brush.name.c_str(), sizeof(brushNameBuffer) - 1);
             if (ImGui::InputText("Name##brush", brushNameBuffer, sizeof(brushNameBuffer))) {
                 brush.name = brushNameBuffer;
+                state.BrushChanged(state.selectedBrushIndex);
                 state.hasUnsavedChanges = true;
             }
 
@@ -761,6 +832,7 @@ private:
             ImGui::Text("Triangles: %zu", brush.indices.size() / 3);
             
             if (ImGui::ColorEdit3("Color", &brush.color.x)) {
+                state.BrushChanged(state.selectedBrushIndex);
                 state.hasUnsavedChanges = true;
             }
 
@@ -771,6 +843,7 @@ private:
     bool v = brush.flags & flag; \
     if (ImGui::Checkbox(name, &v)) { \
         if (v) brush.flags |= flag; else brush.flags &= ~flag; \
+        state.BrushChanged(state.selectedBrushIndex); \
         state.hasUnsavedChanges = true; \
     } \
 }
@@ -794,6 +867,7 @@ private:
                     
                     if (ImGui::Button("Remove Texture")) {
                         brush.textureID = 0;
+                        state.BrushChanged(state.selectedBrushIndex);
                         state.hasUnsavedChanges = true;
                     }
                     
@@ -801,21 +875,26 @@ private:
                     ImGui::Text("UV Settings:");
                     
                     if (ImGui::DragFloat("Scale X", &brush.uvScaleX, 0.1f, 0.1f, 20.0f)) {
+                        state.BrushChanged(state.selectedBrushIndex);
                         state.hasUnsavedChanges = true;
                     }
                     if (ImGui::DragFloat("Scale Y", &brush.uvScaleY, 0.1f, 0.1f, 20.0f)) {
+                        state.BrushChanged(state.selectedBrushIndex);
                         state.hasUnsavedChanges = true;
                     }
                     if (ImGui::DragFloat("Offset X", &brush.uvOffsetX, 0.05f, -10.0f, 10.0f)) {
+                        state.BrushChanged(state.selectedBrushIndex);
                         state.hasUnsavedChanges = true;
                     }
                     if (ImGui::DragFloat("Offset Y", &brush.uvOffsetY, 0.05f, -10.0f, 10.0f)) {
+                        state.BrushChanged(state.selectedBrushIndex);
                         state.hasUnsavedChanges = true;
                     }
                     
                     if (ImGui::Button("Reset UV", ImVec2(180, 0))) {
                         brush.uvScaleX = brush.uvScaleY = 1.0f;
                         brush.uvOffsetX = brush.uvOffsetY = 0.0f;
+                        state.BrushChanged(state.selectedBrushIndex);
                         state.hasUnsavedChanges = true;
                     }
                 }
@@ -833,14 +912,24 @@ private:
             strncpy(entityNameBuffer, ent.name.c_str(), sizeof(entityNameBuffer) - 1);
             if (ImGui::InputText("Name##ent", entityNameBuffer, sizeof(entityNameBuffer))) {
                 ent.name = entityNameBuffer;
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
 
             ImGui::Text("Type: %s", GetEntityTypeName(ent.type));
 
-            if (ImGui::DragFloat3("Position", &ent.position.x, 0.1f)) state.hasUnsavedChanges = true;
-            if (ImGui::DragFloat3("Rotation", &ent.rotation.x, 1.0f, -180.0f, 180.0f)) state.hasUnsavedChanges = true;
-            if (ImGui::DragFloat3("Scale", &ent.scale.x, 0.1f, 0.1f, 10.0f)) state.hasUnsavedChanges = true;
+            if (ImGui::DragFloat3("Position", &ent.position.x, 0.1f)) {
+                state.EntityChanged(state.selectedEntityIndex);
+                state.hasUnsavedChanges = true;
+            }
+            if (ImGui::DragFloat3("Rotation", &ent.rotation.x, 1.0f, -180.0f, 180.0f)) {
+                state.EntityChanged(state.selectedEntityIndex);
+                state.hasUnsavedChanges = true;
+            }
+            if (ImGui::DragFloat3("Scale", &ent.scale.x, 0.1f, 0.1f, 10.0f)) {
+                state.EntityChanged(state.selectedEntityIndex);
+                state.hasUnsavedChanges = true;
+            }
 
             ImGui::Separator();
             RenderEntityTypeProperties(ent);
@@ -852,66 +941,73 @@ private:
         case ENT_LIGHT:
         case ENT_LIGHT_SPOT:
         case ENT_LIGHT_ENV: {
-            float color[3] = {std::stof(ent.GetProperty("color_r", "1")),
-                              std::stof(ent.GetProperty("color_g", "1")),
-                              std::stof(ent.GetProperty("color_b", "1"))};
+            float color[3] = {ent.GetFloat("color_r", 1.0f),
+                              ent.GetFloat("color_g", 1.0f),
+                              ent.GetFloat("color_b", 1.0f)};
             if (ImGui::ColorEdit3("Light Color", color)) {
-                ent.SetProperty("color_r", std::to_string(color[0]));
-                ent.SetProperty("color_g", std::to_string(color[1]));
-                ent.SetProperty("color_b", std::to_string(color[2]));
+                ent.SetFloat("color_r", color[0]);
+                ent.SetFloat("color_g", color[1]);
+                ent.SetFloat("color_b", color[2]);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
 
-            float intensity = std::stof(ent.GetProperty("intensity", "1"));
+            float intensity = ent.GetFloat("intensity", 1.0f);
             if (ImGui::DragFloat("Intensity", &intensity, 0.1f, 0.0f, 100.0f)) {
-                ent.SetProperty("intensity", std::to_string(intensity));
+                ent.SetFloat("intensity", intensity);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
 
-            float radius = std::stof(ent.GetProperty("radius", "10"));
+            float radius = ent.GetFloat("radius", 10.0f);
             if (ImGui::DragFloat("Radius", &radius, 0.5f, 0.0f, 500.0f)) {
-                ent.SetProperty("radius", std::to_string(radius));
+                ent.SetFloat("radius", radius);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
             break;
         }
 
         case ENT_TRIGGER_HURT: {
-            float damage = std::stof(ent.GetProperty("damage", "10"));
+            float damage = ent.GetFloat("damage", 10.0f);
             if (ImGui::DragFloat("Damage", &damage, 1.0f, 0.0f, 1000.0f)) {
-                ent.SetProperty("damage", std::to_string(damage));
+                ent.SetFloat("damage", damage);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
             break;
         }
 
         case ENT_TRIGGER_PUSH: {
-            float force[3] = {std::stof(ent.GetProperty("force_x", "0")),
-                              std::stof(ent.GetProperty("force_y", "10")),
-                              std::stof(ent.GetProperty("force_z", "0"))};
+            float force[3] = {ent.GetFloat("force_x", 0.0f),
+                              ent.GetFloat("force_y", 10.0f),
+                              ent.GetFloat("force_z", 0.0f)};
             if (ImGui::DragFloat3("Push Force", force, 0.5f)) {
-                ent.SetProperty("force_x", std::to_string(force[0]));
-                ent.SetProperty("force_y", std::to_string(force[1]));
-                ent.SetProperty("force_z", std::to_string(force[2]));
+                ent.SetFloat("force_x", force[0]);
+                ent.SetFloat("force_y", force[1]);
+                ent.SetFloat("force_z", force[2]);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
             break;
         }
 
         case ENT_FUNC_DOOR: {
-            float moveDir[3] = {std::stof(ent.GetProperty("move_x", "0")),
-                                std::stof(ent.GetProperty("move_y", "3")),
-                                std::stof(ent.GetProperty("move_z", "0"))};
+            float moveDir[3] = {ent.GetFloat("move_x", 0.0f),
+                                ent.GetFloat("move_y", 3.0f),
+                                ent.GetFloat("move_z", 0.0f)};
             if (ImGui::DragFloat3("Move Distance", moveDir, 0.1f)) {
-                ent.SetProperty("move_x", std::to_string(moveDir[0]));
-                ent.SetProperty("move_y", std::to_string(moveDir[1]));
-                ent.SetProperty("move_z", std::to_string(moveDir[2]));
+                ent.SetFloat("move_x", moveDir[0]);
+                ent.SetFloat("move_y", moveDir[1]);
+                ent.SetFloat("move_z", moveDir[2]);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
 
-            float speed = std::stof(ent.GetProperty("speed", "2"));
+            float speed = ent.GetFloat("speed", 2.0f);
             if (ImGui::DragFloat("Speed", &speed, 0.1f, 0.1f, 20.0f)) {
-                ent.SetProperty("speed", std::to_string(speed));
+                ent.SetFloat("speed", speed);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
             break;
@@ -920,15 +1016,17 @@ private:
         case ENT_ITEM_HEALTH:
         case ENT_ITEM_ARMOR:
         case ENT_ITEM_AMMO: {
-            int amount = std::stoi(ent.GetProperty("amount", "25"));
+            int amount = ent.GetInt("amount", 25);
             if (ImGui::DragInt("Amount", &amount, 1, 1, 200)) {
-                ent.SetProperty("amount", std::to_string(amount));
+                ent.SetInt("amount", amount);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
 
-            float respawn = std::stof(ent.GetProperty("respawn_time", "30"));
+            float respawn = ent.GetFloat("respawn_time", 30.0f);
             if (ImGui::DragFloat("Respawn Time", &respawn, 1.0f, 0.0f, 300.0f)) {
-                ent.SetProperty("respawn_time", std::to_string(respawn));
+                ent.SetFloat("respawn_time", respawn);
+                state.EntityChanged(state.selectedEntityIndex);
                 state.hasUnsavedChanges = true;
             }
             break;
@@ -996,6 +1094,72 @@ private:
         }
     }
 
+    void CompressTexture(Texture& tex) {
+        if (tex.IsCompressed()) return;
+        if (!TextureLoader::EnsurePixels(tex)) return;
+        if (!TextureCompressor::Compress(tex, TextureCompressor::ChooseFormat(tex), 0)) return;
+        
+        // Same GL name, so brushes already pointing at it keep working
+        if (tex.glTextureID != 0) TextureLoader::UploadGLTexture(tex.glTextureID, tex);
+        state.map.InvalidateTextureIndex();
+        state.TextureChanged(tex.id);
+        state.hasUnsavedChanges = true;
+    }
+    
+    void DedupeTextures() {
+        // Textures whose pixels are still in the file can't be compared
+        for (auto& [id, tex] : state.map.textures) {
+            if (tex.IsDeferred() && TextureLoader::EnsurePixels(tex) && tex.glTextureID != 0) {
+                TextureLoader::UploadGLTexture(tex.glTextureID, tex);
+            }
+        }
+        state.map.InvalidateTextureIndex();
+        state.PushUndo();
+        std::unordered_map<uint32_t, uint32_t> duplicates = state.map.FindDuplicateTextures();
+        for (const auto& [id, keep] : duplicates) state.TouchTexture(id);
+        for (size_t i = 0; i < state.map.brushes.size(); i++) {
+            if (duplicates.count(state.map.brushes[i].textureID)) state.TouchBrush(static_cast<int>(i));
+        }
+        std::vector<uint32_t> glBefore;
+        for (const auto& [id, tex] : state.map.textures) {
+            if (tex.glTextureID != 0) glBefore.push_back(tex.glTextureID);
+        }
+        
+        TextureDedupeStats result = state.map.DedupeTextures();
+        
+        // The undo step keeps the merged-away textures, GL names included
+        for (GLuint glID : glBefore) {
+            if (!TextureNameInMap(glID) &&
+                std::find(retiredTextures.begin(), retiredTextures.end(), glID) == retiredTextures.end()) {
+                retiredTextures.push_back(glID);
+            }
+        }
+        
+        std::cout << "[Texture] Dedupe removed " << result.texturesRemoved << " textures, remapped "
+                  << result.brushesRemapped << " brushes, saved " << result.bytesSaved << " bytes\n";
+        if (result.texturesRemoved > 0) state.hasUnsavedChanges = true;
+    }
+    
+    bool TextureNameInMap(GLuint glID) const {
+        for (const auto& [id, tex] : state.map.textures) {
+            if (tex.glTextureID == glID) return true;
+        }
+        return false;
+    }
+    
+    void ReleaseRetiredTextures() {
+        for (size_t i = 0; i < retiredTextures.size();) {
+            GLuint glID = retiredTextures[i];
+            if (TextureNameInMap(glID) || state.history.HoldsGLTexture(glID)) {
+                i++;
+                continue;
+            }
+            glDeleteTextures(1, &glID);
+            retiredTextures[i] = retiredTextures.back();
+            retiredTextures.pop_back();
+        }
+    }
+    
     void LoadTexture(const std::string& path) {
         Texture tex;
         if (TextureLoader::LoadImage(path, tex)) {
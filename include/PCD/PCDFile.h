@@ -2,110 +2,363 @@
 #define PCD_FILE_H
 
 #include "PCDTypes.h"
+#include "PCDFormat.h"
+#include "PCDMappedFile.h"
+#include "PCDWorkerPool.h"
+#include "PCDGeometryCodec.h"
+#include "PCDSchema.h"
 #include <fstream>
+#include <filesystem>
 #include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <mutex>
 
 namespace PCD {
 
-const char MAGIC[4] = {'P', 'C', 'D', '2'}; // Version 2 with textures
-const uint32_t VERSION = 2;
+const char MAGIC[4] = {'P', 'C', 'D', '3'}; // Version 3: section table, aligned streams
+const uint32_t VERSION = 3;
+
+// Threading for PCDWriter/PCDReader. threads = 1 keeps everything on the
+// calling thread; 0 uses every core. Output is identical either way.
+struct SaveOptions {
+    unsigned threads = 1;
+    // Store geometry quantized and block-compressed (GeometryCodec) instead
+    // of as raw float streams. Smaller, but not memory-mappable.
+    bool packGeometry = false;
+    float positionPrecision = 1.0f / 1024.0f; // Grid step for packed positions
+};
+
+struct LoadOptions {
+    unsigned threads = 1;
+    // Leave texture pixels on disk: only record where each blob lives and
+    // fetch it with PCDReader::LoadTexturePixels on first use
+    bool deferTextures = false;
+};
+
+// Copies a deferred texture's pixel blob from its source file into dst,
+// which must hold tex.source.size bytes
+inline bool ReadTextureSource(const Texture& tex, uint8_t* dst) {
+    std::ifstream file(tex.source.path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[PCD] Failed to open texture source: " << tex.source.path << "\n";
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(tex.source.offset));
+    file.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(tex.source.size));
+    if (!file.good()) {
+        std::cerr << "[PCD] Failed to read texture data: " << tex.name << "\n";
+        return false;
+    }
+    return true;
+}
 
 class PCDWriter {
 public:
-    static bool Save(const Map& map, const std::string& filename) {
-        std::ofstream file(filename, std::ios::binary);
-        if (!file.is_open()) {
-            std::cerr << "[PCD] Failed to open file for writing: " << filename << "\n";
+    static bool Save(const Map& map, const std::string& filename, const SaveOptions& options = SaveOptions()) {
+        std::vector<uint8_t> buffer;
+        if (!Serialize(map, buffer, options)) {
+            std::cerr << "[PCD] Map not saved: " << filename << "\n";
             return false;
         }
         
-        // Header
-        file.write(MAGIC, 4);
-        WriteU32(file, VERSION);
-        WriteU32(file, 0); // Flags
-        WriteU32(file, static_cast<uint32_t>(map.brushes.size()));
-        WriteU32(file, static_cast<uint32_t>(map.entities.size()));
-        WriteU32(file, static_cast<uint32_t>(map.textures.size())); // NEW: Texture count
-        
-        char reserved[8] = {0};
-        file.write(reserved, 8);
-        
-        // Metadata
-        WriteString(file, map.name);
-        WriteString(file, map.author);
-        
-        // Textures (NEW)
-        for (const auto& [id, tex] : map.textures) {
-            WriteU32(file, tex.id);
-            WriteString(file, tex.name);
-            WriteU32(file, tex.width);
-            WriteU32(file, tex.height);
-            WriteU32(file, tex.channels);
-            WriteU32(file, static_cast<uint32_t>(tex.data.size()));
-            file.write(reinterpret_cast<const char*>(tex.data.data()), tex.data.size());
+        // Deferred textures may still read their pixels from filename itself,
+        // so the old file stays intact until the new image is fully on disk
+        const std::string tempname = filename + ".tmp";
+        std::error_code ec;
+        {
+            std::ofstream file(tempname, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "[PCD] Failed to open file for writing: " << tempname << "\n";
+                return false;
+            }
+            
+            file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+            file.flush();
+            file.close();
+            if (!file.good()) {
+                std::cerr << "[PCD] Failed to write file: " << tempname << "\n";
+                std::filesystem::remove(tempname, ec);
+                return false;
+            }
         }
         
-        // Brushes
-        for (const auto& brush : map.brushes) {
-            WriteU32(file, static_cast<uint32_t>(brush.vertices.size()));
-            WriteU32(file, static_cast<uint32_t>(brush.indices.size() / 3));
-            WriteU32(file, brush.textureID);
-            WriteU32(file, brush.flags);
-            
-            for (const auto& v : brush.vertices) {
-                WriteFloat(file, v.position.x);
-                WriteFloat(file, v.position.y);
-                WriteFloat(file, v.position.z);
+        std::filesystem::rename(tempname, filename, ec);
+        if (ec) {
+            std::cerr << "[PCD] Failed to replace " << filename << ": " << ec.message() << "\n";
+            std::filesystem::remove(tempname, ec);
+            return false;
+        }
+        
+        RetargetDeferredTextures(map, buffer, filename);
+        
+        std::cout << "[PCD] Saved map: " << filename << "\n";
+        std::cout << "  Brushes: " << map.brushes.size() << "\n";
+        std::cout << "  Entities: " << map.entities.size() << "\n";
+        std::cout << "  Textures: " << map.textures.size() << "\n";
+        
+        return true;
+    }
+    
+    // Lays the whole PCD3 image out in one contiguous buffer.
+    //
+    // A sequential pre-pass assigns every record, string and stream its final
+    // offset; the bytes for textures, brushes and entities are then copied in
+    // independent chunks, optionally across worker threads.
+    //
+    // Fails if a deferred texture's pixels can no longer be read from its
+    // source file; out is then incomplete and must not be written anywhere.
+    static bool Serialize(const Map& map, std::vector<uint8_t>& out, const SaveOptions& options = SaveOptions()) {
+        using namespace Format;
+        
+        // Strings are only sized here; their bytes are copied by the fill pass
+        uint32_t stringsSize = 0;
+        auto reserveString = [&stringsSize](const std::string& str) {
+            StringRef ref{stringsSize, static_cast<uint32_t>(str.size())};
+            stringsSize += ref.length;
+            return ref;
+        };
+        
+        MetaRecord meta{};
+        SchemaCodec::ToRecord(map, meta, reserveString);
+        
+        // Sorted by ID so identical maps always produce identical files
+        std::vector<const Texture*> textures;
+        textures.reserve(map.textures.size());
+        for (const auto& [id, tex] : map.textures) textures.push_back(&tex);
+        std::sort(textures.begin(), textures.end(),
+                  [](const Texture* a, const Texture* b) { return a->id < b->id; });
+        
+        std::vector<TextureRecord> texRecords(textures.size());
+        std::vector<TextureFormatRecord> formatRecords(textures.size());
+        uint64_t texDataSize = 0;
+        for (size_t i = 0; i < textures.size(); i++) {
+            const Texture& tex = *textures[i];
+            TextureRecord& rec = texRecords[i];
+            SchemaCodec::ToRecord(tex, rec, reserveString);
+            rec.dataOffset = texDataSize;
+            rec.dataSize = tex.DataSize();
+            texDataSize = AlignUp(texDataSize + rec.dataSize);
+            formatRecords[i].format = tex.format;
+            formatRecords[i].mipCount = tex.mipCount;
+        }
+        
+        std::vector<BrushRecord> brushRecords(map.brushes.size());
+        uint32_t totalVertices = 0;
+        uint32_t totalIndices = 0;
+        for (size_t i = 0; i < map.brushes.size(); i++) {
+            const Brush& brush = map.brushes[i];
+            BrushRecord& rec = brushRecords[i];
+            SchemaCodec::ToRecord(brush, rec, reserveString);
+            rec.firstVertex = totalVertices;
+            rec.vertexCount = static_cast<uint32_t>(brush.vertices.size());
+            rec.firstIndex = totalIndices;
+            rec.indexCount = static_cast<uint32_t>(brush.indices.size());
+            totalVertices += rec.vertexCount;
+            totalIndices += rec.indexCount;
+        }
+        
+        std::vector<EntityRecord> entityRecords(map.entities.size());
+        std::vector<PropertyRecord> propRecords;
+        for (size_t i = 0; i < map.entities.size(); i++) {
+            const Entity& ent = map.entities[i];
+            EntityRecord& rec = entityRecords[i];
+            rec.firstProperty = static_cast<uint32_t>(propRecords.size());
+            rec.propertyCount = static_cast<uint32_t>(ent.properties.size());
+            for (const auto& [key, value] : ent.properties) {
+                StringRef k = reserveString(key);
+                StringRef v = reserveString(value.Text());
+                propRecords.push_back({k, v});
             }
-            for (const auto& v : brush.vertices) {
-                WriteFloat(file, v.normal.x);
-                WriteFloat(file, v.normal.y);
-                WriteFloat(file, v.normal.z);
+            SchemaCodec::ToRecord(ent, rec, reserveString);
+        }
+        
+        std::vector<uint8_t> packed;
+        if (options.packGeometry) {
+            GeometryCodec::Pack(map.brushes, options.positionPrecision, options.threads, packed);
+        }
+        uint64_t streamVertices = options.packGeometry ? 0 : totalVertices;
+        uint64_t streamIndices = options.packGeometry ? 0 : totalIndices;
+        
+        // Section table
+        struct Pending { SectionType type; uint64_t size; };
+        const Pending pending[] = {
+            {SECTION_META, sizeof(MetaRecord)},
+            {SECTION_STRINGS, stringsSize},
+            {SECTION_TEXTURES, texRecords.size() * sizeof(TextureRecord)},
+            {SECTION_TEXTURE_DATA, texDataSize},
+            {SECTION_BRUSHES, brushRecords.size() * sizeof(BrushRecord)},
+            {SECTION_POSITIONS, streamVertices * 3 * sizeof(float)},
+            {SECTION_NORMALS, streamVertices * 3 * sizeof(float)},
+            {SECTION_UVS, streamVertices * 2 * sizeof(float)},
+            {SECTION_INDICES, streamIndices * sizeof(uint32_t)},
+            {SECTION_ENTITIES, entityRecords.size() * sizeof(EntityRecord)},
+            {SECTION_PROPERTIES, propRecords.size() * sizeof(PropertyRecord)},
+            {SECTION_TEXTURE_FORMATS, formatRecords.size() * sizeof(TextureFormatRecord)},
+            {SECTION_PACKED_GEOMETRY, packed.size()},
+        };
+        const uint32_t sectionCount = sizeof(pending) / sizeof(pending[0]);
+        
+        SectionEntry table[sectionCount];
+        uint64_t cursor = AlignUp(sizeof(FileHeader) + sizeof(table));
+        for (uint32_t i = 0; i < sectionCount; i++) {
+            table[i].type = pending[i].type;
+            table[i].flags = 0;
+            table[i].offset = cursor;
+            table[i].size = pending[i].size;
+            cursor = AlignUp(cursor + pending[i].size);
+        }
+        
+        FileHeader header{};
+        memcpy(header.magic, MAGIC_V3, 4);
+        header.version = VERSION_V3;
+        header.flags = options.packGeometry ? FILE_FLAG_PACKED_GEOMETRY : 0;
+        header.headerSize = sizeof(FileHeader);
+        header.sectionCount = sectionCount;
+        header.brushCount = static_cast<uint32_t>(brushRecords.size());
+        header.entityCount = static_cast<uint32_t>(entityRecords.size());
+        header.textureCount = static_cast<uint32_t>(texRecords.size());
+        header.fileSize = cursor;
+        
+        // Fill the single output buffer
+        out.assign(static_cast<size_t>(cursor), 0);
+        uint8_t* dst = out.data();
+        memcpy(dst, &header, sizeof(header));
+        memcpy(dst + sizeof(header), table, sizeof(table));
+        
+        auto sectionPtr = [&](uint32_t i) { return dst + table[i].offset; };
+        char* strings = reinterpret_cast<char*>(sectionPtr(1));
+        auto putString = [strings](const StringRef& ref, const std::string& str) {
+            if (ref.length) memcpy(strings + ref.offset, str.data(), ref.length);
+        };
+        
+        memcpy(sectionPtr(0), &meta, sizeof(meta));
+        putString(meta.name, map.name);
+        putString(meta.author, map.author);
+        if (!texRecords.empty()) memcpy(sectionPtr(2), texRecords.data(), table[2].size);
+        if (!brushRecords.empty()) memcpy(sectionPtr(4), brushRecords.data(), table[4].size);
+        if (!entityRecords.empty()) memcpy(sectionPtr(9), entityRecords.data(), table[9].size);
+        if (!propRecords.empty()) memcpy(sectionPtr(10), propRecords.data(), table[10].size);
+        if (!formatRecords.empty()) memcpy(sectionPtr(11), formatRecords.data(), table[11].size);
+        if (!packed.empty()) memcpy(sectionPtr(12), packed.data(), packed.size());
+        
+        uint8_t* texData = sectionPtr(3);
+        float* positions = reinterpret_cast<float*>(sectionPtr(5));
+        float* normals = reinterpret_cast<float*>(sectionPtr(6));
+        float* uvs = reinterpret_cast<float*>(sectionPtr(7));
+        uint32_t* indices = reinterpret_cast<uint32_t*>(sectionPtr(8));
+        
+        bool texturesOk = true;
+        std::mutex failMutex;
+        auto encodeTextures = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Texture& tex = *textures[i];
+                putString(texRecords[i].name, tex.name);
+                if (tex.IsDeferred()) {
+                    // Straight from disk; the pixels never enter the Map
+                    if (!ReadTextureSource(tex, texData + texRecords[i].dataOffset)) {
+                        std::lock_guard<std::mutex> lock(failMutex);
+                        texturesOk = false;
+                    }
+                } else if (!tex.data.empty()) {
+                    memcpy(texData + texRecords[i].dataOffset, tex.data.data(), tex.data.size());
+                }
             }
-            for (const auto& v : brush.vertices) {
-                WriteFloat(file, v.uv.u);
-                WriteFloat(file, v.uv.v);
+        };
+        
+        auto encodeBrushes = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Brush& brush = map.brushes[i];
+                const BrushRecord& rec = brushRecords[i];
+                putString(rec.name, brush.name);
+                if (options.packGeometry) continue;
+                float* p = positions + size_t(rec.firstVertex) * 3;
+                float* n = normals + size_t(rec.firstVertex) * 3;
+                float* t = uvs + size_t(rec.firstVertex) * 2;
+                for (const auto& v : brush.vertices) {
+                    *p++ = v.position.x; *p++ = v.position.y; *p++ = v.position.z;
+                    *n++ = v.normal.x; *n++ = v.normal.y; *n++ = v.normal.z;
+                    *t++ = v.uv.u; *t++ = v.uv.v;
+                }
+                if (!brush.indices.empty()) {
+                    memcpy(indices + rec.firstIndex, brush.indices.data(), brush.indices.size() * sizeof(uint32_t));
+                }
             }
-            for (uint32_t idx : brush.indices) {
-                WriteU32(file, idx);
+        };
+        
+        auto encodeEntities = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Entity& ent = map.entities[i];
+                const EntityRecord& rec = entityRecords[i];
+                putString(rec.name, ent.name);
+                for (uint32_t p = 0; p < rec.propertyCount; p++) {
+                    const PropertyRecord& prop = propRecords[rec.firstProperty + p];
+                    putString(prop.key, ent.properties[p].key);
+                    putString(prop.value, ent.properties[p].value.Text());
+                }
             }
-            
-            WriteFloat(file, brush.color.x);
-            WriteFloat(file, brush.color.y);
-            WriteFloat(file, brush.color.z);
-            
-            // UV transform (NEW)
-            WriteFloat(file, brush.uvScaleX);
-            WriteFloat(file, brush.uvScaleY);
-            WriteFloat(file, brush.uvOffsetX);
-            WriteFloat(file, brush.uvOffsetY);
-            
-            WriteString(file, brush.name);
+        };
+        
+        if (options.threads == 1) {
+            encodeTextures(0, textures.size());
+            encodeBrushes(0, map.brushes.size());
+            encodeEntities(0, map.entities.size());
+        } else {
+            WorkerPool& pool = WorkerPool::Shared();
+            pool.ParallelFor(textures.size(), options.threads, encodeTextures);
+            pool.ParallelFor(map.brushes.size(), options.threads, encodeBrushes);
+            pool.ParallelFor(map.entities.size(), options.threads, encodeEntities);
         }
+        return texturesOk;
+    }
+    
+private:
+    // Deferred textures may point into the file that was just replaced, so
+    // move them over to their blobs in the new image
+    static void RetargetDeferredTextures(const Map& map, const std::vector<uint8_t>& image,
+                                         const std::string& filename) {
+        MapView view;
+        if (!view.Open(image.data(), image.size())) return;
+        const Format::SectionEntry* texSection = view.FindSection(Format::SECTION_TEXTURE_DATA);
+        if (!texSection) return;
         
-        // Entities
-        for (const auto& ent : map.entities) {
-            WriteU32(file, static_cast<uint32_t>(ent.type));
-            WriteFloat(file, ent.position.x);
-            WriteFloat(file, ent.position.y);
-            WriteFloat(file, ent.position.z);
-            WriteFloat(file, ent.rotation.x);
-            WriteFloat(file, ent.rotation.y);
-            WriteFloat(file, ent.rotation.z);
-            WriteFloat(file, ent.scale.x);
-            WriteFloat(file, ent.scale.y);
-            WriteFloat(file, ent.scale.z);
-            
-            WriteU32(file, static_cast<uint32_t>(ent.properties.size()));
-            for (const auto& [key, value] : ent.properties) {
-                WriteString(file, key);
-                WriteString(file, value);
+        for (const auto& rec : view.Textures()) {
+            auto it = map.textures.find(rec.id);
+            if (it == map.textures.end() || !it->second.IsDeferred()) continue;
+            it->second.source.path = filename;
+            it->second.source.offset = texSection->offset + rec.dataOffset;
+        }
+    }
+};
+
+class PCDReader {
+public:
+    static bool Load(Map& map, const std::string& filename, const LoadOptions& options = LoadOptions()) {
+        char magic[4] = {0};
+        {
+            std::ifstream probe(filename, std::ios::binary);
+            if (!probe.is_open()) {
+                std::cerr << "[PCD] Failed to open file: " << filename << "\n";
+                return false;
             }
-            WriteString(file, ent.name);
+            probe.read(magic, 4);
         }
         
-        std::cout << "[PCD] Saved map: " << filename << "\n";
+        if (memcmp(magic, Format::MAGIC_V3, 4) != 0) {
+            return LoadLegacy(map, filename, options);
+        }
+        
+        MappedFile file;
+        if (!file.Open(filename)) {
+            std::cerr << "[PCD] Failed to map file: " << filename << "\n";
+            return false;
+        }
+        
+        if (!Decode(map, file.Data(), file.Size(), options, filename)) {
+            return false;
+        }
+        
+        std::cout << "[PCD] Loaded map: " << filename << "\n";
         std::cout << "  Brushes: " << map.brushes.size() << "\n";
         std::cout << "  Entities: " << map.entities.size() << "\n";
         std::cout << "  Textures: " << map.textures.size() << "\n";
@@ -113,23 +366,146 @@ public:
         return true;
     }
     
+    // Decodes a PCD3 image that is already in memory (mapped file, network buffer)
+    // deferTextures needs a backing file and is ignored here
+    static bool LoadFromMemory(Map& map, const uint8_t* data, size_t size, const LoadOptions& options = LoadOptions()) {
+        return Decode(map, data, size, options, std::string());
+    }
+    
+    // Reads the pixels of a texture that was loaded with deferTextures
+    static bool LoadTexturePixels(Texture& tex) {
+        if (!tex.IsDeferred()) return true;
+        
+        std::vector<uint8_t> pixels(static_cast<size_t>(tex.source.size));
+        if (!ReadTextureSource(tex, pixels.data())) return false;
+        
+        tex.data = std::move(pixels);
+        tex.source = Texture::Source();
+        return true;
+    }
+    
 private:
-    static void WriteU32(std::ofstream& f, uint32_t val) {
-        f.write(reinterpret_cast<const char*>(&val), sizeof(val));
+    // Resolves StringRefs for SchemaCodec::FromRecord
+    static auto StringsOf(const MapView& view) {
+        return [&view](const Format::StringRef& ref) { return view.StringView(ref); };
+    }
+    
+    static bool Decode(Map& map, const uint8_t* data, size_t size, const LoadOptions& options,
+                       const std::string& sourcePath) {
+        MapView view;
+        if (!view.Open(data, size)) {
+            return false;
+        }
+        
+        map.Clear();
+        SchemaCodec::FromRecord(view.Meta(), map, StringsOf(view));
+        
+        // Every texture, brush and entity decodes independently of the others
+        Span<Format::TextureRecord> texRecords = view.Textures();
+        Span<Format::TextureFormatRecord> formats = view.TextureFormats();
+        if (formats.size() != texRecords.size()) formats = Span<Format::TextureFormatRecord>();
+        Span<Format::BrushRecord> brushRecords = view.Brushes();
+        Span<Format::EntityRecord> entityRecords = view.Entities();
+        std::vector<Texture> textures(texRecords.size());
+        map.brushes.resize(brushRecords.size());
+        map.entities.resize(entityRecords.size());
+        
+        const Format::SectionEntry* texSection = view.FindSection(Format::SECTION_TEXTURE_DATA);
+        bool defer = options.deferTextures && !sourcePath.empty() && texSection;
+        
+        auto decodeTextures = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                DecodeTexture(view, texRecords[i], textures[i]);
+                if (!formats.empty()) {
+                    textures[i].format = static_cast<TextureFormat>(formats[i].format);
+                    textures[i].mipCount = formats[i].mipCount;
+                }
+                if (defer) {
+                    textures[i].source.path = sourcePath;
+                    textures[i].source.offset = texSection->offset + texRecords[i].dataOffset;
+                    textures[i].source.size = texRecords[i].dataSize;
+                } else {
+                    Span<uint8_t> pixels = view.TexturePixels(texRecords[i]);
+                    textures[i].data.assign(pixels.begin(), pixels.end());
+                }
+            }
+        };
+        auto decodeBrushes = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) DecodeBrush(view, brushRecords[i], map.brushes[i]);
+        };
+        auto decodeEntities = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) DecodeEntity(view, entityRecords[i], map.entities[i]);
+        };
+        
+        if (options.threads == 1) {
+            decodeTextures(0, textures.size());
+            decodeBrushes(0, map.brushes.size());
+            decodeEntities(0, map.entities.size());
+        } else {
+            WorkerPool& pool = WorkerPool::Shared();
+            pool.ParallelFor(textures.size(), options.threads, decodeTextures);
+            pool.ParallelFor(map.brushes.size(), options.threads, decodeBrushes);
+            pool.ParallelFor(map.entities.size(), options.threads, decodeEntities);
+        }
+        
+        if (view.HasPackedGeometry() &&
+            !GeometryCodec::Unpack(view.Section(Format::SECTION_PACKED_GEOMETRY), brushRecords,
+                                   map.brushes, options.threads)) {
+            map.Clear();
+            return false;
+        }
+        
+        for (auto& tex : textures) {
+            uint32_t id = tex.id;
+            map.textures[id] = std::move(tex);
+        }
+        
+        for (const auto& b : map.brushes) map.nextBrushID = std::max(map.nextBrushID, b.id + 1);
+        for (const auto& e : map.entities) map.nextEntityID = std::max(map.nextEntityID, e.id + 1);
+        for (const auto& [id, t] : map.textures) map.nextTextureID = std::max(map.nextTextureID, id + 1);
+        map.RebuildEntityIndex();
+        
+        return true;
     }
-    static void WriteFloat(std::ofstream& f, float val) {
-        f.write(reinterpret_cast<const char*>(&val), sizeof(val));
+    
+    static void DecodeTexture(const MapView& view, const Format::TextureRecord& rec, Texture& tex) {
+        SchemaCodec::FromRecord(rec, tex, StringsOf(view));
     }
-    static void WriteString(std::ofstream& f, const std::string& str) {
-        uint32_t len = static_cast<uint32_t>(str.size());
-        WriteU32(f, len);
-        f.write(str.c_str(), len);
+    
+    static void DecodeBrush(const MapView& view, const Format::BrushRecord& rec, Brush& brush) {
+        SchemaCodec::FromRecord(rec, brush, StringsOf(view));
+        if (view.HasPackedGeometry()) return; // Filled in by GeometryCodec::Unpack
+        
+        Span<float> p = view.BrushPositions(rec);
+        Span<float> n = view.BrushNormals(rec);
+        Span<float> t = view.BrushUVs(rec);
+        brush.vertices.resize(rec.vertexCount);
+        for (uint32_t v = 0; v < rec.vertexCount; v++) {
+            Vertex& vert = brush.vertices[v];
+            vert.position = Vec3(p[v * 3], p[v * 3 + 1], p[v * 3 + 2]);
+            vert.normal = Vec3(n[v * 3], n[v * 3 + 1], n[v * 3 + 2]);
+            vert.uv = Vec2(t[v * 2], t[v * 2 + 1]);
+        }
+        
+        Span<uint32_t> idx = view.BrushIndices(rec);
+        brush.indices.assign(idx.begin(), idx.end());
     }
-};
-
-class PCDReader {
-public:
-    static bool Load(Map& map, const std::string& filename) {
+    
+    static void DecodeEntity(const MapView& view, const Format::EntityRecord& rec, Entity& ent) {
+        SchemaCodec::FromRecord(rec, ent, StringsOf(view));
+        
+        Span<Format::PropertyRecord> props = view.Properties().subspan(rec.firstProperty, rec.propertyCount);
+        // Keys are interned straight from the mapped strings; values are
+        // copied and their numbers parsed here once
+        ent.properties.resize(props.size());
+        for (size_t p = 0; p < props.size(); p++) {
+            ent.properties[p].key = view.StringView(props[p].key);
+            ent.properties[p].value = view.StringView(props[p].value);
+        }
+    }
+    
+    // PCD1/PCD2 compatibility path
+    static bool LoadLegacy(Map& map, const std::string& filename, const LoadOptions& options) {
         std::ifstream file(filename, std::ios::binary);
         if (!file.is_open()) {
             std::cerr << "[PCD] Failed to open file: " << filename << "\n";
@@ -146,7 +522,7 @@ public:
         bool isVersion2 = (memcmp(magic, "PCD2", 4) == 0);
         
         uint32_t version = ReadU32(file);
-        if (version > VERSION) {
+        if (version > 2) {
             std::cerr << "[PCD] Unsupported version: " << version << "\n";
             return false;
         }
@@ -178,8 +554,15 @@ public:
                 tex.channels = ReadU32(file);
                 uint32_t dataSize = ReadU32(file);
                 
-                tex.data.resize(dataSize);
-                file.read(reinterpret_cast<char*>(tex.data.data()), dataSize);
+                if (options.deferTextures) {
+                    tex.source.path = filename;
+                    tex.source.offset = static_cast<uint64_t>(file.tellg());
+                    tex.source.size = dataSize;
+                    file.seekg(dataSize, std::ios::cur);
+                } else {
+                    tex.data.resize(dataSize);
+                    file.read(reinterpret_cast<char*>(tex.data.data()), dataSize);
+                }
                 
                 map.textures[tex.id] = tex;
             }
@@ -254,12 +637,13 @@ public:
             for (uint32_t p = 0; p < propCount; p++) {
                 std::string key = ReadString(file);
                 std::string value = ReadString(file);
-                ent.properties.push_back({key, value});
+                ent.properties.push_back({InternedString(key), PropertyValue(value)});
             }
             ent.name = ReadString(file);
             
             map.entities.push_back(ent);
         }
+        map.RebuildEntityIndex();
         
         std::cout << "[PCD] Loaded map: " << filename << "\n";
         std::cout << "  Brushes: " << map.brushes.size() << "\n";
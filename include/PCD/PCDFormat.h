@@ -0,0 +1,159 @@
+#ifndef PCD_FORMAT_H
+#define PCD_FORMAT_H
+
+// On-disk layout of the PCD3 container.
+//
+//   [FileHeader][SectionEntry * sectionCount][payload][payload]...
+//
+// Every payload starts on a SECTION_ALIGNMENT boundary so the float and
+// index streams can be viewed in place once the file is memory-mapped.
+// All values are little-endian, same as PCD1/PCD2.
+
+#include <cstdint>
+#include <cstddef>
+
+namespace PCD {
+namespace Format {
+
+const char MAGIC_V3[4] = {'P', 'C', 'D', '3'};
+const uint32_t VERSION_V3 = 3;
+const uint32_t SECTION_ALIGNMENT = 16;
+
+// FileHeader::flags
+const uint32_t FILE_FLAG_PACKED_GEOMETRY = 1 << 0; // Geometry lives in SECTION_PACKED_GEOMETRY
+
+enum SectionType : uint32_t {
+    SECTION_META         = 1,  // MetaRecord
+    SECTION_STRINGS      = 2,  // Raw UTF-8 blob, referenced by StringRef
+    SECTION_TEXTURES     = 3,  // TextureRecord * textureCount
+    SECTION_TEXTURE_DATA = 4,  // Pixel blobs, each SECTION_ALIGNMENT aligned
+    SECTION_BRUSHES      = 5,  // BrushRecord * brushCount
+    SECTION_POSITIONS    = 6,  // float[3] * totalVertices
+    SECTION_NORMALS      = 7,  // float[3] * totalVertices
+    SECTION_UVS          = 8,  // float[2] * totalVertices
+    SECTION_INDICES      = 9,  // uint32_t * totalIndices
+    SECTION_ENTITIES     = 10, // EntityRecord * entityCount
+    SECTION_PROPERTIES   = 11, // PropertyRecord * totalProperties
+    SECTION_TEXTURE_FORMATS = 12, // TextureFormatRecord * textureCount (absent = all raw)
+    SECTION_PACKED_GEOMETRY = 13, // PackedGeometryHeader, see PCDGeometryCodec.h
+};
+
+struct StringRef {
+    uint32_t offset; // Into SECTION_STRINGS
+    uint32_t length;
+};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t headerSize;
+    uint32_t sectionCount;
+    uint32_t brushCount;
+    uint32_t entityCount;
+    uint32_t textureCount;
+    uint64_t fileSize;
+    uint8_t reserved[24];
+};
+
+struct SectionEntry {
+    uint32_t type;
+    uint32_t flags;
+    uint64_t offset; // From start of file
+    uint64_t size;   // In bytes
+};
+
+struct MetaRecord {
+    StringRef name;
+    StringRef author;
+    uint32_t nextBrushID;
+    uint32_t nextEntityID;
+    uint32_t nextTextureID;
+    uint32_t reserved;
+};
+
+struct TextureRecord {
+    uint32_t id;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    StringRef name;
+    uint64_t dataOffset; // Into SECTION_TEXTURE_DATA
+    uint64_t dataSize;
+};
+
+// Parallel to SECTION_TEXTURES; kept separate so older PCD3 files stay valid
+struct TextureFormatRecord {
+    uint32_t format; // PCD::TextureFormat
+    uint32_t mipCount;
+};
+
+struct BrushRecord {
+    uint32_t id;
+    uint32_t flags;
+    uint32_t textureID;
+    uint32_t firstVertex; // Into the POSITIONS/NORMALS/UVS streams
+    uint32_t vertexCount;
+    uint32_t firstIndex;  // Into the INDICES stream
+    uint32_t indexCount;
+    float color[3];
+    float uvScaleX;
+    float uvScaleY;
+    float uvOffsetX;
+    float uvOffsetY;
+    StringRef name;
+};
+
+// Quantized + block-compressed replacement for the POSITIONS/NORMALS/UVS/
+// INDICES streams:
+//   [PackedGeometryHeader][PackedBlock * blockCount][uint64 brushOffset * brushCount][blocks]
+// brushOffset is where each brush starts in the decompressed stream.
+struct PackedGeometryHeader {
+    float precision;    // Position grid step
+    uint32_t blockSize; // Decompressed bytes per block (last may be short)
+    uint32_t blockCount;
+    uint32_t reserved;
+    uint64_t rawSize;   // Total decompressed bytes
+};
+
+struct PackedBlock {
+    uint32_t rawSize;
+    uint32_t compressedSize; // == rawSize means stored uncompressed
+    uint64_t offset;         // From the start of the block payload
+};
+
+struct EntityRecord {
+    uint32_t id;
+    uint32_t type;
+    float position[3];
+    float rotation[3];
+    float scale[3];
+    uint32_t firstProperty; // Into SECTION_PROPERTIES
+    uint32_t propertyCount;
+    StringRef name;
+};
+
+struct PropertyRecord {
+    StringRef key;
+    StringRef value;
+};
+
+static_assert(sizeof(FileHeader) == 64, "PCD3 header layout changed");
+static_assert(sizeof(SectionEntry) == 24, "PCD3 section entry layout changed");
+static_assert(sizeof(MetaRecord) == 32, "PCD3 meta record layout changed");
+static_assert(sizeof(TextureRecord) == 40, "PCD3 texture record layout changed");
+static_assert(sizeof(TextureFormatRecord) == 8, "PCD3 texture format record layout changed");
+static_assert(sizeof(BrushRecord) == 64, "PCD3 brush record layout changed");
+static_assert(sizeof(PackedGeometryHeader) == 24, "PCD3 packed geometry header layout changed");
+static_assert(sizeof(PackedBlock) == 16, "PCD3 packed block layout changed");
+static_assert(sizeof(EntityRecord) == 60, "PCD3 entity record layout changed");
+static_assert(sizeof(PropertyRecord) == 16, "PCD3 property record layout changed");
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment = SECTION_ALIGNMENT) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace Format
+} // namespace PCD
+
+#endif // PCD_FORMAT_H
@@ -0,0 +1,441 @@
+#ifndef PCD_GEOMETRY_CODEC_H
+#define PCD_GEOMETRY_CODEC_H
+
+// Compact brush geometry for SECTION_PACKED_GEOMETRY.
+//
+// Each brush becomes one record in a byte stream:
+//   float boundsMin[3]
+//   positions  - grid steps from boundsMin, zigzag-varint delta to the previous vertex
+//   normals    - octahedral, 2 x snorm16
+//   uvs        - 2 x IEEE half
+//   indices    - zigzag-varint delta to the previous index
+// The stream is then cut into fixed-size blocks for BlockCompressor, which
+// also gives the loader independent units of work.
+
+#include "PCDTypes.h"
+#include "PCDFormat.h"
+#include "PCDMappedFile.h"
+#include "PCDCompression.h"
+#include "PCDWorkerPool.h"
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+namespace PCD {
+
+class GeometryCodec {
+public:
+    static const uint32_t BLOCK_SIZE = 64 * 1024;
+
+    // Builds the SECTION_PACKED_GEOMETRY payload for brushes
+    static void Pack(const std::vector<Brush>& brushes, float precision, unsigned threads,
+                     std::vector<uint8_t>& out) {
+        using namespace Format;
+        if (!(precision > 0.0f)) precision = 1.0f / 1024.0f;
+
+        // Encode brushes in contiguous groups, then stitch the groups together
+        size_t groupCount = std::min<size_t>(brushes.size(), size_t(WorkerPool::DefaultThreadCount()) * 4);
+        std::vector<std::vector<uint8_t>> groups(groupCount);
+        std::vector<uint64_t> brushOffsets(brushes.size());
+
+        auto encodeGroups = [&](size_t begin, size_t end) {
+            for (size_t g = begin; g < end; g++) {
+                size_t first = brushes.size() * g / groupCount;
+                size_t last = brushes.size() * (g + 1) / groupCount;
+                for (size_t b = first; b < last; b++) {
+                    brushOffsets[b] = groups[g].size(); // Local for now
+                    EncodeBrush(brushes[b], precision, groups[g]);
+                }
+            }
+        };
+        Run(groupCount, threads, encodeGroups);
+
+        std::vector<uint8_t> raw;
+        for (size_t g = 0; g < groupCount; g++) {
+            size_t first = brushes.size() * g / groupCount;
+            size_t last = brushes.size() * (g + 1) / groupCount;
+            for (size_t b = first; b < last; b++) brushOffsets[b] += raw.size();
+            raw.insert(raw.end(), groups[g].begin(), groups[g].end());
+        }
+
+        uint32_t blockCount = static_cast<uint32_t>((raw.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        std::vector<std::vector<uint8_t>> compressed(blockCount);
+        auto compressBlocks = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                size_t start = i * BLOCK_SIZE;
+                size_t size = std::min<size_t>(BLOCK_SIZE, raw.size() - start);
+                BlockCompressor::Compress(raw.data() + start, size, compressed[i]);
+                // Keep incompressible blocks as they are
+                if (compressed[i].size() >= size) compressed[i].assign(raw.begin() + start, raw.begin() + start + size);
+            }
+        };
+        Run(blockCount, threads, compressBlocks);
+
+        PackedGeometryHeader header{};
+        header.precision = precision;
+        header.blockSize = BLOCK_SIZE;
+        header.blockCount = blockCount;
+        header.rawSize = raw.size();
+
+        std::vector<PackedBlock> blocks(blockCount);
+        uint64_t payloadSize = 0;
+        for (uint32_t i = 0; i < blockCount; i++) {
+            blocks[i].rawSize = static_cast<uint32_t>(std::min<size_t>(BLOCK_SIZE, raw.size() - size_t(i) * BLOCK_SIZE));
+            blocks[i].compressedSize = static_cast<uint32_t>(compressed[i].size());
+            blocks[i].offset = payloadSize;
+            payloadSize += compressed[i].size();
+        }
+
+        out.clear();
+        Append(out, &header, sizeof(header));
+        Append(out, blocks.data(), blocks.size() * sizeof(PackedBlock));
+        Append(out, brushOffsets.data(), brushOffsets.size() * sizeof(uint64_t));
+        for (const auto& block : compressed) Append(out, block.data(), block.size());
+    }
+
+    // Restores vertices and indices of brushes (already sized to records)
+    static bool Unpack(Span<uint8_t> section, Span<Format::BrushRecord> records,
+                       std::vector<Brush>& brushes, unsigned threads) {
+        using namespace Format;
+        PackedGeometryHeader header;
+        if (section.size() < sizeof(header)) {
+            std::cerr << "[PCD] Packed geometry section missing\n";
+            return false;
+        }
+        memcpy(&header, section.data(), sizeof(header));
+
+        uint64_t tableSize = uint64_t(header.blockCount) * sizeof(PackedBlock) + uint64_t(records.size()) * sizeof(uint64_t);
+        if (tableSize > section.size() - sizeof(header) || header.blockSize == 0 ||
+            header.rawSize > uint64_t(header.blockCount) * header.blockSize) {
+            std::cerr << "[PCD] Corrupt packed geometry header\n";
+            return false;
+        }
+        std::vector<PackedBlock> blocks(header.blockCount);
+        std::vector<uint64_t> brushOffsets(records.size());
+        const uint8_t* cursor = section.data() + sizeof(header);
+        memcpy(blocks.data(), cursor, blocks.size() * sizeof(PackedBlock));
+        cursor += blocks.size() * sizeof(PackedBlock);
+        memcpy(brushOffsets.data(), cursor, brushOffsets.size() * sizeof(uint64_t));
+        cursor += brushOffsets.size() * sizeof(uint64_t);
+        const uint8_t* payload = cursor;
+        size_t payloadSize = section.size() - (payload - section.data());
+
+        uint64_t rawCheck = 0;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            const PackedBlock& block = blocks[i];
+            bool last = i + 1 == blocks.size();
+            if (block.offset > payloadSize || block.compressedSize > payloadSize - block.offset ||
+                block.rawSize > header.blockSize || (!last && block.rawSize != header.blockSize)) {
+                std::cerr << "[PCD] Corrupt packed geometry block table\n";
+                return false;
+            }
+            rawCheck += block.rawSize;
+        }
+        if (rawCheck != header.rawSize) {
+            std::cerr << "[PCD] Packed geometry size mismatch\n";
+            return false;
+        }
+
+        std::vector<uint8_t> raw(static_cast<size_t>(header.rawSize));
+        bool ok = true;
+        std::mutex failMutex;
+        auto fail = [&](const char* what) {
+            std::lock_guard<std::mutex> lock(failMutex);
+            if (ok) std::cerr << "[PCD] " << what << "\n";
+            ok = false;
+        };
+
+        auto decompressBlocks = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const PackedBlock& block = blocks[i];
+                uint8_t* dst = raw.data() + i * header.blockSize;
+                if (block.compressedSize == block.rawSize) {
+                    memcpy(dst, payload + block.offset, block.rawSize);
+                } else if (!BlockCompressor::Decompress(payload + block.offset, block.compressedSize, dst, block.rawSize)) {
+                    fail("Corrupt packed geometry block");
+                }
+            }
+        };
+        Run(blocks.size(), threads, decompressBlocks);
+        if (!ok) return false;
+
+        auto decodeBrushes = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (brushOffsets[i] > raw.size() ||
+                    !DecodeBrush(raw.data() + brushOffsets[i], raw.data() + raw.size(),
+                                 records[i].vertexCount, records[i].indexCount, header.precision, brushes[i])) {
+                    fail("Corrupt packed brush geometry");
+                }
+            }
+        };
+        Run(records.size(), threads, decodeBrushes);
+        return ok;
+    }
+
+    static void EncodeBrush(const Brush& brush, float precision, std::vector<uint8_t>& out) {
+        Vec3 boundsMin = brush.GetBounds().min;
+        Append(out, &boundsMin.x, sizeof(float));
+        Append(out, &boundsMin.y, sizeof(float));
+        Append(out, &boundsMin.z, sizeof(float));
+
+        int64_t prev[3] = {0, 0, 0};
+        for (const auto& v : brush.vertices) {
+            int64_t q[3] = {
+                std::llround((v.position.x - boundsMin.x) / precision),
+                std::llround((v.position.y - boundsMin.y) / precision),
+                std::llround((v.position.z - boundsMin.z) / precision),
+            };
+            for (int k = 0; k < 3; k++) {
+                PutVarint(out, ZigZag(q[k] - prev[k]));
+                prev[k] = q[k];
+            }
+        }
+
+        for (const auto& v : brush.vertices) {
+            int16_t oct[2];
+            EncodeOctahedral(v.normal, oct);
+            Append(out, oct, sizeof(oct));
+        }
+
+        for (const auto& v : brush.vertices) {
+            uint16_t uv[2] = {FloatToHalf(v.uv.u), FloatToHalf(v.uv.v)};
+            Append(out, uv, sizeof(uv));
+        }
+
+        int64_t prevIndex = 0;
+        for (uint32_t index : brush.indices) {
+            PutVarint(out, ZigZag(int64_t(index) - prevIndex));
+            prevIndex = index;
+        }
+    }
+
+    static bool DecodeBrush(const uint8_t* p, const uint8_t* end, uint32_t vertexCount, uint32_t indexCount,
+                            float precision, Brush& brush) {
+        float boundsMin[3];
+        if (end - p < 12) return false;
+        memcpy(boundsMin, p, 12);
+        p += 12;
+        // Every vertex takes at least 11 bytes and every index 1
+        if (uint64_t(vertexCount) * 11 + indexCount > uint64_t(end - p)) return false;
+
+        brush.vertices.resize(vertexCount);
+        brush.InvalidateBounds();
+        int64_t q[3] = {0, 0, 0};
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            for (int k = 0; k < 3; k++) {
+                uint64_t delta;
+                if (!GetVarint(p, end, delta)) return false;
+                q[k] += UnZigZag(delta);
+            }
+            Vec3& pos = brush.vertices[i].position;
+            pos.x = boundsMin[0] + float(q[0]) * precision;
+            pos.y = boundsMin[1] + float(q[1]) * precision;
+            pos.z = boundsMin[2] + float(q[2]) * precision;
+        }
+
+        if (size_t(end - p) < size_t(vertexCount) * 8) return false;
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            int16_t oct[2];
+            memcpy(oct, p, sizeof(oct));
+            p += sizeof(oct);
+            brush.vertices[i].normal = DecodeOctahedral(oct);
+        }
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            uint16_t uv[2];
+            memcpy(uv, p, sizeof(uv));
+            p += sizeof(uv);
+            brush.vertices[i].uv = Vec2(HalfToFloat(uv[0]), HalfToFloat(uv[1]));
+        }
+
+        brush.indices.resize(indexCount);
+        int64_t index = 0;
+        for (uint32_t i = 0; i < indexCount; i++) {
+            uint64_t delta;
+            if (!GetVarint(p, end, delta)) return false;
+            index += UnZigZag(delta);
+            if (index < 0 || index > int64_t(UINT32_MAX)) return false;
+            brush.indices[i] = static_cast<uint32_t>(index);
+        }
+        return true;
+    }
+
+    // Largest per-component differences between two decodings of the same brushes
+    struct RoundTripError {
+        float position = 0.0f;
+        float normal = 0.0f;
+        float uv = 0.0f;
+        float positionMagnitude = 0.0f; // Largest |coordinate| seen, for float rounding slack
+        bool topologyMatches = true; // Same counts and identical indices
+    };
+
+    static RoundTripError Compare(const std::vector<Brush>& expected, const std::vector<Brush>& actual) {
+        RoundTripError err;
+        if (expected.size() != actual.size()) {
+            err.topologyMatches = false;
+            return err;
+        }
+        for (size_t b = 0; b < expected.size(); b++) {
+            const Brush& x = expected[b];
+            const Brush& y = actual[b];
+            if (x.vertices.size() != y.vertices.size() || x.indices != y.indices) {
+                err.topologyMatches = false;
+                continue;
+            }
+            for (size_t v = 0; v < x.vertices.size(); v++) {
+                const Vertex& a = x.vertices[v];
+                const Vertex& c = y.vertices[v];
+                err.position = std::max({err.position, std::fabs(a.position.x - c.position.x),
+                                         std::fabs(a.position.y - c.position.y), std::fabs(a.position.z - c.position.z)});
+                err.positionMagnitude = std::max({err.positionMagnitude, std::fabs(a.position.x),
+                                                  std::fabs(a.position.y), std::fabs(a.position.z)});
+                if (a.normal.Length() > 0.0f) {
+                    Vec3 n = a.normal.Normalized();
+                    err.normal = std::max({err.normal, std::fabs(n.x - c.normal.x),
+                                           std::fabs(n.y - c.normal.y), std::fabs(n.z - c.normal.z)});
+                }
+                // Half floats keep 11 significant bits, so scale by magnitude
+                float uvScale = std::max(1.0f, std::max(std::fabs(a.uv.u), std::fabs(a.uv.v)));
+                err.uv = std::max({err.uv, std::fabs(a.uv.u - c.uv.u) / uvScale,
+                                   std::fabs(a.uv.v - c.uv.v) / uvScale});
+            }
+        }
+        return err;
+    }
+
+    // Bounds the packed encoding guarantees for a given grid precision
+    static bool WithinTolerance(const RoundTripError& err, float precision) {
+        return err.topologyMatches &&
+               err.position <= precision * 0.5f + err.positionMagnitude * 4.0f * FLT_EPSILON &&
+               err.normal <= 1e-3f &&
+               err.uv <= 1.0f / 1024.0f;
+    }
+
+    static void EncodeOctahedral(const Vec3& n, int16_t* out) {
+        float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        float x = sum > 0.0f ? n.x / sum : 0.0f;
+        float y = sum > 0.0f ? n.y / sum : 0.0f;
+        if (n.z < 0.0f) {
+            float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+        out[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+        out[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    static Vec3 DecodeOctahedral(const int16_t* in) {
+        float x = std::max(in[0] / 32767.0f, -1.0f);
+        float y = std::max(in[1] / 32767.0f, -1.0f);
+        float z = 1.0f - std::fabs(x) - std::fabs(y);
+        if (z < 0.0f) {
+            float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+        return Vec3(x, y, z).Normalized();
+    }
+
+    static uint16_t FloatToHalf(float value) {
+        uint32_t f;
+        memcpy(&f, &value, 4);
+        uint32_t sign = (f >> 16) & 0x8000;
+        int32_t exponent = int32_t((f >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = f & 0x7FFFFF;
+
+        if (((f >> 23) & 0xFF) == 0xFF) {
+            return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // Inf / NaN
+        }
+        if (exponent >= 31) return uint16_t(sign | 0x7C00);
+        if (exponent <= 0) {
+            if (exponent < -10) return uint16_t(sign);
+            // Subnormal half
+            mantissa |= 0x800000;
+            uint32_t shift = uint32_t(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            uint32_t rest = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (half & 1))) half++;
+            return uint16_t(sign | half);
+        }
+
+        uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+        uint32_t rest = mantissa & 0x1FFF;
+        // Round to nearest even; a carry into the exponent is still correct
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+        return uint16_t(sign | half);
+    }
+
+    static float HalfToFloat(uint16_t h) {
+        uint32_t sign = uint32_t(h & 0x8000) << 16;
+        uint32_t exponent = (h >> 10) & 0x1F;
+        uint32_t mantissa = h & 0x3FF;
+        uint32_t f;
+
+        if (exponent == 0) {
+            if (mantissa == 0) {
+                f = sign;
+            } else {
+                // Renormalise a subnormal
+                exponent = 127 - 15 + 1;
+                while ((mantissa & 0x400) == 0) {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                mantissa &= 0x3FF;
+                f = sign | (exponent << 23) | (mantissa << 13);
+            }
+        } else if (exponent == 31) {
+            f = sign | 0x7F800000 | (mantissa << 13);
+        } else {
+            f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float value;
+        memcpy(&value, &f, 4);
+        return value;
+    }
+
+private:
+    static void Run(size_t count, unsigned threads, const std::function<void(size_t, size_t)>& fn) {
+        if (threads == 1) {
+            fn(0, count);
+        } else {
+            WorkerPool::Shared().ParallelFor(count, threads, fn);
+        }
+    }
+
+    static void Append(std::vector<uint8_t>& out, const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    static uint64_t ZigZag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+    static int64_t UnZigZag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+    static void PutVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    static bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) return false;
+            uint8_t b = *p++;
+            v |= uint64_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) return true;
+        }
+        return false;
+    }
+};
+
+} // namespace PCD
+
+#endif // PCD_GEOMETRY_CODEC_H
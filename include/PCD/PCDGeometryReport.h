@@ -0,0 +1,98 @@
+#ifndef PCD_GEOMETRY_REPORT_H
+#define PCD_GEOMETRY_REPORT_H
+
+// Size / speed / accuracy comparison of the raw and packed geometry
+// encodings for one map, to decide which one a map should ship with.
+
+#include "PCDFile.h"
+#include "PCDGeometryCodec.h"
+#include <chrono>
+#include <ostream>
+
+namespace PCD {
+
+class GeometryReport {
+public:
+    struct Result {
+        float precision = 0.0f;
+        uint64_t rawFileBytes = 0;
+        uint64_t packedFileBytes = 0;
+        uint64_t rawGeometryBytes = 0;    // POSITIONS + NORMALS + UVS + INDICES
+        uint64_t packedGeometryBytes = 0; // PACKED_GEOMETRY
+        double rawSaveMs = 0.0;
+        double packedSaveMs = 0.0;
+        double rawLoadMs = 0.0;    // Decode from memory, best of N
+        double packedLoadMs = 0.0;
+        GeometryCodec::RoundTripError error;
+        bool withinTolerance = false;
+    };
+
+    static Result Measure(const Map& map, float precision, unsigned threads = 1, int iterations = 3) {
+        Result result;
+        result.precision = precision;
+
+        SaveOptions rawOptions;
+        rawOptions.threads = threads;
+        SaveOptions packedOptions = rawOptions;
+        packedOptions.packGeometry = true;
+        packedOptions.positionPrecision = precision;
+        LoadOptions loadOptions;
+        loadOptions.threads = threads;
+
+        std::vector<uint8_t> raw, packed;
+        result.rawSaveMs = BestOf(iterations, [&] { PCDWriter::Serialize(map, raw, rawOptions); });
+        result.packedSaveMs = BestOf(iterations, [&] { PCDWriter::Serialize(map, packed, packedOptions); });
+        result.rawFileBytes = raw.size();
+        result.packedFileBytes = packed.size();
+
+        MapView view;
+        if (view.Open(raw.data(), raw.size())) {
+            result.rawGeometryBytes = view.Section(Format::SECTION_POSITIONS).size() +
+                                      view.Section(Format::SECTION_NORMALS).size() +
+                                      view.Section(Format::SECTION_UVS).size() +
+                                      view.Section(Format::SECTION_INDICES).size();
+        }
+        if (view.Open(packed.data(), packed.size())) {
+            result.packedGeometryBytes = view.Section(Format::SECTION_PACKED_GEOMETRY).size();
+        }
+
+        Map decoded;
+        result.rawLoadMs = BestOf(iterations, [&] { PCDReader::LoadFromMemory(decoded, raw.data(), raw.size(), loadOptions); });
+        result.packedLoadMs = BestOf(iterations, [&] { PCDReader::LoadFromMemory(decoded, packed.data(), packed.size(), loadOptions); });
+
+        result.error = GeometryCodec::Compare(map.brushes, decoded.brushes);
+        result.withinTolerance = GeometryCodec::WithinTolerance(result.error, precision);
+        return result;
+    }
+
+    static void Print(const Result& r, std::ostream& out) {
+        out << "Geometry encoding (precision " << r.precision << ")\n";
+        out << "  raw:    file " << r.rawFileBytes << " B, geometry " << r.rawGeometryBytes
+            << " B, save " << r.rawSaveMs << " ms, load " << r.rawLoadMs << " ms\n";
+        out << "  packed: file " << r.packedFileBytes << " B, geometry " << r.packedGeometryBytes
+            << " B, save " << r.packedSaveMs << " ms, load " << r.packedLoadMs << " ms\n";
+        if (r.packedGeometryBytes > 0) {
+            out << "  geometry ratio " << double(r.rawGeometryBytes) / double(r.packedGeometryBytes) << "x\n";
+        }
+        out << "  max error: position " << r.error.position << ", normal " << r.error.normal
+            << ", uv " << r.error.uv << (r.error.topologyMatches ? "" : ", TOPOLOGY MISMATCH") << "\n";
+        out << "  round trip " << (r.withinTolerance ? "within tolerance" : "OUT OF TOLERANCE") << "\n";
+    }
+
+private:
+    template <typename Fn>
+    static double BestOf(int iterations, Fn&& fn) {
+        double best = 0.0;
+        for (int i = 0; i < std::max(1, iterations); i++) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || ms < best) best = ms;
+        }
+        return best;
+    }
+};
+
+} // namespace PCD
+
+#endif // PCD_GEOMETRY_REPORT_H
@@ -0,0 +1,132 @@
+#ifndef PCD_HASH_H
+#define PCD_HASH_H
+
+// 64-bit content hash (the xxHash64 algorithm). Fast enough to run over
+// texture pixels on every import; not meant to be cryptographic.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace PCD {
+
+class Hasher {
+public:
+    explicit Hasher(uint64_t seed = 0) : seed(seed) {
+        acc[0] = seed + PRIME1 + PRIME2;
+        acc[1] = seed + PRIME2;
+        acc[2] = seed;
+        acc[3] = seed - PRIME1;
+    }
+
+    // Feed bytes incrementally; Digest() equals Hash64 over the concatenation
+    void Update(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        total += size;
+
+        if (bufferSize + size < 32) {
+            memcpy(buffer + bufferSize, p, size);
+            bufferSize += size;
+            return;
+        }
+        if (bufferSize > 0) {
+            size_t fill = 32 - bufferSize;
+            memcpy(buffer + bufferSize, p, fill);
+            ConsumeStripe(buffer);
+            p += fill;
+            size -= fill;
+            bufferSize = 0;
+        }
+        while (size >= 32) {
+            ConsumeStripe(p);
+            p += 32;
+            size -= 32;
+        }
+        memcpy(buffer, p, size);
+        bufferSize = size;
+    }
+
+    template <typename T>
+    void UpdateValue(const T& value) { Update(&value, sizeof(T)); }
+
+    uint64_t Digest() const {
+        uint64_t h;
+        if (total >= 32) {
+            h = Rotl(acc[0], 1) + Rotl(acc[1], 7) + Rotl(acc[2], 12) + Rotl(acc[3], 18);
+            for (int i = 0; i < 4; i++) h = MergeRound(h, acc[i]);
+        } else {
+            h = seed + PRIME5;
+        }
+        h += total;
+
+        const uint8_t* p = buffer;
+        size_t left = bufferSize;
+        while (left >= 8) {
+            h ^= Round(0, Read64(p));
+            h = Rotl(h, 27) * PRIME1 + PRIME4;
+            p += 8;
+            left -= 8;
+        }
+        if (left >= 4) {
+            h ^= uint64_t(Read32(p)) * PRIME1;
+            h = Rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+            left -= 4;
+        }
+        while (left > 0) {
+            h ^= (*p) * PRIME5;
+            h = Rotl(h, 11) * PRIME1;
+            p++;
+            left--;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t Read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+    static uint32_t Read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+    static uint64_t Round(uint64_t a, uint64_t input) {
+        a += input * PRIME2;
+        a = Rotl(a, 31);
+        return a * PRIME1;
+    }
+
+    static uint64_t MergeRound(uint64_t h, uint64_t a) {
+        h ^= Round(0, a);
+        return h * PRIME1 + PRIME4;
+    }
+
+    void ConsumeStripe(const uint8_t* p) {
+        for (int i = 0; i < 4; i++) acc[i] = Round(acc[i], Read64(p + i * 8));
+    }
+
+    uint64_t seed;
+    uint64_t acc[4];
+    uint64_t total = 0;
+    uint8_t buffer[32];
+    size_t bufferSize = 0;
+};
+
+inline uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0) {
+    Hasher hasher(seed);
+    hasher.Update(data, size);
+    return hasher.Digest();
+}
+
+} // namespace PCD
+
+#endif // PCD_HASH_H
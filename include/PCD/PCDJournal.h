@@ -0,0 +1,415 @@
+#ifndef PCD_JOURNAL_H
+#define PCD_JOURNAL_H
+
+// Append-only autosave journal.
+//
+// A journal names a base file (the saved map, a compacted snapshot, or none
+// for a map that was never saved) and appends one batch of records per
+// checkpoint: the full contents of every brush, entity and texture that
+// changed since the previous checkpoint, removals by ID, and the brush or
+// entity order when it moved. Checkpoint cost follows the size of the edit,
+// not the size of the map.
+//
+//   [JournalHeader][base path][record]...
+//
+// Records are the MapRecords of PCDDiff.h, plus a COMMIT after each batch.
+// Records replace whole objects, so replaying one twice is harmless; that is
+// what lets compaction swap the base underneath a journal without a window
+// where a crash loses edits. A batch only takes effect once its COMMIT
+// record reads back intact, so a torn tail is dropped instead of half-applied.
+
+#include "PCDDiff.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace PCD {
+
+class MapJournal {
+public:
+    static const uint32_t VERSION = 2;
+    static const uint64_t COMPACT_BYTES = 16ull << 20; // Journal size that triggers compaction
+
+    struct JournalHeader {
+        char magic[4];         // "PCDJ"
+        uint32_t version;
+        uint32_t basePathSize; // UTF-8 path follows the header; 0 = empty map
+        uint32_t reserved;
+        uint64_t baseSize;     // Identity of the base file when the journal started,
+        int64_t baseTime;      // so a journal is never replayed over a different file
+    };
+
+    // bytes: appended to the journal, 0 when nothing changed
+    using CheckpointStats = DiffStats;
+
+    struct ReplayResult {
+        std::string basePath;
+        uint32_t checkpoints = 0;
+        uint64_t validBytes = 0; // End of the last intact batch
+    };
+
+    MapJournal() = default;
+    ~MapJournal() { Close(); }
+    MapJournal(const MapJournal&) = delete;
+    MapJournal& operator=(const MapJournal&) = delete;
+
+    bool IsOpen() const { return file != nullptr; }
+    const std::string& Path() const { return path; }
+    uint64_t Size() const { return fileBytes; }
+    bool HasCheckpoints() const { return checkpoints > 0; }
+    bool IsCompacting() const { return compaction.valid(); }
+
+    // Starts a fresh journal. current must match the contents of basePath;
+    // without a base file the journal starts from an empty map and the first
+    // checkpoint records everything.
+    bool Start(const std::string& journalPath, const std::string& basePath, const Map& current,
+               unsigned threads = 1) {
+        Close();
+        std::error_code ec;
+        bool hasBase = !basePath.empty() && std::filesystem::exists(basePath, ec);
+
+        path = journalPath;
+        file = std::fopen(journalPath.c_str(), "wb");
+        if (!file) {
+            std::cerr << "[PCD] Failed to create journal: " << journalPath << "\n";
+            path.clear();
+            return false;
+        }
+        fileBytes = WriteHeader(file, hasBase ? basePath : std::string());
+        SyncFile(file);
+        if (fileBytes == 0) {
+            std::cerr << "[PCD] Failed to write journal: " << journalPath << "\n";
+            Close();
+            return false;
+        }
+
+        this->basePath = hasBase ? basePath : std::string();
+        snapshotSlot = -1;
+        checkpoints = 0;
+        RemoveSnapshots();
+
+        tracked.Track(hasBase ? current : Map(), threads);
+        return true;
+    }
+
+    // Replays an existing journal into map and keeps appending to it.
+    // Leaves map untouched and returns false if there is nothing to recover.
+    bool Recover(const std::string& journalPath, Map& map, const LoadOptions& options = LoadOptions(),
+                 unsigned threads = 1) {
+        Close();
+        Map recovered;
+        ReplayResult result;
+        if (!Replay(journalPath, recovered, options, &result) || result.checkpoints == 0) return false;
+
+        // Drop a torn tail so new batches follow the last intact one
+        std::error_code ec;
+        std::filesystem::resize_file(journalPath, result.validBytes, ec);
+        file = ec ? nullptr : std::fopen(journalPath.c_str(), "ab");
+        if (!file) {
+            std::cerr << "[PCD] Failed to reopen journal: " << journalPath << "\n";
+            return false;
+        }
+
+        path = journalPath;
+        fileBytes = result.validBytes;
+        basePath = result.basePath;
+        checkpoints = result.checkpoints;
+        snapshotSlot = -1;
+        for (int slot = 0; slot < 2; slot++) {
+            if (basePath == SnapshotPath(slot)) snapshotSlot = slot;
+        }
+        RemoveSnapshots(); // Leftovers of an interrupted compaction
+
+        tracked.Track(recovered, threads);
+        map = std::move(recovered);
+
+        std::cout << "[PCD] Recovered " << result.checkpoints << " checkpoint(s) from journal: "
+                  << journalPath << "\n";
+        return true;
+    }
+
+    // Appends everything that changed since the last checkpoint as one
+    // durable batch. Only the objects in changes (see MapChanges) and new
+    // ones are hashed, spread over threads (0 = all cores).
+    CheckpointStats Checkpoint(const Map& map, const MapChanges& changes, unsigned threads = 1) {
+        CheckpointStats stats;
+        if (!file) return stats;
+
+        std::vector<uint8_t> batch;
+        stats = tracked.Advance(map, changes, batch, threads);
+        if (batch.empty()) return stats;
+
+        uint64_t number = checkpoints + 1;
+        MapRecords::Append(batch, MapRecords::REC_COMMIT, &number, sizeof(number));
+
+        if (std::fwrite(batch.data(), 1, batch.size(), file) != batch.size()) {
+            std::cerr << "[PCD] Failed to append to journal: " << path << "\n";
+            // The batch may be half written; replay will stop before it, and
+            // later batches must not follow it
+            Close();
+            return stats;
+        }
+        SyncFile(file);
+        fileBytes += batch.size();
+        checkpoints = number;
+        stats.bytes = batch.size();
+        return stats;
+    }
+
+    // Without a change list every object is hashed again
+    CheckpointStats Checkpoint(const Map& map, unsigned threads = 1) {
+        MapChanges everything;
+        everything.all = true;
+        return Checkpoint(map, everything, threads);
+    }
+
+    // Folds the journal into a full PCD snapshot on a background thread once
+    // it passes thresholdBytes. Poll with PollCompaction().
+    bool StartCompaction(uint64_t thresholdBytes = COMPACT_BYTES) {
+        if (!file || compaction.valid() || fileBytes < thresholdBytes) return false;
+
+        // Never overwrite the snapshot the journal is currently based on
+        compactSlot = (snapshotSlot == 0) ? 1 : 0;
+        compactLimit = fileBytes;
+        compaction = std::async(std::launch::async, CompactTo, path, compactLimit, SnapshotPath(compactSlot));
+        return true;
+    }
+
+    // Once a compaction has finished, rebases the journal on the new snapshot
+    // and keeps only the batches written since it started. Cheap to call
+    // every frame.
+    bool PollCompaction() {
+        if (!compaction.valid() ||
+            compaction.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        std::string snapshot = SnapshotPath(compactSlot);
+        if (!compaction.get() || !file) {
+            RemoveFile(snapshot);
+            return false;
+        }
+
+        std::vector<uint8_t> tail(static_cast<size_t>(fileBytes - compactLimit));
+        std::string tmpPath = path + ".tmp";
+        std::FILE* tmp = nullptr;
+        bool ok = ReadRange(path, compactLimit, tail.data(), tail.size()) &&
+                  (tmp = std::fopen(tmpPath.c_str(), "wb")) != nullptr;
+        uint64_t headerBytes = ok ? WriteHeader(tmp, snapshot) : 0;
+        ok = ok && headerBytes > 0 && (tail.empty() || std::fwrite(tail.data(), 1, tail.size(), tmp) == tail.size());
+        if (tmp) {
+            SyncFile(tmp);
+            std::fclose(tmp);
+        }
+
+        std::error_code ec;
+        if (ok) {
+            std::fclose(file);
+            std::filesystem::rename(tmpPath, path, ec);
+            file = std::fopen(path.c_str(), "ab");
+        }
+        if (!ok || ec || !file) {
+            std::cerr << "[PCD] Failed to rebase journal on snapshot: " << path << "\n";
+            RemoveFile(tmpPath);
+            RemoveFile(snapshot);
+            if (!file) Close();
+            return false;
+        }
+
+        // The old snapshot (never the user's map) is no longer referenced
+        if (snapshotSlot >= 0) RemoveFile(SnapshotPath(snapshotSlot));
+        snapshotSlot = compactSlot;
+        basePath = snapshot;
+        fileBytes = headerBytes + tail.size();
+        return true;
+    }
+
+    // Stops journaling, waiting for a running compaction. Files stay on disk
+    // for recovery.
+    void Close() {
+        if (compaction.valid()) {
+            compaction.wait();
+            PollCompaction();
+        }
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    // Closes and deletes the journal and its snapshots, for when the map on
+    // disk is up to date
+    void Discard() {
+        Close();
+        if (path.empty()) return;
+        RemoveFile(path);
+        for (int slot = 0; slot < 2; slot++) RemoveFile(SnapshotPath(slot));
+        path.clear();
+        checkpoints = 0;
+    }
+
+    // Rebuilds the map a journal describes: its base, then every intact
+    // batch within the first limit bytes
+    static bool Replay(const std::string& journalPath, Map& map, const LoadOptions& options = LoadOptions(),
+                       ReplayResult* result = nullptr, uint64_t limit = UINT64_MAX) {
+        std::vector<uint8_t> bytes;
+        {
+            std::ifstream in(journalPath, std::ios::binary | std::ios::ate);
+            if (!in.is_open()) return false;
+            uint64_t size = std::min<uint64_t>(static_cast<uint64_t>(in.tellg()), limit);
+            bytes.resize(static_cast<size_t>(size));
+            in.seekg(0);
+            in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!in.good()) return false;
+        }
+
+        JournalHeader header;
+        if (bytes.size() < sizeof(header)) return false;
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, "PCDJ", 4) != 0 || header.version != VERSION ||
+            header.basePathSize > bytes.size() - sizeof(header)) {
+            std::cerr << "[PCD] Invalid journal: " << journalPath << "\n";
+            return false;
+        }
+        std::string base(reinterpret_cast<const char*>(bytes.data()) + sizeof(header), header.basePathSize);
+        size_t pos = sizeof(header) + header.basePathSize;
+
+        map = Map();
+        if (!base.empty()) {
+            uint64_t size = 0;
+            int64_t time = 0;
+            if (!FileIdentity(base, size, time) || size != header.baseSize || time != header.baseTime) {
+                std::cerr << "[PCD] Journal base changed since the journal was written: " << base << "\n";
+                return false;
+            }
+            if (!PCDReader::Load(map, base, options)) return false;
+        }
+
+        MapPatcher patcher(map);
+        uint32_t checkpoints = 0;
+        uint64_t validBytes = pos;
+        std::vector<MapRecords::Record> batch;
+        MapRecords::Record record{0, MapRecords::Reader(nullptr, 0)};
+
+        // Stops at the end or at a torn/corrupt tail
+        while (MapRecords::Next(bytes.data(), bytes.size(), pos, record)) {
+            if (record.type != MapRecords::REC_COMMIT) {
+                batch.push_back(record);
+                continue;
+            }
+            if (!patcher.Apply(batch)) {
+                std::cerr << "[PCD] Corrupt journal batch in: " << journalPath << "\n";
+                break;
+            }
+            batch.clear();
+            checkpoints++;
+            validBytes = pos;
+        }
+
+        if (result) {
+            result->basePath = base;
+            result->checkpoints = checkpoints;
+            result->validBytes = validBytes;
+        }
+        return true;
+    }
+
+private:
+    std::string path;
+    std::string basePath;
+    std::FILE* file = nullptr;
+    uint64_t fileBytes = 0;
+    uint64_t checkpoints = 0;
+    MapDiffer tracked; // State as of the last checkpoint
+
+    int snapshotSlot = -1; // Slot the journal is based on, -1 = user's map / empty
+    int compactSlot = 0;
+    uint64_t compactLimit = 0;
+    std::future<bool> compaction;
+
+    std::string SnapshotPath(int slot) const { return path + ".snap" + char('0' + slot); }
+
+    void RemoveSnapshots() {
+        for (int slot = 0; slot < 2; slot++) {
+            if (slot != snapshotSlot) RemoveFile(SnapshotPath(slot));
+        }
+    }
+
+    // ---- Files ----
+
+    static uint64_t WriteHeader(std::FILE* f, const std::string& base) {
+        JournalHeader header = {};
+        memcpy(header.magic, "PCDJ", 4);
+        header.version = VERSION;
+        header.basePathSize = static_cast<uint32_t>(base.size());
+        if (!base.empty() && !FileIdentity(base, header.baseSize, header.baseTime)) return 0;
+        if (std::fwrite(&header, sizeof(header), 1, f) != 1) return 0;
+        if (!base.empty() && std::fwrite(base.data(), 1, base.size(), f) != base.size()) return 0;
+        return sizeof(header) + base.size();
+    }
+
+    static bool FileIdentity(const std::string& file, uint64_t& size, int64_t& time) {
+        std::error_code ec;
+        size = std::filesystem::file_size(file, ec);
+        if (ec) return false;
+        auto stamp = std::filesystem::last_write_time(file, ec);
+        if (ec) return false;
+        time = static_cast<int64_t>(stamp.time_since_epoch().count());
+        return true;
+    }
+
+    static bool ReadRange(const std::string& file, uint64_t offset, uint8_t* dst, size_t size) {
+        if (size == 0) return true;
+        std::ifstream in(file, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(offset));
+        in.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(size));
+        return in.good();
+    }
+
+    static void RemoveFile(const std::string& file) {
+        std::error_code ec;
+        std::filesystem::remove(file, ec);
+    }
+
+    // Flushes through to the disk so a checkpoint survives power loss too
+    static void SyncFile(std::FILE* f) {
+        std::fflush(f);
+#ifndef _WIN32
+        fsync(fileno(f));
+#else
+        _commit(_fileno(f));
+#endif
+    }
+
+    // Background job: base + journal[0, limit) -> full PCD at snapshotPath.
+    // Texture pixels are streamed from the base file rather than held in memory.
+    static bool CompactTo(std::string journalPath, uint64_t limit, std::string snapshotPath) {
+        LoadOptions options;
+        options.deferTextures = true;
+        Map map;
+        if (!Replay(journalPath, map, options, nullptr, limit)) return false;
+
+        std::string tmpPath = snapshotPath + ".tmp";
+        if (!PCDWriter::Save(map, tmpPath)) {
+            RemoveFile(tmpPath);
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, snapshotPath, ec);
+        if (ec) {
+            RemoveFile(tmpPath);
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace PCD
+
+#endif // PCD_JOURNAL_H
@@ -0,0 +1,257 @@
+#ifndef PCD_MAP_STATS_H
+#define PCD_MAP_STATS_H
+
+// Running totals for the map statistics panel.
+//
+// Each brush's share of the totals (vertices, triangles, flags and bounds)
+// is kept by ID, so an edit costs only the brushes it marked: their old
+// share is taken back and the new one added. As with PickTree, added and
+// deleted brushes are noticed by comparing counts and walking IDs, which
+// never reads vertices. Texture memory is summed again only when the
+// texture set changed.
+//
+// Bounds grow as brushes are added. Each side also counts the brushes that
+// reach it, so taking one back only costs a lookup into the pick tree when
+// it was the last brush on that side.
+
+#include "PCDTypes.h"
+#include "PCDPickTree.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+namespace PCD {
+
+class MapStats {
+public:
+    struct Totals {
+        size_t totalBrushes = 0;
+        size_t totalEntities = 0;
+        size_t totalTextures = 0;
+        size_t totalVertices = 0;
+        size_t totalTriangles = 0;
+        size_t brushesWithFlag[32] = {}; // By bit of BrushFlags
+        uint64_t textureBytes = 0;
+        uint64_t textureBytesSaved = 0;  // By texture dedupe
+        Vec3 mapBoundsMin;
+        Vec3 mapBoundsMax;
+        bool hasBounds = false;          // False until a brush has vertices
+    };
+
+    // Recounts everything on the next Get, e.g. after loading a map
+    void Invalidate() {
+        valid = false;
+        texturesDirty = true;
+    }
+
+    // Call after changing the brush with this ID in place. Added and
+    // deleted brushes are found without it.
+    void MarkBrush(uint32_t id) {
+        Entry& entry = byID[id];
+        if (entry.dirty) return;
+        entry.dirty = true;
+        dirty.push_back(id);
+    }
+
+    // Call after adding, removing or recompressing textures in place
+    void MarkTextures() { texturesDirty = true; }
+
+    const Totals& Get(const Map& map, PickTree& pickTree) {
+        SyncBrushes(map);
+        UpdateBounds(map, pickTree);
+        totals.totalBrushes = map.brushes.size();
+        totals.totalEntities = map.entities.size();
+
+        if (texturesDirty || totals.totalTextures != map.textures.size()) {
+            totals.totalTextures = map.textures.size();
+            totals.textureBytes = 0;
+            for (const auto& [id, tex] : map.textures) totals.textureBytes += tex.DataSize();
+            texturesDirty = false;
+        }
+        totals.textureBytesSaved = map.textureBytesDeduped;
+        return totals;
+    }
+
+private:
+    static constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+    // Sides of the bounds: min x, max x, min y, max y, min z, max z.
+    // Minimums are kept negated so every side grows upwards.
+    static constexpr int SIDES = 6;
+
+    // Per brush ID: what it added to the totals when last counted
+    struct Entry {
+        uint32_t position = NO_POSITION; // Index in map.brushes when last synced
+        uint32_t stamp = 0;
+        uint32_t vertices = 0;
+        uint32_t triangles = 0;
+        uint32_t flags = 0;
+        float reach[SIDES] = {};         // Valid if hasBounds
+        bool hasBounds = false;
+        bool tracked = false;
+        bool dirty = false;
+    };
+
+    struct Side {
+        float value = -FLT_MAX;
+        size_t count = 0;   // Brushes reaching value
+        bool stale = false; // The last of them was taken back
+    };
+
+    void SyncBrushes(const Map& map) {
+        if (!valid) {
+            Build(map.brushes);
+            return;
+        }
+
+        if (count == map.brushes.size() && DirtyInPlace(map.brushes)) {
+            for (uint32_t id : dirty) {
+                Entry& entry = byID[id];
+                entry.dirty = false;
+                Remove(entry);
+                Add(entry, map.brushes[entry.position]);
+            }
+            dirty.clear();
+            return;
+        }
+
+        Reconcile(map.brushes);
+    }
+
+    bool DirtyInPlace(const std::vector<Brush>& brushes) const {
+        for (uint32_t id : dirty) {
+            uint32_t position = byID.Find(id)->position;
+            if (position >= brushes.size() || brushes[position].id != id) return false;
+        }
+        return true;
+    }
+
+    void Build(const std::vector<Brush>& brushes) {
+        byID.Clear();
+        byID.Reserve(brushes.size());
+        dirty.clear();
+        count = 0;
+        totals.totalVertices = 0;
+        totals.totalTriangles = 0;
+        for (size_t& flagCount : totals.brushesWithFlag) flagCount = 0;
+        for (Side& side : sides) side = Side();
+
+        for (size_t i = 0; i < brushes.size(); i++) {
+            Entry& entry = byID[brushes[i].id];
+            entry.position = static_cast<uint32_t>(i);
+            entry.stamp = stamp;
+            if (!entry.tracked) Add(entry, brushes[i]); // A repeated ID counts once
+        }
+        valid = true;
+    }
+
+    // Walks the whole array after brushes were added, removed or reordered
+    void Reconcile(const std::vector<Brush>& brushes) {
+        stamp++;
+        for (size_t i = 0; i < brushes.size(); i++) {
+            uint32_t id = brushes[i].id;
+            Entry& entry = byID[id];
+            entry.position = static_cast<uint32_t>(i);
+            entry.stamp = stamp;
+            if (entry.tracked && !entry.dirty) continue;
+            if (entry.tracked) Remove(entry);
+            Add(entry, brushes[i]);
+            entry.dirty = false;
+        }
+        // Erased after the walk: erasing shifts entries the walk has not reached
+        std::vector<uint32_t> gone;
+        byID.ForEach([&](uint32_t id, Entry& entry) {
+            entry.dirty = false;
+            if (entry.stamp == stamp) return;
+            gone.push_back(id); // Also marks on brushes deleted since
+            if (entry.tracked) Remove(entry);
+        });
+        for (uint32_t id : gone) byID.Erase(id);
+        dirty.clear();
+    }
+
+    void Add(Entry& entry, const Brush& brush) {
+        entry.vertices = static_cast<uint32_t>(brush.vertices.size());
+        entry.triangles = static_cast<uint32_t>(brush.indices.size() / 3);
+        entry.flags = brush.flags;
+        entry.hasBounds = !brush.vertices.empty();
+        entry.tracked = true;
+        Apply(entry, 1);
+        count++;
+
+        if (!entry.hasBounds) return;
+        const BrushBounds& bounds = brush.GetBounds();
+        const Vec3* corner[2] = {&bounds.min, &bounds.max};
+        for (int s = 0; s < SIDES; s++) {
+            const Vec3& v = *corner[s % 2];
+            float coordinate = s / 2 == 0 ? v.x : (s / 2 == 1 ? v.y : v.z);
+            float reach = s % 2 ? coordinate : -coordinate;
+            entry.reach[s] = reach;
+
+            Side& side = sides[s];
+            if (reach > side.value || (side.stale && reach == side.value)) {
+                side.value = reach;
+                side.count = 1;
+                side.stale = false;
+            } else if (reach == side.value) {
+                side.count++;
+            }
+        }
+    }
+
+    void Remove(Entry& entry) {
+        Apply(entry, -1);
+        entry.tracked = false;
+        count--;
+
+        if (!entry.hasBounds) return;
+        for (int s = 0; s < SIDES; s++) {
+            Side& side = sides[s];
+            if (!side.stale && entry.reach[s] == side.value && --side.count == 0) side.stale = true;
+        }
+    }
+
+    // Adds (sign 1) or takes back (sign -1) one brush's counts; the size_t
+    // arithmetic wraps back to the right total either way
+    void Apply(const Entry& entry, int sign) {
+        size_t s = static_cast<size_t>(sign);
+        totals.totalVertices += s * entry.vertices;
+        totals.totalTriangles += s * entry.triangles;
+        for (int bit = 0; bit < 32; bit++) {
+            if (entry.flags >> bit & 1) totals.brushesWithFlag[bit] += s;
+        }
+    }
+
+    // Sides whose last brush was taken back are found again in the pick tree
+    void UpdateBounds(const Map& map, PickTree& pickTree) {
+        for (int s = 0; s < SIDES; s++) {
+            Side& side = sides[s];
+            if (!side.stale) continue;
+            float coordinate;
+            if (pickTree.BrushExtreme(map, s / 2, s % 2 == 1, coordinate, side.count)) {
+                side.value = s % 2 ? coordinate : -coordinate;
+            } else {
+                side.value = -FLT_MAX;
+            }
+            side.stale = false;
+        }
+
+        totals.hasBounds = sides[0].count > 0;
+        if (!totals.hasBounds) return;
+        totals.mapBoundsMin = Vec3(-sides[0].value, -sides[2].value, -sides[4].value);
+        totals.mapBoundsMax = Vec3(sides[1].value, sides[3].value, sides[5].value);
+    }
+
+    Totals totals;
+    Side sides[SIDES];
+    IDTable<Entry> byID;
+    std::vector<uint32_t> dirty;
+    size_t count = 0; // Tracked brushes
+    uint32_t stamp = 0;
+    bool valid = false;
+    bool texturesDirty = true;
+};
+
+} // namespace PCD
+
+#endif // PCD_MAP_STATS_H
@@ -0,0 +1,258 @@
+#ifndef PCD_MAPPED_FILE_H
+#define PCD_MAPPED_FILE_H
+
+#include "PCDFormat.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace PCD {
+
+// Minimal read-only view over contiguous elements (std::span is C++20)
+template <typename T>
+struct Span {
+    const T* ptr = nullptr;
+    size_t count = 0;
+
+    Span() = default;
+    Span(const T* p, size_t n) : ptr(p), count(n) {}
+
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+    Span subspan(size_t offset, size_t n) const { return Span(ptr + offset, n); }
+};
+
+// Read-only file mapping. Falls back to reading the file into memory where
+// mmap is not available.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& filename) {
+        Close();
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return false;
+        }
+
+        void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) return false;
+
+        bytes = static_cast<const uint8_t*>(addr);
+        length = static_cast<size_t>(st.st_size);
+        mapped = true;
+        return true;
+#else
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return false;
+        fallback.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(fallback.data()), fallback.size());
+        bytes = fallback.data();
+        length = fallback.size();
+        return true;
+#endif
+    }
+
+    void Close() {
+#ifndef _WIN32
+        if (mapped && bytes) {
+            munmap(const_cast<uint8_t*>(bytes), length);
+        }
+#endif
+        fallback.clear();
+        bytes = nullptr;
+        length = 0;
+        mapped = false;
+    }
+
+    bool IsOpen() const { return bytes != nullptr; }
+    const uint8_t* Data() const { return bytes; }
+    size_t Size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<uint8_t> fallback;
+};
+
+// Zero-copy accessor for a PCD3 image. Every span points straight into the
+// underlying bytes, so the view is only valid while they stay alive.
+class MapView {
+public:
+    bool Open(const uint8_t* data, size_t size) {
+        using namespace Format;
+        base = nullptr;
+        length = 0;
+
+        if (size < sizeof(FileHeader)) {
+            std::cerr << "[PCD] File too small for PCD3 header\n";
+            return false;
+        }
+
+        const FileHeader* hdr = reinterpret_cast<const FileHeader*>(data);
+        if (memcmp(hdr->magic, MAGIC_V3, 4) != 0 || hdr->version != VERSION_V3) {
+            std::cerr << "[PCD] Not a PCD3 file\n";
+            return false;
+        }
+        if (hdr->fileSize > size ||
+            sizeof(FileHeader) + uint64_t(hdr->sectionCount) * sizeof(SectionEntry) > size) {
+            std::cerr << "[PCD] Truncated PCD3 file\n";
+            return false;
+        }
+
+        const SectionEntry* table = reinterpret_cast<const SectionEntry*>(data + sizeof(FileHeader));
+        for (uint32_t i = 0; i < hdr->sectionCount; i++) {
+            if (table[i].offset > size || table[i].size > size - table[i].offset ||
+                table[i].offset % SECTION_ALIGNMENT != 0) {
+                std::cerr << "[PCD] Corrupt section table entry " << i << "\n";
+                return false;
+            }
+        }
+
+        base = data;
+        length = size;
+        header = hdr;
+        sections = table;
+
+        if (Brushes().size() != header->brushCount ||
+            Entities().size() != header->entityCount ||
+            Textures().size() != header->textureCount) {
+            std::cerr << "[PCD] Section sizes do not match header counts\n";
+            base = nullptr;
+            return false;
+        }
+        return ValidateRanges();
+    }
+
+    bool IsOpen() const { return base != nullptr; }
+    const Format::FileHeader& Header() const { return *header; }
+    bool HasPackedGeometry() const { return (header->flags & Format::FILE_FLAG_PACKED_GEOMETRY) != 0; }
+
+    Span<uint8_t> Section(Format::SectionType type) const {
+        for (uint32_t i = 0; i < header->sectionCount; i++) {
+            if (sections[i].type == type) {
+                return Span<uint8_t>(base + sections[i].offset, static_cast<size_t>(sections[i].size));
+            }
+        }
+        return {};
+    }
+
+    const Format::SectionEntry* FindSection(Format::SectionType type) const {
+        for (uint32_t i = 0; i < header->sectionCount; i++) {
+            if (sections[i].type == type) return &sections[i];
+        }
+        return nullptr;
+    }
+
+    Format::MetaRecord Meta() const {
+        Format::MetaRecord meta{};
+        Span<uint8_t> s = Section(Format::SECTION_META);
+        if (s.size() >= sizeof(meta)) memcpy(&meta, s.data(), sizeof(meta));
+        return meta;
+    }
+
+    Span<Format::TextureRecord> Textures() const { return Records<Format::TextureRecord>(Format::SECTION_TEXTURES); }
+    Span<Format::TextureFormatRecord> TextureFormats() const { return Records<Format::TextureFormatRecord>(Format::SECTION_TEXTURE_FORMATS); }
+    Span<Format::BrushRecord> Brushes() const { return Records<Format::BrushRecord>(Format::SECTION_BRUSHES); }
+    Span<Format::EntityRecord> Entities() const { return Records<Format::EntityRecord>(Format::SECTION_ENTITIES); }
+    Span<Format::PropertyRecord> Properties() const { return Records<Format::PropertyRecord>(Format::SECTION_PROPERTIES); }
+
+    Span<float> Positions() const { return Records<float>(Format::SECTION_POSITIONS); }
+    Span<float> Normals() const { return Records<float>(Format::SECTION_NORMALS); }
+    Span<float> UVs() const { return Records<float>(Format::SECTION_UVS); }
+    Span<uint32_t> Indices() const { return Records<uint32_t>(Format::SECTION_INDICES); }
+
+    // Per-brush slices of the shared streams (empty when HasPackedGeometry)
+    Span<float> BrushPositions(const Format::BrushRecord& b) const { return Positions().subspan(size_t(b.firstVertex) * 3, size_t(b.vertexCount) * 3); }
+    Span<float> BrushNormals(const Format::BrushRecord& b) const { return Normals().subspan(size_t(b.firstVertex) * 3, size_t(b.vertexCount) * 3); }
+    Span<float> BrushUVs(const Format::BrushRecord& b) const { return UVs().subspan(size_t(b.firstVertex) * 2, size_t(b.vertexCount) * 2); }
+    Span<uint32_t> BrushIndices(const Format::BrushRecord& b) const { return Indices().subspan(b.firstIndex, b.indexCount); }
+
+    Span<uint8_t> TexturePixels(const Format::TextureRecord& t) const {
+        return Section(Format::SECTION_TEXTURE_DATA).subspan(static_cast<size_t>(t.dataOffset), static_cast<size_t>(t.dataSize));
+    }
+
+    std::string String(const Format::StringRef& ref) const { return std::string(StringView(ref)); }
+
+    // Points into the mapped strings section; empty when out of range
+    std::string_view StringView(const Format::StringRef& ref) const {
+        Span<uint8_t> s = Section(Format::SECTION_STRINGS);
+        if (uint64_t(ref.offset) + ref.length > s.size()) return std::string_view();
+        return std::string_view(reinterpret_cast<const char*>(s.data() + ref.offset), ref.length);
+    }
+
+private:
+    template <typename T>
+    Span<T> Records(Format::SectionType type) const {
+        Span<uint8_t> s = Section(type);
+        return Span<T>(reinterpret_cast<const T*>(s.data()), s.size() / sizeof(T));
+    }
+
+    // Bounds-check every reference once so accessors can stay unchecked
+    // (packed geometry is checked by GeometryCodec::Unpack instead)
+    bool ValidateRanges() const {
+        size_t vertexTotal = Positions().size() / 3;
+        if (Normals().size() / 3 != vertexTotal || UVs().size() / 2 != vertexTotal) {
+            std::cerr << "[PCD] Vertex stream sizes disagree\n";
+            return false;
+        }
+        size_t indexTotal = Indices().size();
+        for (const auto& b : HasPackedGeometry() ? Span<Format::BrushRecord>() : Brushes()) {
+            if (uint64_t(b.firstVertex) + b.vertexCount > vertexTotal ||
+                uint64_t(b.firstIndex) + b.indexCount > indexTotal) {
+                std::cerr << "[PCD] Brush " << b.id << " references data out of range\n";
+                return false;
+            }
+        }
+        size_t texDataSize = Section(Format::SECTION_TEXTURE_DATA).size();
+        for (const auto& t : Textures()) {
+            if (t.dataOffset > texDataSize || t.dataSize > texDataSize - t.dataOffset) {
+                std::cerr << "[PCD] Texture " << t.id << " data out of range\n";
+                return false;
+            }
+        }
+        size_t propTotal = Properties().size();
+        for (const auto& e : Entities()) {
+            if (uint64_t(e.firstProperty) + e.propertyCount > propTotal) {
+                std::cerr << "[PCD] Entity " << e.id << " properties out of range\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    const Format::FileHeader* header = nullptr;
+    const Format::SectionEntry* sections = nullptr;
+};
+
+} // namespace PCD
+
+#endif // PCD_MAPPED_FILE_H
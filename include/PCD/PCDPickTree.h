@@ -0,0 +1,652 @@
+#ifndef PCD_PICK_TREE_H
+#define PCD_PICK_TREE_H
+
+// Bounding volume hierarchy for editor picking.
+//
+// Every brush and entity is a leaf holding a slightly enlarged ("fat") copy
+// of its bounds, so small edits that stay inside it need no tree update.
+// A ray query walks the tree nearer child first, skips every node that
+// starts behind the closest hit so far, and tests the triangles of the
+// brushes it reaches, so the result is the front-most surface rather than
+// the first brush whose footprint contains the click. The same tree answers
+// frustum queries for marquee selection and finds the map bounds for the
+// statistics panel.
+//
+// The tree follows the map lazily. Edits mark the objects they changed
+// (Mark*), additions and removals are noticed by comparing counts, and the
+// next query refits or reinserts only what changed. Invalidate() drops the
+// tree for a bulk rebuild, e.g. after loading a map.
+
+#include "PCDTypes.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+namespace PCD {
+
+class PickTree {
+public:
+    enum class Kind : uint8_t { NONE, BRUSH, ENTITY };
+
+    struct Hit {
+        Kind kind = Kind::NONE;
+        int index = -1;           // Into map.brushes or map.entities
+        float distance = FLT_MAX; // Along the ray, in units of its direction
+        Vec3 point;
+    };
+
+    // The box Renderer::RenderEntities draws at an entity's origin
+    static constexpr float ENTITY_HALF_WIDTH = 0.5f;
+    static constexpr float ENTITY_HEIGHT = 1.0f;
+    static constexpr float MARGIN = 0.25f; // Slack around each leaf box
+
+    void Invalidate() { valid = false; }
+
+    // Call after changing the object with this ID in place. Added and
+    // deleted objects are found without it.
+    void MarkBrush(uint32_t id) { Mark(brushes, id); }
+    void MarkEntity(uint32_t id) { Mark(entities, id); }
+
+    Hit Raycast(const Map& map, const Vec3& origin, const Vec3& direction, float maxDistance = FLT_MAX) {
+        Sync(map);
+        Hit best;
+        best.distance = maxDistance;
+        if (root == NO_NODE) return best;
+
+        Vec3 inv(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        float entry;
+        stack.clear();
+        if (RayBox(origin, inv, nodes[root].min, nodes[root].max, best.distance, entry)) stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+
+            if (node.IsLeaf()) {
+                TestLeaf(map, node, origin, direction, inv, best);
+                continue;
+            }
+
+            // Children are re-tested against the current best, so a subtree
+            // pushed earlier is dropped once a nearer hit is known. The nearer
+            // child goes on top of the stack to tighten best.distance first.
+            const Node& a = nodes[node.child[0]];
+            const Node& b = nodes[node.child[1]];
+            float entryA, entryB;
+            bool hitA = RayBox(origin, inv, a.min, a.max, best.distance, entryA);
+            bool hitB = RayBox(origin, inv, b.min, b.max, best.distance, entryB);
+            if (hitA && hitB) {
+                bool aFirst = entryA <= entryB;
+                stack.push_back(aFirst ? node.child[1] : node.child[0]);
+                stack.push_back(aFirst ? node.child[0] : node.child[1]);
+            } else if (hitA) {
+                stack.push_back(node.child[0]);
+            } else if (hitB) {
+                stack.push_back(node.child[1]);
+            }
+        }
+
+        if (best.kind != Kind::NONE) best.point = origin + direction * best.distance;
+        return best;
+    }
+
+    // Indices of every brush and entity whose box is inside or crosses the
+    // frustum, in ascending order. A subtree entirely inside is taken
+    // without testing its leaves, so large selections stay cheap.
+    void QueryFrustum(const Map& map, const Frustum& frustum, std::vector<int>& brushHits,
+                      std::vector<int>& entityHits) {
+        Sync(map);
+        brushHits.clear();
+        entityHits.clear();
+        if (root == NO_NODE) return;
+
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+            bool inside = index & INSIDE_BIT;
+            const Node& node = nodes[index & ~INSIDE_BIT];
+
+            if (!inside) {
+                Frustum::Result result = frustum.Classify(node.min, node.max);
+                if (result == Frustum::OUTSIDE) continue;
+                // Leaf boxes are enlarged, so test the object itself
+                if (node.IsLeaf() && result == Frustum::INTERSECTS) {
+                    Vec3 min, max;
+                    uint32_t position = PositionOf(node);
+                    bool hasBounds = node.kind == Kind::BRUSH ? BoundsOf(map.brushes[position], min, max)
+                                                              : BoundsOf(map.entities[position], min, max);
+                    if (!hasBounds || frustum.Classify(min, max) == Frustum::OUTSIDE) continue;
+                }
+                inside = result == Frustum::INSIDE;
+            }
+
+            if (node.IsLeaf()) {
+                (node.kind == Kind::BRUSH ? brushHits : entityHits).push_back(static_cast<int>(PositionOf(node)));
+            } else {
+                uint32_t flag = inside ? INSIDE_BIT : 0;
+                stack.push_back(node.child[0] | flag);
+                stack.push_back(node.child[1] | flag);
+            }
+        }
+
+        std::sort(brushHits.begin(), brushHits.end());
+        std::sort(entityHits.begin(), entityHits.end());
+    }
+
+    // The largest (upper) or smallest coordinate along axis (0-2) of any
+    // brush with vertices, and how many brushes reach it; false if there
+    // are none. The walk skips every subtree whose box stops short of the
+    // best value found so far. Lower extremes are searched as the largest
+    // negated coordinate, so both directions share that test.
+    bool BrushExtreme(const Map& map, int axis, bool upper, float& value, size_t& count) {
+        Sync(map);
+        float sign = upper ? 1.0f : -1.0f;
+        float best = -FLT_MAX;
+        count = 0;
+        stack.clear();
+        if (root != NO_NODE) stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            // Boxes only ever enclose their contents, so this is a bound
+            if (count > 0 && sign * Axis(upper ? node.max : node.min, axis) < best) continue;
+
+            if (node.IsLeaf()) {
+                if (node.kind != Kind::BRUSH) continue;
+                const BrushBounds& bounds = map.brushes[PositionOf(node)].GetBounds();
+                float reach = sign * Axis(upper ? bounds.max : bounds.min, axis);
+                if (count == 0 || reach > best) {
+                    best = reach;
+                    count = 1;
+                } else if (reach == best) {
+                    count++;
+                }
+                continue;
+            }
+
+            // The more promising child goes on top so it raises best first
+            const Node& a = nodes[node.child[0]];
+            const Node& b = nodes[node.child[1]];
+            bool aFirst = sign * Axis(upper ? a.max : a.min, axis) >= sign * Axis(upper ? b.max : b.min, axis);
+            stack.push_back(aFirst ? node.child[1] : node.child[0]);
+            stack.push_back(aFirst ? node.child[0] : node.child[1]);
+        }
+        value = sign * best;
+        return count > 0;
+    }
+
+    size_t LeafCount() const { return leafCount; }
+    int Height() const { return root == NO_NODE ? 0 : nodes[root].height; }
+
+private:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr uint32_t NO_POSITION = UINT32_MAX;
+    static constexpr uint32_t INSIDE_BIT = 1u << 31; // On stack entries: subtree known to be inside
+
+    struct Node {
+        Vec3 min, max;
+        uint32_t parent = NO_NODE;
+        uint32_t child[2] = {NO_NODE, NO_NODE};
+        Kind kind = Kind::NONE; // Leaves only
+        uint32_t id = 0;        // Leaves only: brush or entity ID
+        int height = 0;         // 0 for leaves
+
+        bool IsLeaf() const { return child[0] == NO_NODE; }
+    };
+
+    // Per brush or entity ID
+    struct Entry {
+        uint32_t leaf = NO_NODE;         // None for brushes without vertices
+        uint32_t position = NO_POSITION; // Index in the map array when last synced
+        uint32_t stamp = 0;
+        bool tracked = false;
+        bool dirty = false;
+    };
+
+    struct Objects {
+        IDTable<Entry> byID;
+        std::vector<uint32_t> dirty;
+        size_t count = 0; // Tracked objects, with or without a leaf
+    };
+
+    static void Mark(Objects& objects, uint32_t id) {
+        Entry& entry = objects.byID[id];
+        if (entry.dirty) return;
+        entry.dirty = true;
+        objects.dirty.push_back(id);
+    }
+
+    uint32_t PositionOf(const Node& leaf) const {
+        return (leaf.kind == Kind::BRUSH ? brushes : entities).byID.Find(leaf.id)->position;
+    }
+
+    static bool BoundsOf(const Brush& brush, Vec3& min, Vec3& max) {
+        if (brush.vertices.empty()) return false;
+        const BrushBounds& bounds = brush.GetBounds();
+        min = bounds.min;
+        max = bounds.max;
+        return true;
+    }
+
+    static bool BoundsOf(const Entity& ent, Vec3& min, Vec3& max) {
+        min = Vec3(ent.position.x - ENTITY_HALF_WIDTH, ent.position.y, ent.position.z - ENTITY_HALF_WIDTH);
+        max = Vec3(ent.position.x + ENTITY_HALF_WIDTH, ent.position.y + ENTITY_HEIGHT, ent.position.z + ENTITY_HALF_WIDTH);
+        return true;
+    }
+
+    // Sync
+
+    void Sync(const Map& map) {
+        if (!valid) {
+            Build(map);
+            return;
+        }
+
+        bool structural = brushes.count != map.brushes.size() || entities.count != map.entities.size() ||
+                          !DirtyInPlace(brushes, map.brushes) || !DirtyInPlace(entities, map.entities);
+        if (structural) {
+            Reconcile(map.brushes, brushes, Kind::BRUSH);
+            Reconcile(map.entities, entities, Kind::ENTITY);
+        } else {
+            RefitDirty(map.brushes, brushes, Kind::BRUSH);
+            RefitDirty(map.entities, entities, Kind::ENTITY);
+        }
+    }
+
+    // True when every marked object is still where it was last seen
+    template <typename T>
+    static bool DirtyInPlace(const Objects& objects, const std::vector<T>& items) {
+        for (uint32_t id : objects.dirty) {
+            uint32_t position = objects.byID.Find(id)->position;
+            if (position >= items.size() || items[position].id != id) return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    void RefitDirty(const std::vector<T>& items, Objects& objects, Kind kind) {
+        for (uint32_t id : objects.dirty) {
+            Entry& entry = objects.byID[id];
+            entry.dirty = false;
+            Refit(items[entry.position], id, objects, kind);
+        }
+        objects.dirty.clear();
+    }
+
+    // Walks the whole array after objects were added, removed or reordered
+    template <typename T>
+    void Reconcile(const std::vector<T>& items, Objects& objects, Kind kind) {
+        stamp++;
+        for (size_t i = 0; i < items.size(); i++) {
+            uint32_t id = items[i].id;
+            Entry& entry = objects.byID[id];
+            entry.position = static_cast<uint32_t>(i);
+            entry.stamp = stamp;
+            if (!entry.tracked || entry.dirty) Refit(items[i], id, objects, kind);
+            entry.dirty = false;
+        }
+        // Erased after the walk: erasing shifts entries the walk has not reached
+        std::vector<uint32_t> gone;
+        objects.byID.ForEach([&](uint32_t id, Entry& entry) {
+            if (entry.stamp == stamp) return;
+            gone.push_back(id);
+            if (!entry.tracked) return;
+            if (entry.leaf != NO_NODE) DropLeaf(entry.leaf);
+            objects.count--;
+        });
+        for (uint32_t id : gone) objects.byID.Erase(id);
+        objects.dirty.clear();
+    }
+
+    // Brings one object's leaf up to date, adding or dropping it as needed
+    template <typename T>
+    void Refit(const T& item, uint32_t id, Objects& objects, Kind kind) {
+        Entry& entry = objects.byID[id];
+        if (!entry.tracked) {
+            entry.tracked = true;
+            objects.count++;
+        }
+
+        Vec3 min, max;
+        uint32_t leaf = entry.leaf;
+        if (!BoundsOf(item, min, max)) {
+            if (leaf != NO_NODE) DropLeaf(leaf);
+            entry.leaf = NO_NODE;
+            return;
+        }
+
+        if (leaf != NO_NODE) {
+            if (Fits(nodes[leaf], min, max)) return;
+            RemoveLeaf(leaf);
+        } else {
+            leaf = AllocateNode();
+            nodes[leaf].kind = kind;
+            nodes[leaf].id = id;
+            entry.leaf = leaf;
+            leafCount++;
+        }
+        SetFatBox(nodes[leaf], min, max);
+        InsertLeaf(leaf);
+    }
+
+    // The leaf still encloses the object and is not much larger than it,
+    // so the edit needs no tree update
+    static bool Fits(const Node& leaf, const Vec3& min, const Vec3& max) {
+        const float slack = MARGIN * 4;
+        return leaf.min.x <= min.x && leaf.min.y <= min.y && leaf.min.z <= min.z &&
+               leaf.max.x >= max.x && leaf.max.y >= max.y && leaf.max.z >= max.z &&
+               min.x - leaf.min.x <= slack && min.y - leaf.min.y <= slack && min.z - leaf.min.z <= slack &&
+               leaf.max.x - max.x <= slack && leaf.max.y - max.y <= slack && leaf.max.z - max.z <= slack;
+    }
+
+    static void SetFatBox(Node& leaf, const Vec3& min, const Vec3& max) {
+        leaf.min = Vec3(min.x - MARGIN, min.y - MARGIN, min.z - MARGIN);
+        leaf.max = Vec3(max.x + MARGIN, max.y + MARGIN, max.z + MARGIN);
+    }
+
+    // Bulk build
+
+    void Build(const Map& map) {
+        nodes.clear();
+        freeNodes.clear();
+        root = NO_NODE;
+        leafCount = 0;
+        brushes = Objects();
+        entities = Objects();
+
+        std::vector<uint32_t> leaves;
+        leaves.reserve(map.brushes.size() + map.entities.size());
+        AddLeaves(map.brushes, brushes, Kind::BRUSH, leaves);
+        AddLeaves(map.entities, entities, Kind::ENTITY, leaves);
+        leafCount = leaves.size();
+        nodes.reserve(leaves.size() * 2);
+        if (!leaves.empty()) {
+            root = BuildRange(leaves.data(), leaves.size());
+            nodes[root].parent = NO_NODE;
+        }
+        valid = true;
+    }
+
+    template <typename T>
+    void AddLeaves(const std::vector<T>& items, Objects& objects, Kind kind, std::vector<uint32_t>& leaves) {
+        objects.byID.Reserve(items.size());
+        objects.count = items.size();
+        for (size_t i = 0; i < items.size(); i++) {
+            Entry& entry = objects.byID[items[i].id];
+            entry.tracked = true;
+            entry.position = static_cast<uint32_t>(i);
+
+            Vec3 min, max;
+            if (!BoundsOf(items[i], min, max)) continue;
+            uint32_t leaf = AllocateNode();
+            nodes[leaf].kind = kind;
+            nodes[leaf].id = items[i].id;
+            SetFatBox(nodes[leaf], min, max);
+            entry.leaf = leaf;
+            leaves.push_back(leaf);
+        }
+    }
+
+    // Top-down median split on the longest axis of the leaf centers
+    uint32_t BuildRange(uint32_t* leaves, size_t count) {
+        if (count == 1) return leaves[0];
+
+        Vec3 lo = Center(nodes[leaves[0]]), hi = lo;
+        for (size_t i = 1; i < count; i++) {
+            Vec3 c = Center(nodes[leaves[i]]);
+            lo = Vec3(std::min(lo.x, c.x), std::min(lo.y, c.y), std::min(lo.z, c.z));
+            hi = Vec3(std::max(hi.x, c.x), std::max(hi.y, c.y), std::max(hi.z, c.z));
+        }
+        Vec3 extent = hi - lo;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        size_t half = count / 2;
+        std::nth_element(leaves, leaves + half, leaves + count, [&](uint32_t a, uint32_t b) {
+            return Axis(Center(nodes[a]), axis) < Axis(Center(nodes[b]), axis);
+        });
+        uint32_t left = BuildRange(leaves, half);
+        uint32_t right = BuildRange(leaves + half, count - half);
+
+        uint32_t parent = AllocateNode();
+        Link(parent, left, right);
+        return parent;
+    }
+
+    // Incremental updates
+
+    // Adds a leaf next to the sibling that grows the total box area least
+    void InsertLeaf(uint32_t leaf) {
+        if (root == NO_NODE) {
+            root = leaf;
+            nodes[leaf].parent = NO_NODE;
+            return;
+        }
+
+        uint32_t index = root;
+        while (!nodes[index].IsLeaf()) {
+            const Node& node = nodes[index];
+            float area = Area(node.min, node.max);
+            float combined = UnionArea(node, nodes[leaf]);
+            float cost = 2 * combined;           // New parent for this node and the leaf
+            float inherited = 2 * (combined - area); // Growth pushed onto the ancestors
+
+            float childCost[2];
+            for (int k = 0; k < 2; k++) {
+                const Node& child = nodes[node.child[k]];
+                float grown = UnionArea(child, nodes[leaf]);
+                childCost[k] = (child.IsLeaf() ? grown : grown - Area(child.min, child.max)) + inherited;
+            }
+            if (cost < childCost[0] && cost < childCost[1]) break;
+            index = childCost[0] < childCost[1] ? node.child[0] : node.child[1];
+        }
+
+        uint32_t sibling = index;
+        uint32_t oldParent = nodes[sibling].parent;
+        uint32_t newParent = AllocateNode();
+        Link(newParent, sibling, leaf);
+        nodes[newParent].parent = oldParent;
+        if (oldParent == NO_NODE) {
+            root = newParent;
+        } else {
+            Replace(oldParent, sibling, newParent);
+        }
+        FixUpwards(oldParent);
+    }
+
+    void RemoveLeaf(uint32_t leaf) {
+        if (leaf == root) {
+            root = NO_NODE;
+            return;
+        }
+
+        uint32_t parent = nodes[leaf].parent;
+        uint32_t grandParent = nodes[parent].parent;
+        uint32_t sibling = nodes[parent].child[0] == leaf ? nodes[parent].child[1] : nodes[parent].child[0];
+        nodes[sibling].parent = grandParent;
+        if (grandParent == NO_NODE) {
+            root = sibling;
+        } else {
+            Replace(grandParent, parent, sibling);
+        }
+        FreeNode(parent);
+        FixUpwards(grandParent);
+    }
+
+    void DropLeaf(uint32_t leaf) {
+        RemoveLeaf(leaf);
+        FreeNode(leaf);
+        leafCount--;
+    }
+
+    void FixUpwards(uint32_t index) {
+        while (index != NO_NODE) {
+            index = Balance(index);
+            Node& node = nodes[index];
+            Link(index, node.child[0], node.child[1]);
+            index = node.parent;
+        }
+    }
+
+    // Rotates the taller child up when the two subtrees differ in height
+    // by more than one, returning the node now at index's place
+    uint32_t Balance(uint32_t index) {
+        const Node& node = nodes[index];
+        if (node.IsLeaf() || node.height < 2) return index;
+        int balance = nodes[node.child[1]].height - nodes[node.child[0]].height;
+        if (balance > 1) return Rotate(index, 1);
+        if (balance < -1) return Rotate(index, 0);
+        return index;
+    }
+
+    uint32_t Rotate(uint32_t index, int slot) {
+        uint32_t up = nodes[index].child[slot];
+        uint32_t other = nodes[index].child[1 - slot];
+        uint32_t parent = nodes[index].parent;
+
+        // The up node takes index's place and index becomes its child
+        nodes[up].parent = parent;
+        if (parent == NO_NODE) {
+            root = up;
+        } else {
+            Replace(parent, index, up);
+        }
+
+        // The up node keeps its taller child and hands the other down
+        uint32_t keep = nodes[up].child[0], give = nodes[up].child[1];
+        if (nodes[keep].height < nodes[give].height) std::swap(keep, give);
+        if (slot == 1) {
+            Link(index, other, give);
+        } else {
+            Link(index, give, other);
+        }
+        Link(up, index, keep);
+        return up;
+    }
+
+    // Makes a and b the children of parent and recomputes its box and height
+    void Link(uint32_t parent, uint32_t a, uint32_t b) {
+        Node& node = nodes[parent];
+        node.child[0] = a;
+        node.child[1] = b;
+        nodes[a].parent = parent;
+        nodes[b].parent = parent;
+        node.min = Vec3(std::min(nodes[a].min.x, nodes[b].min.x), std::min(nodes[a].min.y, nodes[b].min.y),
+                        std::min(nodes[a].min.z, nodes[b].min.z));
+        node.max = Vec3(std::max(nodes[a].max.x, nodes[b].max.x), std::max(nodes[a].max.y, nodes[b].max.y),
+                        std::max(nodes[a].max.z, nodes[b].max.z));
+        node.height = 1 + std::max(nodes[a].height, nodes[b].height);
+    }
+
+    void Replace(uint32_t parent, uint32_t oldChild, uint32_t newChild) {
+        Node& node = nodes[parent];
+        node.child[node.child[0] == oldChild ? 0 : 1] = newChild;
+    }
+
+    uint32_t AllocateNode() {
+        if (!freeNodes.empty()) {
+            uint32_t index = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[index] = Node();
+            return index;
+        }
+        nodes.emplace_back();
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    void FreeNode(uint32_t index) { freeNodes.push_back(index); }
+
+    // Queries
+
+    void TestLeaf(const Map& map, const Node& leaf, const Vec3& origin, const Vec3& direction, const Vec3& inv,
+                  Hit& best) const {
+        if (leaf.kind == Kind::ENTITY) {
+            uint32_t position = PositionOf(leaf);
+            Vec3 min, max;
+            BoundsOf(map.entities[position], min, max);
+            float entry;
+            if (RayBox(origin, inv, min, max, best.distance, entry) && entry < best.distance) {
+                best = {Kind::ENTITY, static_cast<int>(position), entry, Vec3()};
+            }
+            return;
+        }
+
+        uint32_t position = PositionOf(leaf);
+        const Brush& brush = map.brushes[position];
+        for (size_t i = 0; i + 2 < brush.indices.size(); i += 3) {
+            uint32_t a = brush.indices[i], b = brush.indices[i + 1], c = brush.indices[i + 2];
+            if (a >= brush.vertices.size() || b >= brush.vertices.size() || c >= brush.vertices.size()) continue;
+            float t;
+            if (RayTriangle(origin, direction, brush.vertices[a].position, brush.vertices[b].position,
+                            brush.vertices[c].position, t) && t < best.distance) {
+                best = {Kind::BRUSH, static_cast<int>(position), t, Vec3()};
+            }
+        }
+    }
+
+    // Slab test; entry is where the ray enters the box (0 if it starts inside)
+    static bool RayBox(const Vec3& origin, const Vec3& inv, const Vec3& min, const Vec3& max, float maxT,
+                       float& entry) {
+        float t1 = (min.x - origin.x) * inv.x, t2 = (max.x - origin.x) * inv.x;
+        float tNear = std::min(t1, t2), tFar = std::max(t1, t2);
+        t1 = (min.y - origin.y) * inv.y;
+        t2 = (max.y - origin.y) * inv.y;
+        tNear = std::max(tNear, std::min(t1, t2));
+        tFar = std::min(tFar, std::max(t1, t2));
+        t1 = (min.z - origin.z) * inv.z;
+        t2 = (max.z - origin.z) * inv.z;
+        tNear = std::max(tNear, std::min(t1, t2));
+        tFar = std::min(tFar, std::max(t1, t2));
+        entry = std::max(tNear, 0.0f);
+        return tFar >= entry && entry <= maxT;
+    }
+
+    // Moller-Trumbore, both faces
+    static bool RayTriangle(const Vec3& origin, const Vec3& direction, const Vec3& a, const Vec3& b, const Vec3& c,
+                            float& t) {
+        Vec3 e1 = b - a, e2 = c - a;
+        Vec3 p = Cross(direction, e2);
+        float det = Dot(e1, p);
+        if (std::fabs(det) < 1e-12f) return false;
+        float invDet = 1.0f / det;
+        Vec3 s = origin - a;
+        float u = Dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) return false;
+        Vec3 q = Cross(s, e1);
+        float v = Dot(direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return false;
+        t = Dot(e2, q) * invDet;
+        return t >= 0.0f;
+    }
+
+    static Vec3 Cross(const Vec3& a, const Vec3& b) {
+        return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+    static float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    static float Axis(const Vec3& v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+    static Vec3 Center(const Node& node) { return (node.min + node.max) * 0.5f; }
+
+    static float Area(const Vec3& min, const Vec3& max) {
+        Vec3 d = max - min;
+        return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    static float UnionArea(const Node& a, const Node& b) {
+        return Area(Vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+                    Vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+    }
+
+    bool valid = false;
+    uint32_t stamp = 0;
+    uint32_t root = NO_NODE;
+    size_t leafCount = 0;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::vector<uint32_t> stack;
+    Objects brushes, entities;
+};
+
+} // namespace PCD
+
+#endif // PCD_PICK_TREE_H
@@ -0,0 +1,476 @@
+#ifndef PCD_SCHEMA_H
+#define PCD_SCHEMA_H
+
+// Compile-time field schemas.
+//
+// Each serialized type lists its members once, in a Schema<T>
+// specialization, and every format is generated from that list:
+//
+//   - the byte stream used by journal/delta records and network packets:
+//     fixed-size members as one memcpy block, then length-prefixed strings
+//     and arrays (arrays of trivially copyable elements in one memcpy)
+//   - the fixed PCD3 records (BrushRecord, EntityRecord, ...), for members
+//     that name a record member
+//   - content hashes
+//
+// Fixed-size members must come before variable-size ones, so encoding is a
+// single resize followed by unchecked copies and decoding checks bounds once
+// for the fixed block.
+
+#include "PCDTypes.h"
+#include "PCDFormat.h"
+#include "PCDHash.h"
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace PCD {
+
+// Bounds-checked cursor over an encoded byte stream
+struct ByteReader {
+    const uint8_t* ptr;
+    const uint8_t* end;
+    bool ok = true;
+
+    ByteReader(const uint8_t* data, size_t size) : ptr(data), end(data + size) {}
+
+    template <typename T>
+    T Get() {
+        T value{};
+        if (size_t(end - ptr) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return value;
+    }
+
+    const uint8_t* Bytes(size_t size) {
+        if (size_t(end - ptr) < size) {
+            ok = false;
+            return nullptr;
+        }
+        const uint8_t* p = ptr;
+        ptr += size;
+        return p;
+    }
+
+    std::string String() { return std::string(StringView()); }
+
+    // Length-prefixed text, pointing into the stream
+    std::string_view StringView() {
+        uint32_t size = Get<uint32_t>();
+        const uint8_t* p = Bytes(size);
+        return p ? std::string_view(reinterpret_cast<const char*>(p), size) : std::string_view();
+    }
+
+    // Element count that cannot claim more than the bytes left
+    uint32_t Count(size_t elementSize) {
+        uint32_t count = Get<uint32_t>();
+        if (size_t(end - ptr) / elementSize < count) {
+            ok = false;
+            return 0;
+        }
+        return count;
+    }
+};
+
+// How one member type is laid out in the byte stream
+template <typename T, typename = void>
+struct WireType {
+    static_assert(std::is_trivially_copyable<T>::value, "No wire encoding for this member type");
+    static constexpr bool FIXED = true;
+
+    static size_t Size(const T&) { return sizeof(T); }
+    static void Write(const T& value, uint8_t*& dst) {
+        memcpy(dst, &value, sizeof(T));
+        dst += sizeof(T);
+    }
+    static void ReadFixed(T& value, const uint8_t*& src) {
+        memcpy(static_cast<void*>(&value), src, sizeof(T));
+        src += sizeof(T);
+    }
+    static void Hash(const T& value, Hasher& hasher) { hasher.UpdateValue(value); }
+};
+
+template <>
+struct WireType<std::string> {
+    static constexpr bool FIXED = false;
+
+    static size_t Size(const std::string& str) { return sizeof(uint32_t) + str.size(); }
+    static void Write(const std::string& str, uint8_t*& dst) {
+        uint32_t size = static_cast<uint32_t>(str.size());
+        memcpy(dst, &size, sizeof(size));
+        if (size) memcpy(dst + sizeof(size), str.data(), size);
+        dst += sizeof(size) + size;
+    }
+    static void Read(std::string& str, ByteReader& in) { str.assign(in.StringView()); }
+    static void Hash(const std::string& str, Hasher& hasher) {
+        hasher.UpdateValue(static_cast<uint64_t>(str.size()));
+        hasher.Update(str.data(), str.size());
+    }
+};
+
+// Interned text is written as its characters and interned again on read
+template <>
+struct WireType<InternedString> {
+    static constexpr bool FIXED = false;
+
+    static size_t Size(const InternedString& str) { return WireType<std::string>::Size(str); }
+    static void Write(const InternedString& str, uint8_t*& dst) { WireType<std::string>::Write(str, dst); }
+    static void Read(InternedString& str, ByteReader& in) { str = in.StringView(); }
+    static void Hash(const InternedString& str, Hasher& hasher) { WireType<std::string>::Hash(str, hasher); }
+};
+
+// Property values travel as their text and are parsed again on read
+template <>
+struct WireType<PropertyValue> {
+    static constexpr bool FIXED = false;
+
+    static size_t Size(const PropertyValue& value) { return WireType<std::string>::Size(value.Text()); }
+    static void Write(const PropertyValue& value, uint8_t*& dst) { WireType<std::string>::Write(value.Text(), dst); }
+    static void Read(PropertyValue& value, ByteReader& in) { value = in.StringView(); }
+    static void Hash(const PropertyValue& value, Hasher& hasher) { WireType<std::string>::Hash(value.Text(), hasher); }
+};
+
+template <>
+struct WireType<Property> {
+    static constexpr bool FIXED = false;
+
+    static size_t Size(const Property& prop) {
+        return WireType<InternedString>::Size(prop.key) + WireType<PropertyValue>::Size(prop.value);
+    }
+    static void Write(const Property& prop, uint8_t*& dst) {
+        WireType<InternedString>::Write(prop.key, dst);
+        WireType<PropertyValue>::Write(prop.value, dst);
+    }
+    static void Read(Property& prop, ByteReader& in) {
+        WireType<InternedString>::Read(prop.key, in);
+        WireType<PropertyValue>::Read(prop.value, in);
+    }
+    static void Hash(const Property& prop, Hasher& hasher) {
+        WireType<InternedString>::Hash(prop.key, hasher);
+        WireType<PropertyValue>::Hash(prop.value, hasher);
+    }
+};
+
+template <typename A, typename B>
+struct WireType<std::pair<A, B>> {
+    static constexpr bool FIXED = false;
+
+    static size_t Size(const std::pair<A, B>& p) { return WireType<A>::Size(p.first) + WireType<B>::Size(p.second); }
+    static void Write(const std::pair<A, B>& p, uint8_t*& dst) {
+        WireType<A>::Write(p.first, dst);
+        WireType<B>::Write(p.second, dst);
+    }
+    static void Read(std::pair<A, B>& p, ByteReader& in) {
+        ReadOne<A>(p.first, in);
+        ReadOne<B>(p.second, in);
+    }
+    static void Hash(const std::pair<A, B>& p, Hasher& hasher) {
+        WireType<A>::Hash(p.first, hasher);
+        WireType<B>::Hash(p.second, hasher);
+    }
+
+private:
+    template <typename T>
+    static void ReadOne(T& value, ByteReader& in) {
+        if constexpr (WireType<T>::FIXED) {
+            value = in.Get<T>();
+        } else {
+            WireType<T>::Read(value, in);
+        }
+    }
+};
+
+// Count, then the elements: one memcpy when they are plain fixed-size values
+template <typename E>
+struct WireType<std::vector<E>> {
+    static constexpr bool FIXED = false;
+    // Trivially copyable is not enough: InternedString is a pointer
+    static constexpr bool BULK = std::is_trivially_copyable<E>::value && WireType<E>::FIXED;
+
+    static size_t Size(const std::vector<E>& v) {
+        if constexpr (BULK) {
+            return sizeof(uint32_t) + v.size() * sizeof(E);
+        } else {
+            size_t size = sizeof(uint32_t);
+            for (const auto& e : v) size += WireType<E>::Size(e);
+            return size;
+        }
+    }
+    static void Write(const std::vector<E>& v, uint8_t*& dst) {
+        uint32_t count = static_cast<uint32_t>(v.size());
+        memcpy(dst, &count, sizeof(count));
+        dst += sizeof(count);
+        if constexpr (BULK) {
+            if (count) memcpy(dst, v.data(), v.size() * sizeof(E));
+            dst += v.size() * sizeof(E);
+        } else {
+            for (const auto& e : v) WireType<E>::Write(e, dst);
+        }
+    }
+    static void Read(std::vector<E>& v, ByteReader& in) {
+        if constexpr (BULK) {
+            uint32_t count = in.Count(sizeof(E));
+            const uint8_t* src = in.Bytes(size_t(count) * sizeof(E));
+            v.resize(count);
+            if (count && src) memcpy(v.data(), src, size_t(count) * sizeof(E));
+        } else {
+            // Every element takes at least a length prefix. Elements are read
+            // in place so decoding into a reused object keeps their capacity.
+            uint32_t count = in.Count(sizeof(uint32_t));
+            v.resize(count);
+            for (uint32_t i = 0; i < count; i++) {
+                WireType<E>::Read(v[i], in);
+                if (!in.ok) {
+                    v.resize(i);
+                    break;
+                }
+            }
+        }
+    }
+    static void Hash(const std::vector<E>& v, Hasher& hasher) {
+        hasher.UpdateValue(static_cast<uint64_t>(v.size()));
+        if constexpr (BULK) {
+            hasher.Update(v.data(), v.size() * sizeof(E));
+        } else {
+            for (const auto& e : v) WireType<E>::Hash(e, hasher);
+        }
+    }
+};
+
+template <typename>
+struct MemberTraits;
+
+template <typename C, typename T>
+struct MemberTraits<T C::*> {
+    using Class = C;
+    using Type = T;
+};
+
+// One serialized member. RecordMember is where it lives in the type's fixed
+// PCD3 record, or nullptr when the file keeps it elsewhere (a stream section).
+template <auto Member, auto RecordMember = nullptr>
+struct Field {
+    using Type = typename MemberTraits<decltype(Member)>::Type;
+    static constexpr bool FIXED = WireType<Type>::FIXED;
+    static constexpr size_t FIXED_SIZE = FIXED ? sizeof(Type) : 0;
+    static constexpr bool IN_RECORD = !std::is_same<decltype(RecordMember), std::nullptr_t>::value;
+
+    template <typename Obj>
+    static size_t VariableSize(const Obj& obj) {
+        if constexpr (FIXED) {
+            return 0;
+        } else {
+            return WireType<Type>::Size(obj.*Member);
+        }
+    }
+
+    template <typename Obj>
+    static void Write(const Obj& obj, uint8_t*& dst) { WireType<Type>::Write(obj.*Member, dst); }
+
+    template <typename Obj>
+    static void ReadFixed(Obj& obj, const uint8_t*& src) {
+        if constexpr (FIXED) WireType<Type>::ReadFixed(obj.*Member, src);
+    }
+
+    template <typename Obj>
+    static void ReadVariable(Obj& obj, ByteReader& in) {
+        if constexpr (!FIXED) WireType<Type>::Read(obj.*Member, in);
+    }
+
+    template <typename Obj>
+    static void Hash(const Obj& obj, Hasher& hasher) { WireType<Type>::Hash(obj.*Member, hasher); }
+
+    template <typename Obj, typename Record, typename Strings>
+    static void ToRecord(const Obj& obj, Record& rec, Strings& strings) {
+        if constexpr (IN_RECORD) Store(obj.*Member, rec.*RecordMember, strings);
+    }
+
+    template <typename Obj, typename Record, typename Strings>
+    static void FromRecord(const Record& rec, Obj& obj, Strings& strings) {
+        if constexpr (IN_RECORD) Load(rec.*RecordMember, obj.*Member, strings);
+    }
+
+private:
+    // Strings are stored as a StringRef into the strings section
+    template <typename Strings>
+    static void Store(const std::string& str, Format::StringRef& ref, Strings& strings) { ref = strings(str); }
+    template <typename Strings>
+    static void Load(const Format::StringRef& ref, std::string& str, Strings& strings) { str = strings(ref); }
+
+    // Anything else is the same bytes on both sides (Vec3 <-> float[3], enum <-> uint32_t)
+    template <typename From, typename To, typename Strings>
+    static void Store(const From& from, To& to, Strings&) {
+        static_assert(sizeof(From) == sizeof(To) && std::is_trivially_copyable<From>::value &&
+                      std::is_trivially_copyable<To>::value, "Record member does not match the object member");
+        memcpy(static_cast<void*>(&to), &from, sizeof(To));
+    }
+    template <typename From, typename To, typename Strings>
+    static void Load(const From& from, To& to, Strings& strings) { Store(from, to, strings); }
+};
+
+template <typename... Fields>
+struct FieldList {
+    static constexpr size_t FIXED_SIZE = (Fields::FIXED_SIZE + ... + 0);
+
+    static constexpr bool FixedFirst() {
+        const bool fixed[] = {Fields::FIXED..., false};
+        bool variable = false;
+        for (bool f : fixed) {
+            if (!f) variable = true;
+            else if (variable) return false;
+        }
+        return true;
+    }
+    static_assert(FixedFirst(), "Schema fields must list fixed-size members before strings and arrays");
+};
+
+// Specialized for every serialized type:
+//   template <> struct Schema<T> { using Fields = FieldList<Field<&T::a, &Record::a>, ...>; };
+template <typename T>
+struct Schema;
+
+class SchemaCodec {
+public:
+    // Encoded size of obj in the byte stream
+    template <typename T>
+    static size_t WireSize(const T& obj) {
+        return Size(obj, typename Schema<T>::Fields());
+    }
+
+    // Appends obj to out
+    template <typename T>
+    static void Encode(const T& obj, std::vector<uint8_t>& out) {
+        size_t offset = out.size();
+        out.resize(offset + WireSize(obj));
+        uint8_t* dst = out.data() + offset;
+        Write(obj, dst, typename Schema<T>::Fields());
+    }
+
+    // Reads obj from in; false (with in.ok cleared) on truncated or corrupt input
+    template <typename T>
+    static bool Decode(ByteReader& in, T& obj) {
+        Read(in, obj, typename Schema<T>::Fields());
+        return in.ok;
+    }
+
+    template <typename T>
+    static void Hash(const T& obj, Hasher& hasher) {
+        HashFields(obj, hasher, typename Schema<T>::Fields());
+    }
+
+    // Fills the members of a PCD3 record that the schema maps. strings turns
+    // a std::string into a StringRef (writing) or back (reading).
+    template <typename T, typename Record, typename Strings>
+    static void ToRecord(const T& obj, Record& rec, Strings&& strings) {
+        ToRecordFields(obj, rec, strings, typename Schema<T>::Fields());
+    }
+
+    template <typename T, typename Record, typename Strings>
+    static void FromRecord(const Record& rec, T& obj, Strings&& strings) {
+        FromRecordFields(rec, obj, strings, typename Schema<T>::Fields());
+    }
+
+private:
+    template <typename T, typename... F>
+    static size_t Size(const T& obj, FieldList<F...>) {
+        return FieldList<F...>::FIXED_SIZE + (F::VariableSize(obj) + ... + 0);
+    }
+
+    template <typename T, typename... F>
+    static void Write(const T& obj, uint8_t*& dst, FieldList<F...>) {
+        (F::Write(obj, dst), ...);
+    }
+
+    template <typename T, typename... F>
+    static void Read(ByteReader& in, T& obj, FieldList<F...>) {
+        const uint8_t* src = in.Bytes(FieldList<F...>::FIXED_SIZE);
+        if (!src) return;
+        (F::ReadFixed(obj, src), ...);
+        (F::ReadVariable(obj, in), ...);
+    }
+
+    template <typename T, typename... F>
+    static void HashFields(const T& obj, Hasher& hasher, FieldList<F...>) {
+        (F::Hash(obj, hasher), ...);
+    }
+
+    template <typename T, typename Record, typename Strings, typename... F>
+    static void ToRecordFields(const T& obj, Record& rec, Strings& strings, FieldList<F...>) {
+        (F::ToRecord(obj, rec, strings), ...);
+    }
+
+    template <typename T, typename Record, typename Strings, typename... F>
+    static void FromRecordFields(const Record& rec, T& obj, Strings& strings, FieldList<F...>) {
+        (F::FromRecord(rec, obj, strings), ...);
+    }
+};
+
+// ---- Map schemas ----
+
+template <>
+struct Schema<Brush> {
+    using R = Format::BrushRecord;
+    using Fields = FieldList<
+        Field<&Brush::id, &R::id>,
+        Field<&Brush::textureID, &R::textureID>,
+        Field<&Brush::flags, &R::flags>,
+        Field<&Brush::color, &R::color>,
+        Field<&Brush::uvScaleX, &R::uvScaleX>,
+        Field<&Brush::uvScaleY, &R::uvScaleY>,
+        Field<&Brush::uvOffsetX, &R::uvOffsetX>,
+        Field<&Brush::uvOffsetY, &R::uvOffsetY>,
+        Field<&Brush::name, &R::name>,
+        Field<&Brush::vertices>, // Position/normal/UV streams in the file
+        Field<&Brush::indices>>;
+};
+
+template <>
+struct Schema<Entity> {
+    using R = Format::EntityRecord;
+    using Fields = FieldList<
+        Field<&Entity::id, &R::id>,
+        Field<&Entity::type, &R::type>,
+        Field<&Entity::position, &R::position>,
+        Field<&Entity::rotation, &R::rotation>,
+        Field<&Entity::scale, &R::scale>,
+        Field<&Entity::name, &R::name>,
+        Field<&Entity::properties>>; // Properties section in the file
+};
+
+// Pixels are not part of the schema: they may still be on disk (deferred)
+// and live in their own section
+template <>
+struct Schema<Texture> {
+    using R = Format::TextureRecord;
+    using Fields = FieldList<
+        Field<&Texture::id, &R::id>,
+        Field<&Texture::width, &R::width>,
+        Field<&Texture::height, &R::height>,
+        Field<&Texture::channels, &R::channels>,
+        Field<&Texture::format>, // TextureFormatRecord in the file
+        Field<&Texture::mipCount>,
+        Field<&Texture::name, &R::name>>;
+};
+
+// Map-wide metadata only; brushes, entities and textures are stored separately
+template <>
+struct Schema<Map> {
+    using R = Format::MetaRecord;
+    using Fields = FieldList<
+        Field<&Map::nextBrushID, &R::nextBrushID>,
+        Field<&Map::nextEntityID, &R::nextEntityID>,
+        Field<&Map::nextTextureID, &R::nextTextureID>,
+        Field<&Map::name, &R::name>,
+        Field<&Map::author, &R::author>>;
+};
+
+} // namespace PCD
+
+#endif // PCD_SCHEMA_H
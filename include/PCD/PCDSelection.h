@@ -0,0 +1,161 @@
+#ifndef PCD_SELECTION_H
+#define PCD_SELECTION_H
+
+// Selected brushes or entities of one map array.
+//
+// Objects are keyed by slot, their index in Map::brushes or Map::entities.
+// Membership is a bitset, so Contains, Add, Remove and Toggle are O(1) and
+// the renderer can test every object in a single pass. Items() lists the
+// slots in the order they were selected: Remove only clears the bit, and
+// the stale list entry is dropped the next time the list is read.
+//
+// Each entry also remembers the object's ID. Erase() keeps the selection
+// right when an object is deleted and later slots shift down; Rebind()
+// finds the selected objects again by ID after undo has rearranged the
+// arrays.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PCD {
+
+class SelectionSet {
+public:
+    bool Contains(int slot) const {
+        size_t word = static_cast<size_t>(slot) / 64;
+        return slot >= 0 && word < bits.size() && (bits[word] >> (slot % 64) & 1);
+    }
+
+    size_t Size() const { return count; }
+    bool Empty() const { return count == 0; }
+
+    // False if the slot was already selected
+    bool Add(int slot, uint32_t id) {
+        if (slot < 0 || Contains(slot)) return false;
+        size_t word = static_cast<size_t>(slot) / 64;
+        if (word >= bits.size()) bits.resize(word + 1, 0);
+        bits[word] |= uint64_t(1) << (slot % 64);
+        slots.push_back(slot);
+        ids.push_back(id);
+        count++;
+        // Toggling without ever reading the list must not grow it forever
+        if (slots.size() > 2 * count + 64) Compact();
+        return true;
+    }
+
+    // False if the slot was not selected
+    bool Remove(int slot) {
+        if (!Contains(slot)) return false;
+        bits[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        count--;
+        return true;
+    }
+
+    // True if the slot is selected afterwards
+    bool Toggle(int slot, uint32_t id) {
+        if (Remove(slot)) return false;
+        return Add(slot, id);
+    }
+
+    void Clear() {
+        bits.clear();
+        slots.clear();
+        ids.clear();
+        count = 0;
+    }
+
+    // Selected slots, oldest selection first
+    const std::vector<int>& Items() const {
+        Compact();
+        return slots;
+    }
+
+    std::vector<int>::const_iterator begin() const { return Items().begin(); }
+    std::vector<int>::const_iterator end() const { return Items().end(); }
+
+    // The first object still selected, or -1
+    int Front() const { return Empty() ? -1 : Items().front(); }
+
+    // The object at slot was erased from its array; later slots move down
+    void Erase(int slot) {
+        Remove(slot);
+        Compact();
+        for (int& s : slots) {
+            if (s > slot) s--;
+        }
+        RebuildBits();
+    }
+
+    // Re-keys the selection after its array was rearranged. slotOf(id)
+    // returns the object's current slot or -1 when it no longer exists;
+    // those drop out of the selection.
+    template <typename SlotOf>
+    void Rebind(SlotOf slotOf) {
+        Compact();
+        size_t kept = 0;
+        for (size_t i = 0; i < slots.size(); i++) {
+            int slot = slotOf(ids[i]);
+            if (slot < 0) continue;
+            slots[kept] = slot;
+            ids[kept] = ids[i];
+            kept++;
+        }
+        slots.resize(kept);
+        ids.resize(kept);
+        RebuildBits();
+    }
+
+private:
+    // Drops entries whose bit is clear. A slot that was removed and added
+    // again has two entries; the later one is kept so it lists as the most
+    // recent selection. Walking backwards and clearing each bit on first
+    // sight does both.
+    void Compact() const {
+        if (slots.size() == count) return;
+        size_t keep = slots.size();
+        for (size_t i = slots.size(); i-- > 0;) {
+            int slot = slots[i];
+            uint64_t bit = uint64_t(1) << (slot % 64);
+            if (!(bits[slot / 64] & bit)) continue;
+            bits[slot / 64] &= ~bit;
+            keep--;
+            slots[keep] = slot;
+            ids[keep] = ids[i];
+        }
+        slots.erase(slots.begin(), slots.begin() + keep);
+        ids.erase(ids.begin(), ids.begin() + keep);
+        for (int slot : slots) bits[slot / 64] |= uint64_t(1) << (slot % 64);
+    }
+
+    // After slots were rewritten; a slot listed twice is kept once
+    void RebuildBits() {
+        bits.clear();
+        count = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < slots.size(); i++) {
+            int slot = slots[i];
+            size_t word = static_cast<size_t>(slot) / 64;
+            if (word >= bits.size()) bits.resize(word + 1, 0);
+            uint64_t bit = uint64_t(1) << (slot % 64);
+            if (bits[word] & bit) continue;
+            bits[word] |= bit;
+            slots[kept] = slot;
+            ids[kept] = ids[i];
+            kept++;
+        }
+        slots.resize(kept);
+        ids.resize(kept);
+        count = kept;
+    }
+
+    // Compact() only reorders what Items() returns, so it runs on const sets
+    mutable std::vector<uint64_t> bits;
+    mutable std::vector<int> slots;
+    mutable std::vector<uint32_t> ids;
+    size_t count = 0;
+};
+
+} // namespace PCD
+
+#endif // PCD_SELECTION_H
@@ -0,0 +1,183 @@
+#ifndef PCD_STRINGS_H
+#define PCD_STRINGS_H
+
+// Interned strings.
+//
+// Property keys repeat across a map and across maps ("classname",
+// "target", "health", ...). Each distinct key is stored once in a
+// process-wide StringTable and referenced through an InternedString, which
+// is a pointer: copying is free, equality is a pointer compare and the text
+// is always one dereference away. Interned strings live as long as the
+// process, so the table is shared by every map, the clipboard and undo
+// history without any remapping. For the same reason nothing open-ended
+// belongs in it: brush and entity names and property values stay owned
+// strings (see PropertyValue).
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <vector>
+
+namespace PCD {
+
+// Lookups are lock-free so parallel map loads, which intern every name and
+// property, do not contend: each of 16 shards is an open-addressed table of
+// (hash, string) slots that is only ever appended to, and growing it
+// publishes a new slot array while the old one stays readable. Inserts take
+// the shard's mutex and re-check under it.
+class StringTable {
+public:
+    // Returns the single stored copy of text, adding it on first use
+    const std::string* Intern(std::string_view text) {
+        if (text.empty()) return &Empty();
+        size_t hash = std::hash<std::string_view>()(text);
+        Shard& shard = shards[hash >> SHARD_SHIFT];
+        if (const std::string* found = shard.Find(text, hash)) return found;
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (const std::string* found = shard.Find(text, hash)) return found;
+        return shard.Insert(text, hash);
+    }
+
+    // nullptr when text was never interned (lookups must not grow the table)
+    const std::string* Find(std::string_view text) const {
+        if (text.empty()) return &Empty();
+        size_t hash = std::hash<std::string_view>()(text);
+        return shards[hash >> SHARD_SHIFT].Find(text, hash);
+    }
+
+    size_t Size() const {
+        size_t size = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size += shard.storage.size();
+        }
+        return size;
+    }
+
+    static const std::string& Empty() {
+        static const std::string empty;
+        return empty;
+    }
+
+    static StringTable& Shared() {
+        static StringTable table;
+        return table;
+    }
+
+private:
+    static constexpr size_t SHARD_SHIFT = sizeof(size_t) * 8 - 4; // Top 4 hash bits pick one of 16 shards
+
+    struct Slot {
+        std::atomic<size_t> hash{0};
+        std::atomic<const std::string*> text{nullptr}; // Published after hash
+    };
+
+    struct SlotArray {
+        explicit SlotArray(size_t size) : mask(size - 1), slots(new Slot[size]) {}
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::deque<std::string> storage; // deque keeps addresses stable as it grows
+        std::vector<std::unique_ptr<SlotArray>> arrays; // Current one last; older ones may still be read
+        std::atomic<SlotArray*> current{nullptr};
+
+        const std::string* Find(std::string_view text, size_t hash) const {
+            const SlotArray* array = current.load(std::memory_order_acquire);
+            if (!array) return nullptr;
+            for (size_t i = hash & array->mask;; i = (i + 1) & array->mask) {
+                const std::string* candidate = array->slots[i].text.load(std::memory_order_acquire);
+                if (!candidate) return nullptr;
+                if (array->slots[i].hash.load(std::memory_order_relaxed) == hash && *candidate == text) {
+                    return candidate;
+                }
+            }
+        }
+
+        // Caller holds mutex
+        const std::string* Insert(std::string_view text, size_t hash) {
+            SlotArray* array = current.load(std::memory_order_relaxed);
+            // Kept at most half full so probe runs stay short
+            if (!array || (storage.size() + 1) * 2 > array->mask + 1) {
+                arrays.push_back(std::make_unique<SlotArray>(array ? (array->mask + 1) * 2 : 64));
+                SlotArray* grown = arrays.back().get();
+                for (const std::string& stored : storage) {
+                    Place(*grown, std::hash<std::string_view>()(stored), &stored);
+                }
+                current.store(grown, std::memory_order_release);
+                array = grown;
+            }
+            const std::string* stored = &storage.emplace_back(text);
+            Place(*array, hash, stored);
+            return stored;
+        }
+
+        static void Place(SlotArray& array, size_t hash, const std::string* text) {
+            size_t i = hash & array.mask;
+            while (array.slots[i].text.load(std::memory_order_relaxed)) i = (i + 1) & array.mask;
+            array.slots[i].hash.store(hash, std::memory_order_relaxed);
+            array.slots[i].text.store(text, std::memory_order_release);
+        }
+    };
+
+    Shard shards[16];
+};
+
+class InternedString {
+public:
+    InternedString() : text(&StringTable::Empty()) {}
+    explicit InternedString(std::string_view str) : text(StringTable::Shared().Intern(str)) {}
+    explicit InternedString(const std::string& str) : InternedString(std::string_view(str)) {}
+    explicit InternedString(const char* str) : InternedString(std::string_view(str)) {}
+
+    InternedString& operator=(std::string_view str) { text = StringTable::Shared().Intern(str); return *this; }
+    InternedString& operator=(const std::string& str) { return *this = std::string_view(str); }
+    InternedString& operator=(const char* str) { return *this = std::string_view(str); }
+
+    // The interned copy of str without adding it. A string that was never
+    // interned yields a value equal to no other InternedString, since
+    // nothing can be holding it.
+    static InternedString Find(std::string_view str) {
+        InternedString result;
+        const std::string* found = StringTable::Shared().Find(str);
+        result.text = found ? found : &Missing();
+        return result;
+    }
+
+    const std::string& str() const { return *text; }
+    operator const std::string&() const { return *text; }
+    const char* c_str() const { return text->c_str(); }
+    size_t size() const { return text->size(); }
+    bool empty() const { return text->empty(); }
+
+    bool operator==(const InternedString& other) const { return text == other.text; }
+    bool operator!=(const InternedString& other) const { return text != other.text; }
+    bool operator==(std::string_view other) const { return *text == other; }
+    bool operator!=(std::string_view other) const { return *text != other; }
+
+    friend std::string operator+(const InternedString& a, const std::string& b) { return *a.text + b; }
+    friend std::string operator+(const InternedString& a, const char* b) { return *a.text + b; }
+
+    struct Hash {
+        size_t operator()(const InternedString& s) const { return std::hash<const void*>()(s.text); }
+    };
+
+private:
+    static const std::string& Missing() {
+        static const std::string missing;
+        return missing;
+    }
+
+    const std::string* text;
+};
+
+} // namespace PCD
+
+#endif // PCD_STRINGS_H
@@ -0,0 +1,143 @@
+#ifndef PCD_SYNTHETIC_MAP_H
+#define PCD_SYNTHETIC_MAP_H
+
+// Deterministic stress maps for benchmarks: the same parameters always
+// produce byte-identical maps on every platform (no std:: distributions).
+
+#include "PCDTypes.h"
+#include "PCDBrushFactory.h"
+#include <string>
+
+namespace PCD {
+
+class SyntheticMap {
+public:
+    struct Params {
+        uint32_t brushCount = 1000;
+        uint32_t entityCount = 50;
+        uint32_t textureCount = 8;
+        uint32_t textureSize = 256; // Square RGBA textures
+        uint64_t seed = 1;
+    };
+
+    // Brushes are laid out as a grid of rooms (floor, walls, pillars, ramps)
+    // so spatial structure looks like a real map rather than noise
+    static Map Generate(const Params& params) {
+        Random rng(params.seed);
+        Map map;
+        map.name = "synthetic_" + std::to_string(params.brushCount);
+        map.author = "pcd_bench";
+
+        for (uint32_t t = 0; t < params.textureCount; t++) {
+            map.AddTexture(MakeTexture(params.textureSize, t, rng));
+        }
+
+        const float roomSize = 32.0f;
+        const uint32_t brushesPerRoom = 12;
+        uint32_t rooms = (params.brushCount + brushesPerRoom - 1) / brushesPerRoom;
+        uint32_t roomsPerRow = 1;
+        while (roomsPerRow * roomsPerRow < rooms) roomsPerRow++;
+
+        map.brushes.reserve(params.brushCount);
+        for (uint32_t i = 0; i < params.brushCount; i++) {
+            uint32_t room = i / brushesPerRoom;
+            uint32_t slot = i % brushesPerRoom;
+            Vec3 origin(float(room % roomsPerRow) * roomSize, 0.0f, float(room / roomsPerRow) * roomSize);
+
+            Brush brush;
+            if (slot == 0) {
+                // Floor
+                brush = BrushFactory::CreateBox(map, {origin.x, origin.y - 1.0f, origin.z},
+                                                {origin.x + roomSize, origin.y, origin.z + roomSize});
+            } else if (slot <= 4) {
+                // Four walls with a random doorway gap
+                float gap = 4.0f + float(rng.Next() % 8);
+                bool alongX = (slot % 2) == 1;
+                float offset = (slot <= 2) ? 0.0f : roomSize - 1.0f;
+                Vec3 min = alongX ? Vec3(origin.x, 0.0f, origin.z + offset) : Vec3(origin.x + offset, 0.0f, origin.z);
+                Vec3 max = alongX ? Vec3(origin.x + roomSize - gap, 8.0f, min.z + 1.0f)
+                                  : Vec3(min.x + 1.0f, 8.0f, origin.z + roomSize - gap);
+                brush = BrushFactory::CreateBox(map, min, max);
+            } else if (slot <= 8) {
+                float x = origin.x + 4.0f + float(rng.Next() % 24);
+                float z = origin.z + 4.0f + float(rng.Next() % 24);
+                brush = BrushFactory::CreateCylinder(map, {x, 4.0f, z}, 0.5f + float(rng.Next() % 4) * 0.25f, 8.0f,
+                                                     8 + int(rng.Next() % 3) * 4);
+            } else if (slot <= 10) {
+                float x = origin.x + 2.0f + float(rng.Next() % 20);
+                float z = origin.z + 2.0f + float(rng.Next() % 20);
+                brush = BrushFactory::CreateWedge(map, {x, 0.0f, z}, {x + 6.0f, 2.0f + float(rng.Next() % 4), z + 4.0f});
+            } else {
+                float x = origin.x + float(rng.Next() % 28);
+                float z = origin.z + float(rng.Next() % 28);
+                float h = 0.5f + float(rng.Next() % 8) * 0.5f;
+                brush = BrushFactory::CreateBox(map, {x, 0.0f, z}, {x + 2.0f, h, z + 2.0f});
+            }
+
+            brush.name = "brush_" + std::to_string(i);
+            brush.color = Vec3(float(rng.Next() % 256) / 255.0f, float(rng.Next() % 256) / 255.0f,
+                               float(rng.Next() % 256) / 255.0f);
+            if (params.textureCount > 0) brush.textureID = 1 + uint32_t(rng.Next() % params.textureCount);
+            map.brushes.push_back(std::move(brush));
+        }
+
+        static const EntityType types[] = {
+            ENT_INFO_PLAYER_DEATHMATCH, ENT_LIGHT, ENT_ITEM_HEALTH, ENT_ITEM_ARMOR,
+            ENT_ITEM_AMMO, ENT_WEAPON_SHOTGUN, ENT_TRIGGER_PUSH, ENT_TARGET_DESTINATION,
+        };
+        float extent = float(roomsPerRow) * roomSize;
+        map.entities.reserve(params.entityCount);
+        for (uint32_t i = 0; i < params.entityCount; i++) {
+            EntityType type = (i == 0) ? ENT_INFO_PLAYER_START : types[rng.Next() % 8];
+            Vec3 pos(float(rng.Next() % 10000) / 10000.0f * extent, 1.0f, float(rng.Next() % 10000) / 10000.0f * extent);
+            Entity ent = BrushFactory::CreateEntity(map, type, pos);
+            ent.name = std::string(GetEntityTypeName(type)) + "_" + std::to_string(i);
+            if (type == ENT_TRIGGER_PUSH) ent.SetProperty("target", "dest_" + std::to_string(rng.Next() % 16));
+            if (type == ENT_TARGET_DESTINATION) ent.SetProperty("targetname", "dest_" + std::to_string(i % 16));
+            map.entities.push_back(std::move(ent));
+        }
+
+        return map;
+    }
+
+private:
+    // xorshift64*: tiny, fast and identical everywhere
+    struct Random {
+        uint64_t state;
+        explicit Random(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+        uint64_t Next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+    };
+
+    static Texture MakeTexture(uint32_t size, uint32_t index, Random& rng) {
+        Texture tex;
+        tex.name = "synthetic_" + std::to_string(index) + ".png";
+        tex.width = size;
+        tex.height = size;
+        tex.channels = 4;
+        tex.data.resize(size_t(size) * size * 4);
+
+        // Tiles with per-texture colours plus a little noise, so the pixels
+        // behave like real art under compression rather than flat colour
+        uint8_t base[3] = {uint8_t(rng.Next()), uint8_t(rng.Next()), uint8_t(rng.Next())};
+        uint32_t tile = 8u << (index % 3);
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                bool dark = ((x / tile) + (y / tile)) % 2 == 0;
+                uint8_t noise = uint8_t(rng.Next() & 15);
+                uint8_t* p = &tex.data[(size_t(y) * size + x) * 4];
+                for (int c = 0; c < 3; c++) p[c] = uint8_t((dark ? base[c] / 2 : base[c]) + noise);
+                p[3] = 255;
+            }
+        }
+        return tex;
+    }
+};
+
+} // namespace PCD
+
+#endif // PCD_SYNTHETIC_MAP_H
@@ -0,0 +1,442 @@
+#ifndef PCD_TEXTURE_COMPRESSION_H
+#define PCD_TEXTURE_COMPRESSION_H
+
+// CPU-side S3TC (BC1/BC3) encoder and decoder for map textures.
+//
+// Compress() turns a raw texture into a full box-filtered mip chain stored
+// as BC blocks, level 0 first, so the renderer can hand every level straight
+// to glCompressedTexImage2D. Nothing here touches OpenGL.
+
+#include "PCDTypes.h"
+#include "PCDWorkerPool.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+namespace PCD {
+
+class TextureCompressor {
+public:
+    // BC3 when any pixel is not fully opaque, BC1 otherwise
+    static TextureFormat ChooseFormat(const Texture& tex) {
+        if (tex.channels != 4) return TEXFMT_BC1;
+        for (size_t i = 3; i < tex.data.size(); i += 4) {
+            if (tex.data[i] != 255) return TEXFMT_BC3;
+        }
+        return TEXFMT_BC1;
+    }
+
+    // Replaces a raw texture's pixels with a compressed mip chain.
+    // threads works like SaveOptions::threads.
+    static bool Compress(Texture& tex, TextureFormat format, unsigned threads = 1) {
+        if (tex.IsCompressed() || format == TEXFMT_RAW) return true;
+        if (tex.width == 0 || tex.height == 0 ||
+            (tex.channels != 3 && tex.channels != 4) ||
+            tex.data.size() != size_t(tex.width) * tex.height * tex.channels) {
+            std::cerr << "[PCD] Cannot compress texture: " << tex.name << "\n";
+            return false;
+        }
+
+        std::vector<uint8_t> level = ToRGBA(tex);
+        uint32_t w = tex.width;
+        uint32_t h = tex.height;
+        uint32_t mips = MipCount(w, h);
+
+        std::vector<uint8_t> out(ChainSize(format, w, h, mips));
+        size_t offset = 0;
+        for (uint32_t m = 0; m < mips; m++) {
+            EncodeLevel(level.data(), w, h, format, out.data() + offset, threads);
+            offset += LevelSize(format, w, h);
+            if (m + 1 < mips) {
+                level = Downsample(level, w, h);
+                w = std::max(1u, w / 2);
+                h = std::max(1u, h / 2);
+            }
+        }
+
+        tex.data = std::move(out);
+        tex.format = format;
+        tex.mipCount = mips;
+        return true;
+    }
+
+    // Expands one mip level back to RGBA8 (for drivers without S3TC)
+    static bool Decompress(const Texture& tex, uint32_t mip, std::vector<uint8_t>& rgba) {
+        if (!tex.IsCompressed() || mip >= tex.mipCount) return false;
+
+        uint32_t w = 0, h = 0;
+        size_t offset = 0, size = 0;
+        MipLevel(tex, mip, w, h, offset, size);
+        if (offset + size > tex.data.size()) return false;
+
+        rgba.assign(size_t(w) * h * 4, 0);
+        const uint8_t* src = tex.data.data() + offset;
+        size_t blockBytes = BlockBytes(tex.format);
+        uint8_t block[64];
+
+        for (uint32_t by = 0; by < (h + 3) / 4; by++) {
+            for (uint32_t bx = 0; bx < (w + 3) / 4; bx++) {
+                if (tex.format == TEXFMT_BC3) {
+                    DecodeBC3Block(src, block);
+                } else {
+                    DecodeBC1Block(src, block);
+                }
+                src += blockBytes;
+
+                for (uint32_t y = 0; y < 4 && by * 4 + y < h; y++) {
+                    for (uint32_t x = 0; x < 4 && bx * 4 + x < w; x++) {
+                        memcpy(&rgba[(size_t(by * 4 + y) * w + bx * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Size, position and byte range of one level inside Texture::data
+    static void MipLevel(const Texture& tex, uint32_t mip, uint32_t& w, uint32_t& h,
+                         size_t& offset, size_t& size) {
+        w = tex.width;
+        h = tex.height;
+        offset = 0;
+        for (uint32_t m = 0; m < mip; m++) {
+            offset += LevelSize(tex.format, w, h);
+            w = std::max(1u, w / 2);
+            h = std::max(1u, h / 2);
+        }
+        size = LevelSize(tex.format, w, h);
+    }
+
+    static uint32_t MipCount(uint32_t w, uint32_t h) {
+        uint32_t count = 1;
+        while (w > 1 || h > 1) {
+            w = std::max(1u, w / 2);
+            h = std::max(1u, h / 2);
+            count++;
+        }
+        return count;
+    }
+
+    static size_t BlockBytes(TextureFormat format) { return format == TEXFMT_BC3 ? 16 : 8; }
+
+    static size_t LevelSize(TextureFormat format, uint32_t w, uint32_t h) {
+        return size_t((w + 3) / 4) * ((h + 3) / 4) * BlockBytes(format);
+    }
+
+    static size_t ChainSize(TextureFormat format, uint32_t w, uint32_t h, uint32_t mips) {
+        size_t total = 0;
+        for (uint32_t m = 0; m < mips; m++) {
+            total += LevelSize(format, w, h);
+            w = std::max(1u, w / 2);
+            h = std::max(1u, h / 2);
+        }
+        return total;
+    }
+
+    // --- Block codecs. Blocks are 4x4 RGBA8 pixels, row-major. ---
+
+    static void EncodeBC1Block(const uint8_t* rgba, uint8_t* out) {
+        EncodeColorBlock(rgba, out);
+    }
+
+    static void EncodeBC3Block(const uint8_t* rgba, uint8_t* out) {
+        EncodeAlphaBlock(rgba, out);
+        EncodeColorBlock(rgba, out + 8);
+    }
+
+    static void DecodeBC1Block(const uint8_t* in, uint8_t* rgba) {
+        DecodeColorBlock(in, rgba);
+        for (int i = 0; i < 16; i++) rgba[i * 4 + 3] = 255;
+    }
+
+    static void DecodeBC3Block(const uint8_t* in, uint8_t* rgba) {
+        DecodeColorBlock(in + 8, rgba);
+
+        uint8_t palette[8];
+        AlphaPalette(in[0], in[1], palette);
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; i++) bits |= uint64_t(in[2 + i]) << (8 * i);
+        for (int i = 0; i < 16; i++) {
+            rgba[i * 4 + 3] = palette[(bits >> (3 * i)) & 7];
+        }
+    }
+
+private:
+    static std::vector<uint8_t> ToRGBA(const Texture& tex) {
+        if (tex.channels == 4) return tex.data;
+        size_t pixels = size_t(tex.width) * tex.height;
+        std::vector<uint8_t> rgba(pixels * 4);
+        for (size_t i = 0; i < pixels; i++) {
+            rgba[i * 4 + 0] = tex.data[i * 3 + 0];
+            rgba[i * 4 + 1] = tex.data[i * 3 + 1];
+            rgba[i * 4 + 2] = tex.data[i * 3 + 2];
+            rgba[i * 4 + 3] = 255;
+        }
+        return rgba;
+    }
+
+    // 2x2 box filter; odd edges reuse the last row/column
+    static std::vector<uint8_t> Downsample(const std::vector<uint8_t>& src, uint32_t w, uint32_t h) {
+        uint32_t nw = std::max(1u, w / 2);
+        uint32_t nh = std::max(1u, h / 2);
+        std::vector<uint8_t> dst(size_t(nw) * nh * 4);
+
+        for (uint32_t y = 0; y < nh; y++) {
+            uint32_t y0 = std::min(y * 2, h - 1);
+            uint32_t y1 = std::min(y * 2 + 1, h - 1);
+            for (uint32_t x = 0; x < nw; x++) {
+                uint32_t x0 = std::min(x * 2, w - 1);
+                uint32_t x1 = std::min(x * 2 + 1, w - 1);
+                for (int c = 0; c < 4; c++) {
+                    uint32_t sum = src[(size_t(y0) * w + x0) * 4 + c] + src[(size_t(y0) * w + x1) * 4 + c] +
+                                   src[(size_t(y1) * w + x0) * 4 + c] + src[(size_t(y1) * w + x1) * 4 + c];
+                    dst[(size_t(y) * nw + x) * 4 + c] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+        return dst;
+    }
+
+    static void EncodeLevel(const uint8_t* rgba, uint32_t w, uint32_t h, TextureFormat format,
+                            uint8_t* out, unsigned threads) {
+        uint32_t blocksX = (w + 3) / 4;
+        uint32_t blocksY = (h + 3) / 4;
+        size_t blockBytes = BlockBytes(format);
+
+        auto encodeRows = [&](size_t begin, size_t end) {
+            uint8_t block[64];
+            for (size_t by = begin; by < end; by++) {
+                for (uint32_t bx = 0; bx < blocksX; bx++) {
+                    // Clamp so partial edge blocks repeat their last pixel
+                    for (uint32_t y = 0; y < 4; y++) {
+                        uint32_t sy = std::min(uint32_t(by) * 4 + y, h - 1);
+                        for (uint32_t x = 0; x < 4; x++) {
+                            uint32_t sx = std::min(bx * 4 + x, w - 1);
+                            memcpy(&block[(y * 4 + x) * 4], &rgba[(size_t(sy) * w + sx) * 4], 4);
+                        }
+                    }
+                    uint8_t* dst = out + (by * blocksX + bx) * blockBytes;
+                    if (format == TEXFMT_BC3) {
+                        EncodeBC3Block(block, dst);
+                    } else {
+                        EncodeBC1Block(block, dst);
+                    }
+                }
+            }
+        };
+
+        if (threads == 1) {
+            encodeRows(0, blocksY);
+        } else {
+            WorkerPool::Shared().ParallelFor(blocksY, threads, encodeRows);
+        }
+    }
+
+    static uint16_t To565(const float* c) {
+        int r = std::clamp(int(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+        int g = std::clamp(int(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+        int b = std::clamp(int(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    static void From565(uint16_t c, int* rgb) {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Four-colour palette (c0 > c1); BC3 always decodes colour this way
+    static void ColorPalette(uint16_t c0, uint16_t c1, int palette[4][3], bool allowThreeColor) {
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (int k = 0; k < 3; k++) {
+            if (c0 > c1 || !allowThreeColor) {
+                palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+                palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+            } else {
+                palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+                palette[3][k] = 0;
+            }
+        }
+    }
+
+    // Picks the nearest palette entry per pixel; returns total squared error
+    static int PickIndices(const uint8_t* rgba, uint16_t c0, uint16_t c1, uint32_t& indices) {
+        int palette[4][3];
+        ColorPalette(c0, c1, palette, false);
+        indices = 0;
+        int total = 0;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestErr = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = rgba[i * 4 + 0] - palette[p][0];
+                int dg = rgba[i * 4 + 1] - palette[p][1];
+                int db = rgba[i * 4 + 2] - palette[p][2];
+                int err = dr * dr + dg * dg + db * db;
+                if (err < bestErr) { bestErr = err; best = p; }
+            }
+            indices |= uint32_t(best) << (2 * i);
+            total += bestErr;
+        }
+        return total;
+    }
+
+    // Least-squares endpoints for a fixed index assignment
+    static bool RefineEndpoints(const uint8_t* rgba, uint32_t indices, float* e0, float* e1) {
+        static const float weight0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0, bb = 0, ab = 0;
+        float ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            float a = weight0[(indices >> (2 * i)) & 3];
+            float b = 1.0f - a;
+            aa += a * a; bb += b * b; ab += a * b;
+            for (int k = 0; k < 3; k++) {
+                ax[k] += a * rgba[i * 4 + k];
+                bx[k] += b * rgba[i * 4 + k];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f) return false;
+        for (int k = 0; k < 3; k++) {
+            e0[k] = std::clamp((ax[k] * bb - bx[k] * ab) / det, 0.0f, 255.0f);
+            e1[k] = std::clamp((bx[k] * aa - ax[k] * ab) / det, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    static void WriteColorBlock(uint8_t* out, uint16_t c0, uint16_t c1, uint32_t indices) {
+        out[0] = uint8_t(c0); out[1] = uint8_t(c0 >> 8);
+        out[2] = uint8_t(c1); out[3] = uint8_t(c1 >> 8);
+        for (int i = 0; i < 4; i++) out[4 + i] = uint8_t(indices >> (8 * i));
+    }
+
+    // Keeps the block in four-colour mode: c0 > c1, or c0 == c1 with index 0
+    static void OrderEndpoints(uint16_t& c0, uint16_t& c1, uint32_t& indices) {
+        if (c0 < c1) {
+            std::swap(c0, c1);
+            indices ^= 0x55555555; // 0<->1, 2<->3
+        } else if (c0 == c1) {
+            indices = 0;
+        }
+    }
+
+    static void EncodeColorBlock(const uint8_t* rgba, uint8_t* out) {
+        // Principal axis of the colours via a few power iterations
+        float mean[3] = {0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            for (int k = 0; k < 3; k++) mean[k] += rgba[i * 4 + k];
+        }
+        for (int k = 0; k < 3; k++) mean[k] /= 16.0f;
+
+        float cov[6] = {0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            float r = rgba[i * 4 + 0] - mean[0];
+            float g = rgba[i * 4 + 1] - mean[1];
+            float b = rgba[i * 4 + 2] - mean[2];
+            cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+            cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+        }
+
+        float axis[3] = {1.0f, 1.0f, 1.0f};
+        for (int iter = 0; iter < 4; iter++) {
+            float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+            float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+            float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+            float len = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+            if (len < 1e-6f) break;
+            axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+        }
+
+        float minProj = 1e30f, maxProj = -1e30f;
+        for (int i = 0; i < 16; i++) {
+            float proj = (rgba[i * 4 + 0] - mean[0]) * axis[0] +
+                         (rgba[i * 4 + 1] - mean[1]) * axis[1] +
+                         (rgba[i * 4 + 2] - mean[2]) * axis[2];
+            minProj = std::min(minProj, proj);
+            maxProj = std::max(maxProj, proj);
+        }
+        float axisLen2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        float e0[3], e1[3];
+        for (int k = 0; k < 3; k++) {
+            e0[k] = std::clamp(mean[k] + axis[k] * maxProj / axisLen2, 0.0f, 255.0f);
+            e1[k] = std::clamp(mean[k] + axis[k] * minProj / axisLen2, 0.0f, 255.0f);
+        }
+
+        uint16_t c0 = To565(e0), c1 = To565(e1);
+        uint32_t indices;
+        int err = PickIndices(rgba, c0, c1, indices);
+
+        // One least-squares pass usually shaves a good chunk of error
+        float r0[3], r1[3];
+        if (err > 0 && RefineEndpoints(rgba, indices, r0, r1)) {
+            uint16_t rc0 = To565(r0), rc1 = To565(r1);
+            uint32_t refined;
+            int refinedErr = PickIndices(rgba, rc0, rc1, refined);
+            if (refinedErr < err) {
+                c0 = rc0; c1 = rc1; indices = refined;
+            }
+        }
+
+        OrderEndpoints(c0, c1, indices);
+        WriteColorBlock(out, c0, c1, indices);
+    }
+
+    static void DecodeColorBlock(const uint8_t* in, uint8_t* rgba) {
+        uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+        uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+        uint32_t indices = uint32_t(in[4]) | (uint32_t(in[5]) << 8) | (uint32_t(in[6]) << 16) | (uint32_t(in[7]) << 24);
+        int palette[4][3];
+        ColorPalette(c0, c1, palette, true);
+        for (int i = 0; i < 16; i++) {
+            int p = (indices >> (2 * i)) & 3;
+            for (int k = 0; k < 3; k++) rgba[i * 4 + k] = uint8_t(palette[p][k]);
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    static void AlphaPalette(uint8_t a0, uint8_t a1, uint8_t* palette) {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1) {
+            for (int i = 1; i < 7; i++) palette[i + 1] = uint8_t(((7 - i) * a0 + i * a1) / 7);
+        } else {
+            for (int i = 1; i < 5; i++) palette[i + 1] = uint8_t(((5 - i) * a0 + i * a1) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    static void EncodeAlphaBlock(const uint8_t* rgba, uint8_t* out) {
+        uint8_t minA = 255, maxA = 0;
+        for (int i = 0; i < 16; i++) {
+            minA = std::min(minA, rgba[i * 4 + 3]);
+            maxA = std::max(maxA, rgba[i * 4 + 3]);
+        }
+
+        // Eight-value mode (a0 > a1); a flat block just repeats a0
+        uint8_t palette[8];
+        AlphaPalette(maxA, minA, palette);
+        uint64_t bits = 0;
+        if (maxA != minA) {
+            for (int i = 0; i < 16; i++) {
+                int a = rgba[i * 4 + 3];
+                int best = 0, bestErr = 256;
+                for (int p = 0; p < 8; p++) {
+                    int err = std::abs(a - palette[p]);
+                    if (err < bestErr) { bestErr = err; best = p; }
+                }
+                bits |= uint64_t(best) << (3 * i);
+            }
+        }
+
+        out[0] = maxA;
+        out[1] = minA;
+        for (int i = 0; i < 6; i++) out[2 + i] = uint8_t(bits >> (8 * i));
+    }
+};
+
+} // namespace PCD
+
+#endif // PCD_TEXTURE_COMPRESSION_H
@@ -0,0 +1,213 @@
+#ifndef PCD_TRANSFORM_H
+#define PCD_TRANSFORM_H
+
+// Affine transforms of brush vertices in bulk.
+//
+// An Affine is a column-major 4x4 matrix (the layout of the editor's view
+// and projection matrices) together with the inverse-transpose of its upper
+// 3x3, which is what normals go through. TransformBrushes applies one to a
+// list of brushes, splitting large selections across the shared worker
+// pool. The inner loop transforms four vertices at a time with SSE2,
+// transposing the interleaved Vertex layout into x/y/z lanes in registers;
+// other targets, and the last few vertices of a brush, run the same
+// arithmetic in scalar code.
+
+#include "PCDTypes.h"
+#include "PCDWorkerPool.h"
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PCD_TRANSFORM_SSE2 1
+#endif
+
+namespace PCD {
+
+struct Affine {
+    float m[16] = {1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1};
+    float normal[9] = {1, 0, 0,  0, 1, 0,  0, 0, 1}; // Column-major 3x3
+    bool translationOnly = true;
+    bool moveNormals = false;  // False when normals come out unchanged
+    bool renormalize = false;  // The normal matrix changes lengths
+
+    static Affine Translation(const Vec3& delta) {
+        Affine t;
+        t.m[12] = delta.x;
+        t.m[13] = delta.y;
+        t.m[14] = delta.z;
+        return t;
+    }
+
+    // Around the Y axis through pivot; positive angles turn +X towards +Z
+    static Affine RotationY(float radians, const Vec3& pivot) {
+        float c = std::cos(radians), s = std::sin(radians);
+        float m[16] = {c, 0, s, 0,  0, 1, 0, 0,  -s, 0, c, 0,
+                       pivot.x - (c * pivot.x - s * pivot.z), 0, pivot.z - (s * pivot.x + c * pivot.z), 1};
+        return FromMatrix(m);
+    }
+
+    // Per-axis factors about pivot
+    static Affine Scale(const Vec3& factors, const Vec3& pivot) {
+        float m[16] = {factors.x, 0, 0, 0,  0, factors.y, 0, 0,  0, 0, factors.z, 0,
+                       pivot.x * (1 - factors.x), pivot.y * (1 - factors.y), pivot.z * (1 - factors.z), 1};
+        return FromMatrix(m);
+    }
+
+    // Any affine matrix (the bottom row is ignored). A singular one leaves
+    // normals alone rather than collapsing them.
+    static Affine FromMatrix(const float* matrix) {
+        Affine t;
+        for (int i = 0; i < 16; i++) t.m[i] = matrix[i];
+        t.m[3] = t.m[7] = t.m[11] = 0;
+        t.m[15] = 1;
+
+        const float* a = t.m;
+        // Cofactors of the upper 3x3; divided by the determinant they are
+        // its inverse-transpose
+        float c[9] = {a[5] * a[10] - a[6] * a[9], a[6] * a[8] - a[4] * a[10], a[4] * a[9] - a[5] * a[8],
+                      a[9] * a[2] - a[10] * a[1], a[10] * a[0] - a[8] * a[2], a[8] * a[1] - a[9] * a[0],
+                      a[1] * a[6] - a[2] * a[5], a[2] * a[4] - a[0] * a[6], a[0] * a[5] - a[1] * a[4]};
+        float det = a[0] * c[0] + a[1] * c[1] + a[2] * c[2];
+        bool linearIdentity = a[0] == 1 && a[1] == 0 && a[2] == 0 && a[4] == 0 && a[5] == 1 &&
+                              a[6] == 0 && a[8] == 0 && a[9] == 0 && a[10] == 1;
+        t.translationOnly = linearIdentity;
+        if (linearIdentity || std::fabs(det) < 1e-12f) return t;
+
+        for (int i = 0; i < 9; i++) t.normal[i] = c[i] / det;
+        t.moveNormals = true;
+        // Rotations keep unit normals unit length; anything else is fixed up
+        for (int col = 0; col < 3 && !t.renormalize; col++) {
+            const float* n = t.normal + col * 3;
+            t.renormalize = std::fabs(n[0] * n[0] + n[1] * n[1] + n[2] * n[2] - 1) > 1e-5f;
+        }
+        return t;
+    }
+
+    Vec3 TranslationPart() const { return Vec3(m[12], m[13], m[14]); }
+
+    Vec3 Point(const Vec3& p) const {
+        return Vec3(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                    m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                    m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+    }
+
+    Vec3 Normal(const Vec3& n) const {
+        if (!moveNormals) return n;
+        Vec3 out(normal[0] * n.x + normal[3] * n.y + normal[6] * n.z,
+                 normal[1] * n.x + normal[4] * n.y + normal[7] * n.z,
+                 normal[2] * n.x + normal[5] * n.y + normal[8] * n.z);
+        if (renormalize) {
+            float length = std::sqrt(out.x * out.x + out.y * out.y + out.z * out.z);
+            if (length > 0) out = out / length;
+        }
+        return out;
+    }
+};
+
+inline void TransformVertices(Vertex* vertices, size_t count, const Affine& t) {
+    size_t i = 0;
+#ifdef PCD_TRANSFORM_SSE2
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "SSE path assumes px py pz nx ny nz u v");
+    const __m128 m0 = _mm_set1_ps(t.m[0]), m1 = _mm_set1_ps(t.m[1]), m2 = _mm_set1_ps(t.m[2]);
+    const __m128 m4 = _mm_set1_ps(t.m[4]), m5 = _mm_set1_ps(t.m[5]), m6 = _mm_set1_ps(t.m[6]);
+    const __m128 m8 = _mm_set1_ps(t.m[8]), m9 = _mm_set1_ps(t.m[9]), m10 = _mm_set1_ps(t.m[10]);
+    const __m128 m12 = _mm_set1_ps(t.m[12]), m13 = _mm_set1_ps(t.m[13]), m14 = _mm_set1_ps(t.m[14]);
+    const __m128 n0 = _mm_set1_ps(t.normal[0]), n1 = _mm_set1_ps(t.normal[1]), n2 = _mm_set1_ps(t.normal[2]);
+    const __m128 n3 = _mm_set1_ps(t.normal[3]), n4 = _mm_set1_ps(t.normal[4]), n5 = _mm_set1_ps(t.normal[5]);
+    const __m128 n6 = _mm_set1_ps(t.normal[6]), n7 = _mm_set1_ps(t.normal[7]), n8 = _mm_set1_ps(t.normal[8]);
+    const __m128 zero = _mm_setzero_ps();
+
+    if (t.translationOnly) {
+        // One add per vertex, no shuffles. Adding -0 leaves nx exactly as it
+        // was, and x + 1*... collapses to x + dx in the scalar path too.
+        const __m128 delta = _mm_setr_ps(t.m[12], t.m[13], t.m[14], -0.0f);
+        for (; i < count; i++) {
+            float* f = reinterpret_cast<float*>(vertices + i);
+            _mm_storeu_ps(f, _mm_add_ps(_mm_loadu_ps(f), delta));
+        }
+        return;
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        float* f = reinterpret_cast<float*>(vertices + i);
+        // Rows px py pz nx of four vertices become lanes x, y, z, nx
+        __m128 x = _mm_loadu_ps(f), y = _mm_loadu_ps(f + 8), z = _mm_loadu_ps(f + 16), nx = _mm_loadu_ps(f + 24);
+        _MM_TRANSPOSE4_PS(x, y, z, nx);
+
+        __m128 px = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_mul_ps(m8, z)), m12);
+        __m128 py = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_mul_ps(m9, z)), m13);
+        __m128 pz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_mul_ps(m10, z)), m14);
+
+        if (!t.moveNormals) {
+            _MM_TRANSPOSE4_PS(px, py, pz, nx);
+            _mm_storeu_ps(f, px);
+            _mm_storeu_ps(f + 8, py);
+            _mm_storeu_ps(f + 16, pz);
+            _mm_storeu_ps(f + 24, nx);
+            continue;
+        }
+
+        // Rows ny nz u v
+        __m128 ny = _mm_loadu_ps(f + 4), nz = _mm_loadu_ps(f + 12), u = _mm_loadu_ps(f + 20), v = _mm_loadu_ps(f + 28);
+        _MM_TRANSPOSE4_PS(ny, nz, u, v);
+
+        __m128 qx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n0, nx), _mm_mul_ps(n3, ny)), _mm_mul_ps(n6, nz));
+        __m128 qy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n1, nx), _mm_mul_ps(n4, ny)), _mm_mul_ps(n7, nz));
+        __m128 qz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n2, nx), _mm_mul_ps(n5, ny)), _mm_mul_ps(n8, nz));
+        if (t.renormalize) {
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+                                                   _mm_mul_ps(qz, qz)));
+            // Zero-length normals stay as they are, like the scalar path
+            __m128 valid = _mm_cmpgt_ps(length, zero);
+            __m128 divisor = _mm_or_ps(_mm_and_ps(valid, length), _mm_andnot_ps(valid, _mm_set1_ps(1.0f)));
+            qx = _mm_div_ps(qx, divisor);
+            qy = _mm_div_ps(qy, divisor);
+            qz = _mm_div_ps(qz, divisor);
+        }
+
+        _MM_TRANSPOSE4_PS(px, py, pz, qx);
+        _MM_TRANSPOSE4_PS(qy, qz, u, v);
+        _mm_storeu_ps(f, px);
+        _mm_storeu_ps(f + 4, qy);
+        _mm_storeu_ps(f + 8, py);
+        _mm_storeu_ps(f + 12, qz);
+        _mm_storeu_ps(f + 16, pz);
+        _mm_storeu_ps(f + 20, u);
+        _mm_storeu_ps(f + 24, qx);
+        _mm_storeu_ps(f + 28, v);
+    }
+#endif
+    for (; i < count; i++) {
+        vertices[i].position = t.Point(vertices[i].position);
+        vertices[i].normal = t.Normal(vertices[i].normal);
+    }
+}
+
+// Below this many vertices a selection is transformed on the calling thread
+constexpr size_t PARALLEL_TRANSFORM_VERTICES = 16384;
+
+// Applies t to brushes[i] for every i in indices (which must not repeat)
+// and keeps their cached bounds current
+inline void TransformBrushes(std::vector<Brush>& brushes, const std::vector<int>& indices, const Affine& t,
+                             unsigned threads = 0) {
+    size_t vertexTotal = 0;
+    for (int index : indices) vertexTotal += brushes[index].vertices.size();
+    if (vertexTotal < PARALLEL_TRANSFORM_VERTICES) threads = 1;
+
+    WorkerPool::Shared().ParallelFor(indices.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Brush& brush = brushes[indices[i]];
+            TransformVertices(brush.vertices.data(), brush.vertices.size(), t);
+            if (t.translationOnly) {
+                brush.TranslateBounds(t.TranslationPart());
+            } else {
+                brush.InvalidateBounds();
+            }
+        }
+    });
+}
+
+} // namespace PCD
+
+#endif // PCD_TRANSFORM_H
@@ -6,6 +6,10 @@
 #include <cstdint>
 #include <cmath>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include "PCDHash.h"
+#include "PCDStrings.h"
 
 namespace PCD {
 
@@ -55,6 +59,13 @@ enum EntityType : uint32_t {
     ENT_CUSTOM = 255,
 };
 
+// Pixel encoding of Texture::data
+enum TextureFormat : uint32_t {
+    TEXFMT_RAW = 0, // Uncompressed, Texture::channels bytes per pixel, single level
+    TEXFMT_BC1 = 1, // S3TC DXT1, opaque RGB, full mip chain
+    TEXFMT_BC3 = 2, // S3TC DXT5, RGBA, full mip chain
+};
+
 struct Vec3 {
     float x = 0, y = 0, z = 0;
     Vec3() = default;
@@ -107,6 +118,86 @@ struct Vec2 {
     Vec2(float u, float v) : u(u), v(v) {}
 };
 
+// Entity property value: the text as stored in the file, plus its number(s)
+// parsed once when the text is set. The text is owned rather than interned:
+// values are open-ended (targetnames, messages, coordinates) and the
+// interning table never frees anything. Brush and entity names are owned
+// strings for the same reason.
+class PropertyValue {
+public:
+    enum Type : uint8_t { STRING, INT, FLOAT, VEC3 };
+    
+    PropertyValue() = default;
+    explicit PropertyValue(std::string_view str) : text(str) { Parse(); }
+    
+    PropertyValue& operator=(std::string_view str) {
+        text = str;
+        Parse();
+        return *this;
+    }
+    
+    const std::string& Text() const { return text; }
+    Type GetType() const { return type; }
+    
+    int AsInt(int def = 0) const {
+        if (type == INT) return integer;
+        return type == FLOAT ? static_cast<int>(number.x) : def;
+    }
+    float AsFloat(float def = 0.0f) const { return type == INT || type == FLOAT ? number.x : def; }
+    Vec3 AsVec3(const Vec3& def = Vec3()) const { return type == VEC3 ? number : def; }
+    
+private:
+    // INT and FLOAT only when the whole text is one number, VEC3 for three
+    // whitespace-separated numbers; everything else stays a plain string
+    void Parse() {
+        type = STRING;
+        integer = 0;
+        number = Vec3();
+        const char* begin = text.c_str();
+        const char* end = begin + text.size();
+        if (begin == end) return;
+        
+        char* next = nullptr;
+        long i = std::strtol(begin, &next, 10);
+        if (next == end) {
+            type = INT;
+            integer = static_cast<int>(i);
+            number.x = static_cast<float>(i);
+            return;
+        }
+        
+        float values[3];
+        const char* cursor = begin;
+        int count = 0;
+        while (count < 3) {
+            values[count] = std::strtof(cursor, &next);
+            if (next == cursor) break;
+            count++;
+            cursor = next;
+        }
+        while (cursor != end && (*cursor == ' ' || *cursor == '\t')) cursor++;
+        if (cursor != end || count == 2) return;
+        
+        if (count == 1) {
+            type = FLOAT;
+            number.x = values[0];
+        } else if (count == 3) {
+            type = VEC3;
+            number = Vec3(values[0], values[1], values[2]);
+        }
+    }
+    
+    std::string text;
+    Type type = STRING;
+    int integer = 0;
+    Vec3 number; // x holds INT/FLOAT values
+};
+
+struct Property {
+    InternedString key;
+    PropertyValue value;
+};
+
 // Texture data embedded in map file
 struct Texture {
     uint32_t id = 0;
@@ -114,10 +205,42 @@ struct Texture {
     uint32_t width = 0;
     uint32_t height = 0;
     uint32_t channels = 4; // RGBA
-    std::vector<uint8_t> data; // Raw pixel data
+    std::vector<uint8_t> data; // Raw pixels, or every compressed mip level back to back
+    TextureFormat format = TEXFMT_RAW;
+    uint32_t mipCount = 1;
+    
+    // Deferred pixel source: where the blob lives in the map file when the
+    // map was loaded with LoadOptions::deferTextures (not saved)
+    struct Source {
+        std::string path;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+    mutable Source source;
     
     // Runtime OpenGL texture ID (not saved)
     mutable uint32_t glTextureID = 0;
+    
+    bool IsDeferred() const { return data.empty() && source.size > 0; }
+    uint64_t DataSize() const { return IsDeferred() ? source.size : data.size(); }
+    bool IsCompressed() const { return format != TEXFMT_RAW; }
+    
+    // Identity for deduplication: dimensions, encoding and pixel bytes
+    uint64_t ContentHash() const {
+        Hasher hasher;
+        hasher.UpdateValue(width);
+        hasher.UpdateValue(height);
+        hasher.UpdateValue(channels);
+        hasher.UpdateValue(format);
+        hasher.UpdateValue(mipCount);
+        hasher.Update(data.data(), data.size());
+        return hasher.Digest();
+    }
+    
+    bool SameContent(const Texture& other) const {
+        return width == other.width && height == other.height && channels == other.channels &&
+               format == other.format && mipCount == other.mipCount && data == other.data;
+    }
 };
 
 struct Vertex {
@@ -126,6 +249,96 @@ struct Vertex {
     Vec2 uv;
 };
 
+struct BrushBounds {
+    Vec3 min, max, center;
+    
+    static BrushBounds Of(const std::vector<Vertex>& vertices) {
+        BrushBounds bounds;
+        if (vertices.empty()) return bounds;
+        
+        bounds.min = bounds.max = vertices[0].position;
+        for (const auto& v : vertices) {
+            bounds.min.x = std::min(bounds.min.x, v.position.x);
+            bounds.min.y = std::min(bounds.min.y, v.position.y);
+            bounds.min.z = std::min(bounds.min.z, v.position.z);
+            bounds.max.x = std::max(bounds.max.x, v.position.x);
+            bounds.max.y = std::max(bounds.max.y, v.position.y);
+            bounds.max.z = std::max(bounds.max.z, v.position.z);
+        }
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        return bounds;
+    }
+};
+
+// View volume as six planes (a, b, c, d), with a*x + b*y + c*z + d >= 0 on
+// the inside
+struct Frustum {
+    enum Result { OUTSIDE, INTERSECTS, INSIDE };
+    
+    float planes[6][4];
+    
+    // From a column-major projection * view matrix (the renderer's layout).
+    // left..top narrow the sides to a rectangle in normalized device
+    // coordinates, e.g. a marquee on screen; the defaults keep the full view.
+    static Frustum FromViewProjection(const float* m, float left = -1, float right = 1,
+                                      float bottom = -1, float top = 1) {
+        auto row = [m](int i, float* out) {
+            out[0] = m[i]; out[1] = m[4 + i]; out[2] = m[8 + i]; out[3] = m[12 + i];
+        };
+        float x[4], y[4], z[4], w[4];
+        row(0, x);
+        row(1, y);
+        row(2, z);
+        row(3, w);
+        
+        Frustum frustum;
+        for (int k = 0; k < 4; k++) {
+            frustum.planes[0][k] = x[k] - left * w[k];   // x >= left * w
+            frustum.planes[1][k] = right * w[k] - x[k];  // x <= right * w
+            frustum.planes[2][k] = y[k] - bottom * w[k];
+            frustum.planes[3][k] = top * w[k] - y[k];
+            frustum.planes[4][k] = w[k] + z[k];          // Near
+            frustum.planes[5][k] = w[k] - z[k];          // Far
+        }
+        for (auto& plane : frustum.planes) {
+            float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0) {
+                for (float& v : plane) v /= length;
+            }
+        }
+        return frustum;
+    }
+    
+    // Same, from the view and projection matrices the renderer takes
+    static Frustum FromViewAndProjection(const float* view, const float* proj, float left = -1, float right = 1,
+                                         float bottom = -1, float top = 1) {
+        float m[16];
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                m[col*4 + row] = proj[row]*view[col*4] + proj[4 + row]*view[col*4 + 1] +
+                                 proj[8 + row]*view[col*4 + 2] + proj[12 + row]*view[col*4 + 3];
+            }
+        }
+        return FromViewProjection(m, left, right, bottom, top);
+    }
+    
+    // Conservative: a box near a corner may be reported as intersecting
+    // though it is outside
+    Result Classify(const Vec3& min, const Vec3& max) const {
+        Result result = INSIDE;
+        for (const auto& p : planes) {
+            // Box corners farthest along and against the plane normal
+            float farthest = p[0] * (p[0] >= 0 ? max.x : min.x) + p[1] * (p[1] >= 0 ? max.y : min.y) +
+                        p[2] * (p[2] >= 0 ? max.z : min.z) + p[3];
+            if (farthest < 0) return OUTSIDE;
+            float nearest = p[0] * (p[0] >= 0 ? min.x : max.x) + p[1] * (p[1] >= 0 ? min.y : max.y) +
+                         p[2] * (p[2] >= 0 ? min.z : max.z) + p[3];
+            if (nearest < 0) result = INTERSECTS;
+        }
+        return result;
+    }
+};
+
 struct Brush {
     uint32_t id = 0;
     std::vector<Vertex> vertices;
@@ -140,6 +353,32 @@ struct Brush {
     float uvScaleY = 1.0f;
     float uvOffsetX = 0.0f;
     float uvOffsetY = 0.0f;
+    
+    // Bounds of the vertices, computed on first use and cached. Code that
+    // edits vertices in place must call InvalidateBounds() afterwards, or
+    // TranslateBounds() when every vertex moved by the same delta.
+    const BrushBounds& GetBounds() const {
+        if (!boundsValid) {
+            bounds = BrushBounds::Of(vertices);
+            boundsValid = true;
+        }
+        return bounds;
+    }
+    
+    void InvalidateBounds() { boundsValid = false; }
+    
+    // Exact: float addition is monotonic, so min/max of the moved vertices
+    // are the old min/max plus delta
+    void TranslateBounds(const Vec3& delta) {
+        if (!boundsValid) return;
+        bounds.min = bounds.min + delta;
+        bounds.max = bounds.max + delta;
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+    }
+    
+    // Not part of the file or wire format (see Schema<Brush>)
+    mutable BrushBounds bounds;
+    mutable bool boundsValid = false;
 };
 
 struct Entity {
@@ -148,22 +387,374 @@ struct Entity {
     Vec3 position;
     Vec3 rotation;
     Vec3 scale{1, 1, 1};
-    std::vector<std::pair<std::string, std::string>> properties;
+    std::vector<Property> properties; // In file order
     std::string name;
     
-    std::string GetProperty(const std::string& key, const std::string& def = "") const {
-        for (const auto& [k, v] : properties) {
-            if (k == key) return v;
+    // Keys compare as interned pointers; string keys are looked up in the
+    // table once (without interning them) and then compared the same way
+    const PropertyValue* FindProperty(InternedString key) const {
+        for (const auto& prop : properties) {
+            if (prop.key == key) return &prop.value;
+        }
+        return nullptr;
+    }
+    
+    const PropertyValue* FindProperty(std::string_view key) const {
+        return FindProperty(InternedString::Find(key));
+    }
+    
+    std::string GetProperty(std::string_view key, const std::string& def = "") const {
+        const PropertyValue* value = FindProperty(key);
+        return value ? value->Text() : def;
+    }
+    
+    int GetInt(std::string_view key, int def = 0) const {
+        const PropertyValue* value = FindProperty(key);
+        return value ? value->AsInt(def) : def;
+    }
+    
+    float GetFloat(std::string_view key, float def = 0.0f) const {
+        const PropertyValue* value = FindProperty(key);
+        return value ? value->AsFloat(def) : def;
+    }
+    
+    Vec3 GetVec3(std::string_view key, const Vec3& def = Vec3()) const {
+        const PropertyValue* value = FindProperty(key);
+        return value ? value->AsVec3(def) : def;
+    }
+    
+    void SetProperty(std::string_view key, std::string_view value) {
+        InternedString k(key);
+        for (auto& prop : properties) {
+            if (prop.key == k) { prop.value = value; return; }
+        }
+        properties.push_back({k, PropertyValue(value)});
+    }
+    
+    // Same text the editor has always written (std::to_string)
+    void SetInt(std::string_view key, int value) { SetProperty(key, std::to_string(value)); }
+    void SetFloat(std::string_view key, float value) { SetProperty(key, std::to_string(value)); }
+};
+
+// Per-ID bookkeeping for brushes or entities. IDs come from files and the
+// network and can be anything, so they must not index a table directly;
+// this is an open-addressed table of (ID, value) slots instead, kept at most
+// half full so probe runs stay short. Values are default-constructed on
+// first use and stay until erased or cleared.
+template <typename V>
+class IDTable {
+public:
+    // nullptr when id was never added
+    V* Find(uint32_t id) {
+        if (slots.empty()) return nullptr;
+        Slot& slot = slots[Probe(id)];
+        return slot.used ? &slot.value : nullptr;
+    }
+    const V* Find(uint32_t id) const { return const_cast<IDTable*>(this)->Find(id); }
+
+    // Only adding a new ID can grow the table, so references to existing
+    // values stay valid across lookups of IDs already present
+    V& operator[](uint32_t id) {
+        if (!slots.empty()) {
+            size_t i = Probe(id);
+            if (slots[i].used) return slots[i].value;
+            if ((count + 1) * 2 <= slots.size()) return Add(i, id);
+        }
+        Grow(count + 1);
+        return Add(Probe(id), id);
+    }
+
+    void Reserve(size_t size) {
+        if (size * 2 > slots.size()) Grow(size);
+    }
+
+    void Erase(uint32_t id) {
+        if (slots.empty()) return;
+        size_t hole = Probe(id);
+        if (!slots[hole].used) return;
+        // Pull later entries of the probe run back into the hole, so every
+        // run stays unbroken between an entry's home slot and the entry
+        for (size_t i = (hole + 1) & mask; slots[i].used; i = (i + 1) & mask) {
+            size_t home = Home(slots[i].id);
+            if (((hole - home) & mask) < ((i - home) & mask)) {
+                slots[hole] = std::move(slots[i]);
+                hole = i;
+            }
+        }
+        slots[hole] = Slot();
+        count--;
+    }
+
+    // Keeps the slots allocated, so a table refilled over and over settles
+    // at its largest size
+    void Clear() {
+        if (count == 0) return;
+        for (Slot& slot : slots) slot = Slot();
+        count = 0;
+    }
+
+    size_t Size() const { return count; }
+
+    template <typename F>
+    void ForEach(F&& visit) {
+        for (Slot& slot : slots) {
+            if (slot.used) visit(slot.id, slot.value);
+        }
+    }
+
+private:
+    struct Slot {
+        uint32_t id = 0;
+        bool used = false;
+        V value = V();
+    };
+
+    // Fibonacci hashing: sequential IDs spread over the whole table
+    size_t Home(uint32_t id) const {
+        return static_cast<size_t>((uint64_t(id) * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }
+
+    V& Add(size_t i, uint32_t id) {
+        slots[i].used = true;
+        slots[i].id = id;
+        count++;
+        return slots[i].value;
+    }
+
+    // The slot holding id, or the free one where it would go; the table
+    // must not be empty
+    size_t Probe(uint32_t id) const {
+        size_t i = Home(id);
+        while (slots[i].used && slots[i].id != id) i = (i + 1) & mask;
+        return i;
+    }
+
+    void Grow(size_t size) {
+        size_t capacity = 16;
+        while (capacity < size * 2) capacity *= 2;
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.resize(capacity);
+        mask = capacity - 1;
+        for (Slot& slot : old) {
+            if (!slot.used) continue;
+            size_t i = Home(slot.id);
+            while (slots[i].used) i = (i + 1) & mask;
+            slots[i] = std::move(slot);
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+};
+
+// Entities by type, name and target linkage, for gameplay lookups that
+// would otherwise scan Map::entities. Buckets hold entity IDs in map order;
+// an ID resolves to its position in Map::entities through an IDTable, so
+// every lookup is a couple of hash probes. Map owns one and keeps it
+// current, see Map::GetEntityIndex.
+class EntityIndex {
+public:
+    static constexpr uint32_t NO_POSITION = UINT32_MAX;
+    static constexpr uint32_t NO_ENTITY = UINT32_MAX; // Spawn lookups on a map without spawns
+    
+    // Duplicate IDs: the first entity wins, as in MapPatcher
+    void Build(const std::vector<Entity>& entities) {
+        Clear();
+        entries.Reserve(entities.size());
+        for (size_t i = 0; i < entities.size(); i++) {
+            Entry& entry = entries[entities[i].id];
+            if (entry.position != NO_POSITION) continue;
+            entry.position = static_cast<uint32_t>(i);
+            Link(entities[i]);
         }
-        return def;
     }
     
-    void SetProperty(const std::string& key, const std::string& value) {
-        for (auto& [k, v] : properties) {
-            if (k == key) { v = value; return; }
+    void Clear() {
+        entries.Clear();
+        byType.clear();
+        byName.clear();
+        byTarget.clear();
+        byTargetName.clear();
+    }
+    
+    // entities[index] was just inserted
+    void Insert(const std::vector<Entity>& entities, size_t index) {
+        Renumber(entities, index + 1);
+        Entry& entry = entries[entities[index].id];
+        if (entry.position != NO_POSITION) return; // Duplicate ID, the earlier entity keeps it
+        entry.position = static_cast<uint32_t>(index);
+        Link(entities[index]);
+    }
+    
+    // entities[index] is about to be erased. Every later position moves
+    // down, whether or not the entity itself was indexed; when it held its
+    // ID, the next entity sharing that ID takes the ID over.
+    void Erase(const std::vector<Entity>& entities, size_t index) {
+        uint32_t id = entities[index].id;
+        bool indexed = Position(id) == index;
+        if (indexed) Unlink(id);
+        size_t heir = entities.size();
+        for (size_t i = index + 1; i < entities.size(); i++) {
+            if (entities[i].id == id && heir == entities.size()) heir = i;
+            Entry* entry = entries.Find(entities[i].id);
+            if (entry && entry->position == i) entry->position = static_cast<uint32_t>(i - 1);
+        }
+        if (!indexed) return;
+        entries.Erase(id);
+        if (heir == entities.size()) return;
+        entries[id].position = static_cast<uint32_t>(heir - 1);
+        Link(entities[heir]);
+    }
+    
+    // entities[index] had its type, name or target/targetname changed
+    void Update(const std::vector<Entity>& entities, size_t index) {
+        const Entity& ent = entities[index];
+        if (Position(ent.id) != index) return;
+        const Entry& entry = *entries.Find(ent.id);
+        if (entry.type == ent.type && entry.name == ent.name && entry.target == Target(ent) &&
+            entry.targetName == TargetName(ent)) {
+            return;
+        }
+        Unlink(ent.id);
+        Link(ent);
+    }
+    
+    // Position in Map::entities, or NO_POSITION
+    uint32_t Position(uint32_t id) const {
+        const Entry* entry = entries.Find(id);
+        return entry ? entry->position : NO_POSITION;
+    }
+    
+    const std::vector<uint32_t>& OfType(EntityType type) const { return Bucket(byType, type); }
+    const std::vector<uint32_t>& Named(std::string_view name) const {
+        return Bucket(byName, std::string(name));
+    }
+    // Entities whose "target" names the given targetname (who fires at it)
+    const std::vector<uint32_t>& Targeting(std::string_view targetName) const {
+        return Bucket(byTarget, std::string(targetName));
+    }
+    // Entities whose "targetname" is the given name (what a target hits)
+    const std::vector<uint32_t>& WithTargetName(std::string_view targetName) const {
+        return Bucket(byTargetName, std::string(targetName));
+    }
+    
+    // First spawn point in map order, player starts and deathmatch spawns
+    // alike
+    uint32_t FirstSpawn() const {
+        const std::vector<uint32_t>& starts = OfType(ENT_INFO_PLAYER_START);
+        const std::vector<uint32_t>& deathmatch = OfType(ENT_INFO_PLAYER_DEATHMATCH);
+        if (starts.empty()) return deathmatch.empty() ? NO_ENTITY : deathmatch.front();
+        if (deathmatch.empty()) return starts.front();
+        return Position(starts.front()) < Position(deathmatch.front()) ? starts.front() : deathmatch.front();
+    }
+    
+    // One of the spawn points, picked by random (any value, e.g. from an RNG)
+    uint32_t RandomSpawn(uint32_t random) const {
+        const std::vector<uint32_t>& starts = OfType(ENT_INFO_PLAYER_START);
+        const std::vector<uint32_t>& deathmatch = OfType(ENT_INFO_PLAYER_DEATHMATCH);
+        size_t count = starts.size() + deathmatch.size();
+        if (count == 0) return NO_ENTITY;
+        size_t pick = random % count;
+        return pick < starts.size() ? starts[pick] : deathmatch[pick - starts.size()];
+    }
+    
+private:
+    using TextBuckets = std::unordered_map<std::string, std::vector<uint32_t>>; // Names and values are not interned
+    
+    // The keys an entity was filed under, so it can be unfiled after edits
+    struct Entry {
+        uint32_t position = NO_POSITION;
+        EntityType type = ENT_INFO_PLAYER_START;
+        std::string name;
+        std::string target;
+        std::string targetName;
+    };
+    
+    static const InternedString& TargetKey() {
+        static const InternedString key("target");
+        return key;
+    }
+    
+    static const InternedString& TargetNameKey() {
+        static const InternedString key("targetname");
+        return key;
+    }
+    
+    static const std::string& Target(const Entity& ent) {
+        const PropertyValue* value = ent.FindProperty(TargetKey());
+        return value ? value->Text() : StringTable::Empty();
+    }
+    
+    static const std::string& TargetName(const Entity& ent) {
+        const PropertyValue* value = ent.FindProperty(TargetNameKey());
+        return value ? value->Text() : StringTable::Empty();
+    }
+    
+    template <typename Table, typename Key>
+    static const std::vector<uint32_t>& Bucket(const Table& buckets, const Key& key) {
+        static const std::vector<uint32_t> none;
+        auto it = buckets.find(key);
+        return it != buckets.end() ? it->second : none;
+    }
+    
+    void Link(const Entity& ent) {
+        Entry& entry = *entries.Find(ent.id);
+        entry.type = ent.type;
+        entry.name = ent.name;
+        entry.target = Target(ent);
+        entry.targetName = TargetName(ent);
+        Add(byType[ent.type], ent.id);
+        if (!entry.name.empty()) Add(byName[entry.name], ent.id);
+        if (!entry.target.empty()) Add(byTarget[entry.target], ent.id);
+        if (!entry.targetName.empty()) Add(byTargetName[entry.targetName], ent.id);
+    }
+    
+    void Unlink(uint32_t id) {
+        const Entry& entry = *entries.Find(id);
+        Remove(byType, entry.type, id);
+        Remove(byName, entry.name, id);
+        Remove(byTarget, entry.target, id);
+        Remove(byTargetName, entry.targetName, id);
+    }
+    
+    // Buckets stay sorted by position; appends are the common case
+    void Add(std::vector<uint32_t>& bucket, uint32_t id) {
+        uint32_t position = Position(id);
+        auto it = std::lower_bound(bucket.begin(), bucket.end(), position,
+                                   [&](uint32_t other, uint32_t pos) { return Position(other) < pos; });
+        bucket.insert(it, id);
+    }
+    
+    template <typename Table, typename Key>
+    static void Remove(Table& buckets, const Key& key, uint32_t id) {
+        auto it = buckets.find(key);
+        if (it == buckets.end()) return;
+        auto& bucket = it->second;
+        bucket.erase(std::remove(bucket.begin(), bucket.end(), id), bucket.end());
+        if (bucket.empty()) buckets.erase(it);
+    }
+    
+    // Positions from entities[from] on moved up by one
+    void Renumber(const std::vector<Entity>& entities, size_t from) {
+        for (size_t i = entities.size(); i-- > from;) {
+            Entry* entry = entries.Find(entities[i].id);
+            if (entry && entry->position == i - 1) entry->position = static_cast<uint32_t>(i);
         }
-        properties.push_back({key, value});
     }
+    
+    IDTable<Entry> entries; // Entity ID -> position and filed keys
+    std::unordered_map<uint32_t, std::vector<uint32_t>> byType;
+    TextBuckets byName;
+    TextBuckets byTarget;
+    TextBuckets byTargetName;
+};
+
+struct TextureDedupeStats {
+    uint32_t texturesRemoved = 0;
+    uint32_t brushesRemapped = 0;
+    uint64_t bytesSaved = 0;
 };
 
 struct Map {
@@ -176,23 +767,161 @@ struct Map {
     uint32_t nextEntityID = 1;
     uint32_t nextTextureID = 1;
     
+    // Content hash -> texture ID (runtime only, rebuilt on demand)
+    std::unordered_map<uint64_t, uint32_t> textureIndex;
+    bool textureIndexValid = false;
+    uint64_t textureBytesDeduped = 0; // Pixel bytes not stored thanks to dedupe
+    
+    // Entity lookups (runtime only). Built on first use and patched by
+    // AddEntity/RemoveEntity/EntityChanged; code that rewrites entities some
+    // other way calls InvalidateEntityIndex().
+    mutable EntityIndex entityIndex;
+    mutable bool entityIndexValid = false;
+    
     void Clear() {
         brushes.clear();
         entities.clear();
         textures.clear();
+        textureIndex.clear();
+        textureIndexValid = false;
+        entityIndex.Clear();
+        entityIndexValid = false;
+        textureBytesDeduped = 0;
         nextBrushID = 1;
         nextEntityID = 1;
         nextTextureID = 1;
     }
     
-    // Texture management
+    // Texture management. Adding pixels identical to an existing texture
+    // returns that texture's ID instead of storing a second copy.
     uint32_t AddTexture(const Texture& tex) {
+        if (!textureIndexValid) RebuildTextureIndex();
+        
+        uint64_t hash = tex.ContentHash();
+        auto it = textureIndex.find(hash);
+        if (it != textureIndex.end() && !tex.data.empty()) {
+            const Texture* existing = GetTexture(it->second);
+            if (existing && existing->SameContent(tex)) {
+                textureBytesDeduped += tex.data.size();
+                return existing->id;
+            }
+        }
+        
         Texture newTex = tex;
         newTex.id = nextTextureID++;
         textures[newTex.id] = newTex;
+        if (!newTex.data.empty()) textureIndex[hash] = newTex.id;
         return newTex.id;
     }
     
+    // Call after changing a texture's pixels in place
+    void InvalidateTextureIndex() { textureIndexValid = false; }
+    
+    // Deferred textures (pixels still on disk) are left out
+    void RebuildTextureIndex() {
+        textureIndex.clear();
+        for (const auto& [id, tex] : textures) {
+            if (tex.data.empty()) continue;
+            auto result = textureIndex.emplace(tex.ContentHash(), id);
+            // Keep the lowest ID so the index is stable across rebuilds
+            if (!result.second && id < result.first->second) result.first->second = id;
+        }
+        textureIndexValid = true;
+    }
+    
+    // Texture ID -> lowest ID with identical content, for every texture that
+    // DedupeTextures would remove
+    std::unordered_map<uint32_t, uint32_t> FindDuplicateTextures() const {
+        std::vector<uint32_t> ids;
+        ids.reserve(textures.size());
+        for (const auto& [id, tex] : textures) {
+            if (!tex.data.empty()) ids.push_back(id);
+        }
+        std::sort(ids.begin(), ids.end());
+        
+        std::unordered_map<uint64_t, std::vector<uint32_t>> byHash;
+        std::unordered_map<uint32_t, uint32_t> remap;
+        for (uint32_t id : ids) {
+            const Texture& tex = textures.at(id);
+            std::vector<uint32_t>& group = byHash[tex.ContentHash()];
+            
+            uint32_t keep = 0;
+            for (uint32_t candidate : group) {
+                if (textures.at(candidate).SameContent(tex)) { keep = candidate; break; }
+            }
+            if (keep == 0) {
+                group.push_back(id);
+                continue;
+            }
+            remap[id] = keep;
+        }
+        return remap;
+    }
+    
+    // Collapses textures with identical content onto the lowest ID and points
+    // every brush at the survivor
+    TextureDedupeStats DedupeTextures() {
+        TextureDedupeStats result;
+        std::unordered_map<uint32_t, uint32_t> remap = FindDuplicateTextures();
+        for (const auto& [from, to] : remap) {
+            result.texturesRemoved++;
+            result.bytesSaved += textures[from].data.size();
+        }
+        
+        if (!remap.empty()) {
+            for (auto& brush : brushes) {
+                auto it = remap.find(brush.textureID);
+                if (it != remap.end()) {
+                    brush.textureID = it->second;
+                    result.brushesRemapped++;
+                }
+            }
+            for (const auto& [from, to] : remap) textures.erase(from);
+        }
+        
+        textureBytesDeduped += result.bytesSaved;
+        RebuildTextureIndex();
+        return result;
+    }
+    
+    const EntityIndex& GetEntityIndex() const {
+        if (!entityIndexValid) RebuildEntityIndex();
+        return entityIndex;
+    }
+    
+    void InvalidateEntityIndex() { entityIndexValid = false; }
+    
+    void RebuildEntityIndex() const {
+        entityIndex.Build(entities);
+        entityIndexValid = true;
+    }
+    
+    Entity& AddEntity(Entity ent) {
+        entities.push_back(std::move(ent));
+        if (entityIndexValid) entityIndex.Insert(entities, entities.size() - 1);
+        return entities.back();
+    }
+    
+    void RemoveEntity(size_t index) {
+        if (entityIndexValid) entityIndex.Erase(entities, index);
+        entities.erase(entities.begin() + index);
+    }
+    
+    // Call after changing an entity's type, name, target or targetname
+    void EntityChanged(size_t index) {
+        if (entityIndexValid) entityIndex.Update(entities, index);
+    }
+    
+    Entity* GetEntity(uint32_t id) {
+        uint32_t position = GetEntityIndex().Position(id);
+        return position != EntityIndex::NO_POSITION ? &entities[position] : nullptr;
+    }
+    
+    const Entity* GetEntity(uint32_t id) const {
+        uint32_t position = GetEntityIndex().Position(id);
+        return position != EntityIndex::NO_POSITION ? &entities[position] : nullptr;
+    }
+    
     Texture* GetTexture(uint32_t id) {
         auto it = textures.find(id);
         return (it != textures.end()) ? &it->second : nullptr;
@@ -0,0 +1,457 @@
+#ifndef PCD_UNDO_H
+#define PCD_UNDO_H
+
+// Undo history made of per-edit deltas.
+//
+// An edit opens a step with Begin() and touches (Touch*) every brush,
+// entity or texture it is about to modify or delete, before changing it.
+// Objects the edit creates need no call; Commit() finds them by comparing
+// ID lists. A step holds the slots it changed on both sides (ID and array
+// position before and after the edit) and the contents of whichever side
+// is not in the map right now. Undo and redo swap those contents with the
+// map, so one copy of each changed object serves as both the forward and
+// the inverse delta, and the rest of the map is never copied.
+//
+// History is bounded by the bytes the steps hold, not by a step count.
+
+#include "PCDTypes.h"
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace PCD {
+
+class UndoHistory {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 256u << 20;
+
+    explicit UndoHistory(size_t budget = DEFAULT_BUDGET) : budget(budget) {}
+
+    // Opens a step, committing the previous one. Nothing is copied yet.
+    void Begin(const Map& map) {
+        Commit(map);
+        open = true;
+        pending = Pending();
+        pending.info = InfoOf(map);
+        pending.brushOrder = IDsOf(map.brushes);
+        pending.entityOrder = IDsOf(map.entities);
+        pending.textureIDs.reserve(map.textures.size());
+        for (const auto& [id, tex] : map.textures) pending.textureIDs.push_back(id);
+    }
+
+    // Call before modifying or deleting map.brushes[index]
+    void TouchBrush(const Map& map, size_t index) {
+        if (open && index < map.brushes.size()) pending.brushes.emplace(map.brushes[index].id, Touched<Brush>{uint32_t(index), map.brushes[index]});
+    }
+
+    void TouchEntity(const Map& map, size_t index) {
+        if (open && index < map.entities.size()) {
+            pending.entities.emplace(map.entities[index].id, Touched<Entity>{uint32_t(index), map.entities[index]});
+        }
+    }
+
+    void TouchTexture(const Map& map, uint32_t id) {
+        const Texture* tex = map.GetTexture(id);
+        if (open && tex) pending.textures.emplace(id, *tex);
+    }
+
+    // For edits that may rewrite anything (new map, texture dedupe)
+    void TouchAll(const Map& map) {
+        for (size_t i = 0; i < map.brushes.size(); i++) TouchBrush(map, i);
+        for (size_t i = 0; i < map.entities.size(); i++) TouchEntity(map, i);
+        for (const auto& [id, tex] : map.textures) TouchTexture(map, id);
+    }
+
+    // Closes the open step. Steps that changed nothing are dropped.
+    void Commit(const Map& map) {
+        if (!open) return;
+        open = false;
+
+        Step step;
+        step.info = pending.info;
+        bool changed = Diff(pending.brushOrder, pending.brushes, map.brushes, step.brushes, "brush");
+        changed |= Diff(pending.entityOrder, pending.entities, map.entities, step.entities, "entity");
+        changed |= DiffTextures(map, step.textures);
+        changed |= !SameInfo(step.info, InfoOf(map));
+        pending = Pending();
+        if (!changed) return;
+
+        step.bytes = Bytes(step);
+        while (steps.size() > cursor) Drop(steps.size() - 1);
+        steps.push_back(std::move(step));
+        cursor++;
+        bytesUsed += steps.back().bytes;
+        Trim();
+    }
+
+    bool Undo(Map& map) {
+        Commit(map);
+        if (cursor == 0) return false;
+        Swap(steps[--cursor], map);
+        return true;
+    }
+
+    bool Redo(Map& map) {
+        Commit(map);
+        if (cursor == steps.size()) return false;
+        Swap(steps[cursor++], map);
+        Trim();
+        return true;
+    }
+
+    // An open step counts: committing it makes it undoable
+    bool CanUndo() const { return cursor > 0 || open; }
+    bool CanRedo() const { return cursor < steps.size(); }
+
+    void Clear() {
+        steps.clear();
+        cursor = 0;
+        bytesUsed = 0;
+        open = false;
+        pending = Pending();
+        lastChanged = Changed();
+    }
+
+    void SetBudget(size_t bytes) {
+        budget = bytes;
+        Trim();
+    }
+
+    size_t Budget() const { return budget; }
+    size_t MemoryUsed() const { return bytesUsed; }
+    size_t UndoCount() const { return cursor; }
+    size_t RedoCount() const { return steps.size() - cursor; }
+
+    // IDs the last Undo or Redo put back, took out or replaced (an ID can
+    // be listed twice), so caches keyed by ID can update just those
+    struct Changed {
+        std::vector<uint32_t> brushes;
+        std::vector<uint32_t> entities;
+        std::vector<uint32_t> textures;
+    };
+
+    const Changed& LastChanged() const { return lastChanged; }
+
+    // Whether a texture kept for undo or redo carries this GL name, so
+    // undoing could put it back in the map
+    bool HoldsGLTexture(uint32_t glTextureID) const {
+        for (const Step& step : steps) {
+            for (const Texture& tex : step.textures.stored) {
+                if (tex.glTextureID == glTextureID) return true;
+            }
+        }
+        for (const auto& [id, tex] : pending.textures) {
+            if (tex.glTextureID == glTextureID) return true;
+        }
+        return false;
+    }
+
+private:
+    // Where an object sits on one side of a step
+    struct Slot {
+        uint32_t id;
+        uint32_t index;
+    };
+
+    // slots[BEFORE] and slots[AFTER] are sorted by index; stored holds the
+    // contents of the side that is not currently in the map, in slot order
+    template <typename T>
+    struct Delta {
+        std::vector<Slot> slots[2];
+        std::vector<T> stored;
+    };
+
+    struct Info {
+        std::string name;
+        std::string author;
+        uint32_t nextBrushID = 1;
+        uint32_t nextEntityID = 1;
+        uint32_t nextTextureID = 1;
+    };
+
+    struct Step {
+        Delta<Brush> brushes;
+        Delta<Entity> entities;
+        Delta<Texture> textures; // Slot index unused, textures are keyed by ID
+        Info info;               // Also the side not in the map
+        size_t bytes = 0;
+        bool undone = false;     // Which side stored holds: BEFORE while committed, AFTER once undone
+    };
+
+    template <typename T>
+    struct Touched {
+        uint32_t index; // Position when touched
+        T object;
+    };
+
+    struct Pending {
+        Info info;
+        std::vector<uint32_t> brushOrder;
+        std::vector<uint32_t> entityOrder;
+        std::vector<uint32_t> textureIDs;
+        std::unordered_map<uint32_t, Touched<Brush>> brushes; // As they were before the edit
+        std::unordered_map<uint32_t, Touched<Entity>> entities;
+        std::unordered_map<uint32_t, Texture> textures;
+    };
+
+    static constexpr int BEFORE = 0;
+    static constexpr int AFTER = 1;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    template <typename T>
+    static std::vector<uint32_t> IDsOf(const std::vector<T>& objects) {
+        std::vector<uint32_t> ids(objects.size());
+        for (size_t i = 0; i < objects.size(); i++) ids[i] = objects[i].id;
+        return ids;
+    }
+
+    static Info InfoOf(const Map& map) {
+        return {map.name, map.author, map.nextBrushID, map.nextEntityID, map.nextTextureID};
+    }
+
+    static bool SameInfo(const Info& a, const Info& b) {
+        return a.name == b.name && a.author == b.author && a.nextBrushID == b.nextBrushID &&
+               a.nextEntityID == b.nextEntityID && a.nextTextureID == b.nextTextureID;
+    }
+
+    // Fills delta with the touched and added objects of one array (removed
+    // ones were touched first). Untouched objects that vanished cannot be
+    // restored and are reported.
+    template <typename T>
+    bool Diff(const std::vector<uint32_t>& before, const std::unordered_map<uint32_t, Touched<T>>& touched,
+              const std::vector<T>& after, Delta<T>& delta, const char* kind) {
+        // Most edits only modify objects in place: same IDs in the same order
+        bool sameOrder = before.size() == after.size();
+        for (size_t i = 0; sameOrder && i < after.size(); i++) sameOrder = before[i] == after[i].id;
+        if (sameOrder) {
+            std::vector<std::pair<uint32_t, const T*>> changed;
+            for (const auto& [id, entry] : touched) {
+                uint32_t i = entry.index;
+                if (i >= after.size() || after[i].id != id) {
+                    i = uint32_t(std::find(before.begin(), before.end(), id) - before.begin());
+                    if (i == before.size()) continue; // Added and touched within the edit
+                }
+                changed.emplace_back(i, &entry.object);
+            }
+            std::sort(changed.begin(), changed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (const auto& [i, object] : changed) {
+                delta.slots[BEFORE].push_back({before[i], i});
+                delta.slots[AFTER].push_back({before[i], i});
+                delta.stored.push_back(*object);
+            }
+            return !changed.empty();
+        }
+
+        // Pair the two sides up by position, matching IDs through an IDTable
+        // (kept between commits); only the per-position results are stored
+        // densely.
+        IDTable<uint32_t>& beforePosition = diffPositions;
+        beforePosition.Clear();
+        beforePosition.Reserve(before.size());
+        for (uint32_t i = 0; i < before.size(); i++) beforePosition[before[i]] = i;
+        std::vector<uint32_t> afterIndex(before.size(), NONE);
+        std::vector<uint8_t> wasPresent(after.size(), 0);
+        for (uint32_t i = 0; i < after.size(); i++) {
+            if (const uint32_t* position = beforePosition.Find(after[i].id)) {
+                afterIndex[*position] = i;
+                wasPresent[i] = 1;
+            }
+        }
+
+        // Objects on both sides must keep their relative order, otherwise
+        // positions alone can't replay the edit and every slot is recorded
+        bool reordered = false;
+        size_t b = 0;
+        for (uint32_t i = 0; i < after.size(); i++) {
+            if (!wasPresent[i]) continue;
+            while (b < before.size() && afterIndex[b] == NONE) b++;
+            if (b == before.size() || before[b] != after[i].id) { reordered = true; break; }
+            b++;
+        }
+
+        for (uint32_t i = 0; i < before.size(); i++) {
+            uint32_t id = before[i];
+            auto it = touched.find(id);
+            if (it != touched.end()) {
+                delta.slots[BEFORE].push_back({id, i});
+                delta.stored.push_back(it->second.object);
+            } else if (afterIndex[i] == NONE) {
+                std::cerr << "[PCD] Undo: " << kind << " " << id << " was removed without being touched\n";
+            } else if (reordered) {
+                // Moved but untouched, so its contents did not change
+                delta.slots[BEFORE].push_back({id, i});
+                delta.stored.push_back(after[afterIndex[i]]);
+            }
+        }
+        for (uint32_t i = 0; i < after.size(); i++) {
+            uint32_t id = after[i].id;
+            if (reordered || touched.count(id) || !wasPresent[i]) delta.slots[AFTER].push_back({id, i});
+        }
+        return !delta.slots[BEFORE].empty() || !delta.slots[AFTER].empty();
+    }
+
+    bool DiffTextures(const Map& map, Delta<Texture>& delta) const {
+        for (uint32_t id : pending.textureIDs) {
+            auto it = pending.textures.find(id);
+            if (it != pending.textures.end()) {
+                delta.slots[BEFORE].push_back({id, 0});
+                delta.stored.push_back(it->second);
+            } else if (!map.GetTexture(id)) {
+                std::cerr << "[PCD] Undo: texture " << id << " was removed without being touched\n";
+            }
+        }
+        std::vector<uint32_t> existed = pending.textureIDs;
+        std::sort(existed.begin(), existed.end());
+        for (const auto& [id, tex] : map.textures) {
+            if (pending.textures.count(id) || !std::binary_search(existed.begin(), existed.end(), id)) {
+                delta.slots[AFTER].push_back({id, 0});
+            }
+        }
+        return !delta.slots[BEFORE].empty() || !delta.slots[AFTER].empty();
+    }
+
+    // Position of slot.id, trusting slot.index when it still holds that ID
+    template <typename T>
+    static size_t Locate(const std::vector<T>& objects, const Slot& slot) {
+        if (slot.index < objects.size() && objects[slot.index].id == slot.id) return slot.index;
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (objects[i].id == slot.id) return i;
+        }
+        return objects.size();
+    }
+
+    static std::unordered_set<uint32_t> IDsOf(const std::vector<Slot>& slots) {
+        std::unordered_set<uint32_t> ids;
+        ids.reserve(slots.size());
+        for (const Slot& slot : slots) ids.insert(slot.id);
+        return ids;
+    }
+
+    // Moves the map from side `from` to the other side, leaving `from`'s
+    // contents in delta.stored
+    template <typename T>
+    static void Apply(Delta<T>& delta, std::vector<T>& objects, int from) {
+        const std::vector<Slot>& out = delta.slots[from];
+        const std::vector<Slot>& in = delta.slots[1 - from];
+        std::unordered_set<uint32_t> outIDs = IDsOf(out);
+        std::unordered_set<uint32_t> inIDs = IDsOf(in);
+
+        std::vector<T> outgoing;
+        std::vector<size_t> erase;
+        outgoing.reserve(out.size());
+        for (const Slot& slot : out) {
+            size_t i = Locate(objects, slot);
+            outgoing.push_back(i < objects.size() ? std::move(objects[i]) : T());
+            if (i < objects.size() && !inIDs.count(slot.id)) erase.push_back(i);
+        }
+        std::sort(erase.rbegin(), erase.rend());
+        for (size_t i : erase) objects.erase(objects.begin() + i);
+
+        for (size_t k = 0; k < in.size(); k++) {
+            if (outIDs.count(in[k].id)) continue;
+            size_t at = std::min<size_t>(in[k].index, objects.size());
+            objects.insert(objects.begin() + at, std::move(delta.stored[k]));
+        }
+        // Slots on both sides now sit at their target positions (a reorder
+        // records every slot, so positions are right even then)
+        for (size_t k = 0; k < in.size(); k++) {
+            if (outIDs.count(in[k].id) && in[k].index < objects.size()) objects[in[k].index] = std::move(delta.stored[k]);
+        }
+        delta.stored = std::move(outgoing);
+    }
+
+    static void ApplyTextures(Delta<Texture>& delta, std::unordered_map<uint32_t, Texture>& textures, int from) {
+        std::vector<Texture> outgoing;
+        outgoing.reserve(delta.slots[from].size());
+        for (const Slot& slot : delta.slots[from]) {
+            auto it = textures.find(slot.id);
+            outgoing.push_back(it != textures.end() ? std::move(it->second) : Texture());
+            textures.erase(slot.id);
+        }
+        for (size_t k = 0; k < delta.slots[1 - from].size(); k++) {
+            textures[delta.slots[1 - from][k].id] = std::move(delta.stored[k]);
+        }
+        delta.stored = std::move(outgoing);
+    }
+
+    template <typename T>
+    static void ChangedIDs(const Delta<T>& delta, std::vector<uint32_t>& ids) {
+        ids.clear();
+        for (const std::vector<Slot>& side : delta.slots) {
+            for (const Slot& slot : side) ids.push_back(slot.id);
+        }
+    }
+
+    void Swap(Step& step, Map& map) {
+        int from = step.undone ? BEFORE : AFTER;
+        ChangedIDs(step.brushes, lastChanged.brushes);
+        ChangedIDs(step.entities, lastChanged.entities);
+        ChangedIDs(step.textures, lastChanged.textures);
+        Apply(step.brushes, map.brushes, from);
+        Apply(step.entities, map.entities, from);
+        ApplyTextures(step.textures, map.textures, from);
+
+        Info current = InfoOf(map);
+        map.name = step.info.name;
+        map.author = step.info.author;
+        map.nextBrushID = step.info.nextBrushID;
+        map.nextEntityID = step.info.nextEntityID;
+        map.nextTextureID = step.info.nextTextureID;
+        step.info = std::move(current);
+        step.undone = !step.undone;
+
+        if (!step.entities.slots[BEFORE].empty() || !step.entities.slots[AFTER].empty()) map.InvalidateEntityIndex();
+        if (!step.textures.slots[BEFORE].empty() || !step.textures.slots[AFTER].empty()) map.InvalidateTextureIndex();
+
+        bytesUsed -= step.bytes;
+        step.bytes = Bytes(step);
+        bytesUsed += step.bytes;
+    }
+
+    static size_t Bytes(const Brush& brush) {
+        return sizeof(Brush) + brush.vertices.size() * sizeof(Vertex) + brush.indices.size() * sizeof(uint32_t);
+    }
+
+    static size_t Bytes(const Entity& ent) { return sizeof(Entity) + ent.properties.size() * sizeof(Property); }
+    static size_t Bytes(const Texture& tex) { return sizeof(Texture) + tex.data.size(); }
+
+    template <typename T>
+    static size_t Bytes(const Delta<T>& delta) {
+        size_t bytes = (delta.slots[BEFORE].size() + delta.slots[AFTER].size()) * sizeof(Slot);
+        for (const T& obj : delta.stored) bytes += Bytes(obj);
+        return bytes;
+    }
+
+    static size_t Bytes(const Step& step) {
+        return sizeof(Step) + Bytes(step.brushes) + Bytes(step.entities) + Bytes(step.textures) +
+               step.info.name.size() + step.info.author.size();
+    }
+
+    void Drop(size_t index) {
+        bytesUsed -= steps[index].bytes;
+        steps.erase(steps.begin() + index);
+    }
+
+    // Oldest steps go first; the most recent undo step is always kept
+    void Trim() {
+        while (bytesUsed > budget && cursor > 1) {
+            Drop(0);
+            cursor--;
+        }
+        while (bytesUsed > budget && steps.size() > cursor && steps.size() > 1) Drop(steps.size() - 1);
+    }
+
+    std::deque<Step> steps; // [0, cursor) can be undone, [cursor, size) redone
+    size_t cursor = 0;
+    size_t bytesUsed = 0;
+    size_t budget;
+    bool open = false;
+    Pending pending;
+    Changed lastChanged;
+    IDTable<uint32_t> diffPositions; // Scratch for Diff, kept so its slots are not allocated anew each commit
+};
+
+} // namespace PCD
+
+#endif // PCD_UNDO_H
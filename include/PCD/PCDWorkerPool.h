@@ -0,0 +1,133 @@
+#ifndef PCD_WORKER_POOL_H
+#define PCD_WORKER_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+namespace PCD {
+
+// Small persistent thread pool used for bulk map work (file encode/decode,
+// geometry transforms). The calling thread always helps with its own jobs.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threadCount = 0) {
+        if (threadCount == 0) threadCount = DefaultThreadCount();
+        // The caller participates, so one fewer background thread is enough
+        for (unsigned i = 1; i < threadCount; i++) {
+            workers.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Runs fn(begin, end) over [0, count) split into at most maxThreads
+    // contiguous ranges, and returns once every range has finished.
+    void ParallelFor(size_t count, unsigned maxThreads, const std::function<void(size_t, size_t)>& fn) {
+        if (count == 0) return;
+        if (maxThreads == 0) maxThreads = ThreadCount();
+        size_t chunks = std::min<size_t>(count, std::min(maxThreads, ThreadCount()));
+        if (chunks <= 1) {
+            fn(0, count);
+            return;
+        }
+
+        // Counter is only touched under doneMutex so the caller cannot leave
+        // (and destroy these locals) while a worker is still signalling
+        size_t remaining = chunks;
+        std::mutex doneMutex;
+        std::condition_variable done;
+
+        auto runChunk = [&, count, chunks](size_t c) {
+            size_t begin = count * c / chunks;
+            size_t end = count * (c + 1) / chunks;
+            fn(begin, end);
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--remaining == 0) done.notify_all();
+        };
+        auto finished = [&] {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            return remaining == 0;
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t c = 1; c < chunks; c++) {
+                jobs.push_back([&runChunk, c] { runChunk(c); });
+            }
+        }
+        wake.notify_all();
+
+        runChunk(0);
+
+        // Help drain the queue instead of idling while others work
+        while (!finished()) {
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!jobs.empty()) {
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+            }
+            if (job) {
+                job();
+            } else {
+                std::unique_lock<std::mutex> lock(doneMutex);
+                done.wait(lock, [&] { return remaining == 0; });
+            }
+        }
+    }
+
+    // Process-wide pool sized to the machine
+    static WorkerPool& Shared() {
+        static WorkerPool pool(DefaultThreadCount());
+        return pool;
+    }
+
+    static unsigned DefaultThreadCount() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n > 0 ? n : 1;
+    }
+
+private:
+    void WorkerLoop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+} // namespace PCD
+
+#endif // PCD_WORKER_POOL_H
@@ -22,7 +22,8 @@ EditorApp::EditorApp()
       cameraFOV(60.0f), cameraMoveSpeed(10.0f), cameraRotateSpeed(0.005f),
       cameraZoomSpeed(2.0f), shiftPressed(false), dragAccumX(0), dragAccumZ(0),
       isLeftDragging(false), isRightDragging(false), isMiddleDragging(false),
-      isAltPressed(false), lastX(640), lastY(360), firstMouse(true),
+      isAltPressed(false), isMarqueeSelecting(false), marqueeStartX(0), marqueeStartY(0),
+      lastX(640), lastY(360), firstMouse(true),
       lastFrame(0), deltaTime(0) {}
 
 EditorApp::~EditorApp() { Shutdown(); }
@@ -85,8 +86,8 @@ bool EditorApp::Initialize(int width, int height, const char *title) {
 
     mapEditor = new MapEditor();
 
-    // Create default floor
-    if (mapEditor->GetMap().brushes.empty()) {
+    // Create default floor, unless an unsaved map came back from its journal
+    if (!mapEditor->RecoverAutoSave() && mapEditor->GetMap().brushes.empty()) {
         PCD::Brush floor = mapEditor->CreateBox(PCD::Vec3(-20, -1, -20), PCD::Vec3(20, 0, 20));
         floor.name = "Floor";
         floor.color = PCD::Vec3(0.6f, 0.6f, 0.6f);
@@ -97,10 +98,11 @@ bool EditorApp::Initialize(int width, int height, const char *title) {
         spawn.type = PCD::ENT_INFO_PLAYER_START;
         spawn.position = PCD::Vec3(0, 0.1f, 0);
         spawn.name = "PlayerSpawn";
-        mapEditor->GetMap().entities.push_back(spawn);
+        mapEditor->GetMap().AddEntity(spawn);
     }
 
-    TextureLoader::LoadMapTextures(mapEditor->GetMap());
+    // Checkerboards first; the real pixels stream in from the map file
+    TextureLoader::LoadMapTextures(mapEditor->GetMap(), true);
 
     return true;
 }
@@ -115,6 +117,8 @@ void EditorApp::Run() {
 
         ProcessInput(deltaTime);
         UpdateCamera(deltaTime);
+        // One texture per frame, as in game mode
+        TextureLoader::StreamMapTextures(mapEditor->GetMap(), 1);
         Render();
 
         glfwSwapBuffers(window);
@@ -203,11 +207,14 @@ void EditorApp::ProcessInput(float dt) {
                     for (auto& v : brush.vertices) {
                         v.position = v.position + delta;
                     }
+                    brush.TranslateBounds(delta);
+                    mapEditor->BrushChanged(mapEditor->GetSelectedBrushIndex());
                     mapEditor->SetUnsavedChanges(true);
                 }
                 if (mapEditor->GetSelectedEntityIndex() >= 0) {
                     auto& ent = mapEditor->GetMap().entities[mapEditor->GetSelectedEntityIndex()];
                     ent.position = ent.position + delta;
+                    mapEditor->EntityChanged(mapEditor->GetSelectedEntityIndex());
                     mapEditor->SetUnsavedChanges(true);
                 }
             }
@@ -257,16 +264,7 @@ void EditorApp::ProcessInput(float dt) {
                 if (mapEditor->GetSelectedBrushIndex() >= 0) {
                     auto& brush = mapEditor->GetMap().brushes[mapEditor->GetSelectedBrushIndex()];
                     
-                    // Calculate brush center
-                    PCD::Vec3 center(0, 0, 0);
-                    for (auto& v : brush.vertices) {
-                        center.x += v.position.x;
-                        center.y += v.position.y;
-                        center.z += v.position.z;
-                    }
-                    center.x /= brush.vertices.size();
-                    center.y /= brush.vertices.size();
-                    center.z /= brush.vertices.size();
+                    PCD::Vec3 center = brush.GetBounds().center;
                     
                     // Scale from center
                     for (auto& v : brush.vertices) {
@@ -276,6 +274,8 @@ void EditorApp::ProcessInput(float dt) {
                         offset.z *= scaleDelta.z;
                         v.position = center + offset;
                     }
+                    brush.InvalidateBounds();
+                    mapEditor->BrushChanged(mapEditor->GetSelectedBrushIndex());
                     mapEditor->SetUnsavedChanges(true);
                 }
             }
@@ -326,16 +326,7 @@ void EditorApp::ProcessInput(float dt) {
                 if (mapEditor->GetSelectedBrushIndex() >= 0) {
                     auto& brush = mapEditor->GetMap().brushes[mapEditor->GetSelectedBrushIndex()];
                     
-                    // Calculate center
-                    PCD::Vec3 center(0, 0, 0);
-                    for (auto& v : brush.vertices) {
-                        center.x += v.position.x;
-                        center.y += v.position.y;
-                        center.z += v.position.z;
-                    }
-                    center.x /= brush.vertices.size();
-                    center.y /= brush.vertices.size();
-                    center.z /= brush.vertices.size();
+                    PCD::Vec3 center = brush.GetBounds().center;
                     
                     // Rotate around Y axis (most common)
                     if (rotation.y != 0) {
@@ -355,6 +346,8 @@ void EditorApp::ProcessInput(float dt) {
                             v.normal.x = nrelX * cosA - nrelZ * sinA;
                             v.normal.z = nrelX * sinA + nrelZ * cosA;
                         }
+                        brush.InvalidateBounds();
+                        mapEditor->BrushChanged(mapEditor->GetSelectedBrushIndex());
                     }
                     
                     mapEditor->SetUnsavedChanges(true);
@@ -446,6 +439,8 @@ Vec3 EditorApp::GetCameraUp() const {
 }
 
 void EditorApp::Render() {
+    renderer->BeginFrame();
+
     if (currentMode == EditorMode::PLAY) {
         glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -499,23 +494,19 @@ void EditorApp::Render() {
     float aspect = (float)width / height;
 
     GetEditorViewMatrix(view);
-
-    float f = 1.0f / tan(cameraFOV * 3.14159f / 360.0f);
-    float near = 0.1f, far = 1000.0f;
-
-    proj[0] = f / aspect; proj[4] = 0; proj[8] = 0; proj[12] = 0;
-    proj[1] = 0; proj[5] = f; proj[9] = 0; proj[13] = 0;
-    proj[2] = 0; proj[6] = 0; proj[10] = (far + near) / (near - far); proj[14] = (2 * far * near) / (near - far);
-    proj[3] = 0; proj[7] = 0; proj[11] = -1; proj[15] = 0;
+    GetEditorProjectionMatrix(proj, aspect);
 
     renderer->RenderGrid(mapEditor->GetSettings(),
                          PCD::Vec3(cameraFocusPoint.x, cameraFocusPoint.y, cameraFocusPoint.z),
                          view, proj);
     renderer->RenderBrushes(mapEditor->GetMap().brushes,
-                            mapEditor->GetSelectedBrushIndex(), view, proj);
+                            mapEditor->GetSelectedBrushIndex(), view, proj,
+                            &mapEditor->GetSelectedBrushes(),
+                            &mapEditor->VisibleBrushes(view, proj));
     renderer->RenderEntities(mapEditor->GetMap().entities,
                              mapEditor->GetSelectedEntityIndex(),
-                             mapEditor->GetSettings().showEntityIcons, view, proj);
+                             mapEditor->GetSettings().showEntityIcons, view, proj,
+                             &mapEditor->GetSelectedEntities());
 
     mapEditor->RenderGizmo(renderer, view, proj);
 
@@ -532,6 +523,13 @@ void EditorApp::Render() {
     RenderStatsPanel();
     RenderToolsPanel();
 
+    if (isMarqueeSelecting) {
+        ImDrawList* draw = ImGui::GetForegroundDrawList();
+        ImVec2 a((float)marqueeStartX, (float)marqueeStartY), b((float)lastX, (float)lastY);
+        draw->AddRectFilled(a, b, IM_COL32(90, 150, 255, 40));
+        draw->AddRect(a, b, IM_COL32(90, 150, 255, 200));
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -542,18 +540,39 @@ void EditorApp::RenderStatsPanel() {
     ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
     
     if (ImGui::Begin("Map Statistics")) {
+        // Only while the panel is open; edits since the last frame are
+        // applied as deltas
         const auto& stats = mapEditor->GetStats();
-        ImGui::Text("Brushes: %d", stats.totalBrushes);
-        ImGui::Text("Entities: %d", stats.totalEntities);
-        ImGui::Text("Vertices: %d", stats.totalVertices);
-        ImGui::Text("Triangles: %d", stats.totalTriangles);
-        ImGui::Text("Textures: %d", stats.totalTextures);
+        ImGui::Text("Brushes: %zu", stats.totalBrushes);
+        for (int bit = 0; bit < 32; bit++) {
+            if (stats.brushesWithFlag[bit] == 0) continue;
+            ImGui::Text("  %s: %zu", PCD::GetBrushFlagName(static_cast<PCD::BrushFlags>(1u << bit)),
+                        stats.brushesWithFlag[bit]);
+        }
+        ImGui::Text("Entities: %zu", stats.totalEntities);
+        ImGui::Text("Vertices: %zu", stats.totalVertices);
+        ImGui::Text("Triangles: %zu", stats.totalTriangles);
+        ImGui::Text("Textures: %zu (%.1f KB)", stats.totalTextures, stats.textureBytes / 1024.0);
+        if (stats.textureBytesSaved > 0) {
+            ImGui::Text("  Deduped: %.1f KB", stats.textureBytesSaved / 1024.0);
+        }
         ImGui::Separator();
         ImGui::Text("Bounds:");
-        ImGui::Text("  Min: %.1f, %.1f, %.1f", 
-                    stats.mapBoundsMin.x, stats.mapBoundsMin.y, stats.mapBoundsMin.z);
-        ImGui::Text("  Max: %.1f, %.1f, %.1f", 
-                    stats.mapBoundsMax.x, stats.mapBoundsMax.y, stats.mapBoundsMax.z);
+        if (stats.hasBounds) {
+            ImGui::Text("  Min: %.1f, %.1f, %.1f", 
+                        stats.mapBoundsMin.x, stats.mapBoundsMin.y, stats.mapBoundsMin.z);
+            ImGui::Text("  Max: %.1f, %.1f, %.1f", 
+                        stats.mapBoundsMax.x, stats.mapBoundsMax.y, stats.mapBoundsMax.z);
+        } else {
+            ImGui::TextDisabled("  None");
+        }
+        ImGui::Separator();
+        const auto& cull = renderer->GetCullCounts();
+        ImGui::Text("Brushes drawn: %zu", cull.visible);
+        ImGui::Text("  Culled: %zu", cull.culled);
+        const auto& calls = renderer->GetStateCounts();
+        ImGui::Text("GL state calls: %zu", calls.issued);
+        ImGui::Text("  Filtered: %zu", calls.filtered);
     }
     ImGui::End();
 }
@@ -633,6 +652,16 @@ void EditorApp::GetEditorViewMatrix(float *mat) {
     mat[3] = 0;    mat[7] = 0;    mat[11] = 0;    mat[15] = 1;
 }
 
+void EditorApp::GetEditorProjectionMatrix(float *mat, float aspect) {
+    float f = 1.0f / tan(cameraFOV * 3.14159f / 360.0f);
+    float near = 0.1f, far = 1000.0f;
+
+    mat[0] = f / aspect; mat[4] = 0; mat[8] = 0; mat[12] = 0;
+    mat[1] = 0; mat[5] = f; mat[9] = 0; mat[13] = 0;
+    mat[2] = 0; mat[6] = 0; mat[10] = (far + near) / (near - far); mat[14] = (2 * far * near) / (near - far);
+    mat[3] = 0; mat[7] = 0; mat[11] = -1; mat[15] = 0;
+}
+
 void EditorApp::EnterPlayMode() {
     std::cout << "Entering play mode...\n";
     TextureLoader::LoadMapTextures(mapEditor->GetMap());
@@ -752,21 +781,38 @@ void EditorApp::MouseButtonCallback(GLFWwindow *window, int button, int action,
 
                 float view[16], proj[16];
                 app->GetEditorViewMatrix(view);
-
-                float f = 1.0f / tan(app->cameraFOV * 3.14159f / 360.0f);
-                float aspect = (float)width / height;
-                float near = 0.1f, far = 1000.0f;
-
-                proj[0] = f / aspect; proj[4] = 0; proj[8] = 0; proj[12] = 0;
-                proj[1] = 0; proj[5] = f; proj[9] = 0; proj[13] = 0;
-                proj[2] = 0; proj[6] = 0; proj[10] = (far + near) / (near - far); proj[14] = (2 * far * near) / (near - far);
-                proj[3] = 0; proj[7] = 0; proj[11] = -1; proj[15] = 0;
+                app->GetEditorProjectionMatrix(proj, (float)width / height);
 
                 bool shift = mods & GLFW_MOD_SHIFT;
                 app->mapEditor->OnMouseClickWithRay(mx, my, width, height, view, proj, shift);
+
+                // A drag from here selects everything in the rectangle
+                if (app->mapEditor->GetCurrentTool() == PCD::EditorTool::SELECT) {
+                    app->isMarqueeSelecting = true;
+                    app->marqueeStartX = mx;
+                    app->marqueeStartY = my;
+                }
             }
         } else if (action == GLFW_RELEASE) {
             app->isLeftDragging = false;
+            if (app->isMarqueeSelecting) {
+                app->isMarqueeSelecting = false;
+
+                double mx, my;
+                glfwGetCursorPos(window, &mx, &my);
+                // Ignore the jitter of a plain click
+                if (std::abs(mx - app->marqueeStartX) > 4 && std::abs(my - app->marqueeStartY) > 4) {
+                    int width, height;
+                    glfwGetFramebufferSize(window, &width, &height);
+
+                    float view[16], proj[16];
+                    app->GetEditorViewMatrix(view);
+                    app->GetEditorProjectionMatrix(proj, (float)width / height);
+
+                    app->mapEditor->SelectInRect(app->marqueeStartX, app->marqueeStartY, mx, my, width, height,
+                                                 view, proj, mods & GLFW_MOD_SHIFT);
+                }
+            }
             if (app->cameraMode == CameraMode::ORBIT) {
                 app->cameraMode = CameraMode::FREE;
             } else {
@@ -22,13 +22,8 @@ void GameMode::Initialize() {
 }
 
 PCD::Vec3 GameMode::FindPlayerSpawn() {
-    for (const auto& ent : map->entities) {
-        if (ent.type == PCD::ENT_INFO_PLAYER_START || 
-            ent.type == PCD::ENT_INFO_PLAYER_DEATHMATCH) {
-            return PCD::Vec3(ent.position.x, ent.position.y, ent.position.z);
-        }
-    }
-    return PCD::Vec3(0, 0, 0);
+    const PCD::Entity* spawn = map->GetEntity(map->GetEntityIndex().FirstSpawn());
+    return spawn ? spawn->position : PCD::Vec3(0, 0, 0);
 }
 
 void GameMode::ProcessInput(GLFWwindow* window, float dt) {
@@ -47,20 +42,11 @@ void GameMode::CheckGroundCollision() {
     for (const auto& brush : map->brushes) {
         if (!(brush.flags & PCD::BRUSH_SOLID) || brush.vertices.empty()) continue;
         
-        float minX = brush.vertices[0].position.x, maxX = minX;
-        float minZ = brush.vertices[0].position.z, maxZ = minZ;
-        float minY = brush.vertices[0].position.y, maxY = minY;
-        
-        for (const auto& v : brush.vertices) {
-            minX = std::min(minX, v.position.x); maxX = std::max(maxX, v.position.x);
-            minY = std::min(minY, v.position.y); maxY = std::max(maxY, v.position.y);
-            minZ = std::min(minZ, v.position.z); maxZ = std::max(maxZ, v.position.z);
-        }
-        
-        if (controller.position.x >= minX && controller.position.x <= maxX &&
-            controller.position.z >= minZ && controller.position.z <= maxZ &&
-            maxY > highest && maxY <= controller.position.y) {
-            highest = maxY;
+        const PCD::BrushBounds& bounds = brush.GetBounds();
+        if (controller.position.x >= bounds.min.x && controller.position.x <= bounds.max.x &&
+            controller.position.z >= bounds.min.z && controller.position.z <= bounds.max.z &&
+            bounds.max.y > highest && bounds.max.y <= controller.position.y) {
+            highest = bounds.max.y;
             found = true;
         }
     }
@@ -3,6 +3,7 @@
 #include "Game/GameScene.h"
 #include "Game/LocalPlayer.h"
 #include "Game/RemotePlayer.h"
+#include "Engine/TextureLoader.h"
 #include <iostream>
 
 namespace Game {
@@ -66,15 +67,19 @@ void GameScene::Start(const std::string& mapName) {
     
     std::cout << "[GAME] Renderer initialized\n";
     
-    // Find spawn point
+    // Deferred textures start as placeholders and stream in from Update
+    TextureLoader::LoadMapTextures(currentMap, true);
+    
+    // Brushes now point at GL texture names, and the map does not change
+    // during a game, so its geometry goes to the GPU once
+    renderer->BuildStaticMap(currentMap);
+    
+    // Same spawn point the editor's play mode uses (GameMode::FindPlayerSpawn)
     glm::vec3 spawnPos(0.0f, 2.0f, 0.0f);
-    for (const auto& entity : currentMap.entities) {
-        if (entity.type == PCD::ENT_INFO_PLAYER_START || 
-            entity.type == PCD::ENT_INFO_PLAYER_DEATHMATCH) {
-            spawnPos = glm::vec3(entity.position.x, entity.position.y + 1.6f, entity.position.z);
-            std::cout << "[GAME] Found spawn point at: " << spawnPos.x << ", " << spawnPos.y << ", " << spawnPos.z << "\n";
-            break;
-        }
+    uint32_t spawnID = currentMap.GetEntityIndex().FirstSpawn();
+    if (const PCD::Entity* entity = currentMap.GetEntity(spawnID)) {
+        spawnPos = glm::vec3(entity->position.x, entity->position.y + 1.6f, entity->position.z);
+        std::cout << "[GAME] Found spawn point at: " << spawnPos.x << ", " << spawnPos.y << ", " << spawnPos.z << "\n";
     }
     
     // Create local player
@@ -117,6 +122,9 @@ void GameScene::Stop() {
     localPlayer.reset();
     remotePlayers.clear();
     
+    renderer->FreeStaticMap();
+    TextureLoader::FreeMapTextures(currentMap);
+    
     std::cout << "[GAME] Game stopped\n";
 }
 
@@ -137,6 +145,9 @@ void GameScene::Update(float deltaTime) {
     // Update network
     netManager->Update(deltaTime);
     
+    // One texture per frame keeps the upload cost off any single frame
+    TextureLoader::StreamMapTextures(currentMap, 1);
+    
     // Update local player
     if (localPlayer) {
         localPlayer->Update(deltaTime);
@@ -164,6 +175,8 @@ void GameScene::Update(float deltaTime) {
 void GameScene::Render() {
     if (!isRunning || !localPlayer) return;
     
+    renderer->BeginFrame();
+    
     // Clear
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
@@ -203,7 +216,7 @@ void GameScene::Render() {
     proj[3] = 0;        proj[7] = 0; proj[11] = -1;                    proj[15] = 0;
     
     // Render map
-    renderer->RenderBrushes(currentMap.brushes, -1, view, proj);
+    renderer->RenderStaticMap(view, proj);
     
     // Render remote players
     RenderRemotePlayers(view, proj);
@@ -312,6 +325,8 @@ void GameScene::RenderHUD() {
     ImGui::Separator();
     ImGui::Text("FPS: %d (%.1f ms)", fps, frameTime * 1000.0f);
     ImGui::Text("Players Online: %d", static_cast<int>(remotePlayers.size()) + 1);
+    ImGui::Text("Brushes: %zu drawn, %zu culled", renderer->GetCullCounts().visible,
+                renderer->GetCullCounts().culled);
     
     if (localPlayer) {
         glm::vec3 pos = localPlayer->GetPosition();
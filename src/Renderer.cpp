@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 
 static const char* vertexShaderSrc = R"(
 #version 330 core
@@ -11,8 +12,10 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
 uniform mat4 model;
 
 out vec3 vertexColor;
@@ -44,61 +47,99 @@ void main() {
 }
 )";
 
-Renderer::Renderer() : shaderProgram(0), vao(0), vbo(0), ebo(0) {}
+Renderer::Renderer() : modelLoc(-1), hasTextureLoc(-1), cameraUbo(0), cameraValid(false), modelValid(false),
+                       hasTextureValue(-1), vao(0), vbo(0), ebo(0), staticVao(0), staticVbo(0), staticEbo(0),
+                       staticCull(std::make_unique<PCD::CullTree>()) {}
+
+// Position, color, UV from the bound GL_ARRAY_BUFFER into the bound VAO
+static void SetVertexLayout() {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
+    glEnableVertexAttribArray(2);
+}
 
 Renderer::~Renderer() {
     Shutdown();
 }
 
 bool Renderer::Initialize() {
-    GLuint vs = CompileShader(GL_VERTEX_SHADER, vertexShaderSrc);
-    GLuint fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSrc);
-    
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vs);
-    glAttachShader(shaderProgram, fs);
-    glLinkProgram(shaderProgram);
-    
-    GLint success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetProgramInfoLog(shaderProgram, 512, nullptr, log);
-        std::cerr << "Shader linking error:\n" << log << std::endl;
-        return false;
-    }
+    if (!program.Build(vertexShaderSrc, fragmentShaderSrc)) return false;
+    
+    modelLoc = program.Location("model");
+    hasTextureLoc = program.Location("hasTexture");
+    if (!program.BindBlock("Camera", CAMERA_BINDING)) return false;
+    glUseProgram(program.Id());
+    glUniform1i(program.Location("textureSampler"), 0);
     
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    glGenBuffers(1, &cameraUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(camera), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    cameraValid = modelValid = false;
+    hasTextureValue = -1;
     
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
     
+    // Every dynamic draw uses the same layout in vbo and indices in ebo, so
+    // vao records them once; draws only refill the buffers
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    SetVertexLayout();
+    glBindVertexArray(0);
+    state.Invalidate();
+    
     return true;
 }
 
 void Renderer::Shutdown() {
+    FreeStaticMap();
     if (vao) glDeleteVertexArrays(1, &vao);
     if (vbo) glDeleteBuffers(1, &vbo);
     if (ebo) glDeleteBuffers(1, &ebo);
-    if (shaderProgram) glDeleteProgram(shaderProgram);
+    if (cameraUbo) glDeleteBuffers(1, &cameraUbo);
+    vao = vbo = ebo = cameraUbo = 0;
+    program.Destroy();
+    state.Invalidate();
 }
 
-GLuint Renderer::CompileShader(GLenum type, const char* src) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
-    
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetShaderInfoLog(shader, 512, nullptr, log);
-        std::cerr << "Shader compilation error:\n" << log << std::endl;
-    }
-    
-    return shader;
+void Renderer::BeginFrame() {
+    state.NextFrame();
+    lastCullCounts = cullCounts;
+    cullCounts = CullCounts();
+}
+
+// The matrices only change between frames, so in practice the block is
+// written by the first draw of a frame and every later one finds it current
+void Renderer::BeginDraw(const float* view, const float* proj) {
+    state.UseProgram(program.Id());
+    state.BindUniformBlock(CAMERA_BINDING, cameraUbo);
+    if (cameraValid && memcmp(camera, proj, 16 * sizeof(float)) == 0 &&
+        memcmp(camera + 16, view, 16 * sizeof(float)) == 0) return;
+    
+    memcpy(camera, proj, 16 * sizeof(float));
+    memcpy(camera + 16, view, 16 * sizeof(float));
+    state.BindBuffer(GL_UNIFORM_BUFFER, cameraUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), camera);
+    cameraValid = true;
+}
+
+void Renderer::SetModel(const float* mat) {
+    if (modelValid && memcmp(model, mat, sizeof(model)) == 0) return;
+    memcpy(model, mat, sizeof(model));
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
+    modelValid = true;
+}
+
+void Renderer::SetHasTexture(bool textured) {
+    if (hasTextureValue == (int)textured) return;
+    glUniform1i(hasTextureLoc, textured ? 1 : 0);
+    hasTextureValue = textured;
 }
 
 void Renderer::SetIdentityMatrix(float* mat) {
@@ -133,104 +174,248 @@ void Renderer::RenderGrid(const PCD::EditorSettings& settings, const PCD::Vec3&
     gridVerts.insert(gridVerts.end(), {0, -extent, 0, 0.3f, 1.0f, 0.3f, 0, 0});
     gridVerts.insert(gridVerts.end(), {0, extent, 0, 0.3f, 1.0f, 0.3f, 0, 0});
     
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, gridVerts.size() * sizeof(float), gridVerts.data(), GL_DYNAMIC_DRAW);
     
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    glUseProgram(shaderProgram);
-    float model[16];
-    SetIdentityMatrix(model);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, proj);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 0);
+    BeginDraw(view, proj);
+    float identity[16];
+    SetIdentityMatrix(identity);
+    SetModel(identity);
+    SetHasTexture(false);
     
     glDrawArrays(GL_LINES, 0, gridVerts.size() / 8);
 }
 
-void Renderer::RenderBrushes(const std::vector<PCD::Brush>& brushes, int selectedIdx, float* view, float* proj) {
-    for (size_t i = 0; i < brushes.size(); i++) {
+// Vertex color of a brush; special brush types keep their color when selected
+static PCD::Vec3 BrushColor(const PCD::Brush& brush, bool selected) {
+    PCD::Vec3 color = selected ? PCD::Vec3(1.0f, 0.8f, 0.3f) : brush.color;
+    if (brush.flags & PCD::BRUSH_TRIGGER) color = PCD::Vec3(0.8f, 0.2f, 0.8f);
+    if (brush.flags & PCD::BRUSH_WATER) color = PCD::Vec3(0.2f, 0.4f, 0.8f);
+    if (brush.flags & PCD::BRUSH_LAVA) color = PCD::Vec3(0.9f, 0.3f, 0.1f);
+    if (brush.flags & PCD::BRUSH_CLIP) color = PCD::Vec3(0.5f, 0.5f, 0.0f);
+    return color;
+}
+
+// Appends a brush in the shader's layout: position, color, scaled UV
+static void AppendBrushVertices(const PCD::Brush& brush, const PCD::Vec3& color, std::vector<float>& verts) {
+    for (const auto& v : brush.vertices) {
+        verts.insert(verts.end(), {v.position.x, v.position.y, v.position.z, color.x, color.y, color.z,
+                                   v.uv.u * brush.uvScaleX + brush.uvOffsetX,
+                                   v.uv.v * brush.uvScaleY + brush.uvOffsetY});
+    }
+}
+
+// Appends a brush's draw, vertices and indices to a buffer being packed
+void Renderer::PackBrush(const PCD::Brush& brush, size_t index, bool selected, std::vector<float>& verts,
+                         std::vector<unsigned int>& indices, std::vector<BrushDraw>& draws) {
+    BrushDraw draw;
+    draw.texture = brush.textureID;
+    draw.wireframe = selected;
+    draw.count = (GLsizei)brush.indices.size();
+    draw.offset = (GLintptr)(indices.size() * sizeof(unsigned int));
+    draw.baseVertex = (GLint)(verts.size() / 8);
+    draw.brush = index;
+    draws.push_back(draw);
+    
+    AppendBrushVertices(brush, BrushColor(brush, selected), verts);
+    indices.insert(indices.end(), brush.indices.begin(), brush.indices.end());
+}
+
+void Renderer::RenderBrushes(const std::vector<PCD::Brush>& brushes, int selectedIdx, float* view, float* proj,
+                             const PCD::SelectionSet* selection, const std::vector<int>* visible) {
+    // Brushes change between frames in the editor, so they are packed and
+    // uploaded again each frame, but as one buffer pair rather than per brush
+    frameVerts.clear();
+    frameIndices.clear();
+    frameDraws.clear();
+    size_t count = visible ? visible->size() : brushes.size();
+    for (size_t k = 0; k < count; k++) {
+        size_t i = visible ? (size_t)(*visible)[k] : k;
         const auto& brush = brushes[i];
-        
-        std::vector<float> verts;
-        for (const auto& v : brush.vertices) {
-            float r = brush.color.x, g = brush.color.y, b = brush.color.z;
-            
-            if ((int)i == selectedIdx) {
-                r = 1.0f; g = 0.8f; b = 0.3f;
-            }
-            
-            if (brush.flags & PCD::BRUSH_TRIGGER) { r = 0.8f; g = 0.2f; b = 0.8f; }
-            if (brush.flags & PCD::BRUSH_WATER) { r = 0.2f; g = 0.4f; b = 0.8f; }
-            if (brush.flags & PCD::BRUSH_LAVA) { r = 0.9f; g = 0.3f; b = 0.1f; }
-            if (brush.flags & PCD::BRUSH_CLIP) { r = 0.5f; g = 0.5f; b = 0.0f; }
-            
-            verts.push_back(v.position.x);
-            verts.push_back(v.position.y);
-            verts.push_back(v.position.z);
-            verts.push_back(r);
-            verts.push_back(g);
-            verts.push_back(b);
-            verts.push_back(v.uv.u * brush.uvScaleX + brush.uvOffsetX);
-            verts.push_back(v.uv.v * brush.uvScaleY + brush.uvOffsetY);
+        if (brush.vertices.empty() || brush.indices.empty()) continue;
+        bool selected = (int)i == selectedIdx || (selection && selection->Contains((int)i));
+        PackBrush(brush, i, selected, frameVerts, frameIndices, frameDraws);
+    }
+    if (visible) {
+        cullCounts.visible += count;
+        cullCounts.culled += brushes.size() - count;
+    }
+    if (frameDraws.empty()) return;
+    
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, frameVerts.size() * sizeof(float), frameVerts.data(), GL_DYNAMIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, frameIndices.size() * sizeof(unsigned int), 
+                 frameIndices.data(), GL_DYNAMIC_DRAW);
+    
+    BeginDraw(view, proj);
+    float identity[16];
+    SetIdentityMatrix(identity);
+    SetModel(identity);
+    
+    SortIntoBatches(frameDraws);
+    DrawBatches(frameDraws);
+}
+
+// Equal texture and fill mode end up adjacent; brushes keep their map
+// order within a batch
+void Renderer::SortIntoBatches(std::vector<BrushDraw>& draws) {
+    std::stable_sort(draws.begin(), draws.end(), [](const BrushDraw& a, const BrushDraw& b) {
+        if (a.wireframe != b.wireframe) return b.wireframe;
+        return a.texture < b.texture;
+    });
+}
+
+void Renderer::DrawBatches(const std::vector<BrushDraw>& draws) {
+    size_t begin = 0;
+    while (begin < draws.size()) {
+        const BrushDraw& first = draws[begin];
+        batchCounts.clear();
+        batchOffsets.clear();
+        batchBaseVertices.clear();
+        size_t end = begin;
+        for (; end < draws.size() && draws[end].texture == first.texture &&
+               draws[end].wireframe == first.wireframe; end++) {
+            batchCounts.push_back(draws[end].count);
+            batchOffsets.push_back((const void*)draws[end].offset);
+            batchBaseVertices.push_back(draws[end].baseVertex);
         }
         
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_DYNAMIC_DRAW);
-        
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, brush.indices.size() * sizeof(unsigned int), 
-                     brush.indices.data(), GL_DYNAMIC_DRAW);
-        
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
-        glEnableVertexAttribArray(2);
-        
-        glUseProgram(shaderProgram);
-        float model[16];
-        SetIdentityMatrix(model);
-        
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, proj);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-        
-        // Bind texture if available
-        if (brush.textureID > 0) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, brush.textureID);
-            glUniform1i(glGetUniformLocation(shaderProgram, "textureSampler"), 0);
-            glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 1);
-        } else {
-            glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 0);
+        if (first.texture > 0) {
+            state.BindTexture(0, first.texture);
         }
+        SetHasTexture(first.texture > 0);
         
-        if ((int)i == selectedIdx) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glLineWidth(2.0f);
+        state.PolygonMode(first.wireframe ? GL_LINE : GL_FILL);
+        if (first.wireframe) {
+            state.LineWidth(2.0f);
         }
         
-        glDrawElements(GL_TRIANGLES, brush.indices.size(), GL_UNSIGNED_INT, 0);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, batchCounts.data(), GL_UNSIGNED_INT, batchOffsets.data(),
+                                      (GLsizei)batchCounts.size(), batchBaseVertices.data());
+        begin = end;
+    }
+    state.PolygonMode(GL_FILL);
+}
+
+// Immutable storage where the driver has it (GL 4.4 or ARB_buffer_storage),
+// otherwise a one-time GL_STATIC_DRAW upload
+static void UploadStaticBuffer(GLenum target, GLsizeiptr size, const void* data) {
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        glBufferStorage(target, size, data, 0);
+    } else {
+        glBufferData(target, size, data, GL_STATIC_DRAW);
+    }
+}
+
+// One brush's vertices from the packed store in the shader's layout, at
+// the same vertex positions the store gives them
+static void WriteStoreVertices(const PCD::MapGeometry& geometry, const PCD::MapGeometry::Range& range,
+                               const PCD::Brush& brush, std::vector<float>& verts) {
+    PCD::ConstVertexSpan span = geometry.Vertices(range);
+    float* out = verts.data() + size_t(range.firstVertex) * 8;
+    PCD::Vec3 color = BrushColor(brush, false);
+    const PCD::Vec3* positions = span.Positions();
+    const PCD::Vec2* uvs = span.UVs();
+    for (size_t i = 0; i < span.size(); i++, out += 8) {
+        out[0] = positions[i].x;
+        out[1] = positions[i].y;
+        out[2] = positions[i].z;
+        out[3] = color.x;
+        out[4] = color.y;
+        out[5] = color.z;
+        out[6] = uvs[i].u * brush.uvScaleX + brush.uvOffsetX;
+        out[7] = uvs[i].v * brush.uvScaleY + brush.uvOffsetY;
+    }
+}
+
+void Renderer::BuildStaticMap(const PCD::Map& map) {
+    FreeStaticMap();
+    
+    // The store packs every brush's indices back to back, brush-local like
+    // the draws expect, so they upload as they are; only the vertices are
+    // interleaved with each brush's color and UV transform
+    PCD::MapGeometry geometry;
+    geometry.Build(map, 0);
+    const std::vector<PCD::MapGeometry::Range>& ranges = geometry.Ranges();
+    const std::vector<uint32_t>& indices = geometry.IndexStream();
+    
+    std::vector<float> verts(geometry.VertexCount() * 8);
+    staticDraws.reserve(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        const PCD::MapGeometry::Range& range = ranges[i];
+        const PCD::Brush& brush = map.brushes[i];
+        WriteStoreVertices(geometry, range, brush, verts);
+        if (range.vertexCount == 0 || range.indexCount == 0) continue;
         
-        if ((int)i == selectedIdx) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        }
+        BrushDraw draw;
+        draw.texture = brush.textureID;
+        draw.wireframe = false;
+        draw.count = (GLsizei)range.indexCount;
+        draw.offset = (GLintptr)(range.firstIndex * sizeof(uint32_t));
+        draw.baseVertex = (GLint)range.firstVertex;
+        draw.brush = i;
+        staticDraws.push_back(draw);
     }
+    if (staticDraws.empty()) return;
+    SortIntoBatches(staticDraws);
+    
+    std::vector<PCD::BrushBounds> bounds;
+    bounds.reserve(staticDraws.size());
+    for (const BrushDraw& draw : staticDraws) bounds.push_back(map.brushes[draw.brush].GetBounds());
+    staticCull->Build(bounds);
+    
+    glGenVertexArrays(1, &staticVao);
+    glGenBuffers(1, &staticVbo);
+    glGenBuffers(1, &staticEbo);
+    
+    // The attribute layout and index buffer are recorded in staticVao once
+    state.BindVertexArray(staticVao);
+    state.BindBuffer(GL_ARRAY_BUFFER, staticVbo);
+    UploadStaticBuffer(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, staticEbo);
+    UploadStaticBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data());
+    
+    SetVertexLayout();
+    state.BindVertexArray(0);
+    
+    std::cout << "[Renderer] Static map: " << staticDraws.size() << " brushes, "
+              << (verts.size() * sizeof(float) + indices.size() * sizeof(uint32_t)) / 1024 << " KB" << std::endl;
+}
+
+void Renderer::RenderStaticMap(float* view, float* proj) {
+    if (staticDraws.empty()) return;
+    
+    BeginDraw(view, proj);
+    float identity[16];
+    SetIdentityMatrix(identity);
+    SetModel(identity);
+    
+    // Positions come back ascending, so the visible draws keep their batches
+    staticCull->Query(PCD::Frustum::FromViewAndProjection(view, proj), visibleDraws);
+    cullCounts.visible += visibleDraws.size();
+    cullCounts.culled += staticDraws.size() - visibleDraws.size();
+    
+    frameDraws.clear();
+    for (int index : visibleDraws) frameDraws.push_back(staticDraws[index]);
+    
+    state.BindVertexArray(staticVao);
+    DrawBatches(frameDraws);
+}
+
+void Renderer::FreeStaticMap() {
+    if (staticVao) glDeleteVertexArrays(1, &staticVao);
+    if (staticVbo) glDeleteBuffers(1, &staticVbo);
+    if (staticEbo) glDeleteBuffers(1, &staticEbo);
+    staticVao = staticVbo = staticEbo = 0;
+    state.Invalidate();
+    staticDraws.clear();
+    staticCull->Clear();
 }
 
 void Renderer::RenderEntities(const std::vector<PCD::Entity>& entities, int selectedIdx, 
-                               bool showIcons, float* view, float* proj) {
+                               bool showIcons, float* view, float* proj, const PCD::SelectionSet* selection) {
     if (!showIcons) return;
     
     float boxSize = 0.5f;
@@ -251,12 +436,15 @@ void Renderer::RenderEntities(const std::vector<PCD::Entity>& entities, int sele
         3,2,6, 3,6,7, 0,1,5, 0,5,4
     };
     
+    BeginDraw(view, proj);
+    SetHasTexture(false);
+    
     for (size_t i = 0; i < entities.size(); i++) {
         const auto& ent = entities[i];
         
         float r = 0.5f, g = 0.5f, b = 0.5f;
         
-        if ((int)i == selectedIdx) {
+        if ((int)i == selectedIdx || (selection && selection->Contains((int)i))) {
             r = 1.0f; g = 0.9f; b = 0.3f;
         } else {
             switch (ent.type) {
@@ -291,32 +479,18 @@ void Renderer::RenderEntities(const std::vector<PCD::Entity>& entities, int sele
             coloredVerts.push_back(0);
         }
         
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        state.BindVertexArray(vao);
+        state.BindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, coloredVerts.size() * sizeof(float), 
                      coloredVerts.data(), GL_DYNAMIC_DRAW);
-        
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(boxIndices), boxIndices, GL_DYNAMIC_DRAW);
         
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
-        glEnableVertexAttribArray(2);
-        
-        glUseProgram(shaderProgram);
-        float model[16];
-        SetIdentityMatrix(model);
-        model[12] = ent.position.x;
-        model[13] = ent.position.y;
-        model[14] = ent.position.z;
-        
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, proj);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-        glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 0);
+        float entityModel[16];
+        SetIdentityMatrix(entityModel);
+        entityModel[12] = ent.position.x;
+        entityModel[13] = ent.position.y;
+        entityModel[14] = ent.position.z;
+        SetModel(entityModel);
         
         glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
     }
@@ -350,32 +524,20 @@ void Renderer::RenderCreationPreview(const PCD::Vec3& start, const PCD::Vec3& en
         0,4, 1,5, 2,6, 3,7
     };
     
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(previewVerts), previewVerts, GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(lineIndices), lineIndices, GL_DYNAMIC_DRAW);
     
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    glUseProgram(shaderProgram);
-    float model[16];
-    SetIdentityMatrix(model);
+    BeginDraw(view, proj);
+    float identity[16];
+    SetIdentityMatrix(identity);
+    SetModel(identity);
+    SetHasTexture(false);
     
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, proj);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 0);
-    
-    glLineWidth(2.0f);
+    state.LineWidth(2.0f);
     glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-    glLineWidth(1.0f);
+    state.LineWidth(1.0f);
 }
 
 void Renderer::RenderGizmo(const PCD::Vec3& position, PCD::EditorTool tool, int activeAxis, float* view, float* proj) {
@@ -455,30 +617,20 @@ void Renderer::RenderArrow(const PCD::Vec3& pos, const PCD::Vec3& dir, float r,
         verts.insert(verts.end(), {end.x, end.y, end.z, r, g, b, 0, 0});
     }
     
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_DYNAMIC_DRAW);
     
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
-    glEnableVertexAttribArray(2);
+    BeginDraw(view, proj);
+    float identity[16];
+    SetIdentityMatrix(identity);
+    SetModel(identity);
+    SetHasTexture(false);
     
-    glUseProgram(shaderProgram);
-    float model[16];
-    SetIdentityMatrix(model);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, proj);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 0);
-    
-    glLineWidth(lineWidth);
+    state.LineWidth(lineWidth);
     glDrawArrays(GL_LINE_STRIP, 0, 11);
     glDrawArrays(GL_LINES, 11, verts.size()/8 - 11);
-    glLineWidth(1.0f);
+    state.LineWidth(1.0f);
 }
 
 void Renderer::RenderCube(const PCD::Vec3& pos, float size, float r, float g, float b, float* view, float* proj) {
@@ -501,28 +653,16 @@ void Renderer::RenderCube(const PCD::Vec3& pos, float size, float r, float g, fl
         3,2,6, 3,6,7, 0,1,5, 0,5,4
     };
     
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVerts), cubeVerts, GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_DYNAMIC_DRAW);
     
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    glUseProgram(shaderProgram);
-    float model[16];
-    SetIdentityMatrix(model);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, proj);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniform1i(glGetUniformLocation(shaderProgram, "hasTexture"), 0);
+    BeginDraw(view, proj);
+    float identity[16];
+    SetIdentityMatrix(identity);
+    SetModel(identity);
+    SetHasTexture(false);
     
     glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 }
@@ -0,0 +1,703 @@
+// pcd_bench.cpp - Load/save benchmark for PCD maps
+//
+// Generates deterministic synthetic maps and reports save/load wall time,
+// throughput, heap allocations and peak RSS as JSON on stdout, so runs can
+// be diffed and tracked between commits. Also compares the schema-generated
+// record encoders (PCDSchema.h) against equivalent hand-written loops, and
+// delta undo steps (PCDUndo.h) against copying the whole map per edit.
+// Timings only; test_pcd checks the fast paths agree with the slow ones.
+//
+//   pcd_bench [--brushes 1000,10000,100000] [--entities N] [--textures N]
+//             [--texture-size S] [--threads N] [--iterations N]
+//             [--pack] [--precision P] [--seed N] [--out DIR]
+
+#include "PCD/PCDFile.h"
+#include "PCD/PCDSyntheticMap.h"
+#include "PCD/PCDGeometryReport.h"
+#include "PCD/PCDSchema.h"
+#include "PCD/PCDMapGeometry.h"
+#include "PCD/PCDDiff.h"
+#include "PCD/PCDUndo.h"
+#include "PCD/PCDPickTree.h"
+#include "PCD/PCDSelection.h"
+#include "PCD/PCDTransform.h"
+#include "PCD/PCDMapStats.h"
+#include "PCD/PCDCullTree.h"
+#include "pcd_test_util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+// ---------------------------------------------------------------------------
+// Allocation counting: every operator new in the process goes through here
+// ---------------------------------------------------------------------------
+
+// GCC sees the malloc/free pairing through these replacements and warns
+// about mismatched new/delete in every inlined container
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<uint64_t> g_allocCount(0);
+static std::atomic<uint64_t> g_allocBytes(0);
+
+void* operator new(size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using PCDTest::BruteForcePick;
+using PCDTest::QuietStdout;
+
+struct Options {
+    std::vector<uint32_t> brushCounts = {1000, 10000, 100000};
+    int64_t entityCount = -1; // -1: brushes / 20
+    uint32_t textureCount = 8;
+    uint32_t textureSize = 256;
+    unsigned threads = 1;
+    int iterations = 3;
+    bool pack = false;
+    float precision = 1.0f / 1024.0f;
+    uint64_t seed = 1;
+    std::string outDir = "/tmp";
+};
+
+struct Phase {
+    double ms = 0.0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t peakRssKB = 0;
+};
+
+// Peak resident set since the last ResetPeakRss(). Linux lets us reset the
+// high-water mark per phase; elsewhere this is the process-wide peak.
+void ResetPeakRss() {
+    std::ofstream clear("/proc/self/clear_refs");
+    if (clear) clear << "5";
+}
+
+uint64_t PeakRssKB() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::strtoull(line.c_str() + 6, nullptr, 10);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return uint64_t(usage.ru_maxrss);
+}
+
+// Best of N wall time; allocations and RSS come from the last iteration
+template <typename Fn>
+Phase Measure(int iterations, Fn&& fn) {
+    Phase phase;
+    for (int i = 0; i < std::max(1, iterations); i++) {
+        ResetPeakRss();
+        uint64_t count = g_allocCount.load();
+        uint64_t bytes = g_allocBytes.load();
+        auto start = std::chrono::steady_clock::now();
+        {
+            QuietStdout quiet;
+            fn();
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || ms < phase.ms) phase.ms = ms;
+        phase.allocations = g_allocCount.load() - count;
+        phase.allocatedBytes = g_allocBytes.load() - bytes;
+        phase.peakRssKB = PeakRssKB();
+    }
+    return phase;
+}
+
+// Hand-written equivalents of the schema encoders for Brush and Entity,
+// field by field with per-field bounds checks, producing the same bytes
+namespace Handwritten {
+
+template <typename T>
+void Put(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+void PutString(std::vector<uint8_t>& out, const std::string& str) {
+    Put(out, static_cast<uint32_t>(str.size()));
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+void Encode(const PCD::Brush& brush, std::vector<uint8_t>& out) {
+    Put(out, brush.id);
+    Put(out, brush.textureID);
+    Put(out, brush.flags);
+    Put(out, brush.color);
+    Put(out, brush.uvScaleX);
+    Put(out, brush.uvScaleY);
+    Put(out, brush.uvOffsetX);
+    Put(out, brush.uvOffsetY);
+    PutString(out, brush.name);
+    Put(out, static_cast<uint32_t>(brush.vertices.size()));
+    const uint8_t* v = reinterpret_cast<const uint8_t*>(brush.vertices.data());
+    out.insert(out.end(), v, v + brush.vertices.size() * sizeof(PCD::Vertex));
+    Put(out, static_cast<uint32_t>(brush.indices.size()));
+    const uint8_t* i = reinterpret_cast<const uint8_t*>(brush.indices.data());
+    out.insert(out.end(), i, i + brush.indices.size() * sizeof(uint32_t));
+}
+
+void Encode(const PCD::Entity& ent, std::vector<uint8_t>& out) {
+    Put(out, ent.id);
+    Put(out, ent.type);
+    Put(out, ent.position);
+    Put(out, ent.rotation);
+    Put(out, ent.scale);
+    PutString(out, ent.name);
+    Put(out, static_cast<uint32_t>(ent.properties.size()));
+    for (const auto& [key, value] : ent.properties) {
+        PutString(out, key);
+        PutString(out, value.Text());
+    }
+}
+
+bool Decode(PCD::ByteReader& in, PCD::Brush& brush) {
+    brush.id = in.Get<uint32_t>();
+    brush.textureID = in.Get<uint32_t>();
+    brush.flags = in.Get<uint32_t>();
+    brush.color = in.Get<PCD::Vec3>();
+    brush.uvScaleX = in.Get<float>();
+    brush.uvScaleY = in.Get<float>();
+    brush.uvOffsetX = in.Get<float>();
+    brush.uvOffsetY = in.Get<float>();
+    brush.name = in.StringView();
+    uint32_t vertexCount = in.Count(sizeof(PCD::Vertex));
+    const uint8_t* v = in.Bytes(size_t(vertexCount) * sizeof(PCD::Vertex));
+    brush.vertices.resize(vertexCount);
+    if (v && vertexCount) memcpy(brush.vertices.data(), v, size_t(vertexCount) * sizeof(PCD::Vertex));
+    uint32_t indexCount = in.Count(sizeof(uint32_t));
+    const uint8_t* i = in.Bytes(size_t(indexCount) * sizeof(uint32_t));
+    brush.indices.resize(indexCount);
+    if (i && indexCount) memcpy(brush.indices.data(), i, size_t(indexCount) * sizeof(uint32_t));
+    return in.ok;
+}
+
+bool Decode(PCD::ByteReader& in, PCD::Entity& ent) {
+    ent.id = in.Get<uint32_t>();
+    ent.type = in.Get<PCD::EntityType>();
+    ent.position = in.Get<PCD::Vec3>();
+    ent.rotation = in.Get<PCD::Vec3>();
+    ent.scale = in.Get<PCD::Vec3>();
+    ent.name = in.StringView();
+    uint32_t propCount = in.Count(sizeof(uint32_t));
+    ent.properties.resize(propCount);
+    for (auto& [key, value] : ent.properties) {
+        key = in.StringView();
+        value = in.StringView();
+    }
+    return in.ok;
+}
+
+} // namespace Handwritten
+
+struct CodecResult {
+    uint64_t bytes = 0;
+    Phase encode;
+    Phase decode;
+};
+
+// Encodes every object into one buffer and decodes it back, reusing the
+// buffer and the decoded objects between iterations like the journal does.
+// A first untimed round trip grows the buffer and the decoded objects, so
+// whichever codec runs first does not pay for faulting that memory in; with
+// --iterations 1 that cost otherwise decides the comparison on small maps.
+template <typename T, typename Encode, typename Decode>
+CodecResult MeasureCodec(const std::vector<T>& objects, int iterations, std::vector<uint8_t>& buffer,
+                         Encode encode, Decode decode) {
+    CodecResult result;
+    std::vector<T> decoded(objects.size());
+    auto encodeAll = [&] {
+        buffer.clear();
+        for (const auto& obj : objects) encode(obj, buffer);
+    };
+    auto decodeAll = [&] {
+        PCD::ByteReader in(buffer.data(), buffer.size());
+        for (auto& obj : decoded) decode(in, obj);
+    };
+    encodeAll();
+    decodeAll();
+    result.encode = Measure(iterations, encodeAll);
+    result.decode = Measure(iterations, decodeAll);
+    result.bytes = buffer.size();
+    return result;
+}
+
+// Per-brush bounds over every vertex, the walk collision and stats did
+// before brushes cached their bounds: once through Brush::vertices and
+// once through the packed store
+struct Bounds {
+    PCD::Vec3 min, max;
+};
+
+void Grow(Bounds& bounds, const PCD::Vec3* positions, size_t count) {
+    if (count == 0) return;
+    bounds.min = bounds.max = positions[0];
+    for (size_t i = 1; i < count; i++) {
+        bounds.min.x = std::min(bounds.min.x, positions[i].x);
+        bounds.min.y = std::min(bounds.min.y, positions[i].y);
+        bounds.min.z = std::min(bounds.min.z, positions[i].z);
+        bounds.max.x = std::max(bounds.max.x, positions[i].x);
+        bounds.max.y = std::max(bounds.max.y, positions[i].y);
+        bounds.max.z = std::max(bounds.max.z, positions[i].z);
+    }
+}
+
+void BrushBounds(const PCD::Map& map, std::vector<Bounds>& out) {
+    out.resize(map.brushes.size());
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        const auto& vertices = map.brushes[i].vertices;
+        if (vertices.empty()) continue;
+        Bounds& bounds = out[i];
+        bounds.min = bounds.max = vertices[0].position;
+        for (const auto& v : vertices) {
+            bounds.min.x = std::min(bounds.min.x, v.position.x);
+            bounds.min.y = std::min(bounds.min.y, v.position.y);
+            bounds.min.z = std::min(bounds.min.z, v.position.z);
+            bounds.max.x = std::max(bounds.max.x, v.position.x);
+            bounds.max.y = std::max(bounds.max.y, v.position.y);
+            bounds.max.z = std::max(bounds.max.z, v.position.z);
+        }
+    }
+}
+
+void StoreBounds(const PCD::MapGeometry& geometry, std::vector<Bounds>& out) {
+    const auto& ranges = geometry.Ranges();
+    out.resize(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        Grow(out[i], geometry.Vertices(ranges[i]).Positions(), ranges[i].vertexCount);
+    }
+}
+
+// What picking and collision read now: the bounds cached on each Brush
+void CachedBounds(const PCD::Map& map, std::vector<Bounds>& out) {
+    out.resize(map.brushes.size());
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        if (map.brushes[i].vertices.empty()) continue;
+        const PCD::BrushBounds& bounds = map.brushes[i].GetBounds();
+        out[i].min = bounds.min;
+        out[i].max = bounds.max;
+    }
+}
+
+double MBps(uint64_t bytes, double ms) {
+    return ms > 0.0 ? (double(bytes) / (1024.0 * 1024.0)) / (ms / 1000.0) : 0.0;
+}
+
+uint64_t FileSize(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? uint64_t(file.tellg()) : 0;
+}
+
+void PrintPhase(const char* name, const Phase& phase, uint64_t bytes, bool last) {
+    printf("      \"%s\": {\"ms\": %.3f, \"bytes\": %llu, \"mb_per_s\": %.2f, \"allocations\": %llu, "
+           "\"allocated_bytes\": %llu, \"peak_rss_kb\": %llu}%s\n",
+           name, phase.ms, (unsigned long long)bytes, MBps(bytes, phase.ms),
+           (unsigned long long)phase.allocations, (unsigned long long)phase.allocatedBytes,
+           (unsigned long long)phase.peakRssKB, last ? "" : ",");
+}
+
+bool ParseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--pack") {
+            opt.pack = true;
+        } else if (arg == "--brushes" && hasValue) {
+            opt.brushCounts.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (!item.empty()) opt.brushCounts.push_back(uint32_t(std::strtoul(item.c_str(), nullptr, 10)));
+            }
+        } else if (arg == "--entities" && hasValue) {
+            opt.entityCount = std::strtoll(argv[++i], nullptr, 10);
+        } else if (arg == "--textures" && hasValue) {
+            opt.textureCount = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--texture-size" && hasValue) {
+            opt.textureSize = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--iterations" && hasValue) {
+            opt.iterations = std::atoi(argv[++i]);
+        } else if (arg == "--precision" && hasValue) {
+            opt.precision = float(std::atof(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            opt.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--out" && hasValue) {
+            opt.outDir = argv[++i];
+        } else {
+            std::cerr << "Usage: pcd_bench [--brushes 1000,10000,100000] [--entities N] [--textures N]\n"
+                      << "                 [--texture-size S] [--threads N] [--iterations N]\n"
+                      << "                 [--pack] [--precision P] [--seed N] [--out DIR]\n";
+            return false;
+        }
+    }
+    return !opt.brushCounts.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) return 1;
+
+    PCD::SaveOptions saveOptions;
+    saveOptions.threads = opt.threads;
+    saveOptions.packGeometry = opt.pack;
+    saveOptions.positionPrecision = opt.precision;
+    PCD::LoadOptions loadOptions;
+    loadOptions.threads = opt.threads;
+
+    printf("{\n");
+    printf("  \"config\": {\"textures\": %u, \"texture_size\": %u, \"threads\": %u, \"iterations\": %d, "
+           "\"pack\": %s, \"precision\": %g, \"seed\": %llu},\n",
+           opt.textureCount, opt.textureSize, opt.threads, opt.iterations, opt.pack ? "true" : "false",
+           opt.precision, (unsigned long long)opt.seed);
+    printf("  \"runs\": [\n");
+
+    bool ok = true;
+    for (size_t run = 0; run < opt.brushCounts.size(); run++) {
+        PCD::SyntheticMap::Params params;
+        params.brushCount = opt.brushCounts[run];
+        params.entityCount = opt.entityCount >= 0 ? uint32_t(opt.entityCount) : params.brushCount / 20;
+        params.textureCount = opt.textureCount;
+        params.textureSize = opt.textureSize;
+        params.seed = opt.seed;
+
+        PCD::Map map;
+        Phase generate = Measure(1, [&] { map = PCD::SyntheticMap::Generate(params); });
+
+        std::string path = opt.outDir + "/pcd_bench_" + std::to_string(params.brushCount) + ".pcd";
+        bool saved = true;
+        Phase save = Measure(opt.iterations, [&] { saved = PCD::PCDWriter::Save(map, path, saveOptions); });
+        uint64_t fileBytes = FileSize(path);
+
+        PCD::Map loaded;
+        bool loadedOk = true;
+        Phase load = Measure(opt.iterations, [&] { loadedOk = PCD::PCDReader::Load(loaded, path, loadOptions); });
+        if (!saved || !loadedOk || loaded.brushes.size() != map.brushes.size()) {
+            std::cerr << "[PCD] pcd_bench: round trip failed for " << path << std::endl;
+            ok = false;
+        }
+
+        // Schema vs hand-written record codecs over every brush and entity
+        std::vector<uint8_t> schemaBytes, handBytes;
+        CodecResult schemaBrushes = MeasureCodec(map.brushes, opt.iterations, schemaBytes,
+            [](const PCD::Brush& b, std::vector<uint8_t>& out) { PCD::SchemaCodec::Encode(b, out); },
+            [](PCD::ByteReader& in, PCD::Brush& b) { return PCD::SchemaCodec::Decode(in, b); });
+        CodecResult handBrushes = MeasureCodec(map.brushes, opt.iterations, handBytes,
+            [](const PCD::Brush& b, std::vector<uint8_t>& out) { Handwritten::Encode(b, out); },
+            [](PCD::ByteReader& in, PCD::Brush& b) { return Handwritten::Decode(in, b); });
+        CodecResult schemaEntities = MeasureCodec(map.entities, opt.iterations, schemaBytes,
+            [](const PCD::Entity& e, std::vector<uint8_t>& out) { PCD::SchemaCodec::Encode(e, out); },
+            [](PCD::ByteReader& in, PCD::Entity& e) { return PCD::SchemaCodec::Decode(in, e); });
+        CodecResult handEntities = MeasureCodec(map.entities, opt.iterations, handBytes,
+            [](const PCD::Entity& e, std::vector<uint8_t>& out) { Handwritten::Encode(e, out); },
+            [](PCD::ByteReader& in, PCD::Entity& e) { return Handwritten::Decode(in, e); });
+        
+        // Brush vectors vs the packed MapGeometry store
+        PCD::MapGeometry store;
+        Phase storeBuild = Measure(opt.iterations, [&] { store.Build(loaded, opt.threads); });
+        std::vector<Bounds> brushBounds, storeBounds;
+        Phase brushWalk = Measure(opt.iterations, [&] { BrushBounds(loaded, brushBounds); });
+        Phase storeWalk = Measure(opt.iterations, [&] { StoreBounds(store, storeBounds); });
+        std::vector<Bounds> cachedBounds;
+        CachedBounds(loaded, cachedBounds); // First read fills the cache
+        Phase cachedRead = Measure(opt.iterations, [&] { CachedBounds(loaded, cachedBounds); });
+        
+        // Undo: one brush moved per step, recorded as a delta, against the
+        // full-map snapshot each step used to take
+        Phase snapshot = Measure(opt.iterations, [&] { PCD::Map copy = loaded; });
+        PCD::UndoHistory history;
+        const int undoSteps = 50;
+        Phase undoRecord = Measure(1, [&] {
+            for (int i = 0; i < undoSteps; i++) {
+                size_t index = (size_t(i) * 7919) % loaded.brushes.size();
+                history.Begin(loaded);
+                history.TouchBrush(loaded, index);
+                for (auto& v : loaded.brushes[index].vertices) v.position.x += 1.0f;
+            }
+            history.Commit(loaded);
+        });
+        size_t undoBytes = history.MemoryUsed();
+        Phase undoReplay = Measure(1, [&] { while (history.Undo(loaded)) {} });
+        
+        // Picking: rays aimed down at random brushes through the tree,
+        // against testing every triangle of the map
+        std::vector<std::pair<PCD::Vec3, PCD::Vec3>> rays(1000);
+        uint64_t rng = opt.seed;
+        auto next = [&rng] { rng = rng * 6364136223846793005ull + 1442695040888963407ull; return uint32_t(rng >> 33); };
+        for (auto& [origin, dir] : rays) {
+            PCD::Vec3 target = loaded.brushes[next() % loaded.brushes.size()].GetBounds().center;
+            origin = target + PCD::Vec3(float(next() % 200) * 0.1f - 10.0f, 40.0f, float(next() % 200) * 0.1f - 10.0f);
+            dir = (target - origin).Normalized();
+        }
+        PCD::PickTree pickTree;
+        Phase pickBuild = Measure(opt.iterations, [&] {
+            pickTree.Invalidate();
+            pickTree.Raycast(loaded, rays[0].first, rays[0].second);
+        });
+        std::vector<PCD::PickTree::Hit> hits(rays.size());
+        Phase pickQuery = Measure(opt.iterations, [&] {
+            for (size_t i = 0; i < rays.size(); i++) hits[i] = pickTree.Raycast(loaded, rays[i].first, rays[i].second);
+        });
+        const size_t bruteRays = 10;
+        Phase pickBrute = Measure(1, [&] {
+            for (size_t i = 0; i < bruteRays; i++) {
+                int index;
+                BruteForcePick(loaded, rays[i].first, rays[i].second, index);
+            }
+        });
+        Phase pickRefit = Measure(1, [&] {
+            for (size_t i = 0; i < 100; i++) {
+                size_t index = (i * 7919) % loaded.brushes.size();
+                PCD::Brush& brush = loaded.brushes[index];
+                PCD::Vec3 delta(0.5f, 0.0f, 0.0f);
+                for (auto& v : brush.vertices) v.position = v.position + delta;
+                brush.TranslateBounds(delta);
+                pickTree.MarkBrush(brush.id);
+                pickTree.Raycast(loaded, rays[i].first, rays[i].second);
+            }
+        });
+        
+        // Marquee: the left half of a top-down orthographic view of the map
+        PCD::Vec3 lo = loaded.brushes[0].GetBounds().min, hi = loaded.brushes[0].GetBounds().max;
+        for (const auto& brush : loaded.brushes) {
+            const PCD::BrushBounds& b = brush.GetBounds();
+            lo = PCD::Vec3(std::min(lo.x, b.min.x), std::min(lo.y, b.min.y), std::min(lo.z, b.min.z));
+            hi = PCD::Vec3(std::max(hi.x, b.max.x), std::max(hi.y, b.max.y), std::max(hi.z, b.max.z));
+        }
+        PCD::Vec3 c = (lo + hi) * 0.5f, h = (hi - lo) * 0.5f + PCD::Vec3(2, 2, 2);
+        float topDown[16] = {1 / h.x, 0, 0, 0,  0, 0, 1 / h.y, 0,  0, 1 / h.z, 0, 0,
+                             -c.x / h.x, -c.z / h.z, -c.y / h.y, 1};
+        PCD::Frustum half = PCD::Frustum::FromViewProjection(topDown, -1, 0, -1, 1);
+        std::vector<int> marqueeBrushes, marqueeEntities;
+        Phase marquee = Measure(opt.iterations, [&] {
+            pickTree.QueryFrustum(loaded, half, marqueeBrushes, marqueeEntities);
+        });
+        
+        // Selection: the marquee result as a selection set, shift-click
+        // toggles on it and on the std::vector + std::find it replaces, and
+        // the per-brush highlight test the renderer makes
+        PCD::SelectionSet selection;
+        Phase selectFill = Measure(opt.iterations, [&] {
+            selection.Clear();
+            for (int index : marqueeBrushes) selection.Add(index, loaded.brushes[index].id);
+        });
+        std::vector<int> toggles(1000);
+        uint32_t seed = 12345;
+        for (int& index : toggles) {
+            seed = seed * 1664525u + 1013904223u;
+            index = static_cast<int>((seed >> 8) % loaded.brushes.size());
+        }
+        Phase setToggle = Measure(1, [&] {
+            for (int index : toggles) selection.Toggle(index, loaded.brushes[index].id);
+            selection.Items();
+        });
+        std::vector<int> selectionList = marqueeBrushes;
+        Phase vectorToggle = Measure(1, [&] {
+            for (int index : toggles) {
+                auto it = std::find(selectionList.begin(), selectionList.end(), index);
+                if (it != selectionList.end()) {
+                    selectionList.erase(it);
+                } else {
+                    selectionList.push_back(index);
+                }
+            }
+        });
+        size_t highlighted = 0;
+        Phase highlight = Measure(opt.iterations, [&] {
+            highlighted = 0;
+            for (size_t i = 0; i < loaded.brushes.size(); i++) highlighted += selection.Contains(static_cast<int>(i));
+        });
+        
+        // Bulk transform: rotating every brush (a drag step after Select
+        // All) with the per-vertex loop the gizmo used, and with the SSE
+        // kernel on one thread and on the pool
+        const float angle = 0.01f;
+        PCD::Vec3 pivot = c;
+        std::vector<PCD::Brush> scalarBrushes = loaded.brushes;
+        Phase transformScalar = Measure(1, [&] {
+            float cosA = std::cos(angle), sinA = std::sin(angle);
+            for (auto& brush : scalarBrushes) {
+                for (auto& v : brush.vertices) {
+                    float relX = v.position.x - pivot.x, relZ = v.position.z - pivot.z;
+                    v.position.x = pivot.x + relX * cosA - relZ * sinA;
+                    v.position.z = pivot.z + relX * sinA + relZ * cosA;
+                    float nx = v.normal.x, nz = v.normal.z;
+                    v.normal.x = nx * cosA - nz * sinA;
+                    v.normal.z = nx * sinA + nz * cosA;
+                }
+                brush.InvalidateBounds();
+            }
+        });
+        std::vector<int> allBrushes(loaded.brushes.size());
+        for (size_t i = 0; i < allBrushes.size(); i++) allBrushes[i] = static_cast<int>(i);
+        PCD::Affine rotation = PCD::Affine::RotationY(angle, pivot);
+        Phase transformSerial = Measure(1, [&] { PCD::TransformBrushes(loaded.brushes, allBrushes, rotation, 1); });
+        Phase transformParallel = Measure(1, [&] {
+            PCD::TransformBrushes(loaded.brushes, allBrushes, rotation, opt.threads);
+        });
+        
+        // Statistics: recounting the whole map, as the editor did after
+        // every edit, against bringing PCD::MapStats up to date after a
+        // drag step that moved 100 brushes. The brushes above moved without
+        // marks, so the stats get a pick tree of their own.
+        auto rescan = [&] {
+            PCD::MapStats::Totals t;
+            t.totalBrushes = loaded.brushes.size();
+            t.totalEntities = loaded.entities.size();
+            t.totalTextures = loaded.textures.size();
+            for (const auto& [id, tex] : loaded.textures) t.textureBytes += tex.DataSize();
+            for (const auto& brush : loaded.brushes) {
+                t.totalVertices += brush.vertices.size();
+                t.totalTriangles += brush.indices.size() / 3;
+                for (int bit = 0; bit < 32; bit++) t.brushesWithFlag[bit] += brush.flags >> bit & 1;
+                if (brush.vertices.empty()) continue;
+                const PCD::BrushBounds& b = brush.GetBounds();
+                t.mapBoundsMin = t.hasBounds ? PCD::Vec3(std::min(t.mapBoundsMin.x, b.min.x),
+                                                         std::min(t.mapBoundsMin.y, b.min.y),
+                                                         std::min(t.mapBoundsMin.z, b.min.z)) : b.min;
+                t.mapBoundsMax = t.hasBounds ? PCD::Vec3(std::max(t.mapBoundsMax.x, b.max.x),
+                                                         std::max(t.mapBoundsMax.y, b.max.y),
+                                                         std::max(t.mapBoundsMax.z, b.max.z)) : b.max;
+                t.hasBounds = true;
+            }
+            return t;
+        };
+        PCD::PickTree statsTree;
+        PCD::MapStats mapStats;
+        Phase statsBuild = Measure(1, [&] { mapStats.Get(loaded, statsTree); });
+        PCD::MapStats::Totals recounted;
+        Phase statsRescan = Measure(opt.iterations, [&] { recounted = rescan(); });
+        Phase statsUpdate = Measure(opt.iterations, [&] {
+            for (size_t i = 0; i < 100; i++) {
+                uint32_t id = loaded.brushes[toggles[i]].id;
+                mapStats.MarkBrush(id);
+                statsTree.MarkBrush(id);
+            }
+            mapStats.Get(loaded, statsTree);
+        });
+        
+        // Culling: the game's view from the middle of the map, looking
+        // along +X with a 90 degree field of view, through a four-wide
+        // tree against testing every brush
+        PCD::Vec3 eye(c.x, lo.y + 2, c.z);
+        float f = 1.0f, aspect = 16.0f / 9.0f, zNear = 0.1f, zFar = 1000.0f;
+        float lookX[16] = {0, 0, -1, 0,  0, 1, 0, 0,  1, 0, 0, 0,  -eye.z, -eye.y, eye.x, 1};
+        float perspective[16] = {f / aspect, 0, 0, 0,  0, f, 0, 0,  0, 0, (zFar + zNear) / (zNear - zFar), -1,
+                                 0, 0, 2 * zFar * zNear / (zNear - zFar), 0};
+        PCD::Frustum view = PCD::Frustum::FromViewAndProjection(lookX, perspective);
+        std::vector<PCD::BrushBounds> cullBounds;
+        for (const auto& brush : loaded.brushes) {
+            PCD::BrushBounds b;
+            b.min = PCD::Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+            b.max = PCD::Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            cullBounds.push_back(brush.vertices.empty() ? b : brush.GetBounds());
+        }
+        PCD::CullTree cullTree;
+        Phase cullBuild = Measure(1, [&] { cullTree.Build(cullBounds); });
+        std::vector<int> visible;
+        Phase cullQuery = Measure(opt.iterations, [&] { cullTree.Query(view, visible); });
+        std::vector<int> visibleBrute;
+        Phase cullBrute = Measure(opt.iterations, [&] {
+            visibleBrute.clear();
+            for (size_t i = 0; i < cullBounds.size(); i++) {
+                if (loaded.brushes[i].vertices.empty()) continue;
+                if (view.Classify(cullBounds[i].min, cullBounds[i].max) != PCD::Frustum::OUTSIDE) {
+                    visibleBrute.push_back(static_cast<int>(i));
+                }
+            }
+        });
+        
+        PCD::GeometryReport::Result geo;
+        {
+            QuietStdout quiet;
+            geo = PCD::GeometryReport::Measure(map, opt.precision, opt.threads, opt.iterations);
+        }
+
+        printf("    {\n");
+        printf("      \"brushes\": %zu, \"entities\": %zu, \"textures\": %zu,\n",
+               map.brushes.size(), map.entities.size(), map.textures.size());
+        printf("      \"generate_ms\": %.3f,\n", generate.ms);
+        PrintPhase("save", save, fileBytes, false);
+        PrintPhase("load", load, fileBytes, false);
+        printf("      \"records\": {\"brush_bytes\": %llu, \"entity_bytes\": %llu,\n",
+               (unsigned long long)schemaBrushes.bytes, (unsigned long long)schemaEntities.bytes);
+        printf("        \"brush_encode_mb_per_s\": {\"schema\": %.1f, \"handwritten\": %.1f}, "
+               "\"brush_decode_mb_per_s\": {\"schema\": %.1f, \"handwritten\": %.1f},\n",
+               MBps(schemaBrushes.bytes, schemaBrushes.encode.ms), MBps(handBrushes.bytes, handBrushes.encode.ms),
+               MBps(schemaBrushes.bytes, schemaBrushes.decode.ms), MBps(handBrushes.bytes, handBrushes.decode.ms));
+        printf("        \"entity_encode_mb_per_s\": {\"schema\": %.1f, \"handwritten\": %.1f}, "
+               "\"entity_decode_mb_per_s\": {\"schema\": %.1f, \"handwritten\": %.1f}},\n",
+               MBps(schemaEntities.bytes, schemaEntities.encode.ms), MBps(handEntities.bytes, handEntities.encode.ms),
+               MBps(schemaEntities.bytes, schemaEntities.decode.ms), MBps(handEntities.bytes, handEntities.decode.ms));
+        printf("      \"store\": {\"build_ms\": %.3f, \"build_allocations\": %llu, "
+               "\"brush_walk_ms\": %.3f, \"store_walk_ms\": %.3f, \"cached_bounds_ms\": %.3f},\n",
+               storeBuild.ms, (unsigned long long)storeBuild.allocations, brushWalk.ms, storeWalk.ms,
+               cachedRead.ms);
+        printf("      \"pick\": {\"build_ms\": %.3f, \"query_ms\": %.4f, \"brute_force_ms\": %.3f, "
+               "\"refit_query_ms\": %.4f, \"marquee_ms\": %.3f, \"marquee_selected\": %zu, "
+               "\"tree_height\": %d},\n",
+               pickBuild.ms, pickQuery.ms / rays.size(), pickBrute.ms / bruteRays, pickRefit.ms / 100,
+               marquee.ms, marqueeBrushes.size() + marqueeEntities.size(), pickTree.Height());
+        printf("      \"selection\": {\"fill_ms\": %.3f, \"toggle_us\": %.3f, \"vector_toggle_us\": %.3f, "
+               "\"highlight_pass_ms\": %.3f, \"selected\": %zu},\n",
+               selectFill.ms, setToggle.ms * 1000 / toggles.size(), vectorToggle.ms * 1000 / toggles.size(),
+               highlight.ms, selection.Size());
+        printf("      \"transform\": {\"per_vertex_ms\": %.3f, \"bulk_ms\": %.3f, \"bulk_parallel_ms\": %.3f},\n",
+               transformScalar.ms, transformSerial.ms, transformParallel.ms);
+        printf("      \"stats\": {\"build_ms\": %.3f, \"rescan_ms\": %.3f, \"update_ms\": %.4f},\n",
+               statsBuild.ms, statsRescan.ms, statsUpdate.ms);
+        printf("      \"cull\": {\"build_ms\": %.3f, \"query_ms\": %.4f, \"brute_force_ms\": %.3f, "
+               "\"visible\": %zu},\n",
+               cullBuild.ms, cullQuery.ms, cullBrute.ms, visible.size());
+        printf("      \"undo\": {\"snapshot_ms\": %.3f, \"snapshot_bytes\": %llu, \"step_ms\": %.4f, "
+               "\"step_bytes\": %llu, \"undo_ms\": %.4f},\n",
+               snapshot.ms, (unsigned long long)snapshot.allocatedBytes, undoRecord.ms / undoSteps,
+               (unsigned long long)(undoBytes / undoSteps), undoReplay.ms / undoSteps);
+        printf("      \"geometry\": {\"raw_file_bytes\": %llu, \"packed_file_bytes\": %llu, "
+               "\"raw_geometry_bytes\": %llu, \"packed_geometry_bytes\": %llu, "
+               "\"raw_load_ms\": %.3f, \"packed_load_ms\": %.3f, "
+               "\"max_position_error\": %g, \"max_normal_error\": %g, \"max_uv_error\": %g}\n",
+               (unsigned long long)geo.rawFileBytes, (unsigned long long)geo.packedFileBytes,
+               (unsigned long long)geo.rawGeometryBytes, (unsigned long long)geo.packedGeometryBytes,
+               geo.rawLoadMs, geo.packedLoadMs, geo.error.position, geo.error.normal, geo.error.uv);
+        printf("    }%s\n", run + 1 < opt.brushCounts.size() ? "," : "");
+        fflush(stdout);
+
+        std::remove(path.c_str());
+    }
+
+    printf("  ]\n}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// pcd_test_util.h - Helpers shared by test_pcd and pcd_bench
+#ifndef PCD_TEST_UTIL_H
+#define PCD_TEST_UTIL_H
+
+#include "PCD/PCDTypes.h"
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+namespace PCDTest {
+
+// The PCD reader/writer log every save and load to std::cout, which would
+// bury test failures and corrupt the benchmark's JSON
+class QuietStdout {
+public:
+    QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietStdout() { std::cout.rdbuf(saved); }
+private:
+    std::ostringstream sink;
+    std::streambuf* saved;
+};
+
+// Nearest triangle hit by testing every brush, what picking would cost
+// without the tree. Same Moller-Trumbore test as PickTree; test_pcd checks
+// the two agree.
+inline float BruteForcePick(const PCD::Map& map, const PCD::Vec3& origin, const PCD::Vec3& dir, int& index) {
+    auto cross = [](const PCD::Vec3& a, const PCD::Vec3& b) {
+        return PCD::Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    };
+    auto dot = [](const PCD::Vec3& a, const PCD::Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+    float best = FLT_MAX;
+    index = -1;
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        const PCD::Brush& brush = map.brushes[i];
+        for (size_t k = 0; k + 2 < brush.indices.size(); k += 3) {
+            const PCD::Vec3& a = brush.vertices[brush.indices[k]].position;
+            PCD::Vec3 e1 = brush.vertices[brush.indices[k + 1]].position - a;
+            PCD::Vec3 e2 = brush.vertices[brush.indices[k + 2]].position - a;
+            PCD::Vec3 p = cross(dir, e2);
+            float det = dot(e1, p);
+            if (std::fabs(det) < 1e-12f) continue;
+            float invDet = 1.0f / det;
+            PCD::Vec3 s = origin - a;
+            float u = dot(s, p) * invDet;
+            if (u < 0.0f || u > 1.0f) continue;
+            PCD::Vec3 q = cross(s, e1);
+            float v = dot(dir, q) * invDet;
+            if (v < 0.0f || u + v > 1.0f) continue;
+            float t = dot(e2, q) * invDet;
+            if (t >= 0.0f && t < best) {
+                best = t;
+                index = static_cast<int>(i);
+            }
+        }
+    }
+    return best;
+}
+
+} // namespace PCDTest
+
+#endif // PCD_TEST_UTIL_H
@@ -0,0 +1,915 @@
+// test_pcd.cpp - Correctness checks for the PCD map code
+//
+// Runs deterministic synthetic maps through save/load, texture compression
+// and deduplication, entity properties and indices, diff/patch, the
+// autosave journal, undo, packed geometry, picking, selection, transforms,
+// statistics and culling, comparing each against a plain reference. Prints
+// one line per failed check and exits non-zero if any failed; pcd_bench
+// has the timings.
+
+#include "PCD/PCDFile.h"
+#include "PCD/PCDSyntheticMap.h"
+#include "PCD/PCDTextureCompression.h"
+#include "PCD/PCDGeometryReport.h"
+#include "PCD/PCDSchema.h"
+#include "PCD/PCDMapGeometry.h"
+#include "PCD/PCDDiff.h"
+#include "PCD/PCDJournal.h"
+#include "PCD/PCDUndo.h"
+#include "PCD/PCDPickTree.h"
+#include "PCD/PCDSelection.h"
+#include "PCD/PCDTransform.h"
+#include "PCD/PCDMapStats.h"
+#include "PCD/PCDCullTree.h"
+#include "pcd_test_util.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using PCDTest::BruteForcePick;
+using PCDTest::QuietStdout;
+
+int g_failures = 0;
+
+void Check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        g_failures++;
+    }
+}
+
+PCD::Map TestMap(uint32_t brushes, uint64_t seed = 1) {
+    PCD::SyntheticMap::Params params;
+    params.brushCount = brushes;
+    params.entityCount = brushes / 20;
+    params.textureCount = 4;
+    params.textureSize = 64;
+    params.seed = seed;
+    return PCD::SyntheticMap::Generate(params);
+}
+
+void MoveBrush(PCD::Brush& brush, const PCD::Vec3& delta) {
+    for (auto& v : brush.vertices) v.position = v.position + delta;
+    brush.TranslateBounds(delta);
+}
+
+bool SameVec(const PCD::Vec3& a, const PCD::Vec3& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+void TestFile(const std::string& dir) {
+    PCD::Map map = TestMap(2000);
+    uint64_t revision = PCD::MapRevision(map);
+    std::string path = dir + "/file.pcd";
+
+    for (unsigned threads : {1u, 4u}) {
+        PCD::SaveOptions saveOptions;
+        saveOptions.threads = threads;
+        PCD::LoadOptions loadOptions;
+        loadOptions.threads = threads;
+        PCD::Map loaded;
+        Check(PCD::PCDWriter::Save(map, path, saveOptions), "save");
+        Check(PCD::PCDReader::Load(loaded, path, loadOptions), "load");
+        Check(PCD::MapRevision(loaded) == revision, "round trip keeps the map");
+    }
+
+    // Threading must not change a single byte of the image
+    for (bool pack : {false, true}) {
+        std::vector<uint8_t> reference;
+        for (unsigned threads : {1u, 4u, 0u}) {
+            PCD::SaveOptions options;
+            options.threads = threads;
+            options.packGeometry = pack;
+            std::vector<uint8_t> image;
+            Check(PCD::PCDWriter::Serialize(map, image, options), "serialize");
+            if (threads == 1) reference = std::move(image);
+            else Check(image == reference, "threaded serialize matches single-threaded bytes");
+        }
+    }
+
+    PCD::LoadOptions deferred;
+    deferred.deferTextures = true;
+    PCD::Map lazy;
+    Check(PCD::PCDReader::Load(lazy, path, deferred), "deferred load");
+    Check(PCD::MapRevision(lazy) == revision, "deferred textures read the same pixels");
+
+    // The target can't be replaced by a file; lazy must keep its pixels
+    std::string blocked = dir + "/blocked.pcd";
+    std::filesystem::create_directories(blocked + "/inside");
+    Check(!PCD::PCDWriter::Save(lazy, blocked), "save over a directory fails");
+    Check(!std::filesystem::exists(blocked + ".tmp"), "failed save leaves no temp file");
+    Check(PCD::MapRevision(lazy) == revision, "failed save keeps deferred pixels");
+    Check(PCD::PCDWriter::Save(lazy, path), "save over the deferred source");
+    Check(PCD::MapRevision(lazy) == revision, "deferred pixels survive saving over their source");
+
+    PCD::GeometryReport::Result geo = PCD::GeometryReport::Measure(map, 1.0f / 1024.0f, 1, 1);
+    Check(geo.withinTolerance, "packed geometry within tolerance");
+
+    std::vector<uint8_t> bytes;
+    for (const auto& brush : map.brushes) PCD::SchemaCodec::Encode(brush, bytes);
+    for (const auto& ent : map.entities) PCD::SchemaCodec::Encode(ent, bytes);
+    PCD::Map decoded = map;
+    PCD::ByteReader in(bytes.data(), bytes.size());
+    bool decodedOk = true;
+    for (auto& brush : decoded.brushes) decodedOk = PCD::SchemaCodec::Decode(in, brush) && decodedOk;
+    for (auto& ent : decoded.entities) decodedOk = PCD::SchemaCodec::Decode(in, ent) && decodedOk;
+    Check(decodedOk && in.ok, "schema records decode");
+    Check(PCD::MapRevision(decoded) == revision, "schema records round trip");
+}
+
+// Smooth RGBA gradients, with an alpha ramp when translucent
+PCD::Texture GradientTexture(uint32_t size, bool translucent) {
+    PCD::Texture tex;
+    tex.name = "gradient";
+    tex.width = tex.height = size;
+    tex.channels = 4;
+    tex.data.resize(size_t(size) * size * 4);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* p = &tex.data[(size_t(y) * size + x) * 4];
+            p[0] = uint8_t(x * 255 / (size - 1));
+            p[1] = uint8_t(y * 255 / (size - 1));
+            p[2] = uint8_t((x + y) * 255 / (2 * (size - 1)));
+            p[3] = translucent ? uint8_t(255 - x * 255 / (size - 1)) : 255;
+        }
+    }
+    return tex;
+}
+
+// Largest per-channel difference between two RGBA8 images
+int MaxError(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int first, int last) {
+    int worst = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = first; c <= last; c++) worst = std::max(worst, std::abs(int(a[i + c]) - int(b[i + c])));
+    }
+    return worst;
+}
+
+void TestTextureCompression() {
+    PCD::Texture opaque = GradientTexture(64, false);
+    PCD::Texture translucent = GradientTexture(64, true);
+    Check(PCD::TextureCompressor::ChooseFormat(opaque) == PCD::TEXFMT_BC1, "opaque texture picks BC1");
+    Check(PCD::TextureCompressor::ChooseFormat(translucent) == PCD::TEXFMT_BC3, "translucent texture picks BC3");
+
+    for (const PCD::Texture& source : {opaque, translucent}) {
+        PCD::TextureFormat format = PCD::TextureCompressor::ChooseFormat(source);
+        PCD::Texture tex = source;
+        Check(PCD::TextureCompressor::Compress(tex, format, 4), "texture compresses");
+        Check(tex.format == format && tex.mipCount == 7, "compressed texture keeps a full mip chain");
+        Check(tex.data.size() == PCD::TextureCompressor::ChainSize(format, 64, 64, 7), "mip chain size");
+
+        std::vector<uint8_t> rgba;
+        Check(PCD::TextureCompressor::Decompress(tex, 0, rgba) && rgba.size() == source.data.size(),
+              "top level decompresses");
+        Check(MaxError(rgba, source.data, 0, 2) <= 16, "block-compressed colors within tolerance");
+        if (format == PCD::TEXFMT_BC3) {
+            Check(MaxError(rgba, source.data, 3, 3) <= 4, "BC3 keeps alpha");
+        } else {
+            Check(MaxError(rgba, source.data, 3, 3) == 0, "BC1 stays opaque");
+        }
+        Check(PCD::TextureCompressor::Decompress(tex, 6, rgba) && rgba.size() == 4, "1x1 level decompresses");
+    }
+}
+
+void TestTextureDedupe() {
+    PCD::Map map = TestMap(400);
+    const PCD::Texture& original = map.textures.begin()->second;
+    uint32_t keep = original.id;
+    PCD::Texture copy = original;
+    copy.id = 1000;
+    copy.name = "copy";
+    PCD::Texture near = original;
+    near.id = 1001;
+    near.data[near.data.size() / 2] ^= 0x01;
+    map.textures[copy.id] = copy;
+    map.textures[near.id] = near;
+    map.InvalidateTextureIndex();
+
+    size_t onCopy = 0, onNear = 0;
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        if (i % 3 == 1) { map.brushes[i].textureID = copy.id; onCopy++; }
+        if (i % 3 == 2) { map.brushes[i].textureID = near.id; onNear++; }
+    }
+
+    Check(map.AddTexture(copy) == keep, "adding identical pixels returns the existing texture");
+    std::unordered_map<uint32_t, uint32_t> duplicates = map.FindDuplicateTextures();
+    Check(duplicates.size() == 1 && duplicates.count(copy.id) && duplicates[copy.id] == keep,
+          "identical texture maps to the lowest ID");
+
+    PCD::TextureDedupeStats stats = map.DedupeTextures();
+    Check(stats.texturesRemoved == 1 && stats.brushesRemapped == onCopy, "dedupe removes the copy");
+    Check(stats.bytesSaved == copy.data.size(), "dedupe counts the copy's bytes");
+    Check(!map.textures.count(copy.id) && map.textures.count(near.id), "nearly identical texture stays");
+    size_t onKeep = 0, stillNear = 0;
+    bool resolved = true;
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        uint32_t id = map.brushes[i].textureID;
+        if (i % 3 == 1) onKeep += id == keep;
+        if (id == near.id) stillNear++;
+        if (id != 0 && !map.textures.count(id)) resolved = false;
+    }
+    Check(onKeep == onCopy && stillNear == onNear, "brushes point at the surviving texture");
+    Check(resolved, "every brush texture exists after dedupe");
+    Check(map.FindDuplicateTextures().empty(), "nothing left to dedupe");
+}
+
+// Writes map in the PCD2 layout PCDReader::LoadLegacy expects; nothing else
+// writes that format any more
+void WriteLegacyMap(const PCD::Map& map, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    auto u32 = [&file](uint32_t val) { file.write(reinterpret_cast<const char*>(&val), sizeof(val)); };
+    auto f32 = [&file](float val) { file.write(reinterpret_cast<const char*>(&val), sizeof(val)); };
+    auto str = [&](const std::string& text) {
+        u32(static_cast<uint32_t>(text.size()));
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    };
+
+    file.write("PCD2", 4);
+    u32(2);
+    u32(0);
+    u32(static_cast<uint32_t>(map.brushes.size()));
+    u32(static_cast<uint32_t>(map.entities.size()));
+    u32(static_cast<uint32_t>(map.textures.size()));
+    u32(0);
+    u32(0);
+    str(map.name);
+    str(map.author);
+    for (const auto& [id, tex] : map.textures) {
+        u32(id);
+        str(tex.name);
+        u32(tex.width);
+        u32(tex.height);
+        u32(tex.channels);
+        u32(static_cast<uint32_t>(tex.data.size()));
+        file.write(reinterpret_cast<const char*>(tex.data.data()), static_cast<std::streamsize>(tex.data.size()));
+    }
+    for (const auto& brush : map.brushes) {
+        u32(static_cast<uint32_t>(brush.vertices.size()));
+        u32(static_cast<uint32_t>(brush.indices.size() / 3));
+        u32(brush.textureID);
+        u32(brush.flags);
+        for (const auto& v : brush.vertices) { f32(v.position.x); f32(v.position.y); f32(v.position.z); }
+        for (const auto& v : brush.vertices) { f32(v.normal.x); f32(v.normal.y); f32(v.normal.z); }
+        for (const auto& v : brush.vertices) { f32(v.uv.u); f32(v.uv.v); }
+        for (uint32_t index : brush.indices) u32(index);
+        f32(brush.color.x);
+        f32(brush.color.y);
+        f32(brush.color.z);
+        f32(brush.uvScaleX);
+        f32(brush.uvScaleY);
+        f32(brush.uvOffsetX);
+        f32(brush.uvOffsetY);
+        str(brush.name);
+    }
+    for (const auto& ent : map.entities) {
+        u32(static_cast<uint32_t>(ent.type));
+        for (const PCD::Vec3* v : {&ent.position, &ent.rotation, &ent.scale}) { f32(v->x); f32(v->y); f32(v->z); }
+        u32(static_cast<uint32_t>(ent.properties.size()));
+        for (const auto& prop : ent.properties) {
+            str(prop.key.str());
+            str(prop.value.Text());
+        }
+        str(ent.name);
+    }
+}
+
+// Loads a legacy file eagerly and with deferred textures, then checks both
+// survive being re-saved as PCD3
+void CheckLegacyLoad(const std::string& path, const std::string& dir,
+                     size_t brushes, size_t entities, size_t textures) {
+    PCD::Map eager;
+    Check(PCD::PCDReader::Load(eager, path), "legacy map loads");
+    Check(eager.brushes.size() == brushes && eager.entities.size() == entities &&
+          eager.textures.size() == textures, "legacy map keeps its brush, entity and texture counts");
+
+    PCD::LoadOptions deferred;
+    deferred.deferTextures = true;
+    PCD::Map lazy;
+    Check(PCD::PCDReader::Load(lazy, path, deferred), "legacy map loads with deferred textures");
+    bool allDeferred = lazy.textures.size() == textures;
+    for (const auto& [id, tex] : lazy.textures) allDeferred = allDeferred && tex.IsDeferred();
+    Check(allDeferred, "legacy textures stay on disk when deferred");
+    Check(PCD::MapRevision(lazy) == PCD::MapRevision(eager), "deferred legacy textures read the same pixels");
+
+    for (const PCD::Map* map : {&eager, &lazy}) {
+        std::string resaved = dir + "/legacy_resaved.pcd";
+        PCD::Map reloaded;
+        Check(PCD::PCDWriter::Save(*map, resaved), "legacy map saves as PCD3");
+        Check(PCD::PCDReader::Load(reloaded, resaved), "re-saved legacy map loads");
+        Check(PCD::MapRevision(reloaded) == PCD::MapRevision(eager), "legacy map survives re-saving as PCD3");
+    }
+}
+
+void TestLegacy(const std::string& dir, const std::string& maps) {
+    CheckLegacyLoad(maps + "/testing.pcd", dir, 3, 1, 0);
+
+    // The shipped fixtures are all PCD1, which has no textures
+    PCD::Map source;
+    Check(PCD::PCDReader::Load(source, maps + "/testing.pcd"), "PCD1 fixture loads");
+    for (uint32_t id : {1u, 2u}) {
+        PCD::Texture tex = GradientTexture(16, id == 2);
+        tex.id = id;
+        tex.name = "legacy" + std::to_string(id);
+        source.textures[id] = tex;
+    }
+    for (size_t i = 0; i < source.brushes.size(); i++) source.brushes[i].textureID = uint32_t(i % 2 + 1);
+    std::string path = dir + "/legacy.pcd";
+    WriteLegacyMap(source, path);
+    CheckLegacyLoad(path, dir, source.brushes.size(), source.entities.size(), 2);
+
+    PCD::Map loaded;
+    Check(PCD::PCDReader::Load(loaded, path), "PCD2 map loads");
+    Check(loaded.textures.count(1) && loaded.textures[1].data == source.textures[1].data &&
+          loaded.textures.count(2) && loaded.textures[2].data == source.textures[2].data,
+          "PCD2 texture pixels load unchanged");
+}
+
+void TestProperties(const std::string& dir) {
+    using Value = PCD::PropertyValue;
+    Check(Value("42").GetType() == Value::INT && Value("42").AsInt() == 42 && Value("-7").AsFloat() == -7.0f,
+          "integer property parses");
+    Check(Value("-3.5").GetType() == Value::FLOAT && Value("-3.5").AsFloat() == -3.5f && Value("2.9").AsInt() == 2,
+          "float property parses");
+    Value vec("1 2.5 -3");
+    Check(vec.GetType() == Value::VEC3 && SameVec(vec.AsVec3(), PCD::Vec3(1, 2.5f, -3)), "vector property parses");
+    bool strings = true;
+    for (const char* text : {"hello", "1 2", "12abc", "1 2 3 4", ""}) {
+        Value value(text);
+        strings &= value.GetType() == Value::STRING && value.Text() == text && value.AsInt(-1) == -1;
+    }
+    Check(strings, "everything else stays a string");
+    Value reassigned("5");
+    reassigned = "0 0 1";
+    Check(reassigned.GetType() == Value::VEC3 && reassigned.AsInt(9) == 9, "assignment parses again");
+
+    PCD::StringTable table;
+    const std::string* first = table.Intern("info_player_start");
+    Check(table.Intern(std::string("info_player_") + "start") == first && table.Size() == 1,
+          "identical strings share one interned entry");
+    Check(table.Intern("light") != first && table.Size() == 2, "distinct strings get distinct entries");
+    Check(table.Find("trigger") == nullptr && table.Size() == 2, "lookups do not intern");
+    Check(PCD::InternedString("target") == PCD::InternedString(std::string("target")), "interned keys compare equal");
+    Check(PCD::InternedString::Find("test_pcd_never_interned") != PCD::InternedString(), "missing key matches nothing");
+
+    PCD::Map map = TestMap(200);
+    PCD::Entity& ent = map.entities[0];
+    ent.SetInt("health", 25);
+    ent.SetProperty("speed", "1.5");
+    ent.SetProperty("origin_offset", "0 16 -8");
+    ent.SetProperty("message", "Welcome");
+    size_t interned = PCD::StringTable::Shared().Size();
+    ent.name = "test_pcd_unique_name";
+    std::string path = dir + "/properties.pcd";
+    PCD::Map loaded;
+    Check(PCD::PCDWriter::Save(map, path) && PCD::PCDReader::Load(loaded, path), "property map round trip");
+    const PCD::Entity* back = loaded.GetEntity(ent.id);
+    Check(back && back->GetInt("health") == 25 && back->GetFloat("speed") == 1.5f &&
+          SameVec(back->GetVec3("origin_offset"), PCD::Vec3(0, 16, -8)) && back->GetProperty("message") == "Welcome",
+          "typed properties survive a round trip");
+    Check(back && back->FindProperty("speed")->GetType() == Value::FLOAT &&
+          back->FindProperty("message")->GetType() == Value::STRING, "loaded properties parse to the same types");
+    bool sharedKeys = back && back->properties.size() == ent.properties.size();
+    for (size_t i = 0; sharedKeys && i < ent.properties.size(); i++) {
+        sharedKeys = &back->properties[i].key.str() == &ent.properties[i].key.str();
+    }
+    Check(sharedKeys, "loaded keys reuse the interned entries");
+    Check(back && back->name == ent.name, "names survive a round trip");
+    Check(PCD::StringTable::Shared().Size() == interned, "names and known keys intern nothing new");
+}
+
+// The map's kept-up index against one built from scratch, and lookups
+// against scanning the entities
+bool IndexMatches(const PCD::Map& map) {
+    const PCD::EntityIndex& index = map.GetEntityIndex();
+    PCD::EntityIndex fresh;
+    fresh.Build(map.entities);
+    bool match = true;
+    for (size_t i = 0; i < map.entities.size(); i++) {
+        const PCD::Entity& ent = map.entities[i];
+        size_t first = 0;
+        while (map.entities[first].id != ent.id) first++;
+        match &= index.Position(ent.id) == first && map.GetEntity(ent.id) == &map.entities[first];
+        match &= index.Named(ent.name) == fresh.Named(ent.name);
+        match &= index.Targeting(ent.GetProperty("target")) == fresh.Targeting(ent.GetProperty("target"));
+        match &= index.WithTargetName(ent.GetProperty("targetname")) ==
+                 fresh.WithTargetName(ent.GetProperty("targetname"));
+    }
+    for (int type = 0; type <= int(PCD::ENT_CUSTOM); type++) {
+        match &= index.OfType(PCD::EntityType(type)) == fresh.OfType(PCD::EntityType(type));
+    }
+    return match && index.FirstSpawn() == fresh.FirstSpawn();
+}
+
+void TestEntityIndex() {
+    PCD::Map map = TestMap(2000);
+    for (size_t i = 0; i < map.entities.size(); i += 4) map.entities[i].SetProperty("targetname", "door");
+    map.entities[1].SetProperty("target", "door");
+    Check(IndexMatches(map), "entity index matches the entities");
+
+    PCD::Entity spawn;
+    spawn.id = 0xFFFFFF00u;
+    spawn.type = PCD::ENT_INFO_PLAYER_DEATHMATCH;
+    spawn.name = "spawn_b";
+    spawn.SetProperty("target", "door");
+    map.AddEntity(spawn);
+    Check(IndexMatches(map), "index follows AddEntity");
+
+    // A duplicate ID loses to the earlier entity; removing it must still
+    // move every later entity down
+    PCD::Entity duplicate = map.entities[3];
+    duplicate.name = "duplicate";
+    map.AddEntity(duplicate);
+    size_t duplicateIndex = map.entities.size() - 1;
+    PCD::Entity after;
+    after.id = 0xFFFFFF01u;
+    after.type = PCD::ENT_LIGHT;
+    map.AddEntity(after);
+    Check(IndexMatches(map), "duplicate ID keeps the earlier entity");
+    map.RemoveEntity(duplicateIndex);
+    Check(IndexMatches(map) && map.GetEntity(after.id) == &map.entities.back(),
+          "removing a duplicate-ID entity keeps later positions");
+
+    // Removing the holder hands its ID to the next entity with that ID
+    map.AddEntity(duplicate);
+    map.RemoveEntity(3);
+    Check(IndexMatches(map) && map.GetEntity(duplicate.id)->name == "duplicate",
+          "removing an ID's holder hands the ID on");
+
+    PCD::Entity& edited = map.entities[5];
+    edited.type = PCD::ENT_INFO_PLAYER_START;
+    edited.name = "renamed";
+    edited.SetProperty("targetname", "gate");
+    map.EntityChanged(5);
+    Check(IndexMatches(map) && map.GetEntityIndex().Named("renamed").size() == 1, "index follows EntityChanged");
+
+    map.RemoveEntity(0);
+    Check(IndexMatches(map), "index follows removing the first entity");
+}
+
+void TestDiff() {
+    PCD::Map base = TestMap(2000);
+    PCD::Map target = base;
+    MoveBrush(target.brushes[5], PCD::Vec3(1, 0, 0));
+    target.brushes.push_back(PCD::BrushFactory::CreateBox(target, {0, 0, 0}, {1, 1, 1}));
+    target.brushes.erase(target.brushes.begin() + 100);
+    std::swap(target.brushes[0], target.brushes[10]);
+    target.entities[3].SetProperty("foo", "bar");
+    target.entities.erase(target.entities.begin());
+    PCD::Texture tex;
+    tex.name = "patched";
+    tex.width = tex.height = 4;
+    tex.data.assign(64, 7);
+    target.AddTexture(tex);
+    target.textures.erase(1u);
+    target.name = "renamed";
+
+    std::vector<uint8_t> delta;
+    PCD::Diff(base, target, delta, 0);
+    PCD::Map patched = base;
+    Check(PCD::Patch(patched, delta.data(), delta.size()), "patch applies to its base");
+    Check(PCD::MapRevision(patched) == PCD::MapRevision(target), "patch reproduces the target");
+    Check(!PCD::Patch(patched, delta.data(), delta.size()), "patch rejects the wrong base");
+    Check(PCD::MapRevision(patched) == PCD::MapRevision(target), "rejected patch leaves the map alone");
+
+    PCD::Map corrupt = base;
+    delta[delta.size() / 2] ^= 0x55;
+    Check(!PCD::Patch(corrupt, delta.data(), delta.size()), "patch rejects a corrupt delta");
+}
+
+void TestJournal(const std::string& dir) {
+    PCD::Map map = TestMap(2000);
+    std::string base = dir + "/journal.pcd";
+    std::string path = base + ".journal";
+    PCD::PCDWriter::Save(map, base);
+
+    PCD::MapJournal journal;
+    Check(journal.Start(path, base, map, 0), "journal starts");
+    Check(journal.Checkpoint(map, 0).bytes == 0, "unchanged map writes nothing");
+    MoveBrush(map.brushes[5], PCD::Vec3(1, 0, 0));
+    PCD::DiffStats moved = journal.Checkpoint(map, 0);
+    Check(moved.brushesWritten == 1, "one moved brush writes one brush");
+    map.brushes.erase(map.brushes.begin() + 100);
+    map.entities[3].SetProperty("foo", "bar");
+    map.name = "renamed";
+    journal.Checkpoint(map, 0);
+
+    PCD::Map replayed;
+    PCD::MapJournal::ReplayResult result;
+    Check(PCD::MapJournal::Replay(path, replayed, PCD::LoadOptions(), &result), "journal replays");
+    Check(result.checkpoints == 2, "journal holds both checkpoints");
+    Check(PCD::MapRevision(replayed) == PCD::MapRevision(map), "replay reaches the last checkpoint");
+
+    // A crash mid-write leaves a torn batch; replay stops at the one before
+    uint64_t intact = journal.Size();
+    uint64_t intactRevision = PCD::MapRevision(map);
+    MoveBrush(map.brushes[7], PCD::Vec3(0, 1, 0));
+    journal.Checkpoint(map, 0);
+    journal.Close();
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+    Check(PCD::MapJournal::Replay(path, replayed, PCD::LoadOptions(), &result), "torn journal replays");
+    Check(result.validBytes == intact, "torn batch is dropped");
+    Check(PCD::MapRevision(replayed) == intactRevision, "torn journal recovers the last intact checkpoint");
+
+    PCD::MapJournal recovered;
+    PCD::Map restored;
+    Check(recovered.Recover(path, restored), "journal recovers");
+    Check(PCD::MapRevision(restored) == intactRevision, "recovered map is the last intact checkpoint");
+    Check(recovered.Checkpoint(map, 0).brushesWritten == 1, "recovered journal appends after the torn tail");
+    recovered.Close();
+    Check(PCD::MapJournal::Replay(path, replayed) && PCD::MapRevision(replayed) == PCD::MapRevision(map),
+          "replay after recovery reaches the new checkpoint");
+}
+
+// Checkpoints from a change list, as the editor's autosave takes them
+void TestJournalChanges(const std::string& dir) {
+    PCD::Map map = TestMap(2000);
+    std::string base = dir + "/changes.pcd";
+    std::string path = base + ".journal";
+    PCD::PCDWriter::Save(map, base);
+    PCD::MapJournal journal;
+    journal.Start(path, base, map, 0);
+
+    PCD::MapChanges changes;
+    MoveBrush(map.brushes[5], PCD::Vec3(1, 0, 0));
+    changes.brushes.insert(map.brushes[5].id);
+    map.entities[3].SetProperty("foo", "bar");
+    changes.entities.insert(map.entities[3].id);
+    PCD::Texture& tex = map.textures.begin()->second;
+    tex.data[tex.data.size() / 2 + 1] ^= 0xFF; // A single byte of one pixel
+    changes.textures.insert(tex.id);
+    map.brushes.push_back(PCD::BrushFactory::CreateBox(map, {0, 0, 0}, {1, 1, 1}));
+    map.brushes.erase(map.brushes.begin() + 100);
+    std::swap(map.entities[0], map.entities[1]);
+    PCD::DiffStats stats = journal.Checkpoint(map, changes, 0);
+    Check(stats.brushesWritten == 2 && stats.brushesRemoved == 1, "change list writes marked and new brushes");
+    Check(stats.entitiesWritten == 1 && stats.texturesWritten == 1, "change list writes marked entities and textures");
+
+    changes.Clear();
+    Check(journal.Checkpoint(map, changes, 0).bytes == 0, "empty change list writes nothing");
+    changes.brushes.insert(map.brushes[7].id);
+    Check(journal.Checkpoint(map, changes, 0).bytes == 0, "marked but unchanged brush writes nothing");
+
+    // A deferred texture whose source cannot be read is retried until written
+    PCD::Map lazy;
+    PCD::LoadOptions deferred;
+    deferred.deferTextures = true;
+    PCD::PCDReader::Load(lazy, base, deferred);
+    PCD::Texture added = lazy.textures.begin()->second;
+    std::string source = added.source.path;
+    added.id = 0xFFFF0000u;
+    added.source.path = dir + "/missing.pcd";
+    map.textures[added.id] = added;
+    changes.Clear();
+    stats = journal.Checkpoint(map, changes, 0);
+    Check(stats.texturesUnreadable == 1 && stats.texturesWritten == 0, "unreadable texture is counted, not written");
+    map.textures[added.id].source.path = source;
+    stats = journal.Checkpoint(map, changes, 0);
+    Check(stats.texturesUnreadable == 0 && stats.texturesWritten == 1, "unreadable texture is retried");
+
+    journal.Close();
+    PCD::Map replayed;
+    Check(PCD::MapJournal::Replay(path, replayed) && PCD::MapRevision(replayed) == PCD::MapRevision(map),
+          "change list checkpoints replay to the edited map");
+}
+
+void TestUndo() {
+    PCD::Map map = TestMap(2000);
+    std::vector<uint64_t> revisions = {PCD::MapRevision(map)};
+    PCD::UndoHistory history;
+    for (int i = 0; i < 20; i++) {
+        size_t index = (size_t(i) * 7919) % map.brushes.size();
+        history.Begin(map);
+        if (i % 5 == 4) {
+            history.TouchAll(map);
+            map.brushes.erase(map.brushes.begin() + index);
+            map.entities.pop_back();
+        } else {
+            history.TouchBrush(map, index);
+            MoveBrush(map.brushes[index], PCD::Vec3(1, 0, 0));
+        }
+        history.Commit(map);
+        revisions.push_back(PCD::MapRevision(map));
+    }
+    bool undone = true;
+    for (size_t i = revisions.size() - 1; i > 0; i--) {
+        undone &= history.Undo(map) && PCD::MapRevision(map) == revisions[i - 1];
+    }
+    Check(undone && !history.CanUndo(), "undo restores every earlier state");
+    bool redone = true;
+    for (size_t i = 1; i < revisions.size(); i++) {
+        redone &= history.Redo(map) && PCD::MapRevision(map) == revisions[i];
+    }
+    Check(redone && !history.CanRedo(), "redo restores every later state");
+}
+
+void TestBounds() {
+    PCD::Map map = TestMap(2000);
+    bool cachedMatch = true;
+    for (const PCD::Brush& brush : map.brushes) {
+        if (brush.vertices.empty()) continue;
+        PCD::Vec3 lo = brush.vertices[0].position, hi = lo;
+        for (const auto& v : brush.vertices) {
+            lo = PCD::Vec3(std::min(lo.x, v.position.x), std::min(lo.y, v.position.y), std::min(lo.z, v.position.z));
+            hi = PCD::Vec3(std::max(hi.x, v.position.x), std::max(hi.y, v.position.y), std::max(hi.z, v.position.z));
+        }
+        const PCD::BrushBounds& cached = brush.GetBounds();
+        cachedMatch &= SameVec(cached.min, lo) && SameVec(cached.max, hi);
+    }
+    Check(cachedMatch, "cached brush bounds match the vertices");
+}
+
+// The store's copy of a brush, read back through Extract
+bool StoreHolds(const PCD::MapGeometry& store, const PCD::Brush& brush) {
+    PCD::Brush extracted;
+    if (!store.Extract(brush.id, extracted)) return false;
+    if (extracted.indices != brush.indices || extracted.vertices.size() != brush.vertices.size()) return false;
+    for (size_t i = 0; i < brush.vertices.size(); i++) {
+        const PCD::Vertex& a = extracted.vertices[i];
+        const PCD::Vertex& b = brush.vertices[i];
+        if (!SameVec(a.position, b.position) || !SameVec(a.normal, b.normal) || a.uv.u != b.uv.u ||
+            a.uv.v != b.uv.v) return false;
+    }
+    return true;
+}
+
+bool StoreMatches(const PCD::MapGeometry& store, const PCD::Map& map) {
+    if (store.BrushCount() != map.brushes.size()) return false;
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        if (store.Ranges()[i].brushID != map.brushes[i].id || !StoreHolds(store, map.brushes[i])) return false;
+    }
+    return true;
+}
+
+void TestMapGeometry() {
+    PCD::Map map = TestMap(2000);
+    // Scattered 32-bit IDs, so removals shift entries of long probe runs
+    for (size_t i = 0; i < map.brushes.size(); i++) map.brushes[i].id = uint32_t(i + 1) * 2654435761u;
+    PCD::MapGeometry store;
+    store.Build(map, 0);
+    Check(StoreMatches(store, map), "MapGeometry holds every brush's geometry");
+    bool spansMatch = true;
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        size_t j = 0;
+        for (const auto& v : store.Vertices(store.Ranges()[i])) {
+            spansMatch &= SameVec(v.position, map.brushes[i].vertices[j++].position);
+        }
+        spansMatch &= j == map.brushes[i].vertices.size();
+    }
+    Check(spansMatch, "vertex spans iterate like Brush::vertices");
+
+    // Same counts are written in place; other counts move the brush to the end
+    size_t before = store.Positions().size();
+    MoveBrush(map.brushes[10], PCD::Vec3(0, 1, 0));
+    store.Set(map.brushes[10]);
+    Check(store.Positions().size() == before && StoreHolds(store, map.brushes[10]), "same-size Set writes in place");
+    PCD::Brush& grown = map.brushes[20];
+    grown.vertices.push_back(grown.vertices[0]);
+    grown.indices.insert(grown.indices.end(), {0, 1, uint32_t(grown.vertices.size() - 1)});
+    store.Set(grown);
+    const PCD::MapGeometry::Range* moved = store.Find(grown.id);
+    Check(moved && moved->firstVertex + moved->vertexCount == store.Positions().size(),
+          "resized Set moves the brush to the end");
+    Check(store.VertexCount() == store.Positions().size() - (grown.vertices.size() - 1),
+          "resized Set leaves a hole");
+    Check(StoreMatches(store, map), "resized Set keeps every brush");
+
+    // Removing every other brush shifts the ID table; the rest keep their order
+    std::vector<uint32_t> removed;
+    for (size_t i = 0; i < map.brushes.size(); i += 2) removed.push_back(map.brushes[i].id);
+    bool removes = true;
+    for (uint32_t id : removed) removes &= store.Remove(id);
+    map.brushes.erase(std::remove_if(map.brushes.begin(), map.brushes.end(), [&](const PCD::Brush& brush) {
+        return std::find(removed.begin(), removed.end(), brush.id) != removed.end();
+    }), map.brushes.end());
+    bool gone = !store.Remove(removed[0]);
+    for (uint32_t id : removed) gone &= store.Find(id) == nullptr;
+    Check(removes && gone, "removed brushes are gone");
+    Check(StoreMatches(store, map), "remaining brushes are found after removals");
+    Check(store.Positions().size() < before, "removals compact once holes outweigh the data");
+
+    store.Set(map.brushes[0]);
+    map.brushes[1].vertices.pop_back();
+    map.brushes[1].indices.resize(map.brushes[1].indices.size() / 2);
+    store.Set(map.brushes[1]);
+    Check(store.VertexCount() < store.Positions().size(), "hole before compaction");
+    store.Compact();
+    Check(store.VertexCount() == store.Positions().size() && store.IndexCount() == store.IndexStream().size(),
+          "compaction removes the holes");
+    Check(StoreMatches(store, map), "compaction keeps every brush in order");
+
+    // The slot table on its own, where nothing re-adds entries after an erase
+    PCD::IDTable<uint32_t> table;
+    for (uint32_t i = 1; i <= 1000; i++) table[i * 2654435761u] = i;
+    for (uint32_t i = 1; i <= 1000; i += 2) table.Erase(i * 2654435761u);
+    bool found = table.Size() == 500;
+    for (uint32_t i = 1; i <= 1000; i++) {
+        const uint32_t* value = table.Find(i * 2654435761u);
+        found &= i % 2 ? value == nullptr : value && *value == i;
+    }
+    Check(found, "ID table erase keeps every other entry reachable");
+}
+
+void TestPickAndSelect() {
+    PCD::Map map = TestMap(2000);
+    uint64_t rng = 7;
+    auto next = [&rng] { rng = rng * 6364136223846793005ull + 1442695040888963407ull; return uint32_t(rng >> 33); };
+
+    PCD::PickTree tree;
+    bool pickMatch = true;
+    for (int i = 0; i < 50; i++) {
+        if (i == 25) {
+            // Refit after edits
+            for (size_t k = 0; k < 50; k++) {
+                PCD::Brush& brush = map.brushes[(k * 7919) % map.brushes.size()];
+                MoveBrush(brush, PCD::Vec3(0.5f, 0, 0));
+                tree.MarkBrush(brush.id);
+            }
+        }
+        PCD::Vec3 target = map.brushes[next() % map.brushes.size()].GetBounds().center;
+        PCD::Vec3 origin = target + PCD::Vec3(float(next() % 200) * 0.1f - 10.0f, 40.0f, float(next() % 200) * 0.1f - 10.0f);
+        PCD::Vec3 dir = (target - origin).Normalized();
+        PCD::PickTree::Hit hit = tree.Raycast(map, origin, dir);
+        int index;
+        float t = BruteForcePick(map, origin, dir, index);
+        // An entity box may sit in front of the nearest brush
+        switch (hit.kind) {
+        case PCD::PickTree::Kind::BRUSH: pickMatch &= hit.distance == t; break;
+        case PCD::PickTree::Kind::ENTITY: pickMatch &= hit.distance <= t; break;
+        default: pickMatch &= index == -1; break;
+        }
+    }
+    Check(pickMatch, "pick tree matches testing every triangle");
+
+    // Marquee over the left half of a top-down view
+    PCD::Vec3 lo = map.brushes[0].GetBounds().min, hi = map.brushes[0].GetBounds().max;
+    for (const auto& brush : map.brushes) {
+        const PCD::BrushBounds& b = brush.GetBounds();
+        lo = PCD::Vec3(std::min(lo.x, b.min.x), std::min(lo.y, b.min.y), std::min(lo.z, b.min.z));
+        hi = PCD::Vec3(std::max(hi.x, b.max.x), std::max(hi.y, b.max.y), std::max(hi.z, b.max.z));
+    }
+    PCD::Vec3 c = (lo + hi) * 0.5f, h = (hi - lo) * 0.5f + PCD::Vec3(2, 2, 2);
+    float topDown[16] = {1 / h.x, 0, 0, 0,  0, 0, 1 / h.y, 0,  0, 1 / h.z, 0, 0,
+                         -c.x / h.x, -c.z / h.z, -c.y / h.y, 1};
+    PCD::Frustum half = PCD::Frustum::FromViewProjection(topDown, -1, 0, -1, 1);
+    std::vector<int> marqueeBrushes, marqueeEntities;
+    tree.QueryFrustum(map, half, marqueeBrushes, marqueeEntities);
+    size_t expected = 0;
+    for (const auto& brush : map.brushes) {
+        expected += half.Classify(brush.GetBounds().min, brush.GetBounds().max) != PCD::Frustum::OUTSIDE;
+    }
+    Check(marqueeBrushes.size() == expected && expected > 0, "marquee selects every brush in the box");
+
+    PCD::SelectionSet selection;
+    for (int index : marqueeBrushes) selection.Add(index, map.brushes[index].id);
+    std::vector<int> list = marqueeBrushes;
+    for (int i = 0; i < 500; i++) {
+        int index = static_cast<int>(next() % map.brushes.size());
+        selection.Toggle(index, map.brushes[index].id);
+        auto it = std::find(list.begin(), list.end(), index);
+        if (it != list.end()) {
+            list.erase(it);
+        } else {
+            list.push_back(index);
+        }
+    }
+    std::vector<int> items = selection.Items();
+    std::sort(items.begin(), items.end());
+    std::sort(list.begin(), list.end());
+    size_t highlighted = 0;
+    for (size_t i = 0; i < map.brushes.size(); i++) highlighted += selection.Contains(static_cast<int>(i));
+    Check(items == list && highlighted == list.size(), "selection set matches a plain list");
+}
+
+void TestTransform() {
+    PCD::Map map = TestMap(2000);
+    const float angle = 0.3f;
+    PCD::Vec3 pivot(3, 1, -2);
+    std::vector<PCD::Brush> expected = map.brushes;
+    float cosA = std::cos(angle), sinA = std::sin(angle);
+    for (auto& brush : expected) {
+        for (auto& v : brush.vertices) {
+            float relX = v.position.x - pivot.x, relZ = v.position.z - pivot.z;
+            v.position.x = pivot.x + relX * cosA - relZ * sinA;
+            v.position.z = pivot.z + relX * sinA + relZ * cosA;
+            float nx = v.normal.x, nz = v.normal.z;
+            v.normal.x = nx * cosA - nz * sinA;
+            v.normal.z = nx * sinA + nz * cosA;
+        }
+    }
+    std::vector<int> all(map.brushes.size());
+    for (size_t i = 0; i < all.size(); i++) all[i] = static_cast<int>(i);
+    PCD::TransformBrushes(map.brushes, all, PCD::Affine::RotationY(angle, pivot));
+    float error = 0;
+    bool boundsMatch = true;
+    for (size_t i = 0; i < map.brushes.size(); i++) {
+        for (size_t j = 0; j < map.brushes[i].vertices.size(); j++) {
+            PCD::Vec3 d = map.brushes[i].vertices[j].position - expected[i].vertices[j].position;
+            PCD::Vec3 n = map.brushes[i].vertices[j].normal - expected[i].vertices[j].normal;
+            error = std::max({error, std::fabs(d.x), std::fabs(d.y), std::fabs(d.z),
+                              std::fabs(n.x), std::fabs(n.y), std::fabs(n.z)});
+        }
+        if (map.brushes[i].vertices.empty()) continue;
+        PCD::BrushBounds cached = map.brushes[i].GetBounds();
+        map.brushes[i].InvalidateBounds();
+        boundsMatch &= SameVec(cached.min, map.brushes[i].GetBounds().min) &&
+                       SameVec(cached.max, map.brushes[i].GetBounds().max);
+    }
+    Check(error < 1e-3f, "bulk transform matches the per-vertex loop");
+    Check(boundsMatch, "bulk transform keeps cached bounds current");
+}
+
+void TestStatsAndCull() {
+    PCD::Map map = TestMap(2000);
+    PCD::PickTree tree;
+    PCD::MapStats stats;
+    stats.Get(map, tree);
+    for (size_t i = 0; i < 100; i++) {
+        PCD::Brush& brush = map.brushes[(i * 7919) % map.brushes.size()];
+        MoveBrush(brush, PCD::Vec3(0, 2, 0));
+        if (i % 3 == 0) brush.flags ^= PCD::BRUSH_DETAIL;
+        stats.MarkBrush(brush.id);
+        tree.MarkBrush(brush.id);
+    }
+    map.brushes.erase(map.brushes.begin(), map.brushes.begin() + map.brushes.size() / 10);
+    const PCD::MapStats::Totals& kept = stats.Get(map, tree);
+
+    PCD::MapStats::Totals t;
+    for (const auto& [id, tex] : map.textures) t.textureBytes += tex.DataSize();
+    for (const auto& brush : map.brushes) {
+        t.totalVertices += brush.vertices.size();
+        t.totalTriangles += brush.indices.size() / 3;
+        for (int bit = 0; bit < 32; bit++) t.brushesWithFlag[bit] += brush.flags >> bit & 1;
+        if (brush.vertices.empty()) continue;
+        const PCD::BrushBounds& b = brush.GetBounds();
+        t.mapBoundsMin = t.hasBounds ? PCD::Vec3(std::min(t.mapBoundsMin.x, b.min.x), std::min(t.mapBoundsMin.y, b.min.y),
+                                                 std::min(t.mapBoundsMin.z, b.min.z)) : b.min;
+        t.mapBoundsMax = t.hasBounds ? PCD::Vec3(std::max(t.mapBoundsMax.x, b.max.x), std::max(t.mapBoundsMax.y, b.max.y),
+                                                 std::max(t.mapBoundsMax.z, b.max.z)) : b.max;
+        t.hasBounds = true;
+    }
+    Check(kept.totalBrushes == map.brushes.size() && kept.totalVertices == t.totalVertices &&
+          kept.totalTriangles == t.totalTriangles && kept.textureBytes == t.textureBytes &&
+          std::equal(std::begin(kept.brushesWithFlag), std::end(kept.brushesWithFlag), std::begin(t.brushesWithFlag)),
+          "incremental statistics match a recount");
+    Check(kept.hasBounds == t.hasBounds && SameVec(kept.mapBoundsMin, t.mapBoundsMin) &&
+          SameVec(kept.mapBoundsMax, t.mapBoundsMax), "incremental map bounds match a recount");
+
+    // The game's view from the middle of the map, looking along +X
+    PCD::Vec3 eye = (t.mapBoundsMin + t.mapBoundsMax) * 0.5f;
+    float f = 1.0f, aspect = 16.0f / 9.0f, zNear = 0.1f, zFar = 1000.0f;
+    float lookX[16] = {0, 0, -1, 0,  0, 1, 0, 0,  1, 0, 0, 0,  -eye.z, -eye.y, eye.x, 1};
+    float perspective[16] = {f / aspect, 0, 0, 0,  0, f, 0, 0,  0, 0, (zFar + zNear) / (zNear - zFar), -1,
+                             0, 0, 2 * zFar * zNear / (zNear - zFar), 0};
+    PCD::Frustum view = PCD::Frustum::FromViewAndProjection(lookX, perspective);
+    std::vector<PCD::BrushBounds> bounds;
+    for (const auto& brush : map.brushes) bounds.push_back(brush.GetBounds());
+    PCD::CullTree cull;
+    cull.Build(bounds);
+    std::vector<int> visible, expected;
+    cull.Query(view, visible);
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (view.Classify(bounds[i].min, bounds[i].max) != PCD::Frustum::OUTSIDE) expected.push_back(static_cast<int>(i));
+    }
+    Check(visible == expected && !expected.empty(), "cull tree matches testing every brush");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string maps = argc > 1 ? argv[1] : "Assets/maps";
+    std::string dir = (std::filesystem::temp_directory_path() / "test_pcd").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    {
+        QuietStdout quiet;
+        TestFile(dir);
+        TestTextureCompression();
+        TestTextureDedupe();
+        TestLegacy(dir, maps);
+        TestProperties(dir);
+        TestEntityIndex();
+        TestDiff();
+        TestJournal(dir);
+        TestJournalChanges(dir);
+        TestUndo();
+        TestBounds();
+        TestMapGeometry();
+        TestPickAndSelect();
+        TestTransform();
+        TestStatsAndCull();
+    }
+    std::filesystem::remove_all(dir);
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All PCD checks passed" << std::endl;
+    return 0;
+}